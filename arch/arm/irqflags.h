@@ -34,6 +34,7 @@
  *        Headers
  *----------------------------------------------------------------------------*/
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /*----------------------------------------------------------------------------
@@ -56,6 +57,27 @@ static inline void arch_irq_disable(void)
 	asm("msr cpsr_c, %0" :: "r"(cpsr | 0x80));
 }
 
+static inline uint32_t arch_irq_save(void)
+{
+	uint32_t cpsr;
+	asm volatile("mrs %0, cpsr" : "=r"(cpsr));
+	arch_irq_disable();
+	return cpsr;
+}
+
+static inline void arch_irq_restore(uint32_t flags)
+{
+	if ((flags & 0x80) == 0)
+		arch_irq_enable();
+}
+
+static inline bool arch_irq_is_disabled(void)
+{
+	uint32_t cpsr;
+	asm volatile("mrs %0, cpsr" : "=r"(cpsr));
+	return (cpsr & 0x80) != 0;
+}
+
 #elif defined(CONFIG_ARCH_ARMV7A)
 
 static inline void arch_irq_enable(void)
@@ -68,6 +90,31 @@ static inline void arch_irq_disable(void)
 	asm("cpsid if");
 }
 
+static inline uint32_t arch_irq_save(void)
+{
+	uint32_t cpsr;
+	asm volatile("mrs %0, cpsr" : "=r"(cpsr));
+	arch_irq_disable();
+	return cpsr;
+}
+
+static inline void arch_irq_restore(uint32_t flags)
+{
+	/* arch_irq_disable() masks both IRQ and FIQ: unmask each one only
+	 * if it was unmasked when saved */
+	if ((flags & 0x80) == 0)
+		asm("cpsie i");
+	if ((flags & 0x40) == 0)
+		asm("cpsie f");
+}
+
+static inline bool arch_irq_is_disabled(void)
+{
+	uint32_t cpsr;
+	asm volatile("mrs %0, cpsr" : "=r"(cpsr));
+	return (cpsr & 0x80) != 0;
+}
+
 #elif defined(CONFIG_ARCH_ARMV7M)
 
 static inline void arch_irq_enable(void)
@@ -80,6 +127,27 @@ static inline void arch_irq_disable(void)
 	asm("cpsid i");
 }
 
+static inline uint32_t arch_irq_save(void)
+{
+	uint32_t primask;
+	asm volatile("mrs %0, primask" : "=r"(primask));
+	arch_irq_disable();
+	return primask;
+}
+
+static inline void arch_irq_restore(uint32_t flags)
+{
+	if ((flags & 1) == 0)
+		arch_irq_enable();
+}
+
+static inline bool arch_irq_is_disabled(void)
+{
+	uint32_t primask;
+	asm volatile("mrs %0, primask" : "=r"(primask));
+	return (primask & 1) != 0;
+}
+
 #endif
 
 #endif /* ARM_IRQFLAGS_H_ */
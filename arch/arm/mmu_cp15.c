@@ -42,10 +42,135 @@
 
 #include <assert.h>
 
+/*------------------------------------------------------------------------------ */
+/*         Local functions                                                       */
+/*------------------------------------------------------------------------------ */
+
+/**
+ * \brief Convert memory map attributes to section descriptor attributes
+ */
+static uint32_t _mmu_section_attrs(uint32_t attrs)
+{
+	uint32_t desc = TTB_SECT_DOMAIN(0xf) | TTB_TYPE_SECT;
+
+#if defined(CONFIG_ARCH_ARMV5TE)
+	/* no TEX, XN or read-only for privileged mode on ARM926 */
+	desc |= TTB_SECT_SBO | TTB_SECT_AP_FULL_ACCESS;
+
+	switch (attrs & MEM_TYPE_MASK) {
+	case MEM_STRONGLY_ORDERED:
+		desc |= TTB_SECT_STRONGLY_ORDERED;
+		break;
+	case MEM_DEVICE:
+	case MEM_NORMAL_NC:
+		/* non-cached, buffered */
+		desc |= TTB_SECT_SHAREABLE_DEVICE;
+		break;
+	case MEM_NORMAL_WT:
+		desc |= TTB_SECT_CACHEABLE_WT;
+		break;
+	default:
+		desc |= TTB_SECT_CACHEABLE_WB;
+		break;
+	}
+#elif defined(CONFIG_ARCH_ARMV7A)
+	if (attrs & MEM_READ_ONLY)
+		desc |= TTB_SECT_AP_READ_ONLY;
+	else
+		desc |= TTB_SECT_AP_FULL_ACCESS;
+
+	if (attrs & MEM_EXEC_NEVER)
+		desc |= TTB_SECT_EXEC_NEVER;
+	else
+		desc |= TTB_SECT_EXEC;
+
+	if (attrs & MEM_SHAREABLE)
+		desc |= TTB_SECT_SHAREABLE;
+
+	switch (attrs & MEM_TYPE_MASK) {
+	case MEM_STRONGLY_ORDERED:
+		desc |= TTB_SECT_STRONGLY_ORDERED;
+		break;
+	case MEM_DEVICE:
+		desc |= TTB_SECT_SHAREABLE_DEVICE;
+		break;
+	case MEM_NORMAL_NC:
+		desc |= TTB_SECT_NORMAL_NC;
+		break;
+	case MEM_NORMAL_WT:
+		desc |= TTB_SECT_CACHEABLE_WT;
+		break;
+	case MEM_NORMAL_WB:
+		desc |= TTB_SECT_CACHEABLE_WB;
+		break;
+	default:
+		desc |= TTB_SECT_CACHEABLE_WB_WA;
+		break;
+	}
+#endif
+
+	return desc;
+}
+
+#ifdef CONFIG_ARCH_ARMV7A
+/**
+ * \brief Replace groups of 16 identical sections by supersections
+ */
+static void _mmu_merge_supersections(uint32_t* tlb)
+{
+	uint32_t i, j, attrs;
+
+	for (i = 0; i < 4096; i += 16) {
+		if (!tlb[i])
+			continue;
+
+		attrs = tlb[i] & ~TTB_SECT_ADDR(0xFFFFFFFF);
+		for (j = 1; j < 16; j++)
+			if (tlb[i + j] != (TTB_SECT_ADDR((i + j) << 20) | attrs))
+				break;
+		if (j < 16)
+			continue;
+
+		/* supersections have no domain field, domain 0 is used */
+		attrs &= ~(TTB_SECT_DOMAIN(0xf) | TTB_TYPE_SECT);
+		for (j = 0; j < 16; j++)
+			tlb[i + j] = TTB_SUPERSECT_ADDR(i << 20) | attrs
+			           | TTB_TYPE_SUPERSECT;
+	}
+}
+#endif
+
 /*------------------------------------------------------------------------------ */
 /*         Exported functions                                                    */
 /*------------------------------------------------------------------------------ */
 
+void mmu_build_tlb(uint32_t* tlb, const struct _mem_region* regions,
+                   uint32_t count)
+{
+	uint32_t i, addr, desc;
+
+	for (addr = 0; addr < 4096; addr++)
+		tlb[addr] = 0;
+
+	for (i = 0; i < count; i++) {
+		const struct _mem_region* region = &regions[i];
+		uint32_t first = region->start >> 20;
+		uint32_t last = first + (region->size >> 20);
+
+		assert((region->start & 0xFFFFF) == 0);
+		assert(region->size && (region->size & 0xFFFFF) == 0);
+		assert(last <= 4096);
+
+		desc = _mmu_section_attrs(region->attrs);
+		for (addr = first; addr < last; addr++)
+			tlb[addr] = TTB_SECT_ADDR(addr << 20) | desc;
+	}
+
+#ifdef CONFIG_ARCH_ARMV7A
+	_mmu_merge_supersections(tlb);
+#endif
+}
+
 void mmu_configure(void *tlb)
 {
 	assert(!mmu_is_enabled());
@@ -54,8 +179,9 @@ void mmu_configure(void *tlb)
 	cp15_write_ttbr0((unsigned int)tlb);
 
 	/* Domain Access Register */
-	/* only domain 15: access are not checked */
-	cp15_write_dacr(0xC0000000);
+	/* only domains 15 (sections) and 0 (supersections): access are not
+	 * checked */
+	cp15_write_dacr(0xC0000003);
 
 	dsb();
 	isb();
@@ -46,6 +46,9 @@
 /* TTB descriptor type for Section descriptor */
 #define TTB_TYPE_SECT              (2 << 0)
 
+/* TTB descriptor type for Supersection descriptor (ARMv7-A only) */
+#define TTB_TYPE_SUPERSECT         ((1 << 18) | TTB_TYPE_SECT)
+
 /* TTB Section Descriptor: Buffered/Non-Buffered (B) */
 #define TTB_SECT_WRITE_THROUGH     (0 << 2)
 #define TTB_SECT_WRITE_BACK        (1 << 2)
@@ -85,9 +88,22 @@
 #define TTB_SECT_AP_PRIV_READ_ONLY ((1 << 15) | (1 << 10))
 #define TTB_SECT_AP_READ_ONLY      ((1 << 15) | (2 << 10))
 
+/* TTB Section Descriptor: Type Extension (TEX) */
+#define TTB_SECT_TEX(x)            (((x) & 7) << 12)
+
+/* TTB Section Descriptor: Shareable (S) */
+#define TTB_SECT_SHAREABLE         (1 << 16)
+
+/* Memory types using TEX (without TEX remap) */
+#define TTB_SECT_NORMAL_NC         (TTB_SECT_TEX(1) | TTB_SECT_NON_CACHEABLE | TTB_SECT_WRITE_THROUGH)
+#define TTB_SECT_CACHEABLE_WB_WA   (TTB_SECT_TEX(1) | TTB_SECT_CACHEABLE_WB)
+
 #endif /* CONFIG_ARCH_* */
 
 /* TTB Section Descriptor: Section Base Address */
 #define TTB_SECT_ADDR(x)           ((x) & 0xFFF00000)
 
+/* TTB Supersection Descriptor: Supersection Base Address */
+#define TTB_SUPERSECT_ADDR(x)      ((x) & 0xFF000000)
+
 #endif  /* MMU_CP15_H_ */
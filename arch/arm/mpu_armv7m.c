@@ -33,15 +33,79 @@
 
 #include "chip.h"
 #include "barriers.h"
+#include "compiler.h"
 
 #include "arm/mpu_armv7m.h"
 
 #include <assert.h>
+#include <errno.h>
 
 /*------------------------------------------------------------------------------ */
 /*         Exported functions                                                    */
 /*------------------------------------------------------------------------------ */
 
+int mpu_build_config(const struct _mem_region* regions, uint32_t count,
+                     uint32_t* config, uint32_t size)
+{
+	uint32_t i, order, rasr;
+
+	if (count > MPU_REGION_COUNT || size < 2 * count + 2)
+		return -EINVAL;
+
+	for (i = 0; i < count; i++) {
+		const struct _mem_region* region = &regions[i];
+
+		if (region->size < 32 || (region->size & (region->size - 1)))
+			return -EINVAL;
+		if (region->start & (region->size - 1))
+			return -EINVAL;
+		order = 31 - CLZ(region->size);
+
+		rasr = MPU_REGION_SIZE(order - 1) | MPU_ATTR_ENABLE;
+
+		if (region->attrs & MEM_READ_ONLY)
+			rasr |= MPU_AP_READONLY;
+		else
+			rasr |= MPU_AP_READWRITE;
+
+		if (region->attrs & MEM_EXEC_NEVER)
+			rasr |= MPU_ATTR_EXECUTE_NEVER;
+
+		if (region->attrs & MEM_SHAREABLE)
+			rasr |= MPU_ATTR_SHAREABLE;
+
+		switch (region->attrs & MEM_TYPE_MASK) {
+		case MEM_STRONGLY_ORDERED:
+			rasr |= MPU_ATTR_STRONGLY_ORDERED;
+			break;
+		case MEM_DEVICE:
+			rasr |= MPU_ATTR_DEVICE;
+			break;
+		case MEM_NORMAL_NC:
+			rasr |= MPU_ATTR_NORMAL;
+			break;
+		case MEM_NORMAL_WT:
+			rasr |= MPU_ATTR_NORMAL_WT;
+			break;
+		case MEM_NORMAL_WB:
+			rasr |= MPU_ATTR_NORMAL_WB;
+			break;
+		default:
+			rasr |= MPU_ATTR_NORMAL_WB_WA;
+			break;
+		}
+
+		*config++ = MPU_REGION(i, region->start);
+		*config++ = rasr;
+	}
+
+	/* end marker */
+	*config++ = 0;
+	*config++ = 0;
+
+	return 0;
+}
+
 void mpu_configure(const void* config)
 {
 	uint32_t* values = (uint32_t*)config;
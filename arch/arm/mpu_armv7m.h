@@ -43,6 +43,9 @@
  *        Exported definitions
  *----------------------------------------------------------------------------*/
 
+/* Number of MPU regions */
+#define MPU_REGION_COUNT 16
+
 /* Region Address and Index */
 #define MPU_REGION(region, addr) (((addr) & MPU_RBAR_ADDR_Msk) |\
                                   MPU_RBAR_REGION(region) | MPU_RBAR_VALID)
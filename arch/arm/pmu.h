@@ -0,0 +1,169 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef ARM_PMU_H_
+#define ARM_PMU_H_
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+#if defined(CONFIG_ARCH_ARMV7A)
+
+/** Number of event counters used */
+#define ARCH_PMU_EVENTS 2
+
+/** Mask of valid bits of the event counters */
+#define ARCH_PMU_EVENT_MASK 0xffffffffu
+
+/* Common ARMv7 PMU events (all implemented by Cortex-A5) */
+#define ARCH_PMU_EVENT_L1I_REFILL   0x01
+#define ARCH_PMU_EVENT_L1D_REFILL   0x03
+#define ARCH_PMU_EVENT_L1D_ACCESS   0x04
+#define ARCH_PMU_EVENT_INSTRUCTIONS 0x08
+#define ARCH_PMU_EVENT_EXCEPTIONS   0x09
+#define ARCH_PMU_EVENT_BRANCH_MISS  0x10
+#define ARCH_PMU_EVENT_BRANCH_PRED  0x12
+
+#define ARCH_PMU_DEFAULT_EVENT0 ARCH_PMU_EVENT_L1D_REFILL
+#define ARCH_PMU_DEFAULT_EVENT1 ARCH_PMU_EVENT_BRANCH_MISS
+
+#elif defined(CONFIG_ARCH_ARMV7M)
+
+/** Number of event counters used */
+#define ARCH_PMU_EVENTS 2
+
+/** The DWT event counters are only 8-bit wide */
+#define ARCH_PMU_EVENT_MASK 0xffu
+
+/* DWT counters, there is no cache or branch event on ARMv7-M */
+#define ARCH_PMU_EVENT_CPI   0 /**< extra cycles of multi-cycle instructions */
+#define ARCH_PMU_EVENT_EXC   1 /**< cycles spent in exception entry/exit */
+#define ARCH_PMU_EVENT_SLEEP 2 /**< cycles spent sleeping */
+#define ARCH_PMU_EVENT_LSU   3 /**< extra cycles of load/store instructions */
+#define ARCH_PMU_EVENT_FOLD  4 /**< folded instructions */
+
+#define ARCH_PMU_DEFAULT_EVENT0 ARCH_PMU_EVENT_LSU
+#define ARCH_PMU_DEFAULT_EVENT1 ARCH_PMU_EVENT_CPI
+
+#define ARMV7M_DWT_CTRL_EVTENA(event) (1u << (17 + (event)))
+#define ARMV7M_DWT_EVTCNT(event) \
+	(*(volatile uint32_t*)(0xE0001008u + 4 * (event)))
+
+#else
+
+/* ARM926 has no performance counters */
+#define ARCH_PMU_EVENTS 0
+#define ARCH_PMU_EVENT_MASK 0
+#define ARCH_PMU_DEFAULT_EVENT0 0
+#define ARCH_PMU_DEFAULT_EVENT1 0
+
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Public functions
+ *----------------------------------------------------------------------------*/
+
+#if defined(CONFIG_ARCH_ARMV7A)
+
+/**
+ * \brief Configure the two first PMU event counters and enable them, along
+ * with the cycle counter.  Event counters are reset, the cycle counter is not
+ * (see arch_cycles_init).
+ */
+static inline void arch_pmu_init(uint32_t event0, uint32_t event1)
+{
+	uint32_t pmcr;
+
+	asm volatile("mcr p15, 0, %0, c9, c12, 5" :: "r"(0));
+	asm volatile("mcr p15, 0, %0, c9, c13, 1" :: "r"(event0));
+	asm volatile("mcr p15, 0, %0, c9, c12, 5" :: "r"(1));
+	asm volatile("mcr p15, 0, %0, c9, c13, 1" :: "r"(event1));
+	asm volatile("mcr p15, 0, %0, c9, c12, 1" :: "r"((1u << 31) | 3));
+
+	asm volatile("mrc p15, 0, %0, c9, c12, 0" : "=r"(pmcr));
+	pmcr |= (1u << 1) | (1u << 0); /* P: reset events, E: enable */
+	asm volatile("mcr p15, 0, %0, c9, c12, 0" :: "r"(pmcr));
+}
+
+/**
+ * \brief Read an event counter.
+ * \param counter Index of the event in the arch_pmu_init arguments.
+ * \param event Event number given to arch_pmu_init for this counter.
+ */
+static inline uint32_t arch_pmu_read_event(uint32_t counter, uint32_t event)
+{
+	uint32_t value;
+	asm volatile("mcr p15, 0, %0, c9, c12, 5" :: "r"(counter));
+	asm volatile("mrc p15, 0, %0, c9, c13, 2" : "=r"(value));
+	return value;
+}
+
+#elif defined(CONFIG_ARCH_ARMV7M)
+
+/**
+ * \brief Enable the DWT counters for two events, along with the cycle
+ * counter.
+ */
+static inline void arch_pmu_init(uint32_t event0, uint32_t event1)
+{
+	ARMV7M_DEMCR |= ARMV7M_DEMCR_TRCENA;
+	ARMV7M_DWT_LAR = ARMV7M_DWT_LAR_KEY;
+	ARMV7M_DWT_EVTCNT(event0) = 0;
+	ARMV7M_DWT_EVTCNT(event1) = 0;
+	ARMV7M_DWT_CTRL |= ARMV7M_DWT_CTRL_CYCCNTENA |
+	                   ARMV7M_DWT_CTRL_EVTENA(event0) |
+	                   ARMV7M_DWT_CTRL_EVTENA(event1);
+}
+
+static inline uint32_t arch_pmu_read_event(uint32_t counter, uint32_t event)
+{
+	return ARMV7M_DWT_EVTCNT(event) & ARCH_PMU_EVENT_MASK;
+}
+
+#else
+
+static inline void arch_pmu_init(uint32_t event0, uint32_t event1)
+{
+}
+
+static inline uint32_t arch_pmu_read_event(uint32_t counter, uint32_t event)
+{
+	return 0;
+}
+
+#endif
+
+#endif /* ARM_PMU_H_ */
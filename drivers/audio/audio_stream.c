@@ -0,0 +1,382 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "audio/audio_device.h"
+#include "audio/audio_stream.h"
+#include "callback.h"
+#include "chip.h"
+#include "dma/dma.h"
+#include "errno.h"
+#include "intmath.h"
+#include "mm/cache.h"
+#include "ring.h"
+#include "trace.h"
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * Find the DMA channel, data register and data width used by the audio
+ * device for the stream direction.
+ */
+static int _audio_stream_get_dma(struct _audio_stream *stream)
+{
+	struct _audio_desc *audio = stream->audio;
+
+	switch (audio->type) {
+#if defined(CONFIG_HAVE_CLASSD)
+	case AUDIO_DEVICE_CLASSD:
+	{
+		struct _classd_desc *classd = &audio->device.classd.desc;
+
+		if (!stream->playback)
+			return -EINVAL;
+		stream->dma.channel = classd->tx.dma.channel;
+		stream->dma.fifo = (void*)&classd->addr->CLASSD_THR;
+		if (classd->left_enable && classd->right_enable)
+			stream->dma.cfg_dma.data_width = DMA_DATA_WIDTH_WORD;
+		else
+			stream->dma.cfg_dma.data_width = DMA_DATA_WIDTH_HALF_WORD;
+		break;
+	}
+#endif
+#if defined(CONFIG_HAVE_SSC)
+	case AUDIO_DEVICE_SSC:
+	{
+		struct _ssc_desc *ssc = &audio->device.ssc.desc;
+
+		if (stream->playback) {
+			stream->dma.channel = ssc->tx.dma.channel;
+			stream->dma.fifo = (void*)&ssc->addr->SSC_THR;
+		} else {
+			stream->dma.channel = ssc->rx.dma.channel;
+			stream->dma.fifo = (void*)&ssc->addr->SSC_RHR;
+		}
+		if (ssc->slot_length == 8)
+			stream->dma.cfg_dma.data_width = DMA_DATA_WIDTH_BYTE;
+		else if (ssc->slot_length == 16)
+			stream->dma.cfg_dma.data_width = DMA_DATA_WIDTH_HALF_WORD;
+		else
+			stream->dma.cfg_dma.data_width = DMA_DATA_WIDTH_WORD;
+		break;
+	}
+#endif
+#if defined(CONFIG_HAVE_PDMIC)
+	case AUDIO_DEVICE_PDMIC:
+	{
+		struct _pdmic_desc *pdmic = &audio->device.pdmic.desc;
+
+		if (stream->playback)
+			return -EINVAL;
+		stream->dma.channel = pdmic->rx.dma.channel;
+		stream->dma.fifo = (void*)&pdmic->addr->PDMIC_CDR;
+		if (pdmic->dsp_size == PDMIC_CONVERTED_DATA_SIZE_32)
+			stream->dma.cfg_dma.data_width = DMA_DATA_WIDTH_WORD;
+		else
+			stream->dma.cfg_dma.data_width = DMA_DATA_WIDTH_HALF_WORD;
+		break;
+	}
+#endif
+	default:
+		return -EINVAL;
+	}
+
+	return stream->dma.channel ? 0 : -EINVAL;
+}
+
+static void _audio_stream_update_fill(struct _audio_stream *stream,
+		uint16_t fill)
+{
+	if (fill < stream->stats.min_fill)
+		stream->stats.min_fill = fill;
+	if (fill > stream->stats.max_fill)
+		stream->stats.max_fill = fill;
+}
+
+/**
+ * DMA callback, called from interrupt context each time a period has been
+ * transferred.
+ */
+static int _audio_stream_dma_callback(void* arg)
+{
+	struct _audio_stream *stream = (struct _audio_stream*)arg;
+	uint8_t *period = stream->buffer + stream->hw * stream->period_size;
+	uint16_t hw = stream->hw;
+
+	/* Update the local copy first, so that the application never sees an
+	 * out of range index */
+	RING_INC(hw, stream->periods);
+
+	if (stream->playback) {
+		/* Recycle the played period as silence, in case the
+		 * application does not refill it in time */
+		memset(period, 0, stream->period_size);
+		cache_clean_region(period, stream->period_size);
+		stream->hw = hw;
+
+		/* The DMA is now playing a period that was never queued */
+		if (RING_EMPTY(stream->app, hw))
+			stream->stats.xruns++;
+		_audio_stream_update_fill(stream,
+			RING_CNT(stream->app, hw, stream->periods));
+	} else {
+		cache_invalidate_region(period, stream->period_size);
+		stream->hw = hw;
+
+		/* The DMA is now overwriting the oldest unread period */
+		if (RING_EMPTY(hw, stream->app))
+			stream->stats.xruns++;
+		_audio_stream_update_fill(stream,
+			RING_CNT(hw, stream->app, stream->periods));
+	}
+	stream->stats.periods++;
+
+	callback_call(&stream->callback);
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+int audio_stream_init(struct _audio_stream *stream,
+		struct _audio_desc *audio, void *buffer, uint32_t period_size,
+		uint16_t periods, struct _callback *cb)
+{
+	int err;
+
+	if (periods < 3 || periods > AUDIO_STREAM_MAX_PERIODS)
+		return -EINVAL;
+	if (!IS_CACHE_ALIGNED(buffer) || !IS_CACHE_ALIGNED(period_size))
+		return -EINVAL;
+
+	memset(stream, 0, sizeof(*stream));
+	stream->audio = audio;
+	stream->playback = (audio->direction == AUDIO_DEVICE_PLAY);
+	stream->buffer = (uint8_t*)buffer;
+	stream->period_size = period_size;
+	stream->periods = periods;
+	callback_copy(&stream->callback, cb);
+
+	err = _audio_stream_get_dma(stream);
+	if (err < 0)
+		return err;
+
+	if ((period_size >> stream->dma.cfg_dma.data_width) > DMA_MAX_BT_SIZE)
+		return -EINVAL;
+
+	RING_CLEAR(stream->hw, stream->app);
+	stream->stats.min_fill = periods;
+
+	memset(stream->buffer, 0, periods * period_size);
+	cache_clean_region(stream->buffer, periods * period_size);
+
+	return 0;
+}
+
+int audio_stream_start(struct _audio_stream *stream)
+{
+	struct _dma_transfer_cfg cfg[AUDIO_STREAM_MAX_PERIODS];
+	struct _callback _cb;
+	uint32_t len;
+	uint16_t i;
+	int err;
+
+	if (stream->running)
+		return -EBUSY;
+
+	len = stream->period_size >> stream->dma.cfg_dma.data_width;
+	for (i = 0; i < stream->periods; i++) {
+		uint8_t *period = stream->buffer + i * stream->period_size;
+
+		if (stream->playback) {
+			cfg[i].saddr = period;
+			cfg[i].daddr = stream->dma.fifo;
+		} else {
+			cfg[i].saddr = stream->dma.fifo;
+			cfg[i].daddr = period;
+		}
+		cfg[i].len = len;
+	}
+
+	stream->dma.cfg_dma.incr_saddr = stream->playback;
+	stream->dma.cfg_dma.incr_daddr = !stream->playback;
+	stream->dma.cfg_dma.chunk_size = DMA_CHUNK_SIZE_1;
+	stream->dma.cfg_dma.loop = true;
+
+	if (!stream->playback)
+		cache_invalidate_region(stream->buffer,
+				stream->periods * stream->period_size);
+
+	err = dma_configure_transfer(stream->dma.channel, &stream->dma.cfg_dma,
+			cfg, stream->periods);
+	if (err < 0) {
+		trace_error("audio_stream: cannot configure DMA (%d)\r\n", err);
+		return err;
+	}
+
+	callback_set(&_cb, _audio_stream_dma_callback, stream);
+	dma_set_callback(stream->dma.channel, &_cb);
+
+	stream->running = true;
+	dma_start_transfer(stream->dma.channel);
+
+	return 0;
+}
+
+void audio_stream_stop(struct _audio_stream *stream)
+{
+	if (!stream->running)
+		return;
+
+	dma_stop_transfer(stream->dma.channel);
+	stream->running = false;
+}
+
+uint32_t audio_stream_write(struct _audio_stream *stream,
+		const void *data, uint32_t size)
+{
+	const uint8_t *src = (const uint8_t*)data;
+	uint32_t done = 0;
+
+	if (!stream->playback)
+		return 0;
+
+	while (done < size) {
+		uint16_t app = stream->app;
+		uint16_t hw = stream->hw;
+		uint8_t *period;
+		uint32_t len;
+
+		if (stream->running && RING_EMPTY(app, hw)) {
+			/* Underrun: the period at the app index is being
+			 * played, restart after it */
+			RING_INC(app, stream->periods);
+			stream->app_offset = 0;
+			stream->app = app;
+			continue;
+		}
+		if (RING_SPACE(app, hw, stream->periods) == 0)
+			break;
+
+		period = stream->buffer + app * stream->period_size;
+		len = min_u32(size - done, stream->period_size - stream->app_offset);
+		memcpy(period + stream->app_offset, src + done, len);
+		stream->app_offset += len;
+		done += len;
+
+		if (stream->app_offset == stream->period_size) {
+			cache_clean_region(period, stream->period_size);
+			stream->app_offset = 0;
+			RING_INC(app, stream->periods);
+			stream->app = app;
+		}
+	}
+
+	return done;
+}
+
+uint32_t audio_stream_read(struct _audio_stream *stream, void *data,
+		uint32_t size)
+{
+	uint8_t *dst = (uint8_t*)data;
+	uint32_t done = 0;
+
+	if (stream->playback)
+		return 0;
+
+	while (done < size) {
+		uint16_t app = stream->app;
+		uint8_t *period;
+		uint32_t len;
+
+		if (RING_EMPTY(stream->hw, app))
+			break;
+
+		period = stream->buffer + app * stream->period_size;
+		len = min_u32(size - done, stream->period_size - stream->app_offset);
+		memcpy(dst + done, period + stream->app_offset, len);
+		stream->app_offset += len;
+		done += len;
+
+		if (stream->app_offset == stream->period_size) {
+			stream->app_offset = 0;
+			RING_INC(app, stream->periods);
+			stream->app = app;
+		}
+	}
+
+	return done;
+}
+
+uint32_t audio_stream_get_fill(const struct _audio_stream *stream)
+{
+	uint16_t app = stream->app;
+	uint16_t hw = stream->hw;
+
+	if (stream->playback)
+		return RING_CNT(app, hw, stream->periods) * stream->period_size
+			+ stream->app_offset;
+	else
+		return RING_CNT(hw, app, stream->periods) * stream->period_size
+			- stream->app_offset;
+}
+
+uint32_t audio_stream_get_space(const struct _audio_stream *stream)
+{
+	uint16_t app = stream->app;
+	uint16_t hw = stream->hw;
+
+	if (!stream->playback)
+		return 0;
+
+	return RING_SPACE(app, hw, stream->periods) * stream->period_size
+		- stream->app_offset;
+}
+
+void audio_stream_get_stats(const struct _audio_stream *stream,
+		struct _audio_stream_stats *stats)
+{
+	*stats = stream->stats;
+}
+
+void audio_stream_reset_stats(struct _audio_stream *stream)
+{
+	memset(&stream->stats, 0, sizeof(stream->stats));
+	stream->stats.min_fill = stream->periods;
+}
@@ -0,0 +1,182 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Continuous audio streaming over SSC, CLASSD and PDMIC.
+ *
+ * The stream buffer is split in N periods which are transferred by a looped
+ * scatter/gather DMA list, so that the DMA never stops between buffers.  The
+ * application produces (playback) or consumes (capture) whole or partial
+ * periods with audio_stream_write() / audio_stream_read() while the DMA
+ * interrupt moves the hardware position.  Both positions are indexes in a
+ * ring of periods managed with the helpers from ring.h: each side only
+ * writes its own index, so no locking is needed between the application and
+ * the DMA interrupt.
+ *
+ * Playback periods are cleared after being played, so that an underrun
+ * outputs silence instead of stale samples.  Underruns and overruns are
+ * counted in the stream statistics together with the fill level watermarks.
+ */
+
+#ifndef AUDIO_STREAM_H
+#define AUDIO_STREAM_H
+
+#ifdef CONFIG_HAVE_AUDIO
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "audio/audio_device.h"
+#include "callback.h"
+#include "dma/dma.h"
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Maximum number of periods in a stream */
+#ifndef AUDIO_STREAM_MAX_PERIODS
+#define AUDIO_STREAM_MAX_PERIODS 16
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+struct _audio_stream_stats {
+	uint32_t periods;  /**< Periods completed by the DMA */
+	uint32_t xruns;    /**< Underruns (playback) or overruns (capture) */
+	uint16_t min_fill; /**< Lowest fill level seen by the DMA, in periods */
+	uint16_t max_fill; /**< Highest fill level seen by the DMA, in periods */
+};
+
+struct _audio_stream {
+	struct _audio_desc *audio;
+	bool playback;
+
+	uint8_t *buffer;        /**< periods * period_size bytes */
+	uint32_t period_size;   /**< Period size in bytes */
+	uint16_t periods;       /**< Number of periods */
+
+	struct {
+		struct _dma_channel *channel;
+		struct _dma_cfg cfg_dma;
+		void *fifo;
+	} dma;
+
+	volatile uint16_t hw;   /**< Period index owned by the DMA */
+	volatile uint16_t app;  /**< Period index owned by the application */
+	uint32_t app_offset;    /**< Bytes already handled in the app period */
+
+	bool running;
+	struct _callback callback;
+	struct _audio_stream_stats stats;
+};
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Initialize an audio stream on a configured audio device.
+ *
+ * \param stream      Stream to initialize.
+ * \param audio       Audio device, configured with audio_configure().  The
+ *                    stream direction follows audio->direction.
+ * \param buffer      Stream buffer, cache-aligned, periods * period_size
+ *                    bytes.
+ * \param period_size Period size in bytes, multiple of the cache line size.
+ * \param periods     Number of periods (3 to AUDIO_STREAM_MAX_PERIODS).
+ * \param cb          Optional callback, called from the DMA interrupt after
+ *                    each period.
+ * \return 0 on success, or -EINVAL.
+ */
+extern int audio_stream_init(struct _audio_stream *stream,
+		struct _audio_desc *audio, void *buffer, uint32_t period_size,
+		uint16_t periods, struct _callback *cb);
+
+/**
+ * \brief Start the circular DMA.
+ *
+ * For playback, data already written with audio_stream_write() is played
+ * first (pre-fill); missing periods are played as silence.
+ */
+extern int audio_stream_start(struct _audio_stream *stream);
+
+/**
+ * \brief Stop the circular DMA.
+ */
+extern void audio_stream_stop(struct _audio_stream *stream);
+
+/**
+ * \brief Queue samples for playback.
+ * \return Number of bytes accepted, less than \a size if the stream is full.
+ */
+extern uint32_t audio_stream_write(struct _audio_stream *stream,
+		const void *data, uint32_t size);
+
+/**
+ * \brief Fetch captured samples.
+ * \return Number of bytes copied, less than \a size if not enough samples
+ * were captured.
+ */
+extern uint32_t audio_stream_read(struct _audio_stream *stream, void *data,
+		uint32_t size);
+
+/**
+ * \brief Get the number of bytes queued (playback) or available (capture).
+ */
+extern uint32_t audio_stream_get_fill(const struct _audio_stream *stream);
+
+/**
+ * \brief Get the number of bytes that can be written (playback) without
+ * blocking.
+ */
+extern uint32_t audio_stream_get_space(const struct _audio_stream *stream);
+
+/**
+ * \brief Get a copy of the stream statistics.
+ */
+extern void audio_stream_get_stats(const struct _audio_stream *stream,
+		struct _audio_stream_stats *stats);
+
+/**
+ * \brief Reset the stream statistics.
+ */
+extern void audio_stream_reset_stats(struct _audio_stream *stream);
+
+#endif /* CONFIG_HAVE_AUDIO */
+
+#endif /* AUDIO_STREAM_H */
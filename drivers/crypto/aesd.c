@@ -49,13 +49,109 @@
  *        Local functions
  *----------------------------------------------------------------------------*/
 
+/**
+ * \brief Compute the chaining values known before the transfer, inputs may
+ * be overwritten by in-place transfers.
+ */
+static void _aesd_prepare_vector(struct _aesd_desc* desc)
+{
+	uint8_t* iv = (uint8_t*)desc->cfg.vector;
+	const struct _buffer* in;
+	uint32_t size = 0, counter;
+	uint8_t n;
+
+	for (n = 0; n < desc->xfer.count; n++)
+		size += desc->xfer.bufin[n].size;
+
+	switch (desc->cfg.mode) {
+	case AESD_MODE_CBC:
+	case AESD_MODE_CFB:
+		/* the next vector is made of the last ciphertext bytes */
+		if (desc->cfg.encrypt)
+			break;
+		for (n = 0; n < desc->xfer.count; n++) {
+			in = &desc->xfer.bufin[n];
+			if (in->size >= 16) {
+				memcpy(iv, in->data + in->size - 16, 16);
+			} else {
+				memmove(iv, iv + in->size, 16 - in->size);
+				memcpy(iv + 16 - in->size, in->data, in->size);
+			}
+		}
+		break;
+	case AESD_MODE_OFB:
+		/* the next vector is the last output block xor input block */
+		for (n = desc->xfer.count; n > 0; n--) {
+			in = &desc->xfer.bufin[n - 1];
+			if (in->size >= 16) {
+				memcpy(desc->xfer.last_in, in->data + in->size - 16, 16);
+				break;
+			}
+		}
+		break;
+	case AESD_MODE_CTR:
+		counter = ((uint32_t)iv[14] << 8) | iv[15];
+		counter += size / 16;
+		iv[14] = (uint8_t)(counter >> 8);
+		iv[15] = (uint8_t)counter;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * \brief Compute the chaining values that depend on the transfer output.
+ */
+static void _aesd_update_vector(struct _aesd_desc* desc)
+{
+	uint8_t* iv = (uint8_t*)desc->cfg.vector;
+	const struct _buffer* out;
+	uint8_t n, i;
+
+	switch (desc->cfg.mode) {
+	case AESD_MODE_CBC:
+	case AESD_MODE_CFB:
+		if (!desc->cfg.encrypt)
+			break;
+		for (n = 0; n < desc->xfer.count; n++) {
+			out = &desc->xfer.bufout[n];
+			if (out->size >= 16) {
+				memcpy(iv, out->data + out->size - 16, 16);
+			} else {
+				memmove(iv, iv + out->size, 16 - out->size);
+				memcpy(iv + 16 - out->size, out->data, out->size);
+			}
+		}
+		break;
+	case AESD_MODE_OFB:
+		for (n = desc->xfer.count; n > 0; n--) {
+			out = &desc->xfer.bufout[n - 1];
+			if (out->size >= 16) {
+				memcpy(iv, out->data + out->size - 16, 16);
+				for (i = 0; i < 4; i++)
+					desc->cfg.vector[i] ^= desc->xfer.last_in[i];
+				break;
+			}
+		}
+		break;
+	default:
+		break;
+	}
+}
+
 static int _aesd_dma_read_callback(void* arg)
 {
 	struct _aesd_desc* desc = (struct _aesd_desc*)arg;
 
+	uint8_t i;
+
 	dma_reset_channel(desc->xfer.dma.tx.channel);
 
-	cache_invalidate_region((uint32_t*)desc->xfer.bufout->data, desc->xfer.bufout->size);
+	for (i = 0; i < desc->xfer.count; i++)
+		cache_invalidate_region((uint32_t*)desc->xfer.bufout[i].data,
+					desc->xfer.bufout[i].size);
+	_aesd_update_vector(desc);
 
 	mutex_unlock(&desc->mutex);
 
@@ -123,84 +219,99 @@ static uint8_t _aesd_get_size_per_trans(struct _aesd_desc* desc)
 
 static void _aesd_transfer_buffer_dma(struct _aesd_desc* desc)
 {
-	struct _dma_transfer_cfg cfg;
+	struct _dma_transfer_cfg cfg[AESD_MAX_SG];
 	struct _dma_cfg cfg_dma;
 	struct _callback _cb;
-
-	cache_clean_region((uint32_t*)desc->xfer.bufin->data, desc->xfer.bufin->size);
+	uint8_t width, i;
 
 	memset(&cfg_dma, 0, sizeof(cfg_dma));
 	cfg_dma.incr_saddr = true;
 	cfg_dma.incr_daddr = false;
 	cfg_dma.data_width = _aesd_get_dma_data_width(desc);
 	cfg_dma.chunk_size = _aesd_get_dma_chunk_size(desc);
-
-	memset(&cfg, 0, sizeof(cfg));
-	cfg.saddr = (void *)desc->xfer.bufin->data;
-	cfg.daddr = (void *)AES->AES_IDATAR;
-	cfg.len = desc->xfer.bufin->size / DMA_DATA_WIDTH_IN_BYTE(cfg_dma.data_width);
-	dma_configure_transfer(desc->xfer.dma.tx.channel, &cfg_dma, &cfg, 1);
+	width = DMA_DATA_WIDTH_IN_BYTE(cfg_dma.data_width);
+
+	memset(cfg, 0, sizeof(cfg));
+	for (i = 0; i < desc->xfer.count; i++) {
+		cache_clean_region((uint32_t*)desc->xfer.bufin[i].data,
+				   desc->xfer.bufin[i].size);
+		cfg[i].saddr = (void *)desc->xfer.bufin[i].data;
+		cfg[i].daddr = (void *)AES->AES_IDATAR;
+		cfg[i].len = desc->xfer.bufin[i].size / width;
+	}
+	dma_configure_transfer(desc->xfer.dma.tx.channel, &cfg_dma, cfg,
+			       desc->xfer.count);
 	dma_set_callback(desc->xfer.dma.tx.channel, NULL);
 
 	dma_reset_channel(desc->xfer.dma.rx.channel);
 	cfg_dma.incr_saddr = false;
 	cfg_dma.incr_daddr = true;
 
-	memset(&cfg, 0, sizeof(cfg));
-	cfg.saddr = (void *)AES->AES_ODATAR;
-	cfg.daddr = (void *)desc->xfer.bufout->data;
-	cfg.len = desc->xfer.bufout->size / DMA_DATA_WIDTH_IN_BYTE(cfg_dma.data_width);
-	dma_configure_transfer(desc->xfer.dma.rx.channel, &cfg_dma, &cfg, 1);
+	memset(cfg, 0, sizeof(cfg));
+	for (i = 0; i < desc->xfer.count; i++) {
+		cfg[i].saddr = (void *)AES->AES_ODATAR;
+		cfg[i].daddr = (void *)desc->xfer.bufout[i].data;
+		cfg[i].len = desc->xfer.bufout[i].size / width;
+	}
+	dma_configure_transfer(desc->xfer.dma.rx.channel, &cfg_dma, cfg,
+			       desc->xfer.count);
 
 	callback_set(&_cb, _aesd_dma_read_callback, (void*)desc);
 	dma_set_callback(desc->xfer.dma.rx.channel, &_cb);
 
 	dma_start_transfer(desc->xfer.dma.tx.channel);
 	dma_start_transfer(desc->xfer.dma.rx.channel);
-
-	aesd_wait_transfer(desc);
 }
 
 static void _aesd_transfer_buffer_polling(struct _aesd_desc* desc)
 {
 	uint32_t i;
+	uint8_t n;
 
 	aes_enable_it(AES_IER_DATRDY);
-	for (i = 0; i < desc->xfer.bufin->size; i+= _aesd_get_size_per_trans(desc)) {
-		aes_set_input((uint32_t *)((desc->xfer.bufin->data) + i));
-		if (desc->cfg.transfer_mode == AESD_TRANS_POLLING_MANUAL)
-			/* Set the START bit in the AES Control register
-			 to begin the encrypt. or decrypt. process. */
-			aes_start();
-		while ((aes_get_status() & AES_ISR_DATRDY) != AES_ISR_DATRDY);
-		aes_get_output((uint32_t *)((desc->xfer.bufout->data) + i));
+	for (n = 0; n < desc->xfer.count; n++) {
+		struct _buffer* in = &desc->xfer.bufin[n];
+		struct _buffer* out = &desc->xfer.bufout[n];
+
+		for (i = 0; i < in->size; i+= _aesd_get_size_per_trans(desc)) {
+			aes_set_input((uint32_t *)((in->data) + i));
+			if (desc->cfg.transfer_mode == AESD_TRANS_POLLING_MANUAL)
+				/* Set the START bit in the AES Control register
+				 to begin the encrypt. or decrypt. process. */
+				aes_start();
+			while ((aes_get_status() & AES_ISR_DATRDY) != AES_ISR_DATRDY);
+			aes_get_output((uint32_t *)((out->data) + i));
+		}
 	}
+	_aesd_update_vector(desc);
 	mutex_unlock(&desc->mutex);
 
 	callback_call(&desc->xfer.callback);
 }
 
-/*----------------------------------------------------------------------------
- *        Public functions
-
- *----------------------------------------------------------------------------*/
-uint32_t aesd_transfer(struct _aesd_desc* desc, struct _buffer* buffer_in,
-	struct _buffer* buffer_out, struct _callback* cb)
+static uint32_t _aesd_transfer(struct _aesd_desc* desc, struct _buffer* buffer_in,
+	struct _buffer* buffer_out, uint8_t count, struct _callback* cb)
 {
-	aes_encrypt_enable(desc->cfg.encrypt);
-	aes_set_start_mode(desc->cfg.transfer_mode);
-	desc->xfer.bufin = buffer_in;
-	desc->xfer.bufout = buffer_out;
-	callback_copy(&desc->xfer.callback, cb);
+	uint8_t i;
 
-	assert(!(desc->xfer.bufin->size % _aesd_get_size_per_trans(desc)));
-	assert(!(desc->xfer.bufout->size % _aesd_get_size_per_trans(desc)));
+	for (i = 0; i < count; i++) {
+		assert(!(buffer_in[i].size % _aesd_get_size_per_trans(desc)));
+		assert(buffer_out[i].size == buffer_in[i].size);
+	}
 
 	if (!mutex_try_lock(&desc->mutex)) {
 		trace_error("AESD mutex already locked!\r\n");
 		return ADES_ERROR_LOCK;
 	}
 
+	aes_encrypt_enable(desc->cfg.encrypt);
+	aes_set_start_mode(desc->cfg.transfer_mode);
+	desc->xfer.bufin = buffer_in;
+	desc->xfer.bufout = buffer_out;
+	desc->xfer.count = count;
+	callback_copy(&desc->xfer.callback, cb);
+	_aesd_prepare_vector(desc);
+
 	switch (desc->cfg.transfer_mode) {
 	case AESD_TRANS_POLLING_MANUAL:
 	case AESD_TRANS_POLLING_AUTO:
@@ -219,6 +330,30 @@ uint32_t aesd_transfer(struct _aesd_desc* desc, struct _buffer* buffer_in,
 	return AESD_SUCCESS;
 }
 
+/*----------------------------------------------------------------------------
+ *        Public functions
+
+ *----------------------------------------------------------------------------*/
+uint32_t aesd_transfer(struct _aesd_desc* desc, struct _buffer* buffer_in,
+	struct _buffer* buffer_out, struct _callback* cb)
+{
+	uint32_t status = _aesd_transfer(desc, buffer_in, buffer_out, 1, cb);
+
+	if (status == AESD_SUCCESS && desc->cfg.transfer_mode == AESD_TRANS_DMA)
+		aesd_wait_transfer(desc);
+
+	return status;
+}
+
+uint32_t aesd_transfer_sg(struct _aesd_desc* desc, struct _buffer* buffer_in,
+	struct _buffer* buffer_out, uint8_t count, struct _callback* cb)
+{
+	if (count == 0 || count > AESD_MAX_SG)
+		return AESD_ERROR_TRANSFER;
+
+	return _aesd_transfer(desc, buffer_in, buffer_out, count, cb);
+}
+
 bool aesd_is_busy(struct _aesd_desc* desc)
 {
 	return mutex_is_locked(&desc->mutex);
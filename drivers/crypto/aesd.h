@@ -46,6 +46,11 @@
  *        Types
  *----------------------------------------------------------------------------*/
 
+/** Maximum number of buffers in a scatter-gather transfer */
+#ifndef AESD_MAX_SG
+#define AESD_MAX_SG          (8)
+#endif
+
 #define AESD_SUCCESS         (0)
 #define ADES_ERROR_LOCK      (1)
 #define AESD_ERROR_TRANSFER  (2)
@@ -99,7 +104,9 @@ struct _aesd_desc {
 	struct {
 		struct _buffer *bufin;         /*< buffer input */
 		struct _buffer *bufout;        /*< buffer output */
+		uint8_t count;                 /*< number of buffers */
 		struct _callback callback;
+		uint32_t last_in[4];           /*< OFB: last input block */
 
 		struct {
 			struct {
@@ -112,6 +119,15 @@ struct _aesd_desc {
 /*------------------------------------------------------------------------------
  *        Functions
  *----------------------------------------------------------------------------*/
+/**
+ * \brief Program the AES engine with the mode, key and vector of the
+ * descriptor.
+ * After each transfer, cfg.vector holds the chaining value (CBC, CFB, OFB
+ * and CTR modes), so that calling this function again between two transfers
+ * resumes the chain, e.g. after another user reprogrammed the engine.
+ * \note In CTR mode, the engine increments the 16 least significant bits of
+ * the counter block only.
+ */
 extern void aesd_configure_mode(struct _aesd_desc* desc);
 
 extern void aesd_init(struct _aesd_desc* desc);
@@ -120,6 +136,22 @@ extern uint32_t aesd_transfer(struct _aesd_desc* desc,
 			      struct _buffer* buffer_in, struct _buffer* buffer_out,
 			      struct _callback* callback);
 
+/**
+ * \brief Start a scatter-gather transfer, without waiting for completion.
+ * \param desc  AES driver descriptor
+ * \param buffer_in  array of input buffers
+ * \param buffer_out  array of output buffers, buffer_out[i] having the same
+ * size as buffer_in[i]
+ * \param count  number of buffers (up to AESD_MAX_SG)
+ * \param callback  callback invoked when all buffers are processed
+ * \note In DMA mode, the callback is invoked from interrupt context and
+ * buffers must be cache-line aligned. Polling modes complete before
+ * returning.
+ */
+extern uint32_t aesd_transfer_sg(struct _aesd_desc* desc,
+				 struct _buffer* buffer_in, struct _buffer* buffer_out,
+				 uint8_t count, struct _callback* callback);
+
 extern bool aesd_is_busy(struct _aesd_desc* desc);
 
 extern void aesd_wait_transfer(struct _aesd_desc* desc);
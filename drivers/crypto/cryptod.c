@@ -0,0 +1,621 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "callback.h"
+#include "crypto/cryptod.h"
+#include "dma/dma.h"
+#include "errno.h"
+#include "irqflags.h"
+#include "mm/cache.h"
+#include "timer.h"
+#include "trace.h"
+
+#ifdef CONFIG_HAVE_AES
+#include "crypto/aesd.h"
+#endif
+#ifdef CONFIG_HAVE_TDES
+#include "crypto/tdesd.h"
+#endif
+#ifdef CONFIG_HAVE_SHA
+#include "crypto/shad.h"
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/* Job stages */
+#define STAGE_CIPHER  (1 << 0)
+#define STAGE_HASH    (1 << 1)
+#define STAGE_COPY    (1 << 2)
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static void _cryptod_schedule(struct _cryptod *queue);
+
+static uint32_t _cryptod_job_size(const struct _cryptod_job *job)
+{
+	uint32_t size = 0;
+	uint8_t i;
+
+	for (i = 0; i < job->count; i++)
+		size += job->src[i].size;
+	return size;
+}
+
+static enum _cryptod_engine _cryptod_cipher_engine(const struct _cryptod_job *job)
+{
+	return job->cipher == CRYPTOD_CIPHER_TDES ?
+		CRYPTOD_ENGINE_TDES : CRYPTOD_ENGINE_AES;
+}
+
+static struct _buffer *_cryptod_hash_input(const struct _cryptod_job *job)
+{
+	return job->op == CRYPTOD_OP_CIPHER_HASH ? job->dst : job->src;
+}
+
+static uint8_t _cryptod_copy_width(const struct _cryptod_job *job)
+{
+	uint32_t bits = 0;
+	uint8_t i;
+
+	for (i = 0; i < job->count; i++)
+		bits |= (uint32_t)job->src[i].data | (uint32_t)job->dst[i].data |
+		        job->src[i].size;
+	return (bits & 3) ? DMA_DATA_WIDTH_BYTE : DMA_DATA_WIDTH_WORD;
+}
+
+/**
+ * \brief Mark a stage of the active job of an engine as done and update
+ * the scheduler.
+ */
+static void _cryptod_stage_done(struct _cryptod *queue,
+		enum _cryptod_engine engine, uint8_t stage, int status)
+{
+	struct _cryptod_job *job = queue->active[engine];
+	uint32_t flags;
+
+	assert(job);
+
+	flags = arch_irq_save();
+	queue->stats[engine].jobs++;
+	queue->stats[engine].bytes += _cryptod_job_size(job);
+	if (status < 0) {
+		job->status = status;
+		job->pending = 0;
+	}
+	job->running &= ~stage;
+	queue->active[engine] = NULL;
+	arch_irq_restore(flags);
+
+	_cryptod_schedule(queue);
+}
+
+#ifdef CONFIG_HAVE_AES
+static int _cryptod_aes_callback(void *arg)
+{
+	_cryptod_stage_done((struct _cryptod *)arg, CRYPTOD_ENGINE_AES,
+			    STAGE_CIPHER, 0);
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_HAVE_TDES
+static int _cryptod_tdes_callback(void *arg)
+{
+	_cryptod_stage_done((struct _cryptod *)arg, CRYPTOD_ENGINE_TDES,
+			    STAGE_CIPHER, 0);
+	return 0;
+}
+#endif
+
+static int _cryptod_start_cipher(struct _cryptod *queue,
+		struct _cryptod_job *job)
+{
+#if defined(CONFIG_HAVE_AES) || defined(CONFIG_HAVE_TDES)
+	struct _callback cb;
+#endif
+	uint32_t status = 1;
+
+	switch (job->cipher) {
+#ifdef CONFIG_HAVE_AES
+	case CRYPTOD_CIPHER_AES:
+		callback_set(&cb, _cryptod_aes_callback, queue);
+		queue->aes->cfg.encrypt = job->encrypt;
+		if (job->vector) {
+			memcpy(queue->aes->cfg.vector, job->vector,
+			       sizeof(queue->aes->cfg.vector));
+			aesd_configure_mode(queue->aes);
+		}
+		status = aesd_transfer_sg(queue->aes, job->src, job->dst,
+					  job->count, &cb);
+		break;
+#endif
+#ifdef CONFIG_HAVE_TDES
+	case CRYPTOD_CIPHER_TDES:
+		callback_set(&cb, _cryptod_tdes_callback, queue);
+		queue->tdes->cfg.encrypt = job->encrypt;
+		if (job->vector) {
+			memcpy(queue->tdes->cfg.vector, job->vector,
+			       sizeof(queue->tdes->cfg.vector));
+			tdesd_configure_mode(queue->tdes);
+		}
+		status = tdesd_transfer_sg(queue->tdes, job->src, job->dst,
+					   job->count, &cb);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	return status ? -EIO : 0;
+}
+
+#ifdef CONFIG_HAVE_SHA
+static int _cryptod_hash_callback(void *arg)
+{
+	struct _cryptod *queue = (struct _cryptod *)arg;
+	struct _cryptod_job *job = queue->active[CRYPTOD_ENGINE_SHA];
+	struct _callback cb;
+	int err;
+
+	callback_set(&cb, _cryptod_hash_callback, queue);
+
+	if (job->hash_index < job->count) {
+		/* feed next segment */
+		err = shad_update(queue->sha,
+				  &_cryptod_hash_input(job)[job->hash_index++],
+				  &cb);
+	} else if (job->hash_index == job->count) {
+		/* all segments processed, compute digest */
+		job->hash_index++;
+		err = shad_finish(queue->sha, job->digest, &cb);
+	} else {
+		/* digest written */
+		err = 0;
+		_cryptod_stage_done(queue, CRYPTOD_ENGINE_SHA, STAGE_HASH, 0);
+	}
+
+	if (err < 0)
+		_cryptod_stage_done(queue, CRYPTOD_ENGINE_SHA, STAGE_HASH, err);
+	return 0;
+}
+#endif
+
+static int _cryptod_start_hash(struct _cryptod *queue,
+		struct _cryptod_job *job)
+{
+#ifdef CONFIG_HAVE_SHA
+	int err;
+
+	err = shad_start(queue->sha);
+	if (err < 0)
+		return err;
+
+	/* the hash callback chains all shad_update calls then shad_finish */
+	job->hash_index = 0;
+	_cryptod_hash_callback(queue);
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+static int _cryptod_copy_callback(void *arg)
+{
+	struct _cryptod *queue = (struct _cryptod *)arg;
+	struct _cryptod_job *job = queue->active[CRYPTOD_ENGINE_COPY];
+	uint8_t i;
+
+	for (i = 0; i < job->count; i++)
+		cache_invalidate_region(job->dst[i].data, job->dst[i].size);
+
+	_cryptod_stage_done(queue, CRYPTOD_ENGINE_COPY, STAGE_COPY, 0);
+	return 0;
+}
+
+static int _cryptod_start_copy(struct _cryptod *queue,
+		struct _cryptod_job *job)
+{
+	struct _dma_transfer_cfg cfg[CRYPTOD_MAX_SG];
+	struct _dma_cfg cfg_dma;
+	struct _callback cb;
+	uint8_t width, i;
+
+	memset(&cfg_dma, 0, sizeof(cfg_dma));
+	cfg_dma.incr_saddr = true;
+	cfg_dma.incr_daddr = true;
+	cfg_dma.data_width = _cryptod_copy_width(job);
+	cfg_dma.chunk_size = DMA_CHUNK_SIZE_1;
+	width = DMA_DATA_WIDTH_IN_BYTE(cfg_dma.data_width);
+
+	memset(cfg, 0, sizeof(cfg));
+	for (i = 0; i < job->count; i++) {
+		cache_clean_region(job->src[i].data, job->src[i].size);
+		cfg[i].saddr = job->src[i].data;
+		cfg[i].daddr = job->dst[i].data;
+		cfg[i].len = job->src[i].size / width;
+	}
+
+	if (dma_configure_transfer(queue->copy_channel, &cfg_dma, cfg,
+				   job->count) < 0)
+		return -EIO;
+
+	callback_set(&cb, _cryptod_copy_callback, queue);
+	dma_set_callback(queue->copy_channel, &cb);
+	dma_start_transfer(queue->copy_channel);
+	return 0;
+}
+
+/**
+ * \brief Start one stage of a job on an idle engine.
+ * The engine is marked busy before starting, as polling mode drivers
+ * complete before returning.
+ */
+static void _cryptod_start(struct _cryptod *queue, struct _cryptod_job *job,
+		enum _cryptod_engine engine, uint8_t stage)
+{
+	uint32_t flags;
+	int err;
+
+	flags = arch_irq_save();
+	job->pending &= ~stage;
+	job->running |= stage;
+	queue->active[engine] = job;
+	arch_irq_restore(flags);
+
+	switch (stage) {
+	case STAGE_CIPHER:
+		err = _cryptod_start_cipher(queue, job);
+		break;
+	case STAGE_HASH:
+		err = _cryptod_start_hash(queue, job);
+		break;
+	default:
+		err = _cryptod_start_copy(queue, job);
+		break;
+	}
+
+	if (err < 0) {
+		trace_error("cryptod: cannot start engine %d (%d)\r\n",
+			    engine, err);
+		_cryptod_stage_done(queue, engine, stage, err);
+	}
+}
+
+/**
+ * \brief Start pending stages on idle engines.
+ * Each engine serves jobs in submission order, so that cipher jobs chaining
+ * their IV from the previous job see it in the expected state.
+ */
+static void _cryptod_dispatch(struct _cryptod *queue)
+{
+	struct _cryptod_job *job;
+	bool cipher_seen[CRYPTOD_ENGINE_COUNT] = { false };
+	bool hash_seen = false;
+	bool copy_seen = false;
+	enum _cryptod_engine engine;
+
+	for (job = queue->head; job; job = job->next) {
+		uint8_t pending = job->pending;
+
+		if (pending & STAGE_CIPHER) {
+			engine = _cryptod_cipher_engine(job);
+			if (!cipher_seen[engine]) {
+				cipher_seen[engine] = true;
+				if (!queue->active[engine])
+					_cryptod_start(queue, job, engine,
+						       STAGE_CIPHER);
+			}
+		}
+
+		/* encrypt-then-MAC hashes the cipher output */
+		if ((pending & STAGE_HASH) && !hash_seen &&
+		    !((job->pending | job->running) & STAGE_CIPHER &&
+		      job->op == CRYPTOD_OP_CIPHER_HASH)) {
+			hash_seen = true;
+			if (!queue->active[CRYPTOD_ENGINE_SHA])
+				_cryptod_start(queue, job, CRYPTOD_ENGINE_SHA,
+					       STAGE_HASH);
+		}
+
+		if ((pending & STAGE_COPY) && !copy_seen) {
+			copy_seen = true;
+			if (!queue->active[CRYPTOD_ENGINE_COPY])
+				_cryptod_start(queue, job, CRYPTOD_ENGINE_COPY,
+					       STAGE_COPY);
+		}
+	}
+}
+
+/**
+ * \brief Retire completed jobs in submission order.
+ */
+static void _cryptod_complete(struct _cryptod *queue)
+{
+	struct _cryptod_job *job;
+	uint32_t flags;
+
+	for (;;) {
+		flags = arch_irq_save();
+		job = queue->head;
+		if (!job || job->pending || job->running) {
+			arch_irq_restore(flags);
+			break;
+		}
+		queue->head = job->next;
+		if (!queue->head)
+			queue->tail = NULL;
+		queue->depth--;
+		arch_irq_restore(flags);
+
+		if (job->status == -EINPROGRESS)
+			job->status = 0;
+		callback_call(&job->callback);
+	}
+}
+
+/**
+ * \brief Run the scheduler.
+ * May be called from interrupt context or recursively from polling mode
+ * drivers: nested calls only flag the running scheduler to loop again.
+ */
+static void _cryptod_schedule(struct _cryptod *queue)
+{
+	uint32_t flags;
+
+	flags = arch_irq_save();
+	if (queue->scheduling) {
+		queue->reschedule = true;
+		arch_irq_restore(flags);
+		return;
+	}
+	queue->scheduling = true;
+	arch_irq_restore(flags);
+
+	for (;;) {
+		queue->reschedule = false;
+		_cryptod_complete(queue);
+		_cryptod_dispatch(queue);
+
+		flags = arch_irq_save();
+		if (!queue->reschedule) {
+			queue->scheduling = false;
+			arch_irq_restore(flags);
+			break;
+		}
+		arch_irq_restore(flags);
+	}
+}
+
+static bool _cryptod_overlap(const struct _buffer *a,
+		const struct _buffer *b, uint8_t count)
+{
+	uint8_t i, j;
+
+	for (i = 0; i < count; i++)
+		for (j = 0; j < count; j++)
+			if (a[i].data < b[j].data + b[j].size &&
+			    b[j].data < a[i].data + a[i].size)
+				return true;
+	return false;
+}
+
+static int _cryptod_check_job(struct _cryptod *queue,
+		const struct _cryptod_job *job)
+{
+	bool cipher, hash, copy;
+	uint8_t i;
+
+	if (!job->src || job->count == 0 || job->count > CRYPTOD_MAX_SG)
+		return -EINVAL;
+
+	cipher = job->op == CRYPTOD_OP_CIPHER ||
+	         job->op == CRYPTOD_OP_CIPHER_HASH ||
+	         job->op == CRYPTOD_OP_HASH_CIPHER;
+	hash = job->op != CRYPTOD_OP_CIPHER;
+	copy = job->op == CRYPTOD_OP_HASH_COPY;
+
+	if ((cipher || copy) && !job->dst)
+		return -EINVAL;
+	for (i = 0; (cipher || copy) && i < job->count; i++)
+		if (job->dst[i].size != job->src[i].size)
+			return -EINVAL;
+
+	/* the hash reads the source while the cipher writes the destination:
+	 * they must not overlap */
+	if (job->op == CRYPTOD_OP_HASH_CIPHER &&
+	    _cryptod_overlap(job->src, job->dst, job->count))
+		return -EINVAL;
+
+	if (cipher) {
+		switch (job->cipher) {
+#ifdef CONFIG_HAVE_AES
+		case CRYPTOD_CIPHER_AES:
+			if (!queue->aes || job->count > AESD_MAX_SG)
+				return -ENOTSUP;
+			break;
+#endif
+#ifdef CONFIG_HAVE_TDES
+		case CRYPTOD_CIPHER_TDES:
+			if (!queue->tdes || job->count > TDESD_MAX_SG)
+				return -ENOTSUP;
+			break;
+#endif
+		default:
+			return -ENOTSUP;
+		}
+	}
+
+	if (hash) {
+#ifdef CONFIG_HAVE_SHA
+		if (!queue->sha || !job->digest ||
+		    job->digest->size != shad_get_output_size(queue->sha->cfg.algo))
+			return -EINVAL;
+		for (i = 0; i + 1 < job->count; i++)
+			if (job->src[i].size & 3)
+				return -EINVAL;
+#else
+		return -ENOTSUP;
+#endif
+	}
+
+	if (copy) {
+		uint8_t width = DMA_DATA_WIDTH_IN_BYTE(_cryptod_copy_width(job));
+		if (!queue->copy_channel)
+			return -ENOTSUP;
+		for (i = 0; i < job->count; i++)
+			if (job->src[i].size / width > DMA_MAX_BT_SIZE)
+				return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+int cryptod_init(struct _cryptod *queue)
+{
+	queue->copy_channel = dma_allocate_channel(DMA_PERIPH_MEMORY,
+						   DMA_PERIPH_MEMORY);
+	if (!queue->copy_channel)
+		trace_warning("cryptod: no DMA channel for hash-while-copy\r\n");
+
+	queue->head = NULL;
+	queue->tail = NULL;
+	memset((void *)queue->active, 0, sizeof(queue->active));
+	queue->scheduling = false;
+	queue->reschedule = false;
+	cryptod_reset_stats(queue);
+
+	return 0;
+}
+
+int cryptod_submit(struct _cryptod *queue, struct _cryptod_job *job,
+		struct _callback *cb)
+{
+	uint32_t flags;
+	int err;
+
+	err = _cryptod_check_job(queue, job);
+	if (err < 0)
+		return err;
+
+	switch (job->op) {
+	case CRYPTOD_OP_CIPHER:
+		job->pending = STAGE_CIPHER;
+		break;
+	case CRYPTOD_OP_HASH:
+		job->pending = STAGE_HASH;
+		break;
+	case CRYPTOD_OP_HASH_COPY:
+		job->pending = STAGE_HASH | STAGE_COPY;
+		break;
+	default:
+		job->pending = STAGE_CIPHER | STAGE_HASH;
+		break;
+	}
+	job->running = 0;
+	job->hash_index = 0;
+	job->next = NULL;
+	job->status = -EINPROGRESS;
+	callback_copy(&job->callback, cb);
+
+	flags = arch_irq_save();
+	if (queue->tail)
+		queue->tail->next = job;
+	else
+		queue->head = job;
+	queue->tail = job;
+	queue->depth++;
+	if (queue->depth > queue->max_depth)
+		queue->max_depth = queue->depth;
+	arch_irq_restore(flags);
+
+	_cryptod_schedule(queue);
+	return 0;
+}
+
+bool cryptod_is_busy(struct _cryptod *queue)
+{
+	return queue->head != NULL;
+}
+
+void cryptod_wait(struct _cryptod *queue)
+{
+	while (cryptod_is_busy(queue))
+		dma_poll();
+}
+
+void cryptod_get_stats(struct _cryptod *queue, enum _cryptod_engine engine,
+		struct _cryptod_stats *stats)
+{
+	uint64_t elapsed;
+	uint32_t flags;
+
+	assert(engine < CRYPTOD_ENGINE_COUNT);
+
+	flags = arch_irq_save();
+	stats->jobs = queue->stats[engine].jobs;
+	stats->bytes = queue->stats[engine].bytes;
+	arch_irq_restore(flags);
+
+	elapsed = timer_get_tick() - queue->stats_start;
+	stats->bytes_per_sec = elapsed ?
+		(uint32_t)((stats->bytes * 1000) / elapsed) : 0;
+}
+
+uint32_t cryptod_get_max_depth(struct _cryptod *queue)
+{
+	return queue->max_depth;
+}
+
+void cryptod_reset_stats(struct _cryptod *queue)
+{
+	uint32_t flags;
+
+	flags = arch_irq_save();
+	memset(queue->stats, 0, sizeof(queue->stats));
+	queue->max_depth = queue->depth;
+	queue->stats_start = timer_get_tick();
+	arch_irq_restore(flags);
+}
@@ -0,0 +1,221 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Crypto request queue.
+ *
+ * Jobs submitted to the queue are dispatched to the AES or TDES, SHA and
+ * memory DMA engines as soon as each engine is free, so that the cipher
+ * engine processes job N+1 while the SHA engine hashes job N.  Each job
+ * works on a scatter-gather list of buffers and may combine a cipher and a
+ * hash operation:
+ * - CRYPTOD_OP_CIPHER_HASH ciphers the source then hashes the result
+ *   (encrypt-then-MAC),
+ * - CRYPTOD_OP_HASH_CIPHER hashes the source while ciphering it (verify and
+ *   decrypt an encrypt-then-MAC message), source and destination must not
+ *   overlap,
+ * - CRYPTOD_OP_HASH_COPY hashes the source while copying it by DMA.
+ *
+ * Completion callbacks are invoked in submission order, usually from
+ * interrupt context.  Key, mode and hash algorithm are taken from the
+ * configuration of the underlying aesd/tdesd/shad descriptors, which must be
+ * set up in DMA mode.
+ */
+
+#ifndef CRYPTOD_H
+#define CRYPTOD_H
+
+/*------------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "callback.h"
+#include "dma/dma.h"
+#include "io.h"
+
+/*------------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Maximum number of buffers in a job scatter-gather list */
+#ifndef CRYPTOD_MAX_SG
+#define CRYPTOD_MAX_SG 8
+#endif
+
+/*------------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+struct _aesd_desc;
+struct _tdesd_desc;
+struct _shad_desc;
+
+enum _cryptod_op {
+	CRYPTOD_OP_CIPHER,       /**< cipher src into dst */
+	CRYPTOD_OP_HASH,         /**< hash src into digest */
+	CRYPTOD_OP_CIPHER_HASH,  /**< cipher src into dst, then hash dst */
+	CRYPTOD_OP_HASH_CIPHER,  /**< hash src and cipher it into dst */
+	CRYPTOD_OP_HASH_COPY,    /**< hash src and copy it into dst */
+};
+
+enum _cryptod_cipher {
+	CRYPTOD_CIPHER_AES,
+	CRYPTOD_CIPHER_TDES,
+};
+
+/** Engines for which statistics are gathered */
+enum _cryptod_engine {
+	CRYPTOD_ENGINE_AES,
+	CRYPTOD_ENGINE_TDES,
+	CRYPTOD_ENGINE_SHA,
+	CRYPTOD_ENGINE_COPY,
+	CRYPTOD_ENGINE_COUNT,
+};
+
+struct _cryptod_job {
+	/* --- job parameters --- */
+
+	enum _cryptod_op op;
+	enum _cryptod_cipher cipher;
+	bool encrypt;
+	/** IV or counter block for this job, NULL to chain from previous job */
+	const uint32_t *vector;
+	/** Source buffers, all sizes except the last one must be multiple of
+	 * 4 for hash operations */
+	struct _buffer *src;
+	/** Destination buffers (cipher output or copy), dst[i] must have the
+	 * same size as src[i] */
+	struct _buffer *dst;
+	/** Number of source (and destination) buffers */
+	uint8_t count;
+	/** Digest output for hash operations */
+	struct _buffer *digest;
+
+	/** Job status: -EINPROGRESS while queued, 0 or error when done */
+	volatile int status;
+
+	/* --- following fields are used internally --- */
+
+	struct _callback callback;
+	struct _cryptod_job *next;
+	volatile uint8_t pending;
+	volatile uint8_t running;
+	uint8_t hash_index;
+};
+
+struct _cryptod_stats {
+	uint32_t jobs;            /**< operations completed */
+	uint64_t bytes;           /**< bytes processed */
+	uint32_t bytes_per_sec;   /**< average throughput since last reset */
+};
+
+struct _cryptod {
+	/* --- engines, set before cryptod_init --- */
+
+	struct _aesd_desc *aes;
+	struct _tdesd_desc *tdes;
+	struct _shad_desc *sha;
+
+	/* --- following fields are used internally --- */
+
+	struct _dma_channel *copy_channel;
+
+	struct _cryptod_job *head;
+	struct _cryptod_job *tail;
+
+	/** job currently processed by each engine */
+	struct _cryptod_job *volatile active[CRYPTOD_ENGINE_COUNT];
+
+	volatile bool scheduling;
+	volatile bool reschedule;
+
+	uint32_t depth;
+	uint32_t max_depth;
+	uint64_t stats_start;
+	struct {
+		uint32_t jobs;
+		uint64_t bytes;
+	} stats[CRYPTOD_ENGINE_COUNT];
+};
+
+/*------------------------------------------------------------------------------
+ *        Functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Initialize a crypto queue.
+ * \param queue  queue with the aes, tdes and sha fields set to initialized
+ * driver descriptors (NULL when unused)
+ * \return 0 on success, <0 on error
+ */
+extern int cryptod_init(struct _cryptod *queue);
+
+/**
+ * \brief Submit a job.
+ * \param queue  crypto queue
+ * \param job  job to process, must remain valid until completion
+ * \param cb  callback invoked once the job is done (may be NULL)
+ * \return 0 on success, -EINVAL if the job cannot be processed by the
+ * configured engines
+ */
+extern int cryptod_submit(struct _cryptod *queue, struct _cryptod_job *job,
+		struct _callback *cb);
+
+/**
+ * \brief Check if jobs are pending in the queue.
+ */
+extern bool cryptod_is_busy(struct _cryptod *queue);
+
+/**
+ * \brief Wait for all submitted jobs to complete.
+ */
+extern void cryptod_wait(struct _cryptod *queue);
+
+/**
+ * \brief Get the processing statistics of an engine.
+ */
+extern void cryptod_get_stats(struct _cryptod *queue,
+		enum _cryptod_engine engine, struct _cryptod_stats *stats);
+
+/**
+ * \brief Get the maximum number of jobs queued since last reset.
+ */
+extern uint32_t cryptod_get_max_depth(struct _cryptod *queue);
+
+/**
+ * \brief Reset statistics.
+ */
+extern void cryptod_reset_stats(struct _cryptod *queue);
+
+#endif /* CRYPTOD_H */
@@ -451,8 +451,10 @@ int shad_finish(struct _shad_desc* desc, struct _buffer* buffer,
 		return -EAGAIN;
 	}
 
-	if (buffer->size != shad_get_output_size(desc->cfg.algo))
+	if (buffer->size != shad_get_output_size(desc->cfg.algo)) {
+		mutex_unlock(&desc->mutex);
 		return -EINVAL;
+	}
 
 	callback_copy(&desc->xfer.callback, cb);
 	desc->xfer.buffer = buffer;
@@ -53,11 +53,14 @@ static int _tdesd_dma_rx_callback(void* arg)
 {
 	struct _tdesd_desc* desc = (struct _tdesd_desc*)arg;
 
+	uint8_t i;
+
 	/* To read, invalidate region */
 	dma_reset_channel(desc->xfer.dma.tx.channel);
 	dma_reset_channel(desc->xfer.dma.rx.channel);
-	cache_invalidate_region((uint32_t*)desc->xfer.bufout->data,
-				desc->xfer.bufout->size);
+	for (i = 0; i < desc->xfer.count; i++)
+		cache_invalidate_region((uint32_t*)desc->xfer.bufout[i].data,
+					desc->xfer.bufout[i].size);
 	mutex_unlock(&desc->mutex);
 
 	return callback_call(&desc->xfer.callback);
@@ -87,31 +90,40 @@ static uint8_t _tdesd_get_dma_data_width(struct _tdesd_desc* desc)
 
 static void _tdesd_transfer_buffer_dma(struct _tdesd_desc* desc)
 {
-	struct _dma_transfer_cfg cfg;
+	struct _dma_transfer_cfg cfg[TDESD_MAX_SG];
 	struct _dma_cfg cfg_dma;
 	struct _callback _cb;
-
-	cache_clean_region((uint32_t*)desc->xfer.bufin->data, desc->xfer.bufin->size);
+	uint8_t width, i;
 
 	memset(&cfg_dma, 0, sizeof(cfg_dma));
 	cfg_dma.incr_saddr = true;
 	cfg_dma.incr_daddr = false;
 	cfg_dma.data_width = _tdesd_get_dma_data_width(desc);
 	cfg_dma.chunk_size = DMA_CHUNK_SIZE_1;
-
-	memset(&cfg, 0, sizeof(cfg));
-	cfg.saddr = (void*)desc->xfer.bufin->data;
-	cfg.daddr = (void*)TDES->TDES_IDATAR;
-	cfg.len = desc->xfer.bufin->size / DMA_DATA_WIDTH_IN_BYTE(cfg_dma.data_width);
-	dma_configure_transfer(desc->xfer.dma.tx.channel, &cfg_dma, &cfg, 1);
+	width = DMA_DATA_WIDTH_IN_BYTE(cfg_dma.data_width);
+
+	memset(cfg, 0, sizeof(cfg));
+	for (i = 0; i < desc->xfer.count; i++) {
+		cache_clean_region((uint32_t*)desc->xfer.bufin[i].data,
+				   desc->xfer.bufin[i].size);
+		cfg[i].saddr = (void*)desc->xfer.bufin[i].data;
+		cfg[i].daddr = (void*)TDES->TDES_IDATAR;
+		cfg[i].len = desc->xfer.bufin[i].size / width;
+	}
+	dma_configure_transfer(desc->xfer.dma.tx.channel, &cfg_dma, cfg,
+			       desc->xfer.count);
 
 	cfg_dma.incr_saddr = false;
 	cfg_dma.incr_daddr = true;
 
-	cfg.saddr = (void*)desc->xfer.bufout->data;
-	cfg.daddr = (void*)TDES->TDES_ODATAR;
-	cfg.len = desc->xfer.bufout->size / DMA_DATA_WIDTH_IN_BYTE(cfg_dma.data_width);
-	dma_configure_transfer(desc->xfer.dma.rx.channel, &cfg_dma, &cfg, 1);
+	memset(cfg, 0, sizeof(cfg));
+	for (i = 0; i < desc->xfer.count; i++) {
+		cfg[i].saddr = (void*)TDES->TDES_ODATAR;
+		cfg[i].daddr = (void*)desc->xfer.bufout[i].data;
+		cfg[i].len = desc->xfer.bufout[i].size / width;
+	}
+	dma_configure_transfer(desc->xfer.dma.rx.channel, &cfg_dma, cfg,
+			       desc->xfer.count);
 
 	dma_set_callback(desc->xfer.dma.tx.channel, NULL);
 	callback_set(&_cb, _tdesd_dma_rx_callback, (void*)desc);
@@ -119,13 +131,12 @@ static void _tdesd_transfer_buffer_dma(struct _tdesd_desc* desc)
 
 	dma_start_transfer(desc->xfer.dma.tx.channel);
 	dma_start_transfer(desc->xfer.dma.rx.channel);
-
-	tdesd_wait_transfer(desc);
 }
 
 static void _tdesd_transfer_buffer_polling(struct _tdesd_desc* desc)
 {
 	uint32_t i;
+	uint8_t n;
 	uint8_t size = 8;
 
 	if (desc->cfg.mode == TDESD_MODE_CFB) {
@@ -137,53 +148,59 @@ static void _tdesd_transfer_buffer_polling(struct _tdesd_desc* desc)
 			size = 1;
 	}
 
-	/* Iterate per 64-bit data block */
-	for (i = 0; i < desc->xfer.bufin->size; i+= size) {
-		/* Write one 64/32-bit input data block to the authorized
-		Input Data Registers */
-		if (size == 8)
-			tdes_set_input((uint32_t *)((desc->xfer.bufin->data) + i),
-							(uint32_t *)((desc->xfer.bufin->data) + i + 4));
-		else
-			tdes_set_input((uint32_t *)((desc->xfer.bufin->data) + i), NULL);
-
-		if (desc->cfg.transfer_mode == TDES_MR_SMOD_MANUAL_START)
-			/* Set the START bit in the TDES Control
-			 * register to begin the encryption or
-			 * decryption process. */
-			tdes_start();
-
-		while ((tdes_get_status() & TDES_ISR_DATRDY) != TDES_ISR_DATRDY);
-
-		if (size == 8)
-			tdes_get_output((uint32_t *)((desc->xfer.bufout->data) + i),
-							(uint32_t *)((desc->xfer.bufout->data) + i + 4));
-		else
-			tdes_get_output((uint32_t *)((desc->xfer.bufout->data) + i), NULL);
+	for (n = 0; n < desc->xfer.count; n++) {
+		uint8_t* in = desc->xfer.bufin[n].data;
+		uint8_t* out = desc->xfer.bufout[n].data;
+
+		/* Iterate per 64-bit data block */
+		for (i = 0; i < desc->xfer.bufin[n].size; i+= size) {
+			/* Write one 64/32-bit input data block to the authorized
+			Input Data Registers */
+			if (size == 8)
+				tdes_set_input((uint32_t *)(in + i),
+						(uint32_t *)(in + i + 4));
+			else
+				tdes_set_input((uint32_t *)(in + i), NULL);
+
+			if (desc->cfg.transfer_mode == TDES_MR_SMOD_MANUAL_START)
+				/* Set the START bit in the TDES Control
+				 * register to begin the encryption or
+				 * decryption process. */
+				tdes_start();
+
+			while ((tdes_get_status() & TDES_ISR_DATRDY) != TDES_ISR_DATRDY);
+
+			if (size == 8)
+				tdes_get_output((uint32_t *)(out + i),
+						(uint32_t *)(out + i + 4));
+			else
+				tdes_get_output((uint32_t *)(out + i), NULL);
+		}
 	}
 	mutex_unlock(&desc->mutex);
 	callback_call(&desc->xfer.callback);
 }
 
-/*----------------------------------------------------------------------------
- *        Public functions
- *----------------------------------------------------------------------------*/
-
-uint32_t tdesd_transfer(struct _tdesd_desc* desc, struct _buffer* buffer_in,
-			struct _buffer* buffer_out, struct _callback* cb)
+static uint32_t _tdesd_transfer(struct _tdesd_desc* desc, struct _buffer* buffer_in,
+			struct _buffer* buffer_out, uint8_t count, struct _callback* cb)
 {
-	desc->xfer.bufin = buffer_in;
-	desc->xfer.bufout = buffer_out;
-	callback_copy(&desc->xfer.callback, cb);
+	uint8_t i;
 
-	assert(!(desc->xfer.bufin->size % (1 << _tdesd_get_dma_data_width(desc))));
-	assert(!(desc->xfer.bufout->size % (1 << _tdesd_get_dma_data_width(desc))));
+	for (i = 0; i < count; i++) {
+		assert(!(buffer_in[i].size % (1 << _tdesd_get_dma_data_width(desc))));
+		assert(buffer_out[i].size == buffer_in[i].size);
+	}
 
 	if (!mutex_try_lock(&desc->mutex)) {
-		trace_error("AESD mutex already locked!\r\n");
+		trace_error("TDESD mutex already locked!\r\n");
 		return ADES_ERROR_LOCK;
 	}
 
+	desc->xfer.bufin = buffer_in;
+	desc->xfer.bufout = buffer_out;
+	desc->xfer.count = count;
+	callback_copy(&desc->xfer.callback, cb);
+
 	switch (desc->cfg.transfer_mode) {
 	case TDESD_TRANS_POLLING_MANUAL:
 	case TDESD_TRANS_POLLING_AUTO:
@@ -196,12 +213,36 @@ uint32_t tdesd_transfer(struct _tdesd_desc* desc, struct _buffer* buffer_in,
 
 	default:
 		mutex_unlock(&desc->mutex);
-		trace_fatal("Unknown AES transfer mode\r\n");
+		trace_fatal("Unknown TDES transfer mode\r\n");
 	}
 
 	return TDESD_SUCCESS;
 }
 
+/*----------------------------------------------------------------------------
+ *        Public functions
+ *----------------------------------------------------------------------------*/
+
+uint32_t tdesd_transfer(struct _tdesd_desc* desc, struct _buffer* buffer_in,
+			struct _buffer* buffer_out, struct _callback* cb)
+{
+	uint32_t status = _tdesd_transfer(desc, buffer_in, buffer_out, 1, cb);
+
+	if (status == TDESD_SUCCESS && desc->cfg.transfer_mode == TDESD_TRANS_DMA)
+		tdesd_wait_transfer(desc);
+
+	return status;
+}
+
+uint32_t tdesd_transfer_sg(struct _tdesd_desc* desc, struct _buffer* buffer_in,
+			struct _buffer* buffer_out, uint8_t count, struct _callback* cb)
+{
+	if (count == 0 || count > TDESD_MAX_SG)
+		return TDESD_ERROR_TRANSFER;
+
+	return _tdesd_transfer(desc, buffer_in, buffer_out, count, cb);
+}
+
 bool tdesd_is_busy(struct _tdesd_desc* desc)
 {
 	return mutex_is_locked(&desc->mutex);
@@ -46,6 +46,11 @@
  *        Types
  *----------------------------------------------------------------------------*/
 
+/** Maximum number of buffers in a scatter-gather transfer */
+#ifndef TDESD_MAX_SG
+#define TDESD_MAX_SG          (8)
+#endif
+
 #define TDESD_SUCCESS         (0)
 #define ADES_ERROR_LOCK       (1)
 #define TDESD_ERROR_TRANSFER  (2)
@@ -102,6 +107,7 @@ struct _tdesd_desc {
 	struct {
 		struct _buffer *bufin;         /*< buffer input */
 		struct _buffer *bufout;        /*< buffer output */
+		uint8_t count;                 /*< number of buffers */
 		struct _callback callback;
 
 		struct {
@@ -122,6 +128,22 @@ extern uint32_t tdesd_transfer(struct _tdesd_desc* desc,
 		struct _buffer* buffer_in, struct _buffer* buffer_out,
 			       struct _callback* cb);
 
+/**
+ * \brief Start a scatter-gather transfer, without waiting for completion.
+ * \param desc  TDES driver descriptor
+ * \param buffer_in  array of input buffers
+ * \param buffer_out  array of output buffers, buffer_out[i] having the same
+ * size as buffer_in[i]
+ * \param count  number of buffers (up to TDESD_MAX_SG)
+ * \param cb  callback invoked when all buffers are processed
+ * \note In DMA mode, the callback is invoked from interrupt context and
+ * buffers must be cache-line aligned. Polling modes complete before
+ * returning.
+ */
+extern uint32_t tdesd_transfer_sg(struct _tdesd_desc* desc,
+		struct _buffer* buffer_in, struct _buffer* buffer_out,
+		uint8_t count, struct _callback* cb);
+
 extern bool tdesd_is_busy(struct _tdesd_desc* desc);
 
 extern void tdesd_wait_transfer(struct _tdesd_desc* desc);
@@ -126,6 +126,16 @@ void trng_disable_it(void)
 	_trng_callback_arg = NULL;
 }
 
+void trng_suspend_it(void)
+{
+	TRNG->TRNG_IDR = TRNG_IDR_DATRDY;
+}
+
+void trng_resume_it(void)
+{
+	TRNG->TRNG_IER = TRNG_IER_DATRDY;
+}
+
 uint32_t trng_get_random_data(void)
 {
 	while (!(TRNG->TRNG_ISR & TRNG_ISR_DATRDY));
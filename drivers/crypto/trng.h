@@ -73,6 +73,17 @@ extern void trng_enable_it(trng_callback_t cb, void* user_arg);
  */
 extern void trng_disable_it(void);
 
+/**
+ * \brief Temporarily mask the TRNG interrupt, keeping the callback
+ * registered by trng_enable_it().
+ */
+extern void trng_suspend_it(void);
+
+/**
+ * \brief Unmask the TRNG interrupt masked by trng_suspend_it().
+ */
+extern void trng_resume_it(void);
+
 /**
  * \brief Get the next random value generated by the TRNG. This function will
  * block until a value is available.
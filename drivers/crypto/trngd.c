@@ -0,0 +1,370 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Implementation of the TRNG entropy pool and AES CTR-DRBG
+ *
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include "chip.h"
+
+#include "crypto/aes.h"
+#include "crypto/aesd.h"
+#include "crypto/trng.h"
+#include "crypto/trngd.h"
+#include "errno.h"
+#include "intmath.h"
+#include "mutex.h"
+#include "peripherals/pmc.h"
+#include "ring.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(CONFIG_HAVE_TRNG) && defined(CONFIG_HAVE_AES)
+
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+/** DRBG seed length: AES-256 key + one block, in words */
+#define SEED_WORDS 12
+
+/** Number of counter blocks encrypted per AES batch */
+#define BATCH_BLOCKS 16
+
+/** Maximum bytes produced between two DRBG state updates */
+#define MAX_REQUEST 4096
+
+/*----------------------------------------------------------------------------
+ *        Local Data
+ *----------------------------------------------------------------------------*/
+
+static struct {
+	/* entropy pool, filled from the TRNG interrupt */
+	volatile uint32_t pool[TRNGD_POOL_SIZE];
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	uint32_t last_raw;
+	uint32_t half;
+	bool has_half;
+
+	/* CTR-DRBG state */
+	mutex_t mutex;
+	struct _aesd_desc* aes;
+	bool seeded;
+	uint32_t key[8];
+	uint32_t v[4];
+	uint32_t reseed_counter;
+	uint32_t scratch[4 * BATCH_BLOCKS];
+
+	/* statistics */
+	volatile uint32_t raw_words;
+	volatile uint32_t health_failures;
+	uint32_t reseeds;
+	uint32_t starved;
+	uint64_t bytes;
+} _trngd;
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Add a raw TRNG value to the pool.
+ * Values identical to the previous one are rejected (repetition count
+ * test), then two raw values are folded into one pool word.
+ */
+static void _trngd_feed(uint32_t raw)
+{
+	_trngd.raw_words++;
+
+	if (raw == _trngd.last_raw) {
+		_trngd.health_failures++;
+		return;
+	}
+	_trngd.last_raw = raw;
+
+	if (!_trngd.has_half) {
+		_trngd.half = raw;
+		_trngd.has_half = true;
+		return;
+	}
+	_trngd.has_half = false;
+
+	if (RING_SPACE(_trngd.head, _trngd.tail, TRNGD_POOL_SIZE) == 0)
+		return;
+	_trngd.pool[_trngd.head] = _trngd.half ^ ((raw << 16) | (raw >> 16));
+	RING_INC(_trngd.head, TRNGD_POOL_SIZE);
+}
+
+static void _trngd_trng_callback(uint32_t value, void* user_arg)
+{
+	_trngd_feed(value);
+
+	/* stop interrupts until the DRBG consumes the pool */
+	if (RING_SPACE(_trngd.head, _trngd.tail, TRNGD_POOL_SIZE) == 0)
+		trng_suspend_it();
+}
+
+/**
+ * \brief Take the AES engine from the aesd descriptor sharing it.
+ * \return false if an aesd transfer is in progress
+ */
+static bool _trngd_lock_aes(void)
+{
+	return !_trngd.aes || mutex_try_lock(&_trngd.aes->mutex);
+}
+
+/**
+ * \brief Give the AES engine back, programmed as aesd left it.
+ */
+static void _trngd_unlock_aes(void)
+{
+	if (!_trngd.aes)
+		return;
+	aesd_configure_mode(_trngd.aes);
+	mutex_unlock(&_trngd.aes->mutex);
+}
+
+/**
+ * \brief Encrypt blocks in place with AES-256 in ECB mode.
+ * The AES engine must be locked (_trngd_lock_aes).
+ */
+static void _trngd_aes_ecb(const uint32_t* key, uint32_t* data,
+		uint32_t blocks)
+{
+	uint32_t i;
+
+	aes_soft_reset();
+	aes_configure(AES_MR_CIPHER | AES_MR_OPMOD_ECB |
+		      AES_MR_KEYSIZE_AES256 | AES_MR_SMOD_AUTO_START);
+	aes_write_key(key, 32);
+
+	for (i = 0; i < blocks; i++) {
+		aes_set_input(&data[4 * i]);
+		while (!(aes_get_status() & AES_ISR_DATRDY));
+		aes_get_output(&data[4 * i]);
+	}
+}
+
+/**
+ * \brief Increment V as a 128-bit big-endian counter.
+ */
+static void _trngd_increment_v(void)
+{
+	uint8_t* v = (uint8_t*)_trngd.v;
+	int i;
+
+	for (i = 15; i >= 0; i--)
+		if (++v[i])
+			break;
+}
+
+/**
+ * \brief CTR_DRBG_Update: derive a new key and V, optionally mixing in
+ * SEED_WORDS words of provided data.
+ */
+static void _trngd_update(const uint32_t* provided)
+{
+	uint32_t* temp = _trngd.scratch;
+	int i;
+
+	for (i = 0; i < SEED_WORDS / 4; i++) {
+		_trngd_increment_v();
+		memcpy(&temp[4 * i], _trngd.v, 16);
+	}
+	_trngd_aes_ecb(_trngd.key, temp, SEED_WORDS / 4);
+
+	if (provided)
+		for (i = 0; i < SEED_WORDS; i++)
+			temp[i] ^= provided[i];
+
+	memcpy(_trngd.key, &temp[0], sizeof(_trngd.key));
+	memcpy(_trngd.v, &temp[8], sizeof(_trngd.v));
+	memset(temp, 0, SEED_WORDS * sizeof(uint32_t));
+}
+
+/**
+ * \brief Reseed the DRBG if the pool holds a full seed.
+ */
+static bool _trngd_reseed(void)
+{
+	uint32_t seed[SEED_WORDS];
+	int i;
+
+	if (RING_CNT(_trngd.head, _trngd.tail, TRNGD_POOL_SIZE) < SEED_WORDS)
+		return false;
+
+	for (i = 0; i < SEED_WORDS; i++) {
+		seed[i] = _trngd.pool[_trngd.tail];
+		RING_INC(_trngd.tail, TRNGD_POOL_SIZE);
+	}
+	trng_resume_it();
+
+	_trngd_update(seed);
+	memset(seed, 0, sizeof(seed));
+
+	_trngd.reseed_counter = 1;
+	_trngd.reseeds++;
+	return true;
+}
+
+/**
+ * \brief CTR_DRBG_Generate for up to MAX_REQUEST bytes.
+ */
+static void _trngd_generate(uint8_t* out, uint32_t len)
+{
+	uint32_t blocks, size, i;
+
+	while (len) {
+		blocks = min_u32((len + 15) / 16, BATCH_BLOCKS);
+		for (i = 0; i < blocks; i++) {
+			_trngd_increment_v();
+			memcpy(&_trngd.scratch[4 * i], _trngd.v, 16);
+		}
+		_trngd_aes_ecb(_trngd.key, _trngd.scratch, blocks);
+
+		size = min_u32(len, 16 * blocks);
+		memcpy(out, _trngd.scratch, size);
+		out += size;
+		len -= size;
+	}
+	memset(_trngd.scratch, 0, sizeof(_trngd.scratch));
+
+	_trngd_update(NULL);
+	_trngd.reseed_counter++;
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+int trngd_init(struct _aesd_desc* aes)
+{
+	memset(&_trngd, 0, sizeof(_trngd));
+	_trngd.aes = aes;
+
+	pmc_enable_peripheral(ID_AES);
+	trng_enable();
+
+	/* instantiate: key = 0, V = 0, then update with a first seed */
+	while (RING_CNT(_trngd.head, _trngd.tail, TRNGD_POOL_SIZE) < SEED_WORDS) {
+		/* a stuck TRNG fails the repetition test forever */
+		if (_trngd.health_failures > SEED_WORDS) {
+			trng_disable();
+			return -EIO;
+		}
+		_trngd_feed(trng_get_random_data());
+	}
+	if (aes)
+		aesd_wait_transfer(aes);
+	if (!_trngd_lock_aes()) {
+		/* another aesd transfer started meanwhile */
+		trng_disable();
+		return -EBUSY;
+	}
+	_trngd_reseed();
+	_trngd_unlock_aes();
+	_trngd.seeded = true;
+
+	trng_enable_it(_trngd_trng_callback, NULL);
+
+	return 0;
+}
+
+int trngd_get_random(void* buf, uint32_t len)
+{
+	uint8_t* out = (uint8_t*)buf;
+	uint32_t remaining = len;
+	uint32_t chunks, size;
+
+	if (!_trngd.seeded)
+		return -EAGAIN;
+
+	if (!mutex_try_lock(&_trngd.mutex))
+		return -EBUSY;
+
+	if (!_trngd_lock_aes()) {
+		mutex_unlock(&_trngd.mutex);
+		return -EBUSY;
+	}
+
+	/* fail before writing anything if the whole request could go past
+	 * the reseed limit: later reseeds only lower the counter */
+	chunks = len / MAX_REQUEST + (len % MAX_REQUEST != 0);
+	if (_trngd.reseed_counter > TRNGD_RESEED_INTERVAL && !_trngd_reseed())
+		_trngd.starved++;
+	if (chunks && _trngd.reseed_counter + chunks - 1 > TRNGD_RESEED_LIMIT) {
+		_trngd_unlock_aes();
+		mutex_unlock(&_trngd.mutex);
+		return -EAGAIN;
+	}
+
+	while (remaining) {
+		size = min_u32(remaining, MAX_REQUEST);
+		_trngd_generate(out, size);
+		out += size;
+		remaining -= size;
+
+		if (remaining && _trngd.reseed_counter > TRNGD_RESEED_INTERVAL &&
+		    !_trngd_reseed())
+			_trngd.starved++;
+	}
+	_trngd.bytes += len;
+
+	_trngd_unlock_aes();
+	mutex_unlock(&_trngd.mutex);
+	return (int)len;
+}
+
+uint32_t trngd_get_pool_level(void)
+{
+	return RING_CNT(_trngd.head, _trngd.tail, TRNGD_POOL_SIZE);
+}
+
+void trngd_get_stats(struct _trngd_stats* stats)
+{
+	stats->pool_level = trngd_get_pool_level();
+	stats->pool_size = TRNGD_POOL_SIZE - 1;
+	stats->raw_words = _trngd.raw_words;
+	stats->health_failures = _trngd.health_failures;
+	stats->reseeds = _trngd.reseeds;
+	stats->starved = _trngd.starved;
+	stats->bytes = _trngd.bytes;
+}
+
+#endif /* CONFIG_HAVE_TRNG && CONFIG_HAVE_AES */
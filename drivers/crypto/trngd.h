@@ -0,0 +1,137 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Entropy service built on the TRNG and AES peripherals.
+ *
+ * TRNG values are collected from the TRNG interrupt into an entropy pool.
+ * Raw values go through a repetition health test and are whitened by
+ * folding two raw words into one. The pool reseeds a CTR-DRBG (NIST SP
+ * 800-90A, AES-256, no derivation function) running on the AES engine, which
+ * produces the random bytes, so requests never wait for the TRNG.
+ *
+ * The AES engine is shared with aesd through the descriptor given to
+ * trngd_init(): requests take its lock, fail while an aesd transfer is in
+ * progress and leave the engine programmed with the aesd configuration, so
+ * that chained aesd/cryptod jobs are not disturbed.
+ *
+ * The TRNG interrupt is masked while the pool is full.
+ */
+
+#ifndef _TRNGD_H_
+#define _TRNGD_H_
+
+#if defined(CONFIG_HAVE_TRNG) && defined(CONFIG_HAVE_AES)
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "crypto/aesd.h"
+
+/*------------------------------------------------------------------------------
+ *         Definitions
+ *------------------------------------------------------------------------------*/
+
+/** Entropy pool size, in 32-bit words (power of two) */
+#ifndef TRNGD_POOL_SIZE
+#define TRNGD_POOL_SIZE 64
+#endif
+
+/** Number of generate requests after which the DRBG is reseeded as soon as
+ * the pool holds enough entropy */
+#ifndef TRNGD_RESEED_INTERVAL
+#define TRNGD_RESEED_INTERVAL 256
+#endif
+
+/** Number of generate requests after which the DRBG refuses to generate
+ * until reseeded */
+#ifndef TRNGD_RESEED_LIMIT
+#define TRNGD_RESEED_LIMIT (1u << 20)
+#endif
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+struct _trngd_stats {
+	uint32_t pool_level;       /**< whitened words available in pool */
+	uint32_t pool_size;        /**< pool capacity, in words */
+	uint32_t raw_words;        /**< raw words read from the TRNG */
+	uint32_t health_failures;  /**< raw words rejected by health test */
+	uint32_t reseeds;          /**< DRBG reseeds */
+	uint32_t starved;          /**< reseeds delayed by an empty pool */
+	uint64_t bytes;            /**< random bytes generated */
+};
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Start the entropy service.
+ * Instantiates the DRBG from the TRNG (about 100 TRNG values) then enables
+ * the pool refill interrupt.
+ * \param aes  AES driver descriptor of the other users of the AES engine
+ * (e.g. the cryptod queue one), NULL if there is none
+ * \return 0 on success, -EIO if the TRNG fails its health test, -EBUSY if
+ * an aesd transfer holds the AES engine
+ */
+extern int trngd_init(struct _aesd_desc* aes);
+
+/**
+ * \brief Fill a buffer with random bytes, without waiting for the TRNG.
+ * \param buf  destination buffer
+ * \param len  number of bytes
+ * \return len on success, -EAGAIN if the service is not started or the DRBG
+ * needs a reseed that the pool cannot provide yet (nothing is written to
+ * buf then), -EBUSY if called while
+ * another request (e.g. from an interrupt) or an aesd transfer is in
+ * progress.
+ */
+extern int trngd_get_random(void *buf, uint32_t len);
+
+/**
+ * \brief Get the number of whitened words available in the entropy pool.
+ */
+extern uint32_t trngd_get_pool_level(void);
+
+/**
+ * \brief Get the entropy service statistics.
+ */
+extern void trngd_get_stats(struct _trngd_stats *stats);
+
+#endif /* CONFIG_HAVE_TRNG && CONFIG_HAVE_AES */
+
+#endif /* _TRNGD_H_ */
@@ -68,6 +68,8 @@
  *
  * For LCD string display, refer to \ref lcdc_font.
  *
+ * For accelerated fills, copies and blending, refer to \ref lcdc_2d.
+ *
  * @{
  *   \defgroup lcdc_base LCD Driver General Operations
  *   @{
@@ -0,0 +1,599 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include "chip.h"
+#include "compiler.h"
+
+#include "display/lcdc.h"
+#include "display/lcdc_2d.h"
+#include "mm/cache.h"
+#include "errno.h"
+
+#ifdef CONFIG_HAVE_XDMAC
+#include "dma/dma.h"
+#endif
+
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include <stddef.h>
+#include <string.h>
+
+/** \addtogroup lcdc_2d
+ *@{
+ */
+
+/*----------------------------------------------------------------------------
+ *        Local types
+ *----------------------------------------------------------------------------*/
+
+struct _lcdc_2d {
+#ifdef CONFIG_HAVE_XDMAC
+	struct _dma_channel *dma;  /**< Memory-to-memory channel */
+	void *pending_addr;        /**< Destination of the pending transfer */
+	uint32_t pending_len;      /**< Length of the pending transfer span */
+#endif
+	struct _lcdc_2d_stats stats;
+};
+
+/*----------------------------------------------------------------------------
+ *        Local variables
+ *----------------------------------------------------------------------------*/
+
+static struct _lcdc_2d _lcdc_2d;
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * Clip a rectangle to the surface bounds.
+ * \return false if nothing is left to draw.
+ */
+static bool _clip(const struct _lcdc_layer *s, uint32_t x, uint32_t y,
+		uint32_t *w, uint32_t *h)
+{
+	if (!s->buffer || x >= s->width || y >= s->height)
+		return false;
+	if (*w > s->width - x)
+		*w = s->width - x;
+	if (*h > s->height - y)
+		*h = s->height - y;
+	return *w && *h;
+}
+
+static inline uint8_t *_pixel_addr(const struct _lcdc_layer *s,
+		uint32_t x, uint32_t y)
+{
+	return (uint8_t *)s->buffer + y * lcdc_2d_get_pitch(s)
+		+ x * (s->bpp >> 3);
+}
+
+/** Rounded division by 255, exact for v in [0, 255 * 255] */
+static inline uint32_t _div255(uint32_t v)
+{
+	return (v + 128 + ((v + 128) >> 8)) >> 8;
+}
+
+static uint32_t _blend_argb8888(uint32_t s, uint32_t d, uint32_t alpha)
+{
+	uint32_t a = _div255((s >> 24) * alpha);
+	uint32_t ia = 255 - a;
+	uint32_t r, g, b, da;
+
+	if (a == 0)
+		return d;
+	if (a == 255)
+		return s;
+
+	r = _div255(((s >> 16) & 0xff) * a + ((d >> 16) & 0xff) * ia);
+	g = _div255(((s >> 8) & 0xff) * a + ((d >> 8) & 0xff) * ia);
+	b = _div255((s & 0xff) * a + (d & 0xff) * ia);
+	da = a + _div255((d >> 24) * ia);
+
+	return (da << 24) | (r << 16) | (g << 8) | b;
+}
+
+static uint16_t _blend_rgb565(uint32_t s, uint16_t d, uint32_t alpha)
+{
+	uint32_t a = _div255((s >> 24) * alpha);
+	uint32_t a5, s565, s32, d32;
+
+	s565 = ((s >> 8) & 0xf800) | ((s >> 5) & 0x07e0) | ((s >> 3) & 0x001f);
+	if (a == 0)
+		return d;
+	if (a == 255)
+		return (uint16_t)s565;
+
+	/* Blend the three channels at once, using 5-bit alpha (0..32) */
+	a5 = (a + 4) >> 3;
+	s32 = (s565 | (s565 << 16)) & 0x07e0f81f;
+	d32 = (d | ((uint32_t)d << 16)) & 0x07e0f81f;
+	d32 = (d32 + (((s32 - d32) * a5) >> 5)) & 0x07e0f81f;
+
+	return (uint16_t)(d32 | (d32 >> 16));
+}
+
+static void _fill_row16(uint16_t *p, uint32_t n, uint16_t c)
+{
+	uint32_t pattern = c | ((uint32_t)c << 16);
+	uint32_t *w;
+
+	if (((uint32_t)p & 2) && n) {
+		*p++ = c;
+		n--;
+	}
+	w = (uint32_t *)p;
+	for (; n >= 8; n -= 8) {
+		w[0] = pattern;
+		w[1] = pattern;
+		w[2] = pattern;
+		w[3] = pattern;
+		w += 4;
+	}
+	for (; n >= 2; n -= 2)
+		*w++ = pattern;
+	if (n)
+		*(uint16_t *)w = c;
+}
+
+static void _fill_row32(uint32_t *p, uint32_t n, uint32_t c)
+{
+	for (; n >= 4; n -= 4) {
+		p[0] = c;
+		p[1] = c;
+		p[2] = c;
+		p[3] = c;
+		p += 4;
+	}
+	while (n--)
+		*p++ = c;
+}
+
+static void _blend_row_argb8888(uint32_t *d, const uint32_t *s, uint32_t n,
+		uint8_t alpha)
+{
+#if defined(__ARM_NEON__)
+	uint8x8_t ga = vdup_n_u8(alpha);
+
+	for (; n >= 8; n -= 8) {
+		uint8x8x4_t vs = vld4_u8((const uint8_t *)s);
+		uint8x8x4_t vd = vld4_u8((const uint8_t *)d);
+		uint8x8_t a, ia;
+		uint16x8_t t;
+		int i;
+
+		/* memory order is B, G, R, A */
+		a = vs.val[3];
+		if (alpha != 255) {
+			t = vmull_u8(a, ga);
+			a = vraddhn_u16(t, vrshrq_n_u16(t, 8));
+		}
+		ia = vmvn_u8(a);
+		for (i = 0; i < 3; i++) {
+			t = vmull_u8(vs.val[i], a);
+			t = vmlal_u8(t, vd.val[i], ia);
+			vd.val[i] = vraddhn_u16(t, vrshrq_n_u16(t, 8));
+		}
+		t = vmull_u8(vd.val[3], ia);
+		vd.val[3] = vqadd_u8(a, vraddhn_u16(t, vrshrq_n_u16(t, 8)));
+		vst4_u8((uint8_t *)d, vd);
+		s += 8;
+		d += 8;
+	}
+#endif
+	while (n--) {
+		*d = _blend_argb8888(*s++, *d, alpha);
+		d++;
+	}
+}
+
+static void _blend_row_rgb565(uint16_t *d, const uint32_t *s, uint32_t n,
+		uint8_t alpha)
+{
+	while (n--) {
+		*d = _blend_rgb565(*s++, *d, alpha);
+		d++;
+	}
+}
+
+static void _keyed_row16(uint16_t *d, const uint16_t *s, uint32_t n,
+		uint16_t key)
+{
+#if defined(__ARM_NEON__)
+	uint16x8_t vkey = vdupq_n_u16(key);
+
+	for (; n >= 8; n -= 8) {
+		uint16x8_t vs = vld1q_u16(s);
+		uint16x8_t vd = vld1q_u16(d);
+		uint16x8_t mask = vceqq_u16(vs, vkey);
+		vst1q_u16(d, vbslq_u16(mask, vd, vs));
+		s += 8;
+		d += 8;
+	}
+#endif
+	for (; n; n--, s++, d++) {
+		if (*s != key)
+			*d = *s;
+	}
+}
+
+static void _keyed_row32(uint32_t *d, const uint32_t *s, uint32_t n,
+		uint32_t key)
+{
+	key &= 0x00ffffff;
+#if defined(__ARM_NEON__)
+	uint32x4_t vkey = vdupq_n_u32(key);
+	uint32x4_t vrgb = vdupq_n_u32(0x00ffffff);
+
+	for (; n >= 4; n -= 4) {
+		uint32x4_t vs = vld1q_u32(s);
+		uint32x4_t vd = vld1q_u32(d);
+		uint32x4_t mask = vceqq_u32(vandq_u32(vs, vrgb), vkey);
+		vst1q_u32(d, vbslq_u32(mask, vd, vs));
+		s += 4;
+		d += 4;
+	}
+#endif
+	for (; n; n--, s++, d++) {
+		if ((*s & 0x00ffffff) != key)
+			*d = *s;
+	}
+}
+
+#ifdef CONFIG_HAVE_XDMAC
+
+/**
+ * Largest DMA data width usable for all given addresses/lengths.
+ */
+static uint8_t _dma_data_width(uint32_t a, uint32_t b, uint32_t c)
+{
+	uint32_t v = a | b | c;
+
+	if ((v & 3) == 0)
+		return DMA_DATA_WIDTH_WORD;
+	if ((v & 1) == 0)
+		return DMA_DATA_WIDTH_HALF_WORD;
+	return DMA_DATA_WIDTH_BYTE;
+}
+
+/**
+ * Start a strided memory-to-memory transfer: one microblock per row.
+ * \param src Source of the copy, or NULL to fill with \a pattern.
+ */
+static bool _dma_start(uint8_t *dst, uint32_t dst_pitch,
+		const uint8_t *src, uint32_t src_pitch,
+		uint32_t row_bytes, uint32_t rows, uint32_t pattern)
+{
+	struct _xdmacd_cfg cfg;
+	uint8_t width;
+	uint32_t span;
+
+	if (!_lcdc_2d.dma || rows > XDMAC_MAX_BLOCK_LEN + 1)
+		return false;
+	if (row_bytes * rows < LCDC_2D_DMA_THRESHOLD)
+		return false;
+
+	if (src)
+		width = _dma_data_width((uint32_t)dst | (uint32_t)src,
+				dst_pitch | src_pitch, row_bytes);
+	else
+		width = _dma_data_width((uint32_t)dst, dst_pitch, row_bytes);
+
+	lcdc_2d_wait();
+
+	span = (rows - 1) * dst_pitch + row_bytes;
+	cache_clean_region(dst, span);
+	if (src)
+		cache_clean_region(src, (rows - 1) * src_pitch + row_bytes);
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.ubc = row_bytes >> width;
+	cfg.bc = rows - 1;
+	cfg.sa = (void *)src;
+	cfg.da = dst;
+	cfg.dus = dst_pitch - row_bytes;
+	cfg.cfg = XDMAC_CC_TYPE_MEM_TRAN
+		| XDMAC_CC_MBSIZE_SIXTEEN
+		| XDMAC_CC_SWREQ_SWR_CONNECTED
+		| XDMAC_CC_CSIZE_CHK_1
+		| XDMAC_CC_DWIDTH(width)
+		| XDMAC_CC_SIF_AHB_IF0
+		| XDMAC_CC_DIF_AHB_IF0
+		| XDMAC_CC_DAM_UBS_AM;
+	if (src) {
+		cfg.sus = src_pitch - row_bytes;
+		cfg.cfg |= XDMAC_CC_SAM_UBS_AM | XDMAC_CC_MEMSET_NORMAL_MODE;
+	} else {
+		/* In memset mode, the fill pattern is taken from the data
+		 * stride register */
+		cfg.ds = pattern;
+		cfg.cfg |= XDMAC_CC_SAM_FIXED_AM | XDMAC_CC_MEMSET_HW_MODE;
+	}
+
+	if (xdmacd_configure_transfer(_lcdc_2d.dma, &cfg, 0, 0) < 0)
+		return false;
+
+	_lcdc_2d.pending_addr = dst;
+	_lcdc_2d.pending_len = span;
+	_lcdc_2d.stats.dma_ops++;
+	_lcdc_2d.stats.dma_bytes += row_bytes * rows;
+
+	dma_start_transfer(_lcdc_2d.dma);
+
+	return true;
+}
+
+#endif /* CONFIG_HAVE_XDMAC */
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+int lcdc_2d_initialize(bool use_dma)
+{
+	memset(&_lcdc_2d, 0, sizeof(_lcdc_2d));
+
+#ifdef CONFIG_HAVE_XDMAC
+	if (use_dma) {
+		_lcdc_2d.dma = dma_allocate_channel(DMA_PERIPH_MEMORY,
+				DMA_PERIPH_MEMORY);
+		if (!_lcdc_2d.dma)
+			return -ENODEV;
+		dma_set_callback(_lcdc_2d.dma, NULL);
+	}
+#else
+	if (use_dma)
+		return -ENODEV;
+#endif
+
+	return 0;
+}
+
+bool lcdc_2d_is_busy(void)
+{
+#ifdef CONFIG_HAVE_XDMAC
+	if (_lcdc_2d.pending_addr)
+		return !dma_is_transfer_done(_lcdc_2d.dma);
+#endif
+	return false;
+}
+
+void lcdc_2d_wait(void)
+{
+#ifdef CONFIG_HAVE_XDMAC
+	if (!_lcdc_2d.pending_addr)
+		return;
+
+	while (!dma_is_transfer_done(_lcdc_2d.dma))
+		dma_poll();
+
+	/* Drop stale lines so that the CPU sees the DMA result */
+	cache_invalidate_region(_lcdc_2d.pending_addr, _lcdc_2d.pending_len);
+	_lcdc_2d.pending_addr = NULL;
+	_lcdc_2d.pending_len = 0;
+#endif
+}
+
+uint32_t lcdc_2d_get_pitch(const struct _lcdc_layer *surface)
+{
+	uint32_t bytes = (surface->width * surface->bpp + 7) >> 3;
+
+	return (bytes + 3) & ~3u;
+}
+
+void lcdc_2d_fill_rect(struct _lcdc_layer *dst,
+		uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+		uint32_t color)
+{
+	uint32_t pitch = lcdc_2d_get_pitch(dst);
+	uint8_t *row;
+
+	if (dst->bpp != 16 && dst->bpp != 32)
+		return;
+	if (!_clip(dst, x, y, &w, &h))
+		return;
+
+	row = _pixel_addr(dst, x, y);
+	if (dst->bpp == 16)
+		color = (color & 0xffff) | (color << 16);
+
+#ifdef CONFIG_HAVE_XDMAC
+	if (_dma_start(row, pitch, NULL, 0, w * (dst->bpp >> 3), h, color))
+		return;
+#endif
+
+	lcdc_2d_wait();
+	_lcdc_2d.stats.cpu_ops++;
+	_lcdc_2d.stats.cpu_bytes += w * h * (dst->bpp >> 3);
+	for (; h; h--, row += pitch) {
+		if (dst->bpp == 16)
+			_fill_row16((uint16_t *)row, w, (uint16_t)color);
+		else
+			_fill_row32((uint32_t *)row, w, color);
+	}
+}
+
+void lcdc_2d_copy(struct _lcdc_layer *dst, uint32_t dx, uint32_t dy,
+		const struct _lcdc_layer *src, uint32_t sx, uint32_t sy,
+		uint32_t w, uint32_t h)
+{
+	uint32_t dst_pitch = lcdc_2d_get_pitch(dst);
+	uint32_t src_pitch = lcdc_2d_get_pitch(src);
+	uint32_t row_bytes;
+	const uint8_t *s;
+	uint8_t *d;
+	bool overlap;
+
+	if (dst->bpp != src->bpp)
+		return;
+	if (!_clip(src, sx, sy, &w, &h) || !_clip(dst, dx, dy, &w, &h))
+		return;
+
+	row_bytes = w * (dst->bpp >> 3);
+	s = _pixel_addr(src, sx, sy);
+	d = _pixel_addr(dst, dx, dy);
+	overlap = (dst->buffer == src->buffer)
+		&& (d < s + (h - 1) * src_pitch + row_bytes)
+		&& (s < d + (h - 1) * dst_pitch + row_bytes);
+
+#ifdef CONFIG_HAVE_XDMAC
+	if (!overlap && _dma_start(d, dst_pitch, s, src_pitch, row_bytes, h, 0))
+		return;
+#endif
+
+	lcdc_2d_wait();
+	_lcdc_2d.stats.cpu_ops++;
+	_lcdc_2d.stats.cpu_bytes += row_bytes * h;
+	if (overlap && d > s) {
+		/* Copy bottom-up so that source rows are read before being
+		 * overwritten */
+		s += (h - 1) * src_pitch;
+		d += (h - 1) * dst_pitch;
+		for (; h; h--, s -= src_pitch, d -= dst_pitch)
+			memmove(d, s, row_bytes);
+	} else {
+		for (; h; h--, s += src_pitch, d += dst_pitch)
+			memmove(d, s, row_bytes);
+	}
+}
+
+void lcdc_2d_blend(struct _lcdc_layer *dst, uint32_t dx, uint32_t dy,
+		const struct _lcdc_layer *src, uint32_t sx, uint32_t sy,
+		uint32_t w, uint32_t h, uint8_t alpha)
+{
+	uint32_t dst_pitch = lcdc_2d_get_pitch(dst);
+	uint32_t src_pitch = lcdc_2d_get_pitch(src);
+	const uint8_t *s;
+	uint8_t *d;
+
+	if (src->bpp != 32 || (dst->bpp != 16 && dst->bpp != 32))
+		return;
+	if (!_clip(src, sx, sy, &w, &h) || !_clip(dst, dx, dy, &w, &h))
+		return;
+	if (alpha == 0)
+		return;
+
+	lcdc_2d_wait();
+	_lcdc_2d.stats.cpu_ops++;
+	_lcdc_2d.stats.cpu_bytes += w * h * (dst->bpp >> 3);
+
+	s = _pixel_addr(src, sx, sy);
+	d = _pixel_addr(dst, dx, dy);
+	for (; h; h--, s += src_pitch, d += dst_pitch) {
+		if (dst->bpp == 32)
+			_blend_row_argb8888((uint32_t *)d, (const uint32_t *)s,
+					w, alpha);
+		else
+			_blend_row_rgb565((uint16_t *)d, (const uint32_t *)s,
+					w, alpha);
+	}
+}
+
+void lcdc_2d_blit_keyed(struct _lcdc_layer *dst, uint32_t dx,
+		uint32_t dy, const struct _lcdc_layer *src, uint32_t sx,
+		uint32_t sy, uint32_t w, uint32_t h, uint32_t key)
+{
+	uint32_t dst_pitch = lcdc_2d_get_pitch(dst);
+	uint32_t src_pitch = lcdc_2d_get_pitch(src);
+	const uint8_t *s;
+	uint8_t *d;
+
+	if (dst->bpp != src->bpp || (dst->bpp != 16 && dst->bpp != 32))
+		return;
+	if (!_clip(src, sx, sy, &w, &h) || !_clip(dst, dx, dy, &w, &h))
+		return;
+
+	lcdc_2d_wait();
+	_lcdc_2d.stats.cpu_ops++;
+	_lcdc_2d.stats.cpu_bytes += w * h * (dst->bpp >> 3);
+
+	s = _pixel_addr(src, sx, sy);
+	d = _pixel_addr(dst, dx, dy);
+	for (; h; h--, s += src_pitch, d += dst_pitch) {
+		if (dst->bpp == 32)
+			_keyed_row32((uint32_t *)d, (const uint32_t *)s, w, key);
+		else
+			_keyed_row16((uint16_t *)d, (const uint16_t *)s, w,
+					(uint16_t)key);
+	}
+}
+
+void lcdc_2d_draw_glyph(struct _lcdc_layer *dst, uint32_t x,
+		uint32_t y, const uint8_t *glyph, uint8_t width, uint8_t height,
+		uint32_t fg, uint32_t bg, bool opaque)
+{
+	uint32_t pitch = lcdc_2d_get_pitch(dst);
+	uint32_t glyph_pitch = (width + 7) >> 3;
+	uint32_t w = width, h = height;
+	uint32_t row, col;
+	uint8_t *d;
+
+	if (dst->bpp != 16 && dst->bpp != 32)
+		return;
+	if (!_clip(dst, x, y, &w, &h))
+		return;
+
+	lcdc_2d_wait();
+	_lcdc_2d.stats.cpu_ops++;
+	_lcdc_2d.stats.cpu_bytes += w * h * (dst->bpp >> 3);
+
+	d = _pixel_addr(dst, x, y);
+	for (row = 0; row < h; row++, d += pitch, glyph += glyph_pitch) {
+		for (col = 0; col < w; col++) {
+			bool set = glyph[col >> 3] & (0x80 >> (col & 7));
+
+			if (!set && !opaque)
+				continue;
+			if (dst->bpp == 32)
+				((uint32_t *)d)[col] = set ? fg : bg;
+			else
+				((uint16_t *)d)[col] = (uint16_t)(set ? fg : bg);
+		}
+	}
+}
+
+void lcdc_2d_get_stats(struct _lcdc_2d_stats *stats)
+{
+	*stats = _lcdc_2d.stats;
+}
+
+void lcdc_2d_reset_stats(void)
+{
+	memset(&_lcdc_2d.stats, 0, sizeof(_lcdc_2d.stats));
+}
+
+/**@}*/
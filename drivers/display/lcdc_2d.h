@@ -0,0 +1,191 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file */
+
+/**
+ * \ingroup lcdc_module
+ * \addtogroup lcdc_2d LCD 2D Engine
+ *
+ * \section Purpose
+ *
+ * Accelerated 2D operations on RGB565 and ARGB8888 canvases: rectangle fill,
+ * rectangle copy, alpha blending, color-keyed blit and 1bpp glyph rendering.
+ *
+ * \section Usage
+ *
+ * -# Call lcdc_2d_initialize() once, after dma_initialize().
+ * -# Use lcdc_get_canvas() (or any struct _lcdc_layer describing a buffer
+ *    in memory) as destination and source surfaces.
+ * -# Large fills and copies are offloaded to a memory-to-memory XDMAC
+ *    channel using microblock strides, one microblock per row.  They are
+ *    asynchronous: use lcdc_2d_wait() before touching the destination
+ *    with the CPU.  All other lcdc_2d_* functions wait implicitly.
+ * -# Blending and keyed blits run on the CPU, using NEON when the
+ *    compiler targets it (__ARM_NEON__) and packed-pixel C otherwise.
+ *
+ * Colors are given in the native pixel format of the surface (RGB565 in the
+ * low 16 bits for 16bpp surfaces, ARGB8888 for 32bpp surfaces).  Rows are
+ * padded to 4 bytes, like the buffers used by the LCDC layers.
+ *
+ * @{
+ */
+
+#ifndef LCDC_2D_H_
+#define LCDC_2D_H_
+
+#ifdef CONFIG_HAVE_LCDC
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "display/lcdc.h"
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Minimum number of bytes for an operation to be offloaded to DMA */
+#ifndef LCDC_2D_DMA_THRESHOLD
+#define LCDC_2D_DMA_THRESHOLD 4096
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+/** 2D engine statistics */
+struct _lcdc_2d_stats {
+	uint32_t dma_ops;    /**< Operations executed by DMA */
+	uint32_t cpu_ops;    /**< Operations executed by the CPU */
+	uint32_t dma_bytes;  /**< Bytes written by DMA */
+	uint32_t cpu_bytes;  /**< Bytes written by the CPU */
+};
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Initialize the 2D engine.
+ * \param use_dma Offload large fills and copies to a DMA channel.
+ * \return 0 on success, -ENODEV if no DMA channel could be allocated (the
+ * engine then falls back to CPU operations).
+ */
+extern int lcdc_2d_initialize(bool use_dma);
+
+/**
+ * \brief Wait for the pending DMA operation, if any, to complete.
+ */
+extern void lcdc_2d_wait(void);
+
+/**
+ * \brief Check if a DMA operation is in progress.
+ */
+extern bool lcdc_2d_is_busy(void);
+
+/**
+ * \brief Return the row pitch in bytes of a surface.
+ */
+extern uint32_t lcdc_2d_get_pitch(const struct _lcdc_layer *surface);
+
+/**
+ * \brief Fill a rectangle with a solid color.
+ * \param dst   Destination surface (16 or 32bpp).
+ * \param x, y  Top-left corner.
+ * \param w, h  Size of the rectangle, clipped to the surface.
+ * \param color Color in the surface pixel format.
+ */
+extern void lcdc_2d_fill_rect(struct _lcdc_layer *dst,
+		uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+		uint32_t color);
+
+/**
+ * \brief Copy a rectangle between surfaces of identical format.
+ *
+ * Overlapping copies within a surface are supported when the destination is
+ * above the source (scrolling up); other overlaps are handled row by row on
+ * the CPU.
+ */
+extern void lcdc_2d_copy(struct _lcdc_layer *dst, uint32_t dx, uint32_t dy,
+		const struct _lcdc_layer *src, uint32_t sx, uint32_t sy,
+		uint32_t w, uint32_t h);
+
+/**
+ * \brief Blend an ARGB8888 source over a 16 or 32bpp destination.
+ *
+ * The source per-pixel alpha is multiplied by \a alpha (255 = use the
+ * per-pixel alpha only).
+ */
+extern void lcdc_2d_blend(struct _lcdc_layer *dst, uint32_t dx, uint32_t dy,
+		const struct _lcdc_layer *src, uint32_t sx, uint32_t sy,
+		uint32_t w, uint32_t h, uint8_t alpha);
+
+/**
+ * \brief Copy a rectangle, skipping source pixels equal to \a key.
+ *
+ * Source and destination must have the same format.  For ARGB8888 the
+ * alpha channel is ignored when comparing against the key.
+ */
+extern void lcdc_2d_blit_keyed(struct _lcdc_layer *dst, uint32_t dx,
+		uint32_t dy, const struct _lcdc_layer *src, uint32_t sx,
+		uint32_t sy, uint32_t w, uint32_t h, uint32_t key);
+
+/**
+ * \brief Render a 1bpp glyph.
+ *
+ * The glyph bitmap is stored row by row, most significant bit first, each
+ * row using (width + 7) / 8 bytes.
+ *
+ * \param opaque If true, clear pixels are painted with \a bg, otherwise they
+ * are left untouched.
+ */
+extern void lcdc_2d_draw_glyph(struct _lcdc_layer *dst, uint32_t x,
+		uint32_t y, const uint8_t *glyph, uint8_t width, uint8_t height,
+		uint32_t fg, uint32_t bg, bool opaque);
+
+/**
+ * \brief Get a copy of the engine statistics.
+ */
+extern void lcdc_2d_get_stats(struct _lcdc_2d_stats *stats);
+
+/**
+ * \brief Reset the engine statistics.
+ */
+extern void lcdc_2d_reset_stats(void);
+
+#endif /* CONFIG_HAVE_LCDC */
+
+/** @} */
+
+#endif /* LCDC_2D_H_ */
@@ -217,6 +217,7 @@ static void _dma_sg_desc_free(struct _dma_sg_desc* list_head)
 {
 	struct _dma_sg_desc* curr = list_head;
 	struct _dma_sg_desc* tail;
+	uint16_t count = 0;
 
 	if (list_head == NULL)
 		return;
@@ -224,11 +225,14 @@ static void _dma_sg_desc_free(struct _dma_sg_desc* list_head)
 	do {
 		tail = curr;
 		curr = DMA_SG_DESC_GET_NEXT(curr);
+		count++;
 	} while ((curr != NULL) && (curr != list_head));
 	curr = list_head;
 
 	mutex_lock(&_dma_sg_pool.mutex);
 
+	_dma_sg_pool.count += count;
+
 	if (_dma_sg_pool.head == NULL)
 		_dma_sg_pool.head = list_head;
 
@@ -256,6 +260,10 @@ static int _dma_configure_transfer(struct _dma_channel* channel,
 
 	memset(&desc, 0, sizeof(desc));
 
+	_dma_sg_desc_free(channel->sg_list);
+	channel->sg_list = NULL;
+	channel->cyclic = false;
+
 	src_is_periph = is_source_periph(channel);
 	dst_is_periph = is_dest_periph(channel);
 
@@ -367,6 +375,9 @@ static int _dma_sg_configure_transfer(struct _dma_channel* channel,
 	src_is_periph = is_source_periph(channel);
 	dst_is_periph = is_dest_periph(channel);
 
+	_dma_sg_desc_free(channel->sg_list);
+	channel->sg_list = NULL;
+
 	_sg_head = _dma_sg_desc_alloc(sg_list_size);
 	if (_sg_head == NULL)
 		return -ENOMEM;
@@ -427,6 +438,7 @@ static int _dma_sg_configure_transfer(struct _dma_channel* channel,
 		curr = DMA_SG_DESC_GET_NEXT(curr);
 	}
 	channel->sg_list = _sg_head;
+	channel->cyclic = cfg_dma->loop;
 
 	cache_clean_region(_dma_sg_pool.desc, sizeof(_dma_sg_pool.desc));
 
@@ -559,6 +571,7 @@ struct _dma_channel* dma_allocate_channel(uint8_t src, uint8_t dest)
 				dma_prepare_channel(channel);
 
 				channel->sg_list = NULL;
+				channel->cyclic = false;
 
 				return channel;
 			}
@@ -721,6 +734,15 @@ uint32_t dma_get_transferred_data_len(struct _dma_channel* channel, uint8_t chun
 #endif
 }
 
+uint32_t dma_get_dest_addr(struct _dma_channel* channel)
+{
+#if defined(CONFIG_HAVE_XDMAC)
+	return xdmac_get_channel_dest_addr(channel->hw, channel->id);
+#elif defined(CONFIG_HAVE_DMAC)
+	return dmac_get_channel_dest_addr(channel->hw, channel->id);
+#endif
+}
+
 int dma_set_callback(struct _dma_channel* channel, struct _callback* cb)
 {
 	if (channel->state == DMA_STATE_FREE)
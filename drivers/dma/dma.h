@@ -132,6 +132,7 @@ struct _dma_channel {
 	volatile uint32_t rep_count;/* repeat count in auto mode */
 #endif
 	volatile uint8_t state;		/* Channel State */
+	bool cyclic;				/* Looped scatter/gather transfer */
 
 	struct _dma_sg_desc* sg_list;
 };
@@ -147,7 +148,8 @@ struct _dma_cfg {
 	uint32_t chunk_size;
 	bool incr_saddr;
 	bool incr_daddr;
-	bool loop; /* Used by scatter/gather only */
+	bool loop; /* Used by scatter/gather only, callback is called after
+	            * each item and the transfer never completes */
 };
 
 struct _dma_controller {
@@ -275,6 +277,13 @@ extern void dma_fifo_flush(struct _dma_channel* channel);
  */
 extern uint32_t dma_get_transferred_data_len(struct _dma_channel* channel, uint8_t chunk_size, uint32_t len);
 
+/**
+ * \brief Current destination address of a channel, i.e. the address of the
+ * next data to be written. Used to follow the progress of looped transfers.
+ * \param channel Channel pointer
+ */
+extern uint32_t dma_get_dest_addr(struct _dma_channel* channel);
+
 /**
  * \brief DMA interrupt handler
  * \param source Peripheral ID of DMA controller
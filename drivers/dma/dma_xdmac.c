@@ -138,7 +138,11 @@ int xdmacd_configure_transfer(struct _dma_channel* channel,
 					 | XDMAC_CID_LID | XDMAC_CID_DID
 					 | XDMAC_CID_FID | XDMAC_CID_RBEID
 					 | XDMAC_CID_WBEID | XDMAC_CID_ROID);
-		xdmac_enable_channel_it(xdmac, channel->id, XDMAC_CIE_LIE);
+		/* A looped list never ends: interrupt after each item */
+		if (channel->cyclic)
+			xdmac_enable_channel_it(xdmac, channel->id, XDMAC_CIE_BIE);
+		else
+			xdmac_enable_channel_it(xdmac, channel->id, XDMAC_CIE_LIE);
 	} else {
 		/* Linked List is disabled. */
 		xdmac_set_src_addr(xdmac, channel->id, cfg->sa);
@@ -180,7 +184,13 @@ void dma_irq_handler(uint32_t source, void* user_arg)
 		if (channel->state == DMA_STATE_FREE)
 			continue;
 
-		if (!(gcs & (1 << chan))) {
+		if (channel->cyclic) {
+			/* Channel stays enabled, notify each completed item */
+			uint32_t cis = xdmac_get_channel_isr(xdmac, chan);
+
+			if (cis & XDMAC_CIS_BIS)
+				exec = true;
+		} else if (!(gcs & (1 << chan))) {
 			uint32_t cis = xdmac_get_channel_isr(xdmac, chan);
 
 			if (cis & XDMAC_CIS_BIS) {
@@ -0,0 +1,553 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include "chip.h"
+#include "barriers.h"
+#include "timer.h"
+#include "trace.h"
+
+#include "dma/dma.h"
+#include "extram/ddram_test.h"
+#include "extram/mpddrc.h"
+#include "mm/cache.h"
+#include "mm/l1cache.h"
+#include "mm/mmu.h"
+
+#include <errno.h>
+#include <stddef.h>
+
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+/** Patterns of the address bus test */
+#define PATTERN     0xAAAAAAAAu
+#define ANTIPATTERN 0x55555555u
+
+/** Timing swept by ddram_sweep_timings() */
+struct _ddram_timing {
+	const char* name;
+	uint8_t offset; /**< offset of the field in struct _mpddrc_desc */
+};
+
+#define TIMING(x) { #x, offsetof(struct _mpddrc_desc, timings.x) }
+
+/*----------------------------------------------------------------------------
+ *        Local constants
+ *----------------------------------------------------------------------------*/
+
+/* Only timings exercised by read/write accesses: exit delays from power-down
+ * and self-refresh (tXP, tXSRD, tXSNR, tXARD, tXARDS) and tMRD would pass
+ * the tests whatever their value. */
+static const struct _ddram_timing _ddram_timings[] = {
+#ifdef CONFIG_HAVE_MPDDRC_SDRAM
+	TIMING(trp), TIMING(trc), TIMING(twr), TIMING(trcd), TIMING(tras),
+	TIMING(trfc),
+#else
+	TIMING(twtr), TIMING(trrd), TIMING(trp), TIMING(trc), TIMING(twr),
+	TIMING(trcd), TIMING(tras), TIMING(trfc), TIMING(tfaw), TIMING(trtp),
+	TIMING(trpa),
+#endif
+};
+
+static const char* _ddram_bench_names[DDRAM_BENCH_COUNT] = {
+	[DDRAM_BENCH_SEQ_READ] = "seq read",
+	[DDRAM_BENCH_SEQ_WRITE] = "seq write",
+	[DDRAM_BENCH_RANDOM_READ] = "random read",
+	[DDRAM_BENCH_RANDOM_WRITE] = "random write",
+	[DDRAM_BENCH_DMA_COPY] = "dma copy",
+};
+
+/*----------------------------------------------------------------------------
+ *        Local variables
+ *----------------------------------------------------------------------------*/
+
+/** Keeps the result of the read loops alive */
+static volatile uint32_t _ddram_sink;
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static int _ddram_test_fail(struct _ddram_test_error* err,
+		volatile uint32_t* addr, uint32_t expected, uint32_t actual)
+{
+	if (err) {
+		err->addr = (uint32_t)addr;
+		err->expected = expected;
+		err->actual = actual;
+	}
+	return -EIO;
+}
+
+/**
+ * \brief One March element: for each word, in ascending or descending order,
+ * check that it reads expected then, if write is set, write ~expected.
+ */
+static int _ddram_march_element(volatile uint32_t* mem, uint32_t words,
+		bool up, uint32_t expected, bool write,
+		struct _ddram_test_error* err)
+{
+	uint32_t i, value;
+
+	for (i = 0; i < words; i++) {
+		volatile uint32_t* p = up ? &mem[i] : &mem[words - 1 - i];
+		value = *p;
+		if (value != expected)
+			return _ddram_test_fail(err, p, expected, value);
+		if (write)
+			*p = ~expected;
+	}
+	return 0;
+}
+
+static int _ddram_check(uint32_t addr, uint32_t size)
+{
+	int err;
+
+	err = ddram_test_data_bus(addr, NULL);
+	if (err < 0)
+		return err;
+	err = ddram_test_address_bus(addr, size, NULL);
+	if (err < 0)
+		return err;
+	return ddram_test_march_c(addr, size, NULL);
+}
+
+static void _ddram_trace_error(const char* test,
+		const struct _ddram_test_error* err)
+{
+	trace_error("%s test failed at 0x%08x: expected 0x%08x, read 0x%08x\r\n",
+			test, (unsigned)err->addr, (unsigned)err->expected,
+			(unsigned)err->actual);
+}
+
+static uint32_t _ddram_seq_read(uint32_t addr, uint32_t size)
+{
+	const uint32_t* p = (const uint32_t*)addr;
+	const uint32_t* end = (const uint32_t*)(addr + (size & ~63u));
+#if defined(__ARM_NEON__)
+	uint32x4_t acc = vdupq_n_u32(0);
+
+	for (; p < end; p += 16) {
+		acc = veorq_u32(acc, vld1q_u32(p));
+		acc = veorq_u32(acc, vld1q_u32(p + 4));
+		acc = veorq_u32(acc, vld1q_u32(p + 8));
+		acc = veorq_u32(acc, vld1q_u32(p + 12));
+	}
+	_ddram_sink = vgetq_lane_u32(acc, 0) ^ vgetq_lane_u32(acc, 1) ^
+		vgetq_lane_u32(acc, 2) ^ vgetq_lane_u32(acc, 3);
+#else
+	uint32_t acc = 0;
+
+	for (; p < end; p += 16) {
+		acc ^= p[0] ^ p[1] ^ p[2] ^ p[3] ^ p[4] ^ p[5] ^ p[6] ^ p[7];
+		acc ^= p[8] ^ p[9] ^ p[10] ^ p[11] ^ p[12] ^ p[13] ^ p[14] ^ p[15];
+	}
+	_ddram_sink = acc;
+#endif
+	return size & ~63u;
+}
+
+static uint32_t _ddram_seq_write(uint32_t addr, uint32_t size)
+{
+	uint32_t* p = (uint32_t*)addr;
+	uint32_t* end = (uint32_t*)(addr + (size & ~63u));
+#if defined(__ARM_NEON__)
+	uint32x4_t value = vdupq_n_u32(PATTERN);
+
+	for (; p < end; p += 16) {
+		vst1q_u32(p, value);
+		vst1q_u32(p + 4, value);
+		vst1q_u32(p + 8, value);
+		vst1q_u32(p + 12, value);
+	}
+#else
+	int i;
+
+	for (; p < end; p += 16)
+		for (i = 0; i < 16; i++)
+			p[i] = PATTERN;
+#endif
+	dsb();
+	return size & ~63u;
+}
+
+/**
+ * \brief Word accesses at offsets generated by a 32-bit xorshift, within
+ * the largest power of two number of words of the range.
+ */
+static uint32_t _ddram_random(uint32_t addr, uint32_t size, bool write)
+{
+	volatile uint32_t* mem = (volatile uint32_t*)addr;
+	uint32_t words = size / 4;
+	uint32_t mask, state, i, acc = 0;
+
+	if (!words)
+		return 0;
+	for (mask = 1; (mask << 1) && (mask << 1) <= words; mask <<= 1);
+	mask--;
+
+	state = 0x2545F491u;
+	for (i = 0; i < words; i++) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		if (write)
+			mem[state & mask] = state;
+		else
+			acc += mem[state & mask];
+	}
+	_ddram_sink = acc;
+	dsb();
+	return words * 4;
+}
+
+static uint32_t _ddram_dma_copy(uint32_t addr, uint32_t size)
+{
+	struct _dma_channel* channel;
+	struct _dma_cfg cfg = {
+		.data_width = DMA_DATA_WIDTH_WORD,
+		.chunk_size = DMA_CHUNK_SIZE_1,
+		.incr_saddr = true,
+		.incr_daddr = true,
+	};
+	struct _dma_transfer_cfg xfer = {
+		.saddr = (const void*)addr,
+		.daddr = (void*)(addr + size / 2),
+		.len = size / 8,
+	};
+
+	if (!xfer.len)
+		return 0;
+	channel = dma_allocate_channel(DMA_PERIPH_MEMORY, DMA_PERIPH_MEMORY);
+	if (!channel)
+		return 0;
+
+	cache_clean_region(xfer.saddr, size / 2);
+	cache_invalidate_region(xfer.daddr, size / 2);
+	dma_configure_transfer(channel, &cfg, &xfer, 1);
+	dma_start_transfer(channel);
+	while (!dma_is_transfer_done(channel))
+		dma_poll();
+	dma_free_channel(channel);
+	return xfer.len * 4;
+}
+
+static void _ddram_bench_report(uint32_t addr, uint32_t size,
+		const char* label)
+{
+	int kind;
+
+	for (kind = 0; kind < DDRAM_BENCH_COUNT; kind++)
+		trace_info_wp("  %-12s (cache %s): %8u KB/s\r\n",
+				_ddram_bench_names[kind], label,
+				(unsigned)ddram_bench(kind, addr, size));
+}
+
+#ifdef CONFIG_HAVE_MPDDRC_DATA_PATH
+/**
+ * \brief Try all read sampling shifts and keep the center of the passing
+ * window: unlike timings, a lower shift is not faster, only more or less
+ * centered on the data eye.
+ */
+static void _ddram_sweep_data_path(struct _mpddrc_desc* desc, uint32_t addr,
+		uint32_t size)
+{
+	uint32_t nominal = desc->data_path;
+	uint32_t shift, first = 4, last = 0;
+
+	for (shift = 0; shift < 4; shift++) {
+		desc->data_path = (nominal & ~MPDDRC_RD_DATA_PATH_SHIFT_SAMPLING_Msk)
+			| MPDDRC_RD_DATA_PATH_SHIFT_SAMPLING(shift);
+		mpddrc_set_timings(desc);
+		if (_ddram_check(addr, size) == 0) {
+			if (first > shift)
+				first = shift;
+			last = shift;
+		}
+	}
+
+	if (first < 4)
+		desc->data_path = (nominal & ~MPDDRC_RD_DATA_PATH_SHIFT_SAMPLING_Msk)
+			| MPDDRC_RD_DATA_PATH_SHIFT_SAMPLING((first + last) / 2);
+	else
+		desc->data_path = nominal;
+	mpddrc_set_timings(desc);
+
+	trace_info_wp("  %-6s %2u -> %2u (pass %u-%u)\r\n", "shift",
+			(unsigned)(nominal & MPDDRC_RD_DATA_PATH_SHIFT_SAMPLING_Msk),
+			(unsigned)(desc->data_path & MPDDRC_RD_DATA_PATH_SHIFT_SAMPLING_Msk),
+			(unsigned)first, (unsigned)last);
+}
+#endif /* CONFIG_HAVE_MPDDRC_DATA_PATH */
+
+/*----------------------------------------------------------------------------
+ *        Public functions
+ *----------------------------------------------------------------------------*/
+
+int ddram_test_data_bus(uint32_t addr, struct _ddram_test_error* err)
+{
+	volatile uint32_t* mem = (volatile uint32_t*)addr;
+	uint32_t pattern, value;
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		/* the second word drives the bus to the opposite level so that
+		 * floating lines are not read back from the bus capacitance */
+		pattern = 1u << i;
+		mem[0] = pattern;
+		mem[1] = ~pattern;
+		value = mem[0];
+		if (value != pattern)
+			return _ddram_test_fail(err, mem, pattern, value);
+
+		mem[0] = ~pattern;
+		mem[1] = pattern;
+		value = mem[0];
+		if (value != ~pattern)
+			return _ddram_test_fail(err, mem, ~pattern, value);
+	}
+	return 0;
+}
+
+int ddram_test_address_bus(uint32_t addr, uint32_t size,
+		struct _ddram_test_error* err)
+{
+	volatile uint32_t* mem = (volatile uint32_t*)addr;
+	uint32_t words = size / 4;
+	uint32_t offset, test, value;
+
+	for (offset = 1; offset < words; offset <<= 1)
+		mem[offset] = PATTERN;
+
+	/* address lines stuck high */
+	mem[0] = ANTIPATTERN;
+	for (offset = 1; offset < words; offset <<= 1) {
+		value = mem[offset];
+		if (value != PATTERN)
+			return _ddram_test_fail(err, &mem[offset], PATTERN, value);
+	}
+	mem[0] = PATTERN;
+
+	/* address lines stuck low or shorted */
+	for (test = 1; test < words; test <<= 1) {
+		mem[test] = ANTIPATTERN;
+		for (offset = 0; offset < words; offset = offset ? offset << 1 : 1) {
+			if (offset == test)
+				continue;
+			value = mem[offset];
+			if (value != PATTERN)
+				return _ddram_test_fail(err, &mem[offset],
+						PATTERN, value);
+		}
+		mem[test] = PATTERN;
+	}
+	return 0;
+}
+
+int ddram_test_march_c(uint32_t addr, uint32_t size,
+		struct _ddram_test_error* err)
+{
+	volatile uint32_t* mem = (volatile uint32_t*)addr;
+	uint32_t words = size / 4;
+	uint32_t i;
+	int rc;
+
+	/* {any(w0); up(r0,w1); up(r1,w0); down(r0,w1); down(r1,w0); any(r0)} */
+	for (i = 0; i < words; i++)
+		mem[i] = 0;
+	rc = _ddram_march_element(mem, words, true, 0, true, err);
+	if (rc == 0)
+		rc = _ddram_march_element(mem, words, true, ~0u, true, err);
+	if (rc == 0)
+		rc = _ddram_march_element(mem, words, false, 0, true, err);
+	if (rc == 0)
+		rc = _ddram_march_element(mem, words, false, ~0u, true, err);
+	if (rc == 0)
+		rc = _ddram_march_element(mem, words, true, 0, false, err);
+	return rc;
+}
+
+uint32_t ddram_bench(enum _ddram_bench_kind kind, uint32_t addr,
+		uint32_t size)
+{
+	uint64_t start, elapsed;
+	uint32_t bytes;
+
+	start = timer_get_ns();
+	switch (kind) {
+	case DDRAM_BENCH_SEQ_READ:
+		bytes = _ddram_seq_read(addr, size);
+		break;
+	case DDRAM_BENCH_SEQ_WRITE:
+		bytes = _ddram_seq_write(addr, size);
+		break;
+	case DDRAM_BENCH_RANDOM_READ:
+		bytes = _ddram_random(addr, size, false);
+		break;
+	case DDRAM_BENCH_RANDOM_WRITE:
+		bytes = _ddram_random(addr, size, true);
+		break;
+	case DDRAM_BENCH_DMA_COPY:
+		bytes = _ddram_dma_copy(addr, size);
+		break;
+	default:
+		return 0;
+	}
+	elapsed = timer_get_ns() - start;
+
+	if (!bytes || !elapsed)
+		return 0;
+	return (uint32_t)((uint64_t)bytes * (1000000000ull / 1024) / elapsed);
+}
+
+const char* ddram_bench_get_name(enum _ddram_bench_kind kind)
+{
+	if ((unsigned)kind >= DDRAM_BENCH_COUNT)
+		return "";
+	return _ddram_bench_names[kind];
+}
+
+int ddram_sweep_timings(struct _mpddrc_desc* desc, uint32_t addr,
+		uint32_t size, uint8_t margin)
+{
+	struct _mpddrc_desc trial = *desc;
+	int i, j;
+
+	if (size > DDRAM_TEST_SWEEP_WINDOW)
+		size = DDRAM_TEST_SWEEP_WINDOW;
+
+	for (i = 0; i < ARRAY_SIZE(_ddram_timings); i++) {
+		uint8_t* timing = (uint8_t*)&trial + _ddram_timings[i].offset;
+		uint8_t nominal = *timing;
+
+		while (*timing > 0) {
+			(*timing)--;
+			mpddrc_set_timings(&trial);
+			if (_ddram_check(addr, size) < 0) {
+				(*timing)++;
+				break;
+			}
+		}
+		if (*timing + margin < nominal)
+			*timing += margin;
+		else
+			*timing = nominal;
+		mpddrc_set_timings(&trial);
+
+		trace_info_wp("  %-6s %2u -> %2u\r\n", _ddram_timings[i].name,
+				(unsigned)nominal, (unsigned)*timing);
+	}
+
+#ifdef CONFIG_HAVE_MPDDRC_DATA_PATH
+	_ddram_sweep_data_path(&trial, addr, size);
+#endif
+
+	/* each timing was qualified with the previous ones lowered: check the
+	 * combination again, giving back timings from the last swept one */
+	for (i = ARRAY_SIZE(_ddram_timings); _ddram_check(addr, size) < 0; i--) {
+		if (i == 0) {
+			mpddrc_set_timings(desc);
+			return -EIO;
+		}
+		j = _ddram_timings[i - 1].offset;
+		*((uint8_t*)&trial + j) = *((uint8_t*)desc + j);
+		mpddrc_set_timings(&trial);
+		trace_warning("Timing %s restored\r\n", _ddram_timings[i - 1].name);
+	}
+
+	*desc = trial;
+	return 0;
+}
+
+int ddram_qualify(struct _mpddrc_desc* desc, uint32_t addr, uint32_t size,
+		uint8_t margin)
+{
+	struct _mpddrc_desc nominal = *desc;
+	struct _ddram_test_error err;
+	bool dcache = dcache_is_enabled();
+
+	trace_info_wp("DDR qualification on 0x%08x-0x%08x\r\n",
+			(unsigned)addr, (unsigned)(addr + size - 1));
+
+	if (ddram_test_data_bus(addr, &err) < 0) {
+		_ddram_trace_error("Data bus", &err);
+		return -EIO;
+	}
+	if (ddram_test_address_bus(addr, size, &err) < 0) {
+		_ddram_trace_error("Address bus", &err);
+		return -EIO;
+	}
+	if (ddram_test_march_c(addr, size, &err) < 0) {
+		_ddram_trace_error("March C-", &err);
+		return -EIO;
+	}
+	trace_info_wp("Bus and March C- tests passed\r\n");
+
+	trace_info_wp("Timing sweep (margin %u):\r\n", (unsigned)margin);
+	if (ddram_sweep_timings(desc, addr, size, margin) < 0)
+		trace_warning("Lowered timings failed, keeping nominal ones\r\n");
+
+	if (ddram_test_march_c(addr, size, &err) < 0) {
+		_ddram_trace_error("March C- (qualified timings)", &err);
+		*desc = nominal;
+		mpddrc_set_timings(desc);
+		if (ddram_test_march_c(addr, size, &err) < 0) {
+			_ddram_trace_error("March C- (nominal timings)", &err);
+			return -EIO;
+		}
+		trace_warning("Nominal timings restored\r\n");
+	}
+
+	trace_info_wp("Bandwidth:\r\n");
+	if (dcache)
+		dcache_disable();
+	_ddram_bench_report(addr, size, "off");
+	if (mmu_is_enabled()) {
+		dcache_enable();
+		_ddram_bench_report(addr, size, "on");
+		if (!dcache)
+			dcache_disable();
+	} else {
+		trace_info_wp("  MMU disabled, no measurement with cache on\r\n");
+	}
+	if (dcache)
+		dcache_enable();
+
+	return 0;
+}
@@ -0,0 +1,178 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef DDRAM_TEST_HEADER
+#define DDRAM_TEST_HEADER
+
+/**
+ * \file
+ *
+ * DDR bring-up toolkit: memory tests, timing qualification and bandwidth
+ * measurement for memories driven by the MPDDRC.
+ *
+ * Tests and benchmarks write to the memory under test: the code, stack and
+ * data of the caller must not be placed in the tested range, and must not be
+ * placed in external RAM at all while ddram_sweep_timings() is running.
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+#include "extram/mpddrc.h"
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Number of bytes tested after each timing change during a sweep */
+#ifndef DDRAM_TEST_SWEEP_WINDOW
+#define DDRAM_TEST_SWEEP_WINDOW (256 * 1024)
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+/** First mismatch found by a memory test */
+struct _ddram_test_error {
+	uint32_t addr;
+	uint32_t expected;
+	uint32_t actual;
+};
+
+/** Bandwidth measurements */
+enum _ddram_bench_kind {
+	DDRAM_BENCH_SEQ_READ,     /**< CPU sequential read (NEON if available) */
+	DDRAM_BENCH_SEQ_WRITE,    /**< CPU sequential write (NEON if available) */
+	DDRAM_BENCH_RANDOM_READ,  /**< CPU word reads at pseudo-random offsets */
+	DDRAM_BENCH_RANDOM_WRITE, /**< CPU word writes at pseudo-random offsets */
+	DDRAM_BENCH_DMA_COPY,     /**< DMA memory to memory copy */
+	DDRAM_BENCH_COUNT,
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Walking one / walking zero test of the data bus.
+ * Two consecutive words at addr are used.
+ * \param addr address of the test words (word aligned)
+ * \param err if not NULL, filled with the first mismatch
+ * \return 0 on success, -EIO on mismatch
+ */
+extern int ddram_test_data_bus(uint32_t addr, struct _ddram_test_error* err);
+
+/**
+ * \brief Test of the address bus for stuck and shorted lines, by writing
+ * words at power-of-two offsets of addr.
+ * \param addr start of the tested range, aligned on its size
+ * \param size size of the tested range in bytes
+ * \param err if not NULL, filled with the first mismatch
+ * \return 0 on success, -EIO on mismatch
+ */
+extern int ddram_test_address_bus(uint32_t addr, uint32_t size,
+		struct _ddram_test_error* err);
+
+/**
+ * \brief March C- test (10N) with all-zero / all-one word backgrounds.
+ * \param addr start of the tested range (word aligned)
+ * \param size size of the tested range in bytes
+ * \param err if not NULL, filled with the first mismatch
+ * \return 0 on success, -EIO on mismatch
+ */
+extern int ddram_test_march_c(uint32_t addr, uint32_t size,
+		struct _ddram_test_error* err);
+
+/**
+ * \brief Measure a bandwidth.
+ * The DMA copy moves the first half of the range to the second half.
+ * \param kind measurement to run
+ * \param addr start of the range (cache-line aligned)
+ * \param size size of the range in bytes
+ * \return bandwidth in KB/s, or 0 if the measurement is not available
+ */
+extern uint32_t ddram_bench(enum _ddram_bench_kind kind, uint32_t addr,
+		uint32_t size);
+
+/**
+ * \brief Get the display name of a measurement.
+ */
+extern const char* ddram_bench_get_name(enum _ddram_bench_kind kind);
+
+/**
+ * \brief Lower the timings of a configured controller as long as the bus and
+ * March C- tests pass on the first DDRAM_TEST_SWEEP_WINDOW bytes of the range,
+ * then add the margin.
+ *
+ * Timings are swept one at a time, each starting from the value in desc,
+ * which must be the one used to configure the controller. The read data
+ * path, if any, is swept as well. Timings only involved in power-down and
+ * self-refresh exits are not modified. On success desc holds and the
+ * controller uses the qualified timings, otherwise the timings of desc are
+ * restored.
+ *
+ * \param desc descriptor of the configured memory
+ * \param addr start of the range, aligned on DDRAM_TEST_SWEEP_WINDOW
+ * \param size size of the range in bytes
+ * \param margin number of clock cycles added to each minimum
+ * \return 0 on success, -EIO if the qualified timings failed verification
+ */
+extern int ddram_sweep_timings(struct _mpddrc_desc* desc, uint32_t addr,
+		uint32_t size, uint8_t margin);
+
+/**
+ * \brief Run the whole bring-up sequence and trace a report: bus tests and
+ * March C- on the range, timing sweep, verification of the qualified timings
+ * on the whole range and bandwidth measurements, with the data cache
+ * disabled and, if the MMU is enabled, with the data cache enabled.
+ *
+ * The fastest stable configuration is left applied and returned in desc.
+ *
+ * \param desc descriptor of the configured memory
+ * \param addr start of the range, aligned on its size
+ * \param size size of the range in bytes
+ * \param margin number of clock cycles added to each timing minimum
+ * \return 0 on success, -EIO if a test failed with the nominal timings
+ */
+extern int ddram_qualify(struct _mpddrc_desc* desc, uint32_t addr,
+		uint32_t size, uint8_t margin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DDRAM_TEST_HEADER */
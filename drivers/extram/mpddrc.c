@@ -39,7 +39,7 @@
 #include <assert.h>
 #include <stdlib.h>
 
-static void _set_ddr_timings(struct _mpddrc_desc* desc)
+static void _set_ddr_timings(const struct _mpddrc_desc* desc)
 {
 #ifdef CONFIG_HAVE_MPDDRC_SDRAM
 	uint8_t trc_trfc, txsr;
@@ -515,6 +515,15 @@ extern void mpddrc_configure(struct _mpddrc_desc* desc)
 #endif
 }
 
+void mpddrc_set_timings(const struct _mpddrc_desc* desc)
+{
+#ifdef CONFIG_HAVE_MPDDRC_DATA_PATH
+	MPDDRC->MPDDRC_RD_DATA_PATH = desc->data_path;
+#endif
+	_set_ddr_timings(desc);
+	dsb();
+}
+
 void mpddrc_issue_low_power_command(uint32_t cmd)
 {
 	uint32_t value;
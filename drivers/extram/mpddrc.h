@@ -87,6 +87,15 @@ struct _mpddrc_desc {
 
 extern void mpddrc_configure(struct _mpddrc_desc* desc);
 
+/**
+ * \brief Reprogram the timing parameters (and read data path, if any) of an
+ * already configured controller.
+ * Only the timings and data_path fields of desc are used, the device is not
+ * re-initialized. Used to qualify timings, see ddram_sweep_timings().
+ * \param desc the descriptor holding the new timings
+ */
+extern void mpddrc_set_timings(const struct _mpddrc_desc* desc);
+
 /**
  * \brief Issue a Low-Power Command to the DDR-SDRAM device.
  *
@@ -100,6 +100,14 @@ struct _pin
 
 typedef void (*pio_handler_t)(uint32_t group, uint32_t status, void *arg);
 
+/** Pin masks for all PIO groups, indexed by PIO_GROUP_* */
+struct _pio_port_masks
+{
+	uint32_t set[PIO_GROUP_LENGTH];    /*< Pins to drive high */
+	uint32_t clear[PIO_GROUP_LENGTH];  /*< Pins to drive low */
+	uint32_t toggle[PIO_GROUP_LENGTH]; /*< Pins to invert */
+};
+
 /*------------------------------------------------------------------------------
  *         Exported functions
  *------------------------------------------------------------------------------*/
@@ -117,6 +125,10 @@ extern "C" {
  * computed using ARRAY_SIZE whenever its length is not known in
  * advance.
  *
+ * Consecutive entries of the same group are configured together: their
+ * register writes are coalesced when possible. When a pin appears in
+ * several entries, the last one applies.
+ *
  * \param pins Pointer to a list of struct _pin instances.
  * \param size Size of the pins list
  */
@@ -224,6 +236,76 @@ extern void pio_enable_it(const struct _pin *pin);
  */
 extern void pio_disable_it(const struct _pin *pin);
 
+/**
+ * \brief Collects the masks of a list of pins, per PIO group.
+ *
+ * \param pins   Pointer to a list of struct _pin instances.
+ * \param size   Size of the pins list
+ * \param masks  Array of PIO_GROUP_LENGTH masks, the masks of the pins are
+ * added to its content.
+ */
+extern void pio_port_get_masks(const struct _pin *pins, uint32_t size,
+                               uint32_t *masks);
+
+/**
+ * \brief Updates the output levels of pins of several PIO groups.
+ *
+ * Each group with a non-empty mask is updated with at most two register
+ * writes: pins in 'clear' are driven low first, then pins in 'set' are
+ * driven high. Pins in 'toggle' are inverted from their current output
+ * level. Use pio_port_write() when the pins of a group must change
+ * simultaneously.
+ *
+ * \param masks  Pins to set, clear and toggle
+ */
+extern void pio_port_update(const struct _pio_port_masks *masks);
+
+/**
+ * \brief Reads the levels of all the pins of all the PIO groups.
+ *
+ * \param levels  Array of PIO_GROUP_LENGTH values, filled with the pin
+ * levels of each group (0 for groups not present on the device).
+ */
+extern void pio_port_read(uint32_t *levels);
+
+/**
+ * \brief Drives some pins of a PIO group to the given levels with a single
+ * write of the output data register.
+ *
+ * The pins must be configured as outputs. Only the pins in 'mask' are
+ * modified.
+ *
+ * \param group  PIO group number
+ * \param mask   Bitmask of the pins to drive
+ * \param value  Levels of the pins
+ */
+extern void pio_port_write(uint32_t group, uint32_t mask, uint32_t value);
+
+/**
+ * \brief Selects the pins of a group modified by writes to its output data
+ * register, either by pio_port_write() or by DMA.
+ *
+ * \param group  PIO group number
+ * \param mask   Bitmask of the pins
+ */
+extern void pio_set_output_write_mask(uint32_t group, uint32_t mask);
+
+/**
+ * \brief Gets the address of the output data register of a group (for DMA
+ * transfers).
+ *
+ * \param group  PIO group number
+ */
+extern volatile uint32_t *pio_get_output_data_register(uint32_t group);
+
+/**
+ * \brief Gets the address of the pin data status register of a group (for
+ * DMA transfers).
+ *
+ * \param group  PIO group number
+ */
+extern volatile const uint32_t *pio_get_pin_data_register(uint32_t group);
+
 #ifdef __cplusplus
 }
 #endif
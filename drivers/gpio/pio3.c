@@ -69,11 +69,38 @@
 #include "compiler.h"
 
 #include <assert.h>
+#include <stdbool.h>
+#include <string.h>
 
 /*----------------------------------------------------------------------------
  *        Local types
  *----------------------------------------------------------------------------*/
 
+/** Pins to set and to clear in a pair of PIO registers */
+struct _pio_masks {
+	uint32_t set;
+	uint32_t clear;
+};
+
+/** Register pairs updated by pio_configure() */
+enum _pio_cfg {
+	PIO_CFG_PULLUP,     /*< PIO_PUER / PIO_PUDR */
+	PIO_CFG_PULLDOWN,   /*< PIO_PPDER / PIO_PPDDR */
+	PIO_CFG_MULTIDRIVE, /*< PIO_MDER / PIO_MDDR */
+	PIO_CFG_FILTER,     /*< PIO_IFER / PIO_IFDR */
+	PIO_CFG_SLOWCLK,    /*< PIO_IFSCER / PIO_IFSCDR */
+	PIO_CFG_SCHMITT,    /*< PIO_SCHMITT (read-modify-write) */
+	PIO_CFG_AIM,        /*< PIO_AIMER / PIO_AIMDR */
+	PIO_CFG_LEVEL_IT,   /*< PIO_LSR / PIO_ESR */
+	PIO_CFG_RISE_HIGH,  /*< PIO_REHLSR / PIO_FELLSR */
+	PIO_CFG_ABCDSR0,    /*< PIO_ABCDSR[0] (read-modify-write) */
+	PIO_CFG_ABCDSR1,    /*< PIO_ABCDSR[1] (read-modify-write) */
+	PIO_CFG_DATA,       /*< PIO_SODR / PIO_CODR */
+	PIO_CFG_OUTPUT,     /*< PIO_OER / PIO_ODR */
+	PIO_CFG_PIO,        /*< PIO_PER / PIO_PDR */
+	PIO_CFG_COUNT,
+};
+
 struct _handler {
 	uint32_t      group;
 	uint32_t      mask;
@@ -247,132 +274,184 @@ static void _pio_handler(uint32_t source, void* user_arg)
 #endif
 }
 
+static void _pio_cfg_assign(struct _pio_masks *masks, uint32_t mask,
+			    bool value)
+{
+	if (value) {
+		masks->set |= mask;
+		masks->clear &= ~mask;
+	} else {
+		masks->clear |= mask;
+		masks->set &= ~mask;
+	}
+}
+
+static void _pio_collect_cfg(const struct _pin *pin, struct _pio_masks *cfg)
+{
+	uint32_t mask = pin->mask;
+
+	/* Enable pull-up resistors as requested */
+	_pio_cfg_assign(&cfg[PIO_CFG_PULLUP], mask,
+			pin->attribute & PIO_PULLUP);
+
+	/* Enable pull-down resistors as requested */
+	_pio_cfg_assign(&cfg[PIO_CFG_PULLDOWN], mask,
+			pin->attribute & PIO_PULLDOWN);
+
+	/* Select open-drain output stage as requested */
+	_pio_cfg_assign(&cfg[PIO_CFG_MULTIDRIVE], mask,
+			pin->attribute & PIO_OPENDRAIN);
+
+	/* Enable the input filter if requested */
+	_pio_cfg_assign(&cfg[PIO_CFG_FILTER], mask,
+			pin->attribute & (PIO_DEGLITCH | PIO_DEBOUNCE));
+
+	/* The de-bounce input filter depends on the slow clock */
+	_pio_cfg_assign(&cfg[PIO_CFG_SLOWCLK], mask,
+			pin->attribute & PIO_DEBOUNCE);
+
+	_pio_cfg_assign(&cfg[PIO_CFG_SCHMITT], mask,
+			!(pin->attribute & PIO_NO_SCHMITT_TRIG));
+
+	if (pin->attribute & PIO_DRVSTR_MASK)
+		trace_fatal("Invalid pin drive strength\r\n");
+
+	switch (pin->attribute & PIO_IT_MASK) {
+	case PIO_IT_FALL_EDGE:
+		_pio_cfg_assign(&cfg[PIO_CFG_AIM], mask, true);
+		_pio_cfg_assign(&cfg[PIO_CFG_LEVEL_IT], mask, false);
+		_pio_cfg_assign(&cfg[PIO_CFG_RISE_HIGH], mask, false);
+		break;
+	case PIO_IT_RISE_EDGE:
+		_pio_cfg_assign(&cfg[PIO_CFG_AIM], mask, true);
+		_pio_cfg_assign(&cfg[PIO_CFG_LEVEL_IT], mask, false);
+		_pio_cfg_assign(&cfg[PIO_CFG_RISE_HIGH], mask, true);
+		break;
+	case PIO_IT_BOTH_EDGE:
+		_pio_cfg_assign(&cfg[PIO_CFG_AIM], mask, false);
+		break;
+	case PIO_IT_LOW_LEVEL:
+		_pio_cfg_assign(&cfg[PIO_CFG_AIM], mask, true);
+		_pio_cfg_assign(&cfg[PIO_CFG_LEVEL_IT], mask, true);
+		_pio_cfg_assign(&cfg[PIO_CFG_RISE_HIGH], mask, false);
+		break;
+	case PIO_IT_HIGH_LEVEL:
+		_pio_cfg_assign(&cfg[PIO_CFG_AIM], mask, true);
+		_pio_cfg_assign(&cfg[PIO_CFG_LEVEL_IT], mask, true);
+		_pio_cfg_assign(&cfg[PIO_CFG_RISE_HIGH], mask, true);
+		break;
+	default:
+		trace_fatal("Invalid pin interrupt type\r\n");
+		break;
+	}
+
+	switch (pin->type) {
+	case PIO_PERIPH_A:
+	case PIO_PERIPH_B:
+	case PIO_PERIPH_C:
+	case PIO_PERIPH_D:
+		_pio_cfg_assign(&cfg[PIO_CFG_ABCDSR0], mask,
+				pin->type == PIO_PERIPH_B ||
+				pin->type == PIO_PERIPH_D);
+		_pio_cfg_assign(&cfg[PIO_CFG_ABCDSR1], mask,
+				pin->type == PIO_PERIPH_C ||
+				pin->type == PIO_PERIPH_D);
+		_pio_cfg_assign(&cfg[PIO_CFG_PIO], mask, false);
+		break;
+	case PIO_INPUT:
+		_pio_cfg_assign(&cfg[PIO_CFG_OUTPUT], mask, false);
+		_pio_cfg_assign(&cfg[PIO_CFG_PIO], mask, true);
+		break;
+	case PIO_OUTPUT_0:
+	case PIO_OUTPUT_1:
+		_pio_cfg_assign(&cfg[PIO_CFG_DATA], mask,
+				pin->type == PIO_OUTPUT_1);
+		_pio_cfg_assign(&cfg[PIO_CFG_OUTPUT], mask, true);
+		_pio_cfg_assign(&cfg[PIO_CFG_PIO], mask, true);
+		break;
+	default:
+		trace_fatal("Invalid pin type\r\n");
+	}
+}
+
+static void _pio_write_pair(volatile uint32_t *set_reg,
+			    volatile uint32_t *clear_reg,
+			    const struct _pio_masks *masks)
+{
+	if (masks->set)
+		*set_reg = masks->set;
+	if (masks->clear)
+		*clear_reg = masks->clear;
+}
+
+static void _pio_update_reg(volatile uint32_t *reg,
+			    const struct _pio_masks *masks)
+{
+	if (masks->set || masks->clear)
+		*reg = (*reg & ~masks->clear) | masks->set;
+}
+
 /*----------------------------------------------------------------------------
  *         Exported functions
  *----------------------------------------------------------------------------*/
 
 void pio_configure(const struct _pin *pin_list, uint32_t size)
 {
-	int i;
-
-	for (i = 0; i < size; i++) {
-		const struct _pin *pin = &pin_list[i];
-		Pio* pio = _pio_get_instance(pin->group);
+	int i = 0;
+
+	while (i < size) {
+		uint32_t group = pin_list[i].group;
+		Pio* pio = _pio_get_instance(group);
+		struct _pio_masks cfg[PIO_CFG_COUNT];
+		uint32_t mask = 0;
+		bool input = false;
+
+		memset(cfg, 0, sizeof(cfg));
+
+		/* Collect the configuration of the following entries of the
+		 * same group, each register is then written once */
+		for (; i < size && pin_list[i].group == group; i++) {
+			const struct _pin *pin = &pin_list[i];
+			mask |= pin->mask;
+			if (pin->type == PIO_INPUT)
+				input = true;
+			_pio_collect_cfg(pin, cfg);
+		}
 
 		/* Disable interrupts */
-		pio->PIO_IDR = pin->mask;
+		pio->PIO_IDR = mask;
 
 		/* The PIO input logic requires the peripheral clock */
-		if (pin->type == PIO_INPUT)
-			pmc_configure_peripheral(_pio_get_periph_id(pin->group), NULL, true);
-
-		/* Enable pull-up resistors as requested */
-		if (pin->attribute & PIO_PULLUP)
-			pio->PIO_PUER = pin->mask;
-		else
-			pio->PIO_PUDR = pin->mask;
-
-		/* Enable pull-down resistors as requested */
-		if (pin->attribute & PIO_PULLDOWN)
-			pio->PIO_PPDER = pin->mask;
-		else
-			pio->PIO_PPDDR = pin->mask;
-
-		/* Select open-drain output stage as requested */
-		if (pin->attribute & PIO_OPENDRAIN)
-			pio->PIO_MDER = pin->mask;
-		else
-			pio->PIO_MDDR = pin->mask;
-
-		/* Enable the input filter if requested */
-		if (pin->attribute & (PIO_DEGLITCH | PIO_DEBOUNCE))
-			pio->PIO_IFER = pin->mask;
-		else
-			pio->PIO_IFDR = pin->mask;
-
-		/* The de-bounce input filter depends on the slow clock */
-		if (pin->attribute & PIO_DEBOUNCE)
-			pio->PIO_IFSCER = pin->mask;
-		else
-			pio->PIO_IFSCDR = pin->mask;
-
-		if (pin->attribute & PIO_NO_SCHMITT_TRIG)
-			pio->PIO_SCHMITT &= ~pin->mask;
-		else
-			pio->PIO_SCHMITT |= pin->mask;
-
-		if (pin->attribute & PIO_DRVSTR_MASK)
-			trace_fatal("Invalid pin drive strength\r\n");
-
-		switch (pin->attribute & PIO_IT_MASK) {
-		case PIO_IT_FALL_EDGE:
-			pio->PIO_AIMER = pin->mask;
-			pio->PIO_ESR = pin->mask;
-			pio->PIO_FELLSR = pin->mask;
-			break;
-		case PIO_IT_RISE_EDGE:
-			pio->PIO_AIMER = pin->mask;
-			pio->PIO_ESR = pin->mask;
-			pio->PIO_REHLSR = pin->mask;
-			break;
-		case PIO_IT_BOTH_EDGE:
-			pio->PIO_AIMDR = pin->mask;
-			break;
-		case PIO_IT_LOW_LEVEL:
-			pio->PIO_AIMER = pin->mask;
-			pio->PIO_LSR = pin->mask;
-			pio->PIO_FELLSR = pin->mask;
-			break;
-		case PIO_IT_HIGH_LEVEL:
-			pio->PIO_AIMER = pin->mask;
-			pio->PIO_LSR = pin->mask;
-			pio->PIO_REHLSR = pin->mask;
-			break;
-		default:
-			trace_fatal("Invalid pin interrupt type\r\n");
-			break;
-		}
-
-		switch (pin->type) {
-		case PIO_PERIPH_A:
-			pio->PIO_ABCDSR[0] &= ~pin->mask;
-			pio->PIO_ABCDSR[1] &= ~pin->mask;
-			pio->PIO_PDR = pin->mask;
-			break;
-		case PIO_PERIPH_B:
-			pio->PIO_ABCDSR[0] |= pin->mask;
-			pio->PIO_ABCDSR[1] &= ~pin->mask;
-			pio->PIO_PDR = pin->mask;
-			break;
-		case PIO_PERIPH_C:
-			pio->PIO_ABCDSR[0] &= ~pin->mask;
-			pio->PIO_ABCDSR[1] |= pin->mask;
-			pio->PIO_PDR = pin->mask;
-			break;
-		case PIO_PERIPH_D:
-			pio->PIO_ABCDSR[0] |= pin->mask;
-			pio->PIO_ABCDSR[1] |= pin->mask;
-			pio->PIO_PDR = pin->mask;
-			break;
-		case PIO_INPUT:
-			pio->PIO_ODR = pin->mask;
-			pio->PIO_PER = pin->mask;
-			break;
-		case PIO_OUTPUT_0:
-		case PIO_OUTPUT_1:
-			/* Select the logic level to be driven */
-			if (pin->type == PIO_OUTPUT_1)
-				pio->PIO_SODR = pin->mask;
-			else
-				pio->PIO_CODR = pin->mask;
-			/* Give control of the pin(s) to the PIO (vs to the
-			 * peripheral), and enable the output stage */
-			pio->PIO_OER = pin->mask;
-			pio->PIO_PER = pin->mask;
-			break;
-		default:
-			trace_fatal("Invalid pin type\r\n");
-		}
+		if (input)
+			pmc_configure_peripheral(_pio_get_periph_id(group), NULL, true);
+
+		_pio_write_pair(&pio->PIO_PUER, &pio->PIO_PUDR,
+				&cfg[PIO_CFG_PULLUP]);
+		_pio_write_pair(&pio->PIO_PPDER, &pio->PIO_PPDDR,
+				&cfg[PIO_CFG_PULLDOWN]);
+		_pio_write_pair(&pio->PIO_MDER, &pio->PIO_MDDR,
+				&cfg[PIO_CFG_MULTIDRIVE]);
+		_pio_write_pair(&pio->PIO_IFER, &pio->PIO_IFDR,
+				&cfg[PIO_CFG_FILTER]);
+		_pio_write_pair(&pio->PIO_IFSCER, &pio->PIO_IFSCDR,
+				&cfg[PIO_CFG_SLOWCLK]);
+		_pio_update_reg(&pio->PIO_SCHMITT, &cfg[PIO_CFG_SCHMITT]);
+		_pio_write_pair(&pio->PIO_AIMER, &pio->PIO_AIMDR,
+				&cfg[PIO_CFG_AIM]);
+		_pio_write_pair(&pio->PIO_LSR, &pio->PIO_ESR,
+				&cfg[PIO_CFG_LEVEL_IT]);
+		_pio_write_pair(&pio->PIO_REHLSR, &pio->PIO_FELLSR,
+				&cfg[PIO_CFG_RISE_HIGH]);
+		_pio_update_reg(&pio->PIO_ABCDSR[0], &cfg[PIO_CFG_ABCDSR0]);
+		_pio_update_reg(&pio->PIO_ABCDSR[1], &cfg[PIO_CFG_ABCDSR1]);
+		/* Select the logic level to be driven, then give control of
+		 * the pins to the PIO (vs to the peripheral) */
+		_pio_write_pair(&pio->PIO_SODR, &pio->PIO_CODR,
+				&cfg[PIO_CFG_DATA]);
+		_pio_write_pair(&pio->PIO_OER, &pio->PIO_ODR,
+				&cfg[PIO_CFG_OUTPUT]);
+		_pio_write_pair(&pio->PIO_PER, &pio->PIO_PDR,
+				&cfg[PIO_CFG_PIO]);
 	}
 }
 
@@ -498,3 +577,74 @@ void pio_disable_it(const struct _pin *pin)
 	Pio* pio = _pio_get_instance(pin->group);
 	pio->PIO_IDR = pin->mask;
 }
+
+void pio_port_get_masks(const struct _pin *pins, uint32_t size,
+                        uint32_t *masks)
+{
+	int i;
+
+	for (i = 0; i < size; i++) {
+		assert(pins[i].group < PIO_GROUP_LENGTH);
+		masks[pins[i].group] |= pins[i].mask;
+	}
+}
+
+void pio_port_update(const struct _pio_port_masks *masks)
+{
+	int i;
+
+	for (i = 0; i < PIO_GROUP_LENGTH; i++) {
+		uint32_t set = masks->set[i];
+		uint32_t clear = masks->clear[i];
+		Pio* pio;
+
+		if (!(set | clear | masks->toggle[i]) || !_pio_has_group(i))
+			continue;
+		pio = _pio_get_instance(i);
+		if (masks->toggle[i]) {
+			uint32_t odsr = pio->PIO_ODSR;
+			set |= masks->toggle[i] & ~odsr;
+			clear |= masks->toggle[i] & odsr;
+		}
+		if (clear)
+			pio->PIO_CODR = clear;
+		if (set)
+			pio->PIO_SODR = set;
+	}
+}
+
+void pio_port_read(uint32_t *levels)
+{
+	int i;
+
+	for (i = 0; i < PIO_GROUP_LENGTH; i++)
+		levels[i] = _pio_has_group(i) ?
+			_pio_get_instance(i)->PIO_PDSR : 0;
+}
+
+void pio_port_write(uint32_t group, uint32_t mask, uint32_t value)
+{
+	Pio* pio = _pio_get_instance(group);
+
+	pio->PIO_OWDR = ~mask;
+	pio->PIO_OWER = mask;
+	pio->PIO_ODSR = value;
+}
+
+void pio_set_output_write_mask(uint32_t group, uint32_t mask)
+{
+	Pio* pio = _pio_get_instance(group);
+
+	pio->PIO_OWDR = ~mask;
+	pio->PIO_OWER = mask;
+}
+
+volatile uint32_t *pio_get_output_data_register(uint32_t group)
+{
+	return &_pio_get_instance(group)->PIO_ODSR;
+}
+
+volatile const uint32_t *pio_get_pin_data_register(uint32_t group)
+{
+	return &_pio_get_instance(group)->PIO_PDSR;
+}
@@ -69,6 +69,7 @@
 #include "compiler.h"
 
 #include <assert.h>
+#include <stdbool.h>
 
 /*----------------------------------------------------------------------------
  *        Local types
@@ -115,6 +116,9 @@ static uint32_t _pio_get_group_mask(uint32_t id)
 	return group;
 }
 
+/** Number of PIO groups implemented by the controller */
+#define _PIO_GROUP_COUNT ARRAY_SIZE(((Pio*)0)->PIO_IO)
+
 static PioIo* _pio_get_instance(uint32_t group)
 {
 	assert(group < PIO_GROUP_LENGTH);
@@ -188,123 +192,155 @@ static void _pio_handler(uint32_t source, void* user_arg)
 #endif
 }
 
+static uint32_t _pio_get_cfgr(const struct _pin *pin)
+{
+	uint32_t cfgr = 0;
+
+	/* Enable pull-up resistors as requested */
+	if (pin->attribute & PIO_PULLUP)
+		cfgr |= PIO_CFGR_PUEN_ENABLED;
+
+	/* Enable pull-down resistors as requested */
+	if (pin->attribute & PIO_PULLDOWN)
+		cfgr |= PIO_CFGR_PDEN_ENABLED;
+
+	/* Select open-drain output stage as requested */
+	if (pin->attribute & PIO_OPENDRAIN)
+		cfgr |= PIO_CFGR_OPD_ENABLED;
+
+	if (pin->attribute & PIO_DEGLITCH)
+		cfgr |= PIO_CFGR_IFEN_ENABLED;
+
+	if (pin->attribute & PIO_DEBOUNCE)
+		cfgr |= PIO_CFGR_IFSCEN_ENABLED;
+
+	if (pin->attribute & PIO_NO_SCHMITT_TRIG)
+		cfgr |= PIO_CFGR_SCHMITT_DISABLED;
+
+	switch (pin->attribute & PIO_DRVSTR_MASK) {
+	case PIO_DRVSTR_LO:
+		cfgr |= PIO_CFGR_DRVSTR_LO;
+		break;
+	case PIO_DRVSTR_ME:
+		cfgr |= PIO_CFGR_DRVSTR_ME;
+		break;
+	case PIO_DRVSTR_HI:
+		cfgr |= PIO_CFGR_DRVSTR_HI;
+		break;
+	default:
+		trace_fatal("Invalid pin drive strength\r\n");
+		break;
+	}
+
+	switch (pin->attribute & PIO_IT_MASK) {
+	case PIO_IT_FALL_EDGE:
+		cfgr |= PIO_CFGR_EVTSEL_FALLING;
+		break;
+	case PIO_IT_RISE_EDGE:
+		cfgr |= PIO_CFGR_EVTSEL_RISING;
+		break;
+	case PIO_IT_BOTH_EDGE:
+		cfgr |= PIO_CFGR_EVTSEL_BOTH;
+		break;
+	case PIO_IT_LOW_LEVEL:
+		cfgr |= PIO_CFGR_EVTSEL_LOW;
+		break;
+	case PIO_IT_HIGH_LEVEL:
+		cfgr |= PIO_CFGR_EVTSEL_HIGH;
+		break;
+	default:
+		trace_fatal("Invalid pin interrupt type\r\n");
+		break;
+	}
+
+	switch (pin->type) {
+	case PIO_PERIPH_A:
+		cfgr |= PIO_CFGR_FUNC_PERIPH_A;
+		break;
+	case PIO_PERIPH_B:
+		cfgr |= PIO_CFGR_FUNC_PERIPH_B;
+		break;
+	case PIO_PERIPH_C:
+		cfgr |= PIO_CFGR_FUNC_PERIPH_C;
+		break;
+	case PIO_PERIPH_D:
+		cfgr |= PIO_CFGR_FUNC_PERIPH_D;
+		break;
+	case PIO_PERIPH_E:
+		cfgr |= PIO_CFGR_FUNC_PERIPH_E;
+		break;
+	case PIO_PERIPH_F:
+		cfgr |= PIO_CFGR_FUNC_PERIPH_F;
+		break;
+	case PIO_PERIPH_G:
+		cfgr |= PIO_CFGR_FUNC_PERIPH_G;
+		break;
+	case PIO_INPUT:
+		break;
+	case PIO_OUTPUT_0:
+	case PIO_OUTPUT_1:
+		cfgr |= PIO_CFGR_DIR_OUTPUT;
+		break;
+	default:
+		trace_fatal("Invalid pin type\r\n");
+	}
+
+	return cfgr;
+}
+
 /*----------------------------------------------------------------------------
  *         Exported functions
  *----------------------------------------------------------------------------*/
 
 void pio_configure(const struct _pin *pin_list, uint32_t size)
 {
-	int i;
-
-	for (i = 0; i < size; i++) {
-		const struct _pin *pin = &pin_list[i];
-		PioIo* pio = _pio_get_instance(pin->group);
-		uint32_t cfgr = 0;
+	bool clock = false;
+	int i = 0;
+
+	while (i < size) {
+		const struct _pin *first = &pin_list[i];
+		PioIo* pio = _pio_get_instance(first->group);
+		uint32_t cfgr = _pio_get_cfgr(first);
+		uint32_t mask = 0;
+		uint32_t set = 0;
+		uint32_t clear = 0;
+
+		/* Merge the following entries with the same group and
+		 * configuration, they are written together */
+		for (; i < size; i++) {
+			const struct _pin *pin = &pin_list[i];
+			if (pin->group != first->group ||
+			    _pio_get_cfgr(pin) != cfgr)
+				break;
+			mask |= pin->mask;
+			if (pin->type == PIO_OUTPUT_1) {
+				set |= pin->mask;
+				clear &= ~pin->mask;
+			} else if (pin->type == PIO_OUTPUT_0) {
+				clear |= pin->mask;
+				set &= ~pin->mask;
+			}
+		}
 
 		/* Disable interrupts */
-		pio->PIO_IDR = pin->mask;
+		pio->PIO_IDR = mask;
 
 		/* The PIO input logic requires the peripheral clock */
-		if (pin->type == PIO_INPUT)
+		if (first->type == PIO_INPUT && !clock) {
 			pmc_configure_peripheral(ID_PIOA, NULL, true);
-
-		/* Configure pins as non-secure */
-		PIOA->S_PIO_IO[pin->group].S_PIO_SIONR = pin->mask;
-
-		/* Enable pull-up resistors as requested */
-		if (pin->attribute & PIO_PULLUP)
-			cfgr |= PIO_CFGR_PUEN_ENABLED;
-
-		/* Enable pull-down resistors as requested */
-		if (pin->attribute & PIO_PULLDOWN)
-			cfgr |= PIO_CFGR_PDEN_ENABLED;
-
-		/* Select open-drain output stage as requested */
-		if (pin->attribute & PIO_OPENDRAIN)
-			cfgr |= PIO_CFGR_OPD_ENABLED;
-
-		if (pin->attribute & PIO_DEGLITCH)
-			cfgr |= PIO_CFGR_IFEN_ENABLED;
-
-		if (pin->attribute & PIO_DEBOUNCE)
-			cfgr |= PIO_CFGR_IFSCEN_ENABLED;
-
-		if (pin->attribute & PIO_NO_SCHMITT_TRIG)
-			cfgr |= PIO_CFGR_SCHMITT_DISABLED;
-
-		switch (pin->attribute & PIO_DRVSTR_MASK) {
-		case PIO_DRVSTR_LO:
-			cfgr |= PIO_CFGR_DRVSTR_LO;
-			break;
-		case PIO_DRVSTR_ME:
-			cfgr |= PIO_CFGR_DRVSTR_ME;
-			break;
-		case PIO_DRVSTR_HI:
-			cfgr |= PIO_CFGR_DRVSTR_HI;
-			break;
-		default:
-			trace_fatal("Invalid pin drive strength\r\n");
-			break;
+			clock = true;
 		}
 
-		switch (pin->attribute & PIO_IT_MASK) {
-		case PIO_IT_FALL_EDGE:
-			cfgr |= PIO_CFGR_EVTSEL_FALLING;
-			break;
-		case PIO_IT_RISE_EDGE:
-			cfgr |= PIO_CFGR_EVTSEL_RISING;
-			break;
-		case PIO_IT_BOTH_EDGE:
-			cfgr |= PIO_CFGR_EVTSEL_BOTH;
-			break;
-		case PIO_IT_LOW_LEVEL:
-			cfgr |= PIO_CFGR_EVTSEL_LOW;
-			break;
-		case PIO_IT_HIGH_LEVEL:
-			cfgr |= PIO_CFGR_EVTSEL_HIGH;
-			break;
-		default:
-			trace_fatal("Invalid pin interrupt type\r\n");
-			break;
-		}
+		/* Configure pins as non-secure */
+		PIOA->S_PIO_IO[first->group].S_PIO_SIONR = mask;
 
-		switch (pin->type) {
-		case PIO_PERIPH_A:
-			cfgr |= PIO_CFGR_FUNC_PERIPH_A;
-			break;
-		case PIO_PERIPH_B:
-			cfgr |= PIO_CFGR_FUNC_PERIPH_B;
-			break;
-		case PIO_PERIPH_C:
-			cfgr |= PIO_CFGR_FUNC_PERIPH_C;
-			break;
-		case PIO_PERIPH_D:
-			cfgr |= PIO_CFGR_FUNC_PERIPH_D;
-			break;
-		case PIO_PERIPH_E:
-			cfgr |= PIO_CFGR_FUNC_PERIPH_E;
-			break;
-		case PIO_PERIPH_F:
-			cfgr |= PIO_CFGR_FUNC_PERIPH_F;
-			break;
-		case PIO_PERIPH_G:
-			cfgr |= PIO_CFGR_FUNC_PERIPH_G;
-			break;
-		case PIO_INPUT:
-			break;
-		case PIO_OUTPUT_0:
-		case PIO_OUTPUT_1:
-			if (pin->type == PIO_OUTPUT_1)
-				pio->PIO_SODR = pin->mask;
-			else
-				pio->PIO_CODR = pin->mask;
-			cfgr |= PIO_CFGR_DIR_OUTPUT;
-			break;
-		default:
-			trace_fatal("Invalid pin type\r\n");
-		}
+		/* Set the initial level of outputs */
+		if (set)
+			pio->PIO_SODR = set;
+		if (clear)
+			pio->PIO_CODR = clear;
 
-		pio->PIO_MSKR = pin->mask;
+		pio->PIO_MSKR = mask;
 		pio->PIO_CFGR = cfgr;
 	}
 }
@@ -392,3 +428,67 @@ void pio_disable_it(const struct _pin *pin)
 	PioIo* pio = _pio_get_instance(pin->group);
 	pio->PIO_IDR = pin->mask;
 }
+
+void pio_port_get_masks(const struct _pin *pins, uint32_t size,
+                        uint32_t *masks)
+{
+	int i;
+
+	for (i = 0; i < size; i++) {
+		assert(pins[i].group < PIO_GROUP_LENGTH);
+		masks[pins[i].group] |= pins[i].mask;
+	}
+}
+
+void pio_port_update(const struct _pio_port_masks *masks)
+{
+	int i;
+
+	for (i = 0; i < _PIO_GROUP_COUNT; i++) {
+		PioIo* pio = _pio_get_instance(i);
+		uint32_t set = masks->set[i];
+		uint32_t clear = masks->clear[i];
+
+		if (masks->toggle[i]) {
+			uint32_t odsr = pio->PIO_ODSR;
+			set |= masks->toggle[i] & ~odsr;
+			clear |= masks->toggle[i] & odsr;
+		}
+		if (clear)
+			pio->PIO_CODR = clear;
+		if (set)
+			pio->PIO_SODR = set;
+	}
+}
+
+void pio_port_read(uint32_t *levels)
+{
+	int i;
+
+	for (i = 0; i < PIO_GROUP_LENGTH; i++)
+		levels[i] = i < _PIO_GROUP_COUNT ?
+			_pio_get_instance(i)->PIO_PDSR : 0;
+}
+
+void pio_port_write(uint32_t group, uint32_t mask, uint32_t value)
+{
+	PioIo* pio = _pio_get_instance(group);
+
+	pio->PIO_MSKR = mask;
+	pio->PIO_ODSR = value;
+}
+
+void pio_set_output_write_mask(uint32_t group, uint32_t mask)
+{
+	_pio_get_instance(group)->PIO_MSKR = mask;
+}
+
+volatile uint32_t *pio_get_output_data_register(uint32_t group)
+{
+	return &_pio_get_instance(group)->PIO_ODSR;
+}
+
+volatile const uint32_t *pio_get_pin_data_register(uint32_t group)
+{
+	return &_pio_get_instance(group)->PIO_PDSR;
+}
@@ -0,0 +1,268 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "compiler.h"
+#include "dma/dma.h"
+#include "dma/dma_xdmac.h"
+#include "errno.h"
+#include "gpio/pio.h"
+#include "gpio/piod.h"
+#include "mm/cache.h"
+#include "peripherals/pmc.h"
+#include "peripherals/tc.h"
+
+#if defined(CONFIG_HAVE_XDMAC) && defined(CONFIG_HAVE_TC_DMA_MODE)
+
+/*----------------------------------------------------------------------------
+ *        Local variables
+ *----------------------------------------------------------------------------*/
+
+/** Destination of the TC_RAB reads acknowledging the TC DMA requests */
+NOT_CACHED
+static uint32_t _piod_ack;
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static int _piod_transfer_callback(void* args)
+{
+	struct _piod_desc* desc = (struct _piod_desc*)args;
+
+	tc_stop(desc->tc, desc->channel);
+	if (desc->xfer.read)
+		cache_invalidate_region(desc->xfer.buffer, desc->xfer.size);
+
+	dma_reset_channel(desc->xfer.channel);
+	mutex_unlock(&desc->mutex);
+
+	return callback_call(&desc->callback);
+}
+
+static void _piod_set_desc(struct _xdmac_desc_view2* dma_desc,
+			   const void* src, void* dest, uint32_t cfg)
+{
+	dma_desc->mbr_nda = dma_desc + 1;
+	dma_desc->mbr_ubc = XDMA_UBC_NVIEW_NDV2
+	                  | XDMA_UBC_NDE_FETCH_EN
+	                  | XDMA_UBC_NSEN_UPDATED
+	                  | XDMA_UBC_NDEN_UPDATED
+	                  | XDMA_UBC_UBLEN(1);
+	dma_desc->mbr_sa = src;
+	dma_desc->mbr_da = dest;
+	dma_desc->mbr_cfg = cfg;
+}
+
+static int _piod_transfer(struct _piod_desc* desc, void* buffer,
+			  uint32_t count, bool read, struct _callback* cb)
+{
+	volatile const uint32_t* rab = &desc->tc->TC_CHANNEL[desc->channel].TC_RAB;
+	struct _xdmac_desc_view2* dma_desc = desc->dma_desc;
+	uint32_t* samples = (uint32_t*)buffer;
+	struct _xdmacd_cfg cfg;
+	struct _callback _cb;
+	uint32_t ack_cfg, data_cfg, desc_ctrl, i;
+	void* data;
+
+	if (count == 0 || !dma_desc ||
+	    desc->dma_desc_count < PIOD_DESC_COUNT(desc->edge, count))
+		return -EINVAL;
+
+	if (!mutex_try_lock(&desc->mutex))
+		return -EBUSY;
+
+	callback_copy(&desc->callback, cb);
+	desc->xfer.buffer = buffer;
+	desc->xfer.size = count * sizeof(uint32_t);
+	desc->xfer.read = read;
+
+	ack_cfg = XDMAC_CC_TYPE_PER_TRAN
+	        | XDMAC_CC_MBSIZE_SINGLE
+	        | XDMAC_CC_DSYNC_PER2MEM
+	        | XDMAC_CC_SWREQ_HWR_CONNECTED
+	        | XDMAC_CC_CSIZE_CHK_1
+	        | XDMAC_CC_DWIDTH_WORD
+	        | XDMAC_CC_SIF_AHB_IF1
+	        | XDMAC_CC_DIF_AHB_IF0
+	        | XDMAC_CC_SAM_FIXED_AM
+	        | XDMAC_CC_DAM_FIXED_AM
+	        | XDMAC_CC_PERID(desc->xfer.channel->src_rxif);
+	/* The sample is moved as soon as the request is acknowledged */
+	data_cfg = XDMAC_CC_TYPE_MEM_TRAN
+	         | XDMAC_CC_MBSIZE_SINGLE
+	         | XDMAC_CC_SWREQ_SWR_CONNECTED
+	         | XDMAC_CC_CSIZE_CHK_1
+	         | XDMAC_CC_DWIDTH_WORD
+	         | XDMAC_CC_SAM_FIXED_AM
+	         | XDMAC_CC_DAM_FIXED_AM
+	         | XDMAC_CC_PERID_Msk;
+	if (read) {
+		data = (void*)pio_get_pin_data_register(desc->group);
+		data_cfg |= XDMAC_CC_SIF_AHB_IF1 | XDMAC_CC_DIF_AHB_IF0;
+	} else {
+		data = (void*)pio_get_output_data_register(desc->group);
+		data_cfg |= XDMAC_CC_SIF_AHB_IF0 | XDMAC_CC_DIF_AHB_IF1;
+		cache_clean_region(buffer, desc->xfer.size);
+		pio_set_output_write_mask(desc->group, desc->mask);
+	}
+
+	/* RA and RB are loaded alternately: with a single sampling edge,
+	 * the load on the other edge is acknowledged and ignored */
+	for (i = 0; i < count; i++) {
+		_piod_set_desc(dma_desc++, (const void*)rab, &_piod_ack, ack_cfg);
+		if (read)
+			_piod_set_desc(dma_desc++, data, &samples[i], data_cfg);
+		else
+			_piod_set_desc(dma_desc++, &samples[i], data, data_cfg);
+		if (desc->edge != PIOD_EDGE_BOTH)
+			_piod_set_desc(dma_desc++, (const void*)rab, &_piod_ack,
+				       ack_cfg);
+	}
+	/* The last load needs no acknowledge, the timer is stopped */
+	if (desc->edge != PIOD_EDGE_BOTH)
+		dma_desc--;
+	(dma_desc - 1)->mbr_nda = NULL;
+	(dma_desc - 1)->mbr_ubc &= ~XDMA_UBC_NDE_FETCH_EN;
+	cache_clean_region(desc->dma_desc,
+			   (dma_desc - desc->dma_desc) * sizeof(*dma_desc));
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cfg = ack_cfg;
+	desc_ctrl = XDMAC_CNDC_NDVIEW_NDV2
+	          | XDMAC_CNDC_NDE_DSCR_FETCH_EN
+	          | XDMAC_CNDC_NDSUP_SRC_PARAMS_UPDATED
+	          | XDMAC_CNDC_NDDUP_DST_PARAMS_UPDATED;
+	xdmacd_configure_transfer(desc->xfer.channel, &cfg, desc_ctrl,
+				  desc->dma_desc);
+
+	callback_set(&_cb, _piod_transfer_callback, (void*)desc);
+	dma_set_callback(desc->xfer.channel, &_cb);
+
+	dma_start_transfer(desc->xfer.channel);
+
+	/* Drop the loads left by a previous transfer so that the first
+	 * request comes from the first edge */
+	*rab;
+	*rab;
+	tc_get_status(desc->tc, desc->channel);
+	tc_start(desc->tc, desc->channel);
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------
+ *        Public functions
+ *----------------------------------------------------------------------------*/
+
+int piod_configure(struct _piod_desc* desc)
+{
+	uint32_t tc_id = get_tc_id_from_addr(desc->tc, desc->channel);
+	uint32_t mode = TC_CMR_TCCLKS_TIMER_CLOCK1;
+	uint32_t emr = 0;
+
+	switch (desc->edge) {
+	case PIOD_EDGE_RISING:
+	case PIOD_EDGE_BOTH:
+		mode |= TC_CMR_LDRA_RISING | TC_CMR_LDRB_FALLING;
+		break;
+	case PIOD_EDGE_FALLING:
+		mode |= TC_CMR_LDRA_FALLING | TC_CMR_LDRB_RISING;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (desc->pwm_trigger) {
+#ifdef TC_EMR_TRIGSRCA_PWMx
+		emr |= TC_EMR_TRIGSRCA_PWMx;
+#else
+		return -EINVAL;
+#endif
+	}
+
+	desc->mutex = 0;
+	callback_set(&desc->callback, NULL, NULL);
+
+	desc->xfer.channel = dma_allocate_channel(tc_id, DMA_PERIPH_MEMORY);
+	if (!desc->xfer.channel)
+		return -ENODEV;
+
+	if (!pmc_is_peripheral_enabled(tc_id))
+		pmc_configure_peripheral(tc_id, NULL, true);
+
+	/* Capture mode: the counter value is irrelevant, only the RA/RB
+	 * loads matter as they raise the DMA requests */
+	tc_configure(desc->tc, desc->channel, mode);
+	desc->tc->TC_CHANNEL[desc->channel].TC_EMR = emr;
+
+	return 0;
+}
+
+int piod_write(struct _piod_desc* desc, const uint32_t* pattern,
+	       uint32_t count, struct _callback* cb)
+{
+	return _piod_transfer(desc, (void*)pattern, count, false, cb);
+}
+
+int piod_read(struct _piod_desc* desc, uint32_t* samples,
+	      uint32_t count, struct _callback* cb)
+{
+	return _piod_transfer(desc, samples, count, true, cb);
+}
+
+void piod_stop(struct _piod_desc* desc)
+{
+	tc_stop(desc->tc, desc->channel);
+	if (mutex_is_locked(&desc->mutex)) {
+		dma_stop_transfer(desc->xfer.channel);
+		dma_reset_channel(desc->xfer.channel);
+		mutex_unlock(&desc->mutex);
+	}
+}
+
+bool piod_is_busy(struct _piod_desc* desc)
+{
+	return mutex_is_locked(&desc->mutex);
+}
+
+void piod_wait(struct _piod_desc* desc)
+{
+	while (mutex_is_locked(&desc->mutex))
+		dma_poll();
+}
+
+#endif /* CONFIG_HAVE_XDMAC && CONFIG_HAVE_TC_DMA_MODE */
@@ -0,0 +1,174 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * DMA-driven parallel pattern output and capture on a PIO group.
+ *
+ * Each sample is a 32-bit word written to the output data register of the
+ * group (PIO_ODSR, only the pins selected by the mask are driven) or read
+ * from its pin data status register (PIO_PDSR). The transfer is paced by the
+ * edges of the input A of a TC channel in capture mode: the TIOA pin (e.g. the
+ * strobe of the bus, or a clock looped back from a PWM or TC output) or,
+ * on devices where TC_EMR.TRIGSRCA is available, the matching PWM output.
+ *
+ * The TC raises a DMA request each time RA or RB is loaded. The request is
+ * acknowledged by reading TC_RAB, so each sample uses a peripheral-synchronized
+ * descriptor reading TC_RAB followed by a memory descriptor moving the sample.
+ * The linked list is built in the descriptor array given by the caller.
+ *
+ * piod_write() selects the driven pins once, when the transfer starts, with
+ * the write mask of the group (PIO_MSKR on PIO4, PIO_OWER/PIO_OWDR on PIO3).
+ * While piod_is_busy() returns true the group belongs to the driver:
+ * pio_port_write(), pio_set_output_write_mask() and, on PIO4,
+ * pio_configure() on any pin of the group change that mask and corrupt the
+ * running pattern. Stop or wait for the transfer first.
+ */
+
+#ifndef PIOD_H
+#define PIOD_H
+
+#if defined(CONFIG_HAVE_XDMAC) && defined(CONFIG_HAVE_TC_DMA_MODE)
+
+/*------------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "callback.h"
+#include "chip.h"
+#include "dma/dma.h"
+#include "dma/xdmac.h"
+#include "mutex.h"
+
+/*------------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+/** Edges of the TC input A on which samples are transferred */
+enum _piod_edge
+{
+	PIOD_EDGE_RISING = 0,
+	PIOD_EDGE_FALLING,
+	PIOD_EDGE_BOTH,
+};
+
+struct _piod_desc {
+	uint32_t group;          /*< PIO group */
+	uint32_t mask;           /*< Pins driven by piod_write() */
+	Tc* tc;                  /*< Pacing timer */
+	uint8_t channel;         /*< Pacing timer channel */
+	enum _piod_edge edge;    /*< Sampling edges */
+	bool pwm_trigger;        /*< Input A driven by PWMx instead of TIOAx */
+
+	/* Descriptors of the linked list, see PIOD_DESC_COUNT() */
+	struct _xdmac_desc_view2* dma_desc;
+	uint32_t dma_desc_count;
+
+	mutex_t mutex;
+	struct _callback callback;
+
+	/* structure to hold data about current transfer */
+	struct {
+		struct _dma_channel* channel;
+		void* buffer;
+		uint32_t size;
+		bool read;
+	} xfer;
+};
+
+/*------------------------------------------------------------------------------
+ *        Macros
+ *----------------------------------------------------------------------------*/
+
+/** Number of DMA descriptors needed to transfer 'samples' samples */
+#define PIOD_DESC_COUNT(edge, samples) \
+	((samples) * ((edge) == PIOD_EDGE_BOTH ? 2 : 3))
+
+/*------------------------------------------------------------------------------
+ *        Functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Configure the pacing timer and allocate the DMA channel
+ * \param desc  Driver descriptor, all its configuration fields must be set
+ * \return 0 on success, -EINVAL or -ENODEV otherwise
+ */
+extern int piod_configure(struct _piod_desc* desc);
+
+/**
+ * \brief Drive a pattern on the pins of the group, one word per sample
+ * The other PIO functions must not be used on the group until the transfer
+ * ends, see above.
+ * \param desc     Driver descriptor
+ * \param pattern  Samples to write to PIO_ODSR
+ * \param count    Number of samples
+ * \param cb       Callback invoked once all samples are written
+ * \return 0 on success, -EBUSY if a transfer is running, -EINVAL if
+ * dma_desc_count is too small
+ */
+extern int piod_write(struct _piod_desc* desc, const uint32_t* pattern,
+		      uint32_t count, struct _callback* cb);
+
+/**
+ * \brief Capture the levels of the pins of the group, one word per sample
+ * \param desc     Driver descriptor
+ * \param samples  Buffer receiving the PIO_PDSR values
+ * \param count    Number of samples
+ * \param cb       Callback invoked once all samples are captured
+ * \return 0 on success, -EBUSY if a transfer is running, -EINVAL if
+ * dma_desc_count is too small
+ */
+extern int piod_read(struct _piod_desc* desc, uint32_t* samples,
+		     uint32_t count, struct _callback* cb);
+
+/**
+ * \brief Abort the current transfer
+ * \param desc  Driver descriptor
+ */
+extern void piod_stop(struct _piod_desc* desc);
+
+/**
+ * \brief Check if a transfer is running
+ * \param desc  Driver descriptor
+ */
+extern bool piod_is_busy(struct _piod_desc* desc);
+
+/**
+ * \brief Wait for the end of the current transfer
+ * \param desc  Driver descriptor
+ */
+extern void piod_wait(struct _piod_desc* desc);
+
+#endif /* CONFIG_HAVE_XDMAC && CONFIG_HAVE_TC_DMA_MODE */
+
+#endif /* PIOD_H */
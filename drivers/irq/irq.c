@@ -32,6 +32,11 @@
  *----------------------------------------------------------------------------*/
 
 #include "chip.h"
+#include "compiler.h"
+#include "irqflags.h"
+#ifdef CONFIG_IRQ_STATS
+#include "cycles.h"
+#endif
 
 #if defined(CONFIG_HAVE_AIC2) || defined(CONFIG_HAVE_AIC5)
 #include "irq/aic.h"
@@ -42,6 +47,7 @@
 #endif
 
 #include <assert.h>
+#include <string.h>
 
 /*------------------------------------------------------------------------------
  *         Local types
@@ -53,6 +59,8 @@ struct handler_entry {
 	struct handler_entry* next;
 };
 
+typedef void (*irq_vector_t)(void);
+
 /*------------------------------------------------------------------------------
  *         Local variables
  *------------------------------------------------------------------------------*/
@@ -60,6 +68,11 @@ struct handler_entry {
 static struct handler_entry  handlers_pool[ID_PERIPH_COUNT * 2];
 static struct handler_entry* next_free_handler;
 static struct handler_entry* handlers[ID_PERIPH_COUNT];
+static volatile uint32_t nesting;
+
+#ifdef CONFIG_IRQ_STATS
+static struct _irq_stats stats[ID_PERIPH_COUNT];
+#endif
 
 /*------------------------------------------------------------------------------
  *         Local functions
@@ -99,10 +112,56 @@ static void _free_handler(struct handler_entry* entry)
 	next_free_handler = entry;
 }
 
+#ifdef CONFIG_IRQ_STATS
+static void _update_stats(uint32_t source, uint32_t cycles)
+{
+	struct _irq_stats* s = &stats[source];
+
+	s->count++;
+	s->cycles_total += cycles;
+	if (cycles > s->cycles_max)
+		s->cycles_max = cycles;
+	if (s->count == 1 || cycles < s->cycles_min)
+		s->cycles_min = cycles;
+}
+#endif
+
+/**
+ * \brief Call the handlers registered for a source. Interrupts stay
+ * enabled, so a source with a higher priority can preempt them.
+ */
+NOINLINE static void _irq_dispatch(uint32_t source)
+{
+	struct handler_entry *entry;
+#ifdef CONFIG_IRQ_STATS
+	uint32_t start = arch_cycles_read();
+#endif
+
+	entry = handlers[source];
+	if (!entry) {
+		// no handler for interrupt, block
+		while (1);
+	}
+
+	nesting++;
+	do {
+		entry->handler(source, entry->user_arg);
+		entry = entry->next;
+	} while (entry);
+	nesting--;
+
+#ifdef CONFIG_IRQ_STATS
+	_update_stats(source, arch_cycles_read() - start);
+#endif
+}
+
+/**
+ * \brief Vector used for sources without handler, it has to ask the
+ * interrupt controller which source is active.
+ */
 static void _default_irq_handler(void)
 {
 	uint32_t source;
-	struct handler_entry *entry;
 
 #if defined(CONFIG_HAVE_AIC2) || defined(CONFIG_HAVE_AIC5)
 	source = aic_get_current_interrupt_source();
@@ -112,17 +171,90 @@ static void _default_irq_handler(void)
 #error Unknown IRQ controller!
 #endif
 
-	entry = handlers[source];
-	if (!entry) {
-		// no handler for interrupt, block
-		while (1);
-	}
+	_irq_dispatch(source);
+}
 
-	while (entry) {
-		if (entry->handler)
-			entry->handler(source, entry->user_arg);
-		entry = entry->next;
-	}
+/*
+ * One vector per source, installed in the interrupt controller once the
+ * source has a handler: the source number is a constant, which saves reading
+ * it back from the AIC (a peripheral bus access) on every interrupt.
+ */
+
+#define _IRQ_VECTOR(t, u) \
+	static void _irq_vector_##t##u(void) { _irq_dispatch((t) * 10 + (u)); }
+
+#define _IRQ_VECTORS(t) \
+	_IRQ_VECTOR(t, 0) _IRQ_VECTOR(t, 1) _IRQ_VECTOR(t, 2) \
+	_IRQ_VECTOR(t, 3) _IRQ_VECTOR(t, 4) _IRQ_VECTOR(t, 5) \
+	_IRQ_VECTOR(t, 6) _IRQ_VECTOR(t, 7) _IRQ_VECTOR(t, 8) \
+	_IRQ_VECTOR(t, 9)
+
+#define _IRQ_VECTOR_ENTRIES(t) \
+	_irq_vector_##t##0, _irq_vector_##t##1, _irq_vector_##t##2, \
+	_irq_vector_##t##3, _irq_vector_##t##4, _irq_vector_##t##5, \
+	_irq_vector_##t##6, _irq_vector_##t##7, _irq_vector_##t##8, \
+	_irq_vector_##t##9,
+
+_IRQ_VECTORS(0)
+_IRQ_VECTORS(1)
+_IRQ_VECTORS(2)
+_IRQ_VECTORS(3)
+#if ID_PERIPH_COUNT > 40
+_IRQ_VECTORS(4)
+#endif
+#if ID_PERIPH_COUNT > 50
+_IRQ_VECTORS(5)
+#endif
+#if ID_PERIPH_COUNT > 60
+_IRQ_VECTORS(6)
+#endif
+#if ID_PERIPH_COUNT > 70
+_IRQ_VECTORS(7)
+#endif
+#if ID_PERIPH_COUNT > 80
+_IRQ_VECTORS(8)
+#endif
+#if ID_PERIPH_COUNT > 90
+_IRQ_VECTORS(9)
+#endif
+#if ID_PERIPH_COUNT > 100
+#error "Too many peripheral IDs for the IRQ vector table"
+#endif
+
+static const irq_vector_t _irq_vectors[] = {
+	_IRQ_VECTOR_ENTRIES(0)
+	_IRQ_VECTOR_ENTRIES(1)
+	_IRQ_VECTOR_ENTRIES(2)
+	_IRQ_VECTOR_ENTRIES(3)
+#if ID_PERIPH_COUNT > 40
+	_IRQ_VECTOR_ENTRIES(4)
+#endif
+#if ID_PERIPH_COUNT > 50
+	_IRQ_VECTOR_ENTRIES(5)
+#endif
+#if ID_PERIPH_COUNT > 60
+	_IRQ_VECTOR_ENTRIES(6)
+#endif
+#if ID_PERIPH_COUNT > 70
+	_IRQ_VECTOR_ENTRIES(7)
+#endif
+#if ID_PERIPH_COUNT > 80
+	_IRQ_VECTOR_ENTRIES(8)
+#endif
+#if ID_PERIPH_COUNT > 90
+	_IRQ_VECTOR_ENTRIES(9)
+#endif
+};
+
+static void _set_vector(uint32_t source, irq_vector_t vector)
+{
+#if defined(CONFIG_HAVE_AIC2) || defined(CONFIG_HAVE_AIC5)
+	aic_set_source_vector(source, vector);
+#elif defined(CONFIG_HAVE_NVIC)
+	nvic_set_source_vector(source, vector);
+#else
+#error Unknown IRQ controller!
+#endif
 }
 
 /*----------------------------------------------------------------------------
@@ -133,6 +265,10 @@ void irq_initialize(void)
 {
 	_initialize_handlers_pool();
 
+#ifdef CONFIG_IRQ_STATS
+	arch_cycles_init();
+#endif
+
 #if defined(CONFIG_HAVE_AIC2) || defined(CONFIG_HAVE_AIC5)
 	aic_initialize(_default_irq_handler);
 #elif defined(CONFIG_HAVE_NVIC)
@@ -155,10 +291,13 @@ void irq_configure_mode(uint32_t source, enum _irq_mode mode)
 
 void irq_configure_priority(uint32_t source, uint8_t priority)
 {
+	assert(priority <= IRQ_PRIORITY_MAX);
+
 #if defined(CONFIG_HAVE_AIC2) || defined(CONFIG_HAVE_AIC5)
 	aic_configure_priority(source, priority);
 #elif defined(CONFIG_HAVE_NVIC)
-	nvic_configure_priority(source, priority);
+	/* lower values have higher priority on the NVIC */
+	nvic_configure_priority(source, IRQ_PRIORITY_MAX - priority);
 #else
 #error Unknown IRQ controller!
 #endif
@@ -167,6 +306,9 @@ void irq_configure_priority(uint32_t source, uint8_t priority)
 void irq_add_handler(uint32_t source, irq_handler_t handler, void* user_arg)
 {
 	struct handler_entry* entry;
+	uint32_t flags;
+
+	assert(source < ID_PERIPH_COUNT);
 
 	/* check if handler is already registered */
 	entry = handlers[source];
@@ -178,18 +320,31 @@ void irq_add_handler(uint32_t source, irq_handler_t handler, void* user_arg)
 		entry = entry->next;
 	}
 
+	flags = arch_irq_save();
+
 	/* add handler to linked list */
 	entry = _alloc_handler();
 	entry->handler = handler;
 	entry->user_arg = user_arg;
 	entry->next = handlers[source];
 	handlers[source] = entry;
+
+	/* first handler: vector the source directly */
+	if (!entry->next)
+		_set_vector(source, _irq_vectors[source]);
+
+	arch_irq_restore(flags);
 }
 
 void irq_remove_handler(uint32_t source, irq_handler_t handler)
 {
 	struct handler_entry* prev;
 	struct handler_entry* cur;
+	uint32_t flags;
+
+	assert(source < ID_PERIPH_COUNT);
+
+	flags = arch_irq_save();
 
 	/* remove handler from linked list */
 	prev = NULL;
@@ -198,11 +353,20 @@ void irq_remove_handler(uint32_t source, irq_handler_t handler)
 		if (cur->handler == handler) {
 			if (prev)
 				prev->next = cur->next;
+			else
+				handlers[source] = cur->next;
 			_free_handler(cur);
-			return;
+			break;
 		}
+		prev = cur;
 		cur = cur->next;
 	}
+
+	/* last handler removed: back to the default vector */
+	if (!handlers[source])
+		_set_vector(source, _default_irq_handler);
+
+	arch_irq_restore(flags);
 }
 
 void irq_enable(uint32_t source)
@@ -226,3 +390,30 @@ void irq_disable(uint32_t source)
 #error Unknown IRQ controller!
 #endif
 }
+
+bool irq_is_in_handler(void)
+{
+	return nesting != 0;
+}
+
+#ifdef CONFIG_IRQ_STATS
+
+void irq_get_stats(uint32_t source, struct _irq_stats* s)
+{
+	uint32_t flags;
+
+	assert(source < ID_PERIPH_COUNT);
+
+	flags = arch_irq_save();
+	*s = stats[source];
+	arch_irq_restore(flags);
+}
+
+void irq_reset_stats(void)
+{
+	uint32_t flags = arch_irq_save();
+	memset(stats, 0, sizeof(stats));
+	arch_irq_restore(flags);
+}
+
+#endif /* CONFIG_IRQ_STATS */
@@ -34,10 +34,23 @@
  *         Headers
  *------------------------------------------------------------------------------*/
 
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef void (*irq_handler_t)(uint32_t source, void* user_arg);
 
+/** Lowest and highest priorities accepted by irq_configure_priority() */
+#define IRQ_PRIORITY_MIN 0
+#define IRQ_PRIORITY_MAX 7
+
+/** Per-source interrupt statistics (CONFIG_IRQ_STATS) */
+struct _irq_stats {
+	uint32_t count;        /**< number of interrupts handled */
+	uint32_t cycles_min;   /**< shortest handler run, in CPU cycles */
+	uint32_t cycles_max;   /**< longest handler run, in CPU cycles */
+	uint64_t cycles_total; /**< cumulated handler run time, in CPU cycles */
+};
+
 enum _irq_mode {
 	IRQ_MODE_HIGH_LEVEL,
 	IRQ_MODE_LOW_LEVEL,
@@ -74,8 +87,14 @@ extern void irq_configure_mode(uint32_t source, enum _irq_mode mode);
 /**
  * \brief Configure the interrupt priority for a given source.
  *
+ * Handlers run with interrupts enabled: a source with a higher priority
+ * preempts the handler of a lower priority one (nested interrupts). All
+ * sources have the same priority after reset, so nothing nests until
+ * priorities are configured.
+ *
  * \param source   Interrupt source to configure
- * \param priority Interrupt priority
+ * \param priority Interrupt priority, from IRQ_PRIORITY_MIN (lowest) to
+ *                 IRQ_PRIORITY_MAX (highest)
  */
 extern void irq_configure_priority(uint32_t source, uint8_t priority);
 
@@ -116,6 +135,36 @@ extern void irq_enable(uint32_t source);
  */
 extern void irq_disable(uint32_t source);
 
+/**
+ * \brief Tell if the caller runs from an interrupt handler.
+ *
+ * Handlers run with interrupts enabled but the interrupt controller only
+ * delivers interrupts of higher priority, so code waiting for an interrupt
+ * must not sleep when this returns true.
+ */
+extern bool irq_is_in_handler(void);
+
+#ifdef CONFIG_IRQ_STATS
+
+/**
+ * \brief Get the statistics of an interrupt source.
+ *
+ * Handler run times are measured with the CPU cycle counter (none on
+ * ARM926, only the count is available) and include the time spent in
+ * nested interrupts.
+ *
+ * \param source  Interrupt source
+ * \param stats   Structure to fill
+ */
+extern void irq_get_stats(uint32_t source, struct _irq_stats* stats);
+
+/**
+ * \brief Clear the statistics of all interrupt sources.
+ */
+extern void irq_reset_stats(void);
+
+#endif /* CONFIG_IRQ_STATS */
+
 #ifdef __cplusplus
 }
 #endif
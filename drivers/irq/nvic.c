@@ -42,6 +42,15 @@
 #include <stdint.h>
 #include <string.h>
 
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+/** Number of priority bits implemented by the NVIC */
+#ifndef NVIC_PRIO_BITS
+#define NVIC_PRIO_BITS 3
+#endif
+
 /*----------------------------------------------------------------------------
  *        Local variables
  *----------------------------------------------------------------------------*/
@@ -72,7 +81,10 @@ void nvic_set_source_vector(uint32_t source, nvic_handler_t handler)
 
 void nvic_configure_priority(uint32_t source, uint8_t priority)
 {
-	/* TODO */
+	volatile uint8_t* ipr = (volatile uint8_t*)NVIC->NVIC_IPR;
+
+	/* only the upper bits of each priority byte are implemented */
+	ipr[source] = (priority << (8 - NVIC_PRIO_BITS)) & 0xff;
 }
 
 void nvic_enable(uint32_t source)
@@ -77,7 +77,7 @@ extern void nvic_set_source_vector(uint32_t source, nvic_handler_t handler);
  * \brief Configure the interrupt priority for a given source.
  *
  * \param source   Interrupt source to configure
- * \param priority Interrupt priority
+ * \param priority Interrupt priority, 0 is the highest
  */
 extern void nvic_configure_priority(uint32_t source, uint8_t priority);
 
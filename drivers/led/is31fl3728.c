@@ -71,10 +71,13 @@ static int _is31fl3728_write_reg(struct _is31fl3728* is31fl3728, uint8_t iaddr,
 			.attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_TX | BUS_I2C_BUF_ATTR_STOP,
 		},
 	};
+	struct _bus_request req = {
+		.remote = is31fl3728->twi.addr,
+		.buf = buf,
+		.buffers = 1,
+	};
 
-	bus_start_transaction(act8865a->bus);
-	err = bus_transfer(is31fl3728->twi.bus, is31fl3728->twi.addr, buf, 1, NULL);
-	bus_stop_transaction(is31fl3728->twi.bus);
+	err = bus_execute(is31fl3728->twi.bus, &req);
 
 	return err;
 }
@@ -116,7 +119,7 @@ void is31fl3728_refresh(struct _is31fl3728 *is31fl3728)
 
 int is31fl3728_configure(struct _is31fl3728 *is31fl3728, uint8_t addr, uint8_t *fb)
 {
-	is31fl3728->addr = addr;
+	is31fl3728->twi.addr = addr;
 
 	is31fl3728->fb = fb;
 
@@ -27,16 +27,129 @@
  * ----------------------------------------------------------------------------
  */
 
+
 /** \file */
 
 /*----------------------------------------------------------------------------
  *        Headers
  *----------------------------------------------------------------------------*/
 
+#include "cycles.h"
+#include "irqflags.h"
+
 #include "mm/cache.h"
+#include "mm/dma_coherent.h"
 #include "mm/l1cache.h"
 #include "mm/l2cache.h"
 
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ *        Local variables
+ *----------------------------------------------------------------------------*/
+
+static struct _cache_thresholds _thresholds = {
+	.l1_clean = CACHE_L1_FULL_THRESHOLD,
+	.l2_clean = CACHE_L2_FULL_THRESHOLD,
+};
+
+static struct _cache_stats _stats;
+
+#ifdef ARCH_HAVE_CYCLES
+/** Scratch buffer used to time line-by-line operations */
+ALIGNED(L1_CACHE_BYTES)
+static uint8_t _calibration_buffer[CACHE_CALIBRATION_BYTES];
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Clean a region, picking for each cache level either a line-by-line
+ * operation or a clean of the whole cache depending on the region length.
+ */
+static void _cache_clean(uint32_t start, uint32_t end)
+{
+#ifdef CONFIG_HAVE_L1CACHE
+	uint32_t length = end - start;
+
+	if (!dcache_is_enabled())
+		return;
+
+	if (length >= _thresholds.l1_clean) {
+		dcache_clean();
+		_stats.l1_full_ops++;
+	} else {
+		dcache_clean_region(start, end);
+		_stats.l1_region_ops++;
+	}
+
+#ifdef CONFIG_HAVE_L2CACHE
+	if (!l2cache_is_enabled())
+		return;
+
+	if (length >= _thresholds.l2_clean) {
+		/* way operations include the final cache sync */
+		l2cache_clean();
+		_stats.l2_full_ops++;
+	} else {
+		l2cache_clean_region(start, end);
+		/* a single sync for the whole region */
+		l2cache_sync();
+		_stats.l2_region_ops++;
+	}
+	_stats.l2_syncs++;
+#endif /* CONFIG_HAVE_L2CACHE */
+#endif /* CONFIG_HAVE_L1CACHE */
+}
+
+/**
+ * \brief Invalidate a region line by line.
+ *
+ * There is no whole-cache alternative: invalidating the whole cache would
+ * require cleaning it first, which may write stale dirty lines over buffers
+ * being (or just) filled by DMA.
+ */
+static void _cache_invalidate(uint32_t start, uint32_t end)
+{
+#ifdef CONFIG_HAVE_L1CACHE
+	if (!dcache_is_enabled())
+		return;
+
+	dcache_invalidate_region(start, end);
+	_stats.l1_region_ops++;
+
+#ifdef CONFIG_HAVE_L2CACHE
+	if (!l2cache_is_enabled())
+		return;
+
+	l2cache_invalidate_region(start, end);
+	/* a single sync for the whole region */
+	l2cache_sync();
+	_stats.l2_region_ops++;
+	_stats.l2_syncs++;
+#endif /* CONFIG_HAVE_L2CACHE */
+#endif /* CONFIG_HAVE_L1CACHE */
+}
+
+#ifdef ARCH_HAVE_CYCLES
+/**
+ * \brief Compute the region length above which the whole cache operation is
+ * faster, given the cost of both operations on the calibration buffer.
+ */
+static uint32_t _crossover(uint32_t full_cycles, uint32_t region_cycles)
+{
+	uint64_t length;
+
+	if (region_cycles == 0)
+		return UINT32_MAX;
+
+	length = (uint64_t)full_cycles * CACHE_CALIBRATION_BYTES / region_cycles;
+	return length > UINT32_MAX ? UINT32_MAX : (uint32_t)length;
+}
+#endif
+
 /*----------------------------------------------------------------------------
  *        Functions
  *----------------------------------------------------------------------------*/
@@ -46,15 +159,13 @@ void cache_invalidate_region(void *start, uint32_t length)
 	uint32_t start_addr = (uint32_t)start;
 	uint32_t end_addr = start_addr + length;
 
-#ifdef CONFIG_HAVE_L1CACHE
-	if (dcache_is_enabled()) {
-		dcache_invalidate_region(start_addr, end_addr);
-#ifdef CONFIG_HAVE_L2CACHE
-		if (l2cache_is_enabled())
-			l2cache_invalidate_region(start_addr, end_addr);
-#endif /* CONFIG_HAVE_L2CACHE */
+	/* coherent memory is not cached, no maintenance needed */
+	if (dma_is_coherent(start, length)) {
+		_stats.coherent_skips++;
+		return;
 	}
-#endif /* CONFIG_HAVE_L1CACHE */
+
+	_cache_invalidate(start_addr, end_addr);
 }
 
 void cache_clean_region(const void *start, uint32_t length)
@@ -62,13 +173,74 @@ void cache_clean_region(const void *start, uint32_t length)
 	uint32_t start_addr = (uint32_t)start;
 	uint32_t end_addr = start_addr + length;
 
-#ifdef CONFIG_HAVE_L1CACHE
-	if (dcache_is_enabled()) {
-		dcache_clean_region(start_addr, end_addr);
+	/* coherent memory is not cached, no maintenance needed */
+	if (dma_is_coherent(start, length)) {
+		_stats.coherent_skips++;
+		return;
+	}
+
+	_cache_clean(start_addr, end_addr);
+}
+
+void cache_calibrate(void)
+{
+#if defined(ARCH_HAVE_CYCLES) && defined(CONFIG_HAVE_L1CACHE)
+	uint32_t start = (uint32_t)_calibration_buffer;
+	uint32_t end = start + sizeof(_calibration_buffer);
+	uint32_t flags, t0, region, full;
+
+	if (!dcache_is_enabled())
+		return;
+
+	flags = arch_irq_save();
+	arch_cycles_init();
+
+	/* L1: line-by-line on dirty lines against the whole cache */
+	memset(_calibration_buffer, 0, sizeof(_calibration_buffer));
+	t0 = arch_cycles_read();
+	dcache_clean_region(start, end);
+	region = arch_cycles_read() - t0;
+	t0 = arch_cycles_read();
+	dcache_clean();
+	full = arch_cycles_read() - t0;
+	_thresholds.l1_clean = _crossover(full, region);
+
 #ifdef CONFIG_HAVE_L2CACHE
-		if (l2cache_is_enabled())
-			l2cache_clean_region(start_addr, end_addr);
-#endif /* CONFIG_HAVE_L2CACHE */
+	if (l2cache_is_enabled()) {
+		/* L2: push the buffer out of L1 so that it lands dirty in L2 */
+		memset(_calibration_buffer, 0, sizeof(_calibration_buffer));
+		dcache_clean_region(start, end);
+		t0 = arch_cycles_read();
+		l2cache_clean_region(start, end);
+		l2cache_sync();
+		region = arch_cycles_read() - t0;
+		t0 = arch_cycles_read();
+		l2cache_clean();
+		full = arch_cycles_read() - t0;
+		_thresholds.l2_clean = _crossover(full, region);
 	}
-#endif /* CONFIG_HAVE_L1CACHE */
+#endif /* CONFIG_HAVE_L2CACHE */
+
+	arch_irq_restore(flags);
+#endif
+}
+
+void cache_get_thresholds(struct _cache_thresholds* thresholds)
+{
+	*thresholds = _thresholds;
+}
+
+void cache_set_thresholds(const struct _cache_thresholds* thresholds)
+{
+	_thresholds = *thresholds;
+}
+
+void cache_get_stats(struct _cache_stats* stats)
+{
+	*stats = _stats;
+}
+
+void cache_reset_stats(void)
+{
+	memset(&_stats, 0, sizeof(_stats));
 }
@@ -44,6 +44,12 @@
  * address on a cache line.  Since these sections will contain only cache
  * aligned variables, we can be certain that flushing/invalidating any variable
  * in these regions will not flush/invalidate more than expected.
+ *
+ * Region cleaning switches, for each cache level, from line-by-line
+ * operations to a clean of the whole cache when the region is larger than a
+ * threshold.  Default thresholds are the cache sizes; cache_calibrate()
+ * replaces them by the measured crossover points on cores with a cycle
+ * counter.  Invalidation is always performed line by line.
  */
 
 #ifndef CACHE_H_
@@ -56,6 +62,7 @@
 #include "chip.h"
 #include "compiler.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /*----------------------------------------------------------------------------
@@ -98,11 +105,46 @@
 	SECTION(".region_ddr_cache_aligned")
 #endif
 
+/** Default region length above which the whole L1 cache is cleaned */
+#ifndef CACHE_L1_FULL_THRESHOLD
+#define CACHE_L1_FULL_THRESHOLD (L1_CACHE_BYTES * L1_CACHE_SETS * L1_CACHE_WAYS)
+#endif
+
+/** Default region length above which the whole L2 cache is cleaned */
+#ifndef CACHE_L2_FULL_THRESHOLD
+#define CACHE_L2_FULL_THRESHOLD (128 * 1024)
+#endif
+
+/** Size of the buffer used by cache_calibrate() */
+#ifndef CACHE_CALIBRATION_BYTES
+#define CACHE_CALIBRATION_BYTES (1024)
+#endif
+
 /**
  * Is x is aligned on a cache line?
  */
 #define IS_CACHE_ALIGNED(x) ((((uint32_t)(x)) & (L1_CACHE_BYTES - 1)) == 0)
 
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+/** Region lengths (in bytes) from which the whole cache is cleaned */
+struct _cache_thresholds {
+	uint32_t l1_clean;
+	uint32_t l2_clean;
+};
+
+/** Number of region maintenance requests served by each strategy */
+struct _cache_stats {
+	uint32_t l1_region_ops;  /**< line-by-line L1 operations */
+	uint32_t l1_full_ops;    /**< whole L1 cache operations */
+	uint32_t l2_region_ops;  /**< line-by-line L2 operations */
+	uint32_t l2_full_ops;    /**< whole L2 cache (all ways) operations */
+	uint32_t l2_syncs;       /**< L2 cache syncs */
+	uint32_t coherent_skips; /**< requests on coherent memory, skipped */
+};
+
 /*----------------------------------------------------------------------------
  *        Exported functions
  *----------------------------------------------------------------------------*/
@@ -110,6 +152,8 @@
 /**
  *  \brief Invalidate cache lines corresponding to a memory region
  *
+ *  Lines are always invalidated one by one, no other line is cleaned.
+ *
  *  \param start Beginning of the memory region
  *  \param length Length of the memory region
  */
@@ -118,9 +162,41 @@ extern void cache_invalidate_region(void *start, uint32_t length);
 /**
  *  \brief Clean cache lines corresponding to a memory region
  *
+ *  Above the clean threshold the whole cache is cleaned instead.
+ *
  *  \param start Beginning of the memory region
  *  \param length Length of the memory region
  */
 extern void cache_clean_region(const void *start, uint32_t length);
 
+/**
+ *  \brief Measure the cost of line-by-line and whole cache operations and
+ *  set the thresholds to the crossover points
+ *
+ *  Must be called after enabling the caches, and again once the L2 cache is
+ *  enabled (L2 thresholds are only updated if the L2 cache is enabled).
+ *  Does nothing on cores without cycle counter.
+ */
+extern void cache_calibrate(void);
+
+/**
+ *  \brief Get the current strategy thresholds
+ */
+extern void cache_get_thresholds(struct _cache_thresholds* thresholds);
+
+/**
+ *  \brief Override the strategy thresholds
+ */
+extern void cache_set_thresholds(const struct _cache_thresholds* thresholds);
+
+/**
+ *  \brief Get the strategy counters
+ */
+extern void cache_get_stats(struct _cache_stats* stats);
+
+/**
+ *  \brief Reset the strategy counters
+ */
+extern void cache_reset_stats(void);
+
 #endif /* #ifndef CACHE_H_ */
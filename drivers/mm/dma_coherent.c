@@ -0,0 +1,194 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include "chip.h"
+#include "compiler.h"
+#include "irqflags.h"
+
+#include "mm/cache.h"
+#include "mm/dma_coherent.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+/** Number of cache lines in the pool */
+#define POOL_LINES (DMA_COHERENT_POOL_SIZE / L1_CACHE_BYTES)
+
+/** Number of words in the allocation bitmap */
+#define POOL_BITMAP_WORDS ((POOL_LINES + 31) / 32)
+
+/** Bounds of the NOT_CACHED data, pool included */
+#if defined(__ICCARM__)
+#pragma section=".region_nocache"
+#define NOCACHE_START ((uint32_t)__section_begin(".region_nocache"))
+#define NOCACHE_END   ((uint32_t)__section_end(".region_nocache"))
+#elif defined(__GNUC__)
+/* weak: 0 if the linker script has no non-cached section */
+extern uint8_t _snocache[] WEAK;
+extern uint8_t _enocache[] WEAK;
+#define NOCACHE_START ((uint32_t)_snocache)
+#define NOCACHE_END   ((uint32_t)_enocache)
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Local variables
+ *----------------------------------------------------------------------------*/
+
+#if DMA_COHERENT_POOL_SIZE > 0
+ALIGNED(L1_CACHE_BYTES) NOT_CACHED
+static uint8_t _pool[DMA_COHERENT_POOL_SIZE];
+
+/** One bit per cache line of the pool, set when the line is allocated */
+static uint32_t _pool_bitmap[POOL_BITMAP_WORDS];
+#else
+static uint8_t* const _pool = NULL;
+static uint32_t _pool_bitmap[1];
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static inline bool _line_is_used(uint32_t line)
+{
+	return (_pool_bitmap[line / 32] & (1u << (line % 32))) != 0;
+}
+
+static void _mark_lines(uint32_t first, uint32_t count, bool used)
+{
+	uint32_t line;
+
+	for (line = first; line < first + count; line++) {
+		if (used)
+			_pool_bitmap[line / 32] |= 1u << (line % 32);
+		else
+			_pool_bitmap[line / 32] &= ~(1u << (line % 32));
+	}
+}
+
+static inline uint32_t _size_to_lines(uint32_t size)
+{
+	return (size + L1_CACHE_BYTES - 1) / L1_CACHE_BYTES;
+}
+
+static bool _is_in_range(uint32_t addr, uint32_t length,
+		uint32_t start, uint32_t end)
+{
+	return start < end && addr >= start && length <= end - start &&
+	       addr - start <= end - start - length;
+}
+
+static bool _is_in_pool(const void* start, uint32_t length)
+{
+	uint32_t pool = (uint32_t)_pool;
+
+	return pool && _is_in_range((uint32_t)start, length, pool,
+				    pool + DMA_COHERENT_POOL_SIZE);
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+void* dma_alloc_coherent(uint32_t size)
+{
+	uint32_t count = _size_to_lines(size);
+	uint32_t line, run = 0;
+	void* buffer = NULL;
+	uint32_t flags;
+
+	if (count == 0 || count > POOL_LINES)
+		return NULL;
+
+	flags = arch_irq_save();
+
+	/* first fit */
+	for (line = 0; line < POOL_LINES; line++) {
+		if (_line_is_used(line)) {
+			run = 0;
+			continue;
+		}
+		if (++run == count) {
+			line = line + 1 - count;
+			_mark_lines(line, count, true);
+			buffer = &_pool[line * L1_CACHE_BYTES];
+			break;
+		}
+	}
+
+	arch_irq_restore(flags);
+
+	return buffer;
+}
+
+void dma_free_coherent(void* buffer, uint32_t size)
+{
+	uint32_t offset;
+	uint32_t flags;
+
+	if (!buffer)
+		return;
+
+	assert(_is_in_pool(buffer, size));
+	assert(IS_CACHE_ALIGNED(buffer));
+
+	offset = (uint8_t*)buffer - _pool;
+
+	flags = arch_irq_save();
+	_mark_lines(offset / L1_CACHE_BYTES, _size_to_lines(size), false);
+	arch_irq_restore(flags);
+}
+
+bool dma_is_coherent(const void* start, uint32_t length)
+{
+	return _is_in_pool(start, length) ||
+	       _is_in_range((uint32_t)start, length, NOCACHE_START,
+			    NOCACHE_END);
+}
+
+uint32_t dma_coherent_get_free(void)
+{
+	uint32_t line, free = 0;
+
+	for (line = 0; line < POOL_LINES; line++)
+		if (!_line_is_used(line))
+			free += L1_CACHE_BYTES;
+
+	return free;
+}
@@ -0,0 +1,109 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Interface for the DMA-coherent memory pool.
+ *
+ * The pool is a statically reserved buffer placed in the not-cached section
+ * (see NOT_CACHED in mm/cache.h), which the board MMU/MPU setup maps as
+ * non-cacheable memory.  It is intended for DMA descriptors and small DMA
+ * buffers shared between the CPU and peripherals: since CPU accesses never
+ * hit the data caches, no cache maintenance is needed for such buffers and
+ * cache_clean_region()/cache_invalidate_region() return immediately when
+ * called on them.
+ *
+ * Defining DMA_COHERENT_POOL_SIZE to 0 removes the pool, for programs whose
+ * linker script has no not-cached section (i.e. SAM-BA applets).
+ *
+ * Allocations are rounded up to a multiple of L1_CACHE_BYTES and are aligned
+ * on a cache line.
+ */
+
+#ifndef DMA_COHERENT_H_
+#define DMA_COHERENT_H_
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Size of the coherent pool in bytes (multiple of L1_CACHE_BYTES) */
+#ifndef DMA_COHERENT_POOL_SIZE
+#ifdef CONFIG_ARCH_ARMV7M
+/* non-cached SRAM is only 4KB and is shared with other NOT_CACHED data */
+#define DMA_COHERENT_POOL_SIZE (1024)
+#else
+#define DMA_COHERENT_POOL_SIZE (64 * 1024)
+#endif
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Allocate a buffer from the coherent pool
+ *
+ * \param size Size of the buffer in bytes
+ * \return a cache-line aligned buffer, or NULL if the pool is exhausted
+ */
+extern void* dma_alloc_coherent(uint32_t size);
+
+/**
+ * \brief Return a buffer to the coherent pool
+ *
+ * \param buffer Buffer returned by dma_alloc_coherent()
+ * \param size Size given to dma_alloc_coherent() when allocating the buffer
+ */
+extern void dma_free_coherent(void* buffer, uint32_t size);
+
+/**
+ * \brief Check if a memory region lies in the coherent pool or in other
+ * NOT_CACHED data
+ *
+ * \param start Beginning of the memory region
+ * \param length Length of the memory region
+ * \return true if the whole region is in non-cacheable coherent memory
+ */
+extern bool dma_is_coherent(const void* start, uint32_t length);
+
+/**
+ * \brief Get the number of free bytes in the coherent pool
+ */
+extern uint32_t dma_coherent_get_free(void);
+
+#endif /* DMA_COHERENT_H_ */
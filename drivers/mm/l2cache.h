@@ -78,6 +78,15 @@ extern void l2cache_invalidate(void);
  */
 extern void l2cache_clean_invalidate(void);
 
+/**
+ * \brief Wait for completion of pending L2 cache operations and drain the
+ * L2 write buffers.
+ *
+ * Region operations do not synchronize by themselves so that callers can
+ * issue a single sync after several of them.
+ */
+extern void l2cache_sync(void);
+
 /**
  * \brief Invalidate the L2 cache within the specified region
  * \param start virtual start address of region
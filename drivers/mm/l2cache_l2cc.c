@@ -346,6 +346,12 @@ void l2cache_clean_invalidate(void)
 	}
 }
 
+void l2cache_sync(void)
+{
+	if (l2cache_is_enabled())
+		l2cc_cache_sync();
+}
+
 void l2cache_invalidate_region(uint32_t start, uint32_t end)
 {
 	assert(start < end);
@@ -0,0 +1,108 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Declarative memory map description.
+ *
+ * Each target describes its address space as an array of struct _mem_region,
+ * from which mmu_build_tlb() generates the MMU translation table and
+ * mpu_build_config() the MPU configuration.  When regions overlap, the last
+ * one in the array wins (for the MPU, the region with the highest number).
+ *
+ * Entries are declared with MEM_MMU_REGION() or MEM_MPU_REGION() so that
+ * regions the hardware cannot map are rejected by the compiler.  The table is
+ * also kept in the program image so that scripts/memmap.py can dump and check
+ * it (overlaps, attributes, section placement) from the ELF file on the host.
+ */
+
+#ifndef MEMMAP_H_
+#define MEMMAP_H_
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/* Memory types */
+#define MEM_STRONGLY_ORDERED (0) /**< all accesses in order, not buffered */
+#define MEM_DEVICE           (1) /**< peripheral registers, writes buffered */
+#define MEM_NORMAL_NC        (2) /**< normal memory, not cached */
+#define MEM_NORMAL_WT        (3) /**< cached, write-through */
+#define MEM_NORMAL_WB        (4) /**< cached, write-back, read-allocate */
+#define MEM_NORMAL_WB_WA     (5) /**< cached, write-back, read/write-allocate */
+#define MEM_TYPE_MASK        (0x7)
+
+/* Region flags */
+#define MEM_READ_ONLY        (1 << 4) /**< no write access (ignored on ARMv5) */
+#define MEM_EXEC_NEVER       (1 << 5) /**< no instruction fetch (ignored on ARMv5) */
+#define MEM_SHAREABLE        (1 << 6) /**< shareable normal memory */
+
+/** Evaluates to 0, fails to build if the condition is false */
+#define MEM_BUILD_CHECK(cond) (0 * sizeof(char[(cond) ? 1 : -1]))
+
+/** Can the region be mapped by MMU sections? */
+#define MEM_MMU_REGION_IS_VALID(start, size) \
+	((size) != 0 && ((start) & 0xfffff) == 0 && ((size) & 0xfffff) == 0)
+
+/** Can the region be mapped by a single MPU region? */
+#define MEM_MPU_REGION_IS_VALID(start, size) \
+	((size) >= 32 && ((size) & ((size) - 1)) == 0 && ((start) & ((size) - 1)) == 0)
+
+/**
+ * Memory map entries, checked at build time: MMU regions must be multiples
+ * of 1MB, MPU regions powers of 2 aligned on their size.
+ */
+#define MEM_MMU_REGION(name, start, size, attrs) \
+	{ (name), (start) + MEM_BUILD_CHECK(MEM_MMU_REGION_IS_VALID(start, size)), \
+	  (size), (attrs) }
+
+#define MEM_MPU_REGION(name, start, size, attrs) \
+	{ (name), (start) + MEM_BUILD_CHECK(MEM_MPU_REGION_IS_VALID(start, size)), \
+	  (size), (attrs) }
+
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+/** Memory map entry */
+struct _mem_region {
+	const char* name; /**< region name, for scripts/memmap.py */
+	uint32_t start;   /**< start address */
+	uint32_t size;    /**< size in bytes */
+	uint32_t attrs;   /**< memory type and MEM_* flags */
+};
+
+#endif /* MEMMAP_H_ */
@@ -37,11 +37,29 @@
  *----------------------------------------------------------------------------*/
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "mm/memmap.h"
 
 /*----------------------------------------------------------------------------
  *        Exported functions
  *----------------------------------------------------------------------------*/
 
+/**
+ * \brief Fill a translation table from a memory map
+ *
+ * Regions are identity-mapped with 1MB sections; aligned 16MB blocks with
+ * identical attributes use supersections when supported (ARMv7-A).  Region
+ * start and size must be multiples of 1MB.  Addresses not covered by any
+ * region generate translation faults.
+ *
+ * \param tlb Translation table (4096 entries, aligned on 16KB)
+ * \param regions Memory map
+ * \param count Number of entries in the memory map
+ */
+extern void mmu_build_tlb(uint32_t* tlb, const struct _mem_region* regions,
+                          uint32_t count);
+
 /**
  * \brief Configure the MMU
  */
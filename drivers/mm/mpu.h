@@ -37,11 +37,32 @@
  *----------------------------------------------------------------------------*/
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "mm/memmap.h"
 
 /*----------------------------------------------------------------------------
  *        Exported functions
  *----------------------------------------------------------------------------*/
 
+/**
+ * \brief Build an MPU configuration (as expected by mpu_configure) from a
+ * memory map
+ *
+ * Region N of the memory map is programmed in MPU region N.  Region sizes
+ * must be powers of two, at least 32 bytes, and start addresses must be
+ * aligned on the region size.
+ *
+ * \param regions Memory map
+ * \param count Number of entries in the memory map
+ * \param config Output buffer
+ * \param size Number of words in the output buffer (at least 2 * count + 2)
+ * \return 0 on success, -EINVAL if a region cannot be mapped or if the
+ * memory map or the buffer is too large.
+ */
+extern int mpu_build_config(const struct _mem_region* regions, uint32_t count,
+                            uint32_t* config, uint32_t size);
+
 /**
  * \brief Configure the MPU
  */
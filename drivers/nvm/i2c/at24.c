@@ -121,17 +121,14 @@ static int _at24_compute_address_field(const struct _at24* at24, uint8_t *addr_b
 
 static int _at24_twi_read(const struct _at24* at24, uint8_t addr_offset, struct _buffer *buf)
 {
-	int err;
-
-	/* start a TWI bus transaction */
-	bus_start_transaction(at24->bus);
-
-	/* start the TWI bus transfer */
-	err = bus_transfer(at24->bus, at24->addr + addr_offset, buf, 2, NULL);
-
-	bus_stop_transaction(at24->bus);
+	struct _bus_request req = {
+		.remote = at24->addr + addr_offset,
+		.buf = buf,
+		.buffers = 2,
+	};
 
-	return err;
+	/* queue the TWI bus transfer and wait for its completion */
+	return bus_execute(at24->bus, &req);
 }
 
 //------------------------------------------------------------------------------
@@ -213,12 +210,15 @@ int at24_write(const struct _at24* at24, uint32_t offset, const uint8_t* data, u
 			.attr = BUS_BUF_ATTR_TX | BUS_I2C_BUF_ATTR_STOP,
 		},
 	};
+	struct _bus_request req = {
+		.buf = buf,
+		.buffers = 2,
+	};
 	uint8_t chunk_size;
 	int err = 0;
 
-	/* start a TWI bus transaction */
-	bus_start_transaction(at24->bus);
-
+	/* each page is a separate request so that other devices can use the
+	 * bus during the write cycles */
 	while (length) {
 		/* compute chunk size (aligned to write page size) */
 		chunk_size = min_u32(length, page_size - (offset % page_size));
@@ -228,8 +228,9 @@ int at24_write(const struct _at24* at24, uint32_t offset, const uint8_t* data, u
 		buf[1].data = (uint8_t*)data;
 		buf[1].size = chunk_size;
 
-		/* start the TWI bus transfer */
-		err = bus_transfer(at24->bus, at24->addr + addr_offset, buf, 2, NULL);
+		/* queue the TWI bus transfer */
+		req.remote = at24->addr + addr_offset;
+		err = bus_execute(at24->bus, &req);
 		if (err < 0)
 			break;
 
@@ -242,9 +243,6 @@ int at24_write(const struct _at24* at24, uint32_t offset, const uint8_t* data, u
 		msleep(10);
 	};
 
-	/* stop transaction */
-	bus_stop_transaction(at24->bus);
-
 	return err;
 }
 
@@ -177,7 +177,7 @@ static uint8_t ecc_read_page_with_pmecc(const struct _nand_flash *nand,
  * \return 0 if successful; otherwise returns an error code.
  */
 static uint8_t ecc_write_page_with_swecc(const struct _nand_flash *nand,
-		uint16_t block, uint16_t page, void *data, void *spare)
+		uint16_t block, uint16_t page, const void *data, void *spare)
 {
 	uint8_t error;
 	uint8_t hamming[NAND_MAX_SPARE_ECC_BYTES];
@@ -221,7 +221,7 @@ static uint8_t ecc_write_page_with_swecc(const struct _nand_flash *nand,
  * \return 0 if successful; otherwise returns an error code.
  */
 static uint8_t ecc_write_page_with_pmecc(const struct _nand_flash *nand,
-		uint16_t block, uint16_t page, void *data)
+		uint16_t block, uint16_t page, const void *data)
 {
 	uint8_t error;
 
@@ -286,7 +286,7 @@ uint8_t nand_ecc_read_page(const struct _nand_flash *nand,
  * \return 0 if successful; otherwise returns an error code.
  */
 uint8_t nand_ecc_write_page(const struct _nand_flash *nand,
-	uint16_t block, uint16_t page, void *data, void *spare)
+	uint16_t block, uint16_t page, const void *data, void *spare)
 {
 	NAND_TRACE("nand_ecc_write_page(B#%d:P#%d)\r\n", block, page);
 	assert(data || spare);
@@ -68,6 +68,6 @@ extern uint8_t nand_ecc_read_page(const struct _nand_flash *nand,
 
 extern uint8_t nand_ecc_write_page(const struct _nand_flash *nand,
 		uint16_t block, uint16_t page,
-		void *data, void *spare);
+		const void *data, void *spare);
 
 #endif /* NAND_FLASH_ECC_H */
@@ -296,7 +296,7 @@ static void _data_array_in(const struct _nand_flash *nand, bool nfc_sram,
  * \param offset   Offset in bytes
  */
 static void _data_array_out(const struct _nand_flash *nand, bool nfc_sram,
-		uint8_t *buffer, uint32_t size, uint32_t offset)
+		const uint8_t *buffer, uint32_t size, uint32_t offset)
 {
 	uint32_t address = nand->data_addr;
 	uint32_t i;
@@ -314,7 +314,7 @@ static void _data_array_out(const struct _nand_flash *nand, bool nfc_sram,
 
 		/* Check the data bus width of the NandFlash */
 		if (bus_width == 16 && !nfc_sram) {
-			uint16_t *buff16 = (uint16_t*)buffer;
+			const uint16_t *buff16 = (const uint16_t*)buffer;
 			volatile uint16_t *data16 = (volatile uint16_t*)address;
 			size = (size + 1) >> 1;
 			for (i = size; i != 0; i--) {
@@ -322,7 +322,7 @@ static void _data_array_out(const struct _nand_flash *nand, bool nfc_sram,
 				buff16++;
 			}
 		} else {
-			uint8_t *buff8 = buffer;
+			const uint8_t *buff8 = buffer;
 			volatile uint8_t *data8 = (volatile uint8_t*)address;
 			for (i = size; i != 0; i--) {
 				*data8 = *buff8;
@@ -565,7 +565,7 @@ static uint8_t _read_page_with_pmecc(const struct _nand_flash *nand,
  * \return 0 if the write operation is successful; otherwise returns 1.
 */
 static uint8_t _write_page(const struct _nand_flash *nand,
-	uint16_t block, uint16_t page, uint8_t *data, uint8_t *spare)
+	uint16_t block, uint16_t page, const uint8_t *data, const uint8_t *spare)
 {
 	uint8_t error = 0;
 	uint32_t data_size = nand_model_get_page_data_size(&nand->model);
@@ -642,7 +642,7 @@ static uint8_t _write_page(const struct _nand_flash *nand,
  * \return 0 if the write operation is successful; otherwise returns 1.
 */
 static uint8_t _write_page_with_pmecc(const struct _nand_flash *nand,
-	uint16_t block, uint16_t page, uint8_t *data)
+	uint16_t block, uint16_t page, const uint8_t *data)
 {
 	uint8_t error = 0;
 	uint32_t data_size = nand_model_get_page_data_size(&nand->model);
@@ -677,7 +677,7 @@ static uint8_t _write_page_with_pmecc(const struct _nand_flash *nand,
 
 #ifdef CONFIG_HAVE_NFC
 	if (nand_is_nfc_sram_enabled()) {
-		_data_array_out(nand, true, (uint8_t*)data, data_size, 0);
+		_data_array_out(nand, true, data, data_size, 0);
 
 		_send_cle_ale(nand, CLE_WRITE_EN | ALE_COL_EN | ALE_ROW_EN | CLE_DATA_EN,
 		              NAND_CMD_WRITE_1, 0, 0, row_address);
@@ -689,7 +689,7 @@ static uint8_t _write_page_with_pmecc(const struct _nand_flash *nand,
 		_send_cle_ale(nand, CLE_WRITE_EN | ALE_COL_EN | ALE_ROW_EN,
 		              NAND_CMD_WRITE_1, 0, 0, row_address);
 
-		_data_array_out(nand, false, (uint8_t *)data, data_size, 0);
+		_data_array_out(nand, false, data, data_size, 0);
 	}
 
 	_send_cle_ale(nand, CLE_WRITE_EN | ALE_COL_EN,
@@ -866,7 +866,7 @@ uint8_t nand_raw_read_page(const struct _nand_flash *nand,
  * NAND_ERROR_BADBLOCK.
  */
 uint8_t nand_raw_write_page(const struct _nand_flash *nand,
-		uint16_t block, uint16_t page, void *data, void *spare)
+		uint16_t block, uint16_t page, const void *data, const void *spare)
 {
 	NAND_TRACE("nand_raw_write_page(B#%d:P#%d)\r\n", block, page);
 
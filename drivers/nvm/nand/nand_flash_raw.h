@@ -82,7 +82,7 @@ extern uint8_t nand_raw_read_page(const struct _nand_flash *nand,
 
 extern uint8_t nand_raw_write_page(const struct _nand_flash *nand,
 		uint16_t block, uint16_t page,
-		void *data, void *spare);
+		const void *data, const void *spare);
 
 extern uint8_t nand_raw_copy_page(const struct _nand_flash *nand,
 		uint16_t source_block, uint16_t source_page,
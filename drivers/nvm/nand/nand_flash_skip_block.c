@@ -213,7 +213,7 @@ uint8_t nand_skipblock_read_block(const struct _nand_flash *nand,
  */
 
 uint8_t nand_skipblock_write_page(const struct _nand_flash *nand,
-	uint16_t block, uint16_t page, void *data, void *spare)
+	uint16_t block, uint16_t page, const void *data, void *spare)
 {
 	/* Check that the block is LIVE */
 	if (nand_skipblock_check_block(nand, block) != GOODBLOCK) {
@@ -235,7 +235,7 @@ uint8_t nand_skipblock_write_page(const struct _nand_flash *nand,
 */
 
 uint8_t nand_skipblock_write_block(const struct _nand_flash *nand,
-	uint16_t block, void *data)
+	uint16_t block, const void *data)
 {
 	uint32_t num_pages_per_block, page_size;
 	uint16_t i;
@@ -257,7 +257,7 @@ uint8_t nand_skipblock_write_block(const struct _nand_flash *nand,
 			trace_error("nand_skipblock_write_block: Cannot write page %d of block %d.\r\n", i, block);
 			return NAND_ERROR_CANNOTWRITE;
 		}
-		data = (void*)((uint8_t*)data + page_size);
+		data = (const uint8_t*)data + page_size;
 	}
 
 	return 0;
@@ -99,9 +99,9 @@ uint8_t nand_skipblock_read_block(const struct _nand_flash *nand,
 
 extern uint8_t nand_skipblock_write_page(const struct _nand_flash *nand,
 		uint16_t block, uint16_t page,
-		void *data, void *spare);
+		const void *data, void *spare);
 
 uint8_t nand_skipblock_write_block(const struct _nand_flash *nand,
-		uint16_t block, void *data);
+		uint16_t block, const void *data);
 
 #endif /* NAND_FLASH_SKIP_BLOCK_H */
@@ -36,6 +36,7 @@
 #include "callback.h"
 #include "peripherals/bus.h"
 #include "errno.h"
+#include "irqflags.h"
 #ifdef CONFIG_HAVE_BUS_SPI
 #include "spi/spid.h"
 #endif
@@ -75,6 +76,28 @@ struct _bus_desc {
 		mutex_t lock;
 		mutex_t transaction;
 	} mutex;
+
+	struct {
+		struct _bus_request* head[BUS_PRIORITY_COUNT];
+		struct _bus_request* tail[BUS_PRIORITY_COUNT];
+		struct _bus_request* volatile active;
+
+		/** the queue holds the bus transaction */
+		bool owner;
+		/** sequence number of the last transfer started */
+		uint8_t seq;
+		/** a timed out transfer still runs on the interface */
+		volatile bool stalled;
+		volatile bool scheduling;
+		volatile bool reschedule;
+
+		uint32_t depth;
+		uint32_t max_depth;
+		uint32_t requests;
+		uint32_t errors;
+		uint64_t latency;
+		uint32_t max_latency;
+	} queue;
 };
 
 /*----------------------------------------------------------------------------
@@ -265,6 +288,274 @@ static int _bus_set_transfer_mode(uint8_t bus_id, enum _bus_transfer_mode mode)
 	return 0;
 }
 
+static int _bus_start_transfer(uint8_t bus_id, uint16_t remote, struct _buffer* buf, uint16_t buffers, struct _callback* cb)
+{
+	switch (_bus[bus_id].type) {
+#ifdef CONFIG_HAVE_SPI_BUS
+	case BUS_TYPE_SPI:
+		_bus[bus_id].iface.spid.chip_select = (uint8_t)remote;
+
+		return spid_transfer(&_bus[bus_id].iface.spid, buf, buffers, cb);
+#endif
+#ifdef CONFIG_HAVE_I2C_BUS
+	case BUS_TYPE_I2C:
+		_bus[bus_id].iface.twid.slave_addr = (uint8_t)remote;
+
+		return twid_transfer(&_bus[bus_id].iface.twid, buf, buffers, cb);
+#endif
+	default:
+		return -EINVAL;
+	}
+}
+
+static bool _bus_iface_is_busy(uint8_t bus_id)
+{
+	switch (_bus[bus_id].type) {
+#ifdef CONFIG_HAVE_SPI_BUS
+	case BUS_TYPE_SPI:
+		return spid_is_busy(&_bus[bus_id].iface.spid);
+#endif
+#ifdef CONFIG_HAVE_I2C_BUS
+	case BUS_TYPE_I2C:
+		return twid_is_busy(&_bus[bus_id].iface.twid);
+#endif
+	default:
+		return false;
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *         Request queue
+ *----------------------------------------------------------------------------*/
+
+static void _bus_schedule(uint8_t bus_id);
+
+/**
+ * \brief Complete the active request and invoke its callback.
+ */
+static void _bus_complete(uint8_t bus_id, int status)
+{
+	struct _bus_desc* bus = &_bus[bus_id];
+	struct _bus_request* req;
+	struct _callback cb;
+	uint32_t flags, latency;
+	uint64_t elapsed;
+
+	flags = arch_irq_save();
+	req = bus->queue.active;
+	if (!req) {
+		arch_irq_restore(flags);
+		return;
+	}
+	bus->queue.active = NULL;
+	bus->queue.depth--;
+	elapsed = (timer_get_ns() - req->submit_time) / 1000;
+	latency = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+	bus->queue.requests++;
+	if (status < 0)
+		bus->queue.errors++;
+	bus->queue.latency += latency;
+	if (latency > bus->queue.max_latency)
+		bus->queue.max_latency = latency;
+	/* a stalled interface stays locked until its transfer ends */
+	if (!bus->queue.stalled)
+		mutex_unlock(&bus->mutex.lock);
+	arch_irq_restore(flags);
+
+	/* the request may be reused as soon as its status is updated */
+	callback_copy(&cb, &req->callback);
+	req->status = status;
+	callback_call(&cb);
+}
+
+static int _bus_queue_callback(void* arg)
+{
+	uint8_t bus_id = (uint8_t)(uint32_t)arg;
+	uint8_t seq = (uint8_t)((uint32_t)arg >> 8);
+	struct _bus_desc* bus = &_bus[bus_id];
+	uint32_t flags;
+
+	flags = arch_irq_save();
+	if (seq != bus->queue.seq) {
+		/* not the last transfer started */
+		arch_irq_restore(flags);
+		return 0;
+	}
+	if (bus->queue.stalled) {
+		/* late end of a timed out transfer, its request is already
+		 * completed: only release the interface */
+		bus->queue.stalled = false;
+		mutex_unlock(&bus->mutex.lock);
+		arch_irq_restore(flags);
+		_bus_schedule(bus_id);
+		return 0;
+	}
+	arch_irq_restore(flags);
+
+	_bus_complete(bus_id, 0);
+	_bus_schedule(bus_id);
+
+	return 0;
+}
+
+/**
+ * \brief Start the highest priority request if the bus is free, release the
+ * bus transaction once the queue is empty.
+ */
+static void _bus_dispatch(uint8_t bus_id)
+{
+	struct _bus_desc* bus = &_bus[bus_id];
+	struct _bus_request* req;
+	struct _callback cb;
+	uint32_t flags;
+	int prio, err;
+
+	for (;;) {
+		flags = arch_irq_save();
+		if (bus->queue.active) {
+			arch_irq_restore(flags);
+			return;
+		}
+
+		/* a timed out transfer dropped by the interface driver without
+		 * completion no longer holds the interface */
+		if (bus->queue.stalled && !_bus_iface_is_busy(bus_id)) {
+			bus->queue.stalled = false;
+			mutex_unlock(&bus->mutex.lock);
+		}
+
+		for (prio = BUS_PRIORITY_MAX; prio >= 0; prio--)
+			if (bus->queue.head[prio])
+				break;
+		if (prio < 0) {
+			if (bus->queue.owner) {
+				bus->queue.owner = false;
+				mutex_unlock(&bus->mutex.transaction);
+			}
+			arch_irq_restore(flags);
+			return;
+		}
+
+		/* wait for bus_stop_transaction() if a blocking user holds
+		 * the bus */
+		if (!bus->queue.owner) {
+			if (!mutex_try_lock(&bus->mutex.transaction)) {
+				arch_irq_restore(flags);
+				return;
+			}
+			bus->queue.owner = true;
+		}
+		if (!mutex_try_lock(&bus->mutex.lock)) {
+			arch_irq_restore(flags);
+			return;
+		}
+
+		req = bus->queue.head[prio];
+		bus->queue.head[prio] = req->next;
+		if (!req->next)
+			bus->queue.tail[prio] = NULL;
+		bus->queue.active = req;
+		bus->queue.seq++;
+		arch_irq_restore(flags);
+
+		callback_set(&cb, _bus_queue_callback,
+				(void*)((uint32_t)bus_id | ((uint32_t)bus->queue.seq << 8)));
+		err = _bus_start_transfer(bus_id, req->remote, req->buf,
+				req->buffers, &cb);
+		if (err < 0)
+			_bus_complete(bus_id, err);
+	}
+}
+
+/**
+ * \brief Run the scheduler.
+ * May be called from interrupt context or recursively from polling mode
+ * drivers: nested calls only flag the running scheduler to loop again.
+ */
+static void _bus_schedule(uint8_t bus_id)
+{
+	struct _bus_desc* bus = &_bus[bus_id];
+	uint32_t flags;
+
+	flags = arch_irq_save();
+	if (bus->queue.scheduling) {
+		bus->queue.reschedule = true;
+		arch_irq_restore(flags);
+		return;
+	}
+	bus->queue.scheduling = true;
+	arch_irq_restore(flags);
+
+	for (;;) {
+		bus->queue.reschedule = false;
+		_bus_dispatch(bus_id);
+
+		flags = arch_irq_save();
+		if (!bus->queue.reschedule) {
+			bus->queue.scheduling = false;
+			arch_irq_restore(flags);
+			break;
+		}
+		arch_irq_restore(flags);
+	}
+}
+
+/**
+ * \brief Remove a queued request, return false if it is not queued.
+ * Must be called with interrupts disabled.
+ */
+static bool _bus_unlink(struct _bus_desc* bus, struct _bus_request* req)
+{
+	struct _bus_request** prev;
+	struct _bus_request* last = NULL;
+
+	for (prev = &bus->queue.head[req->priority]; *prev; prev = &(*prev)->next) {
+		if (*prev == req) {
+			*prev = req->next;
+			if (bus->queue.tail[req->priority] == req)
+				bus->queue.tail[req->priority] = last;
+			bus->queue.depth--;
+			return true;
+		}
+		last = *prev;
+	}
+	return false;
+}
+
+/**
+ * \brief Complete a request with -ETIMEDOUT.
+ * A queued request is removed. The active one is completed at once; if its
+ * transfer still runs, the interface drivers cannot stop it: the queue is
+ * then stalled, no other request is started until the transfer ends or the
+ * interface is found idle, and its late completion is ignored.
+ */
+static void _bus_abort(uint8_t bus_id, struct _bus_request* req)
+{
+	struct _bus_desc* bus = &_bus[bus_id];
+	uint32_t flags;
+
+	flags = arch_irq_save();
+	if (_bus_unlink(bus, req)) {
+		req->status = -ETIMEDOUT;
+		arch_irq_restore(flags);
+		/* the queue may now be empty */
+		_bus_schedule(bus_id);
+		return;
+	}
+	if (bus->queue.active != req) {
+		arch_irq_restore(flags);
+		return;
+	}
+	if (_bus_iface_is_busy(bus_id)) {
+		trace_warning("bus: transfer timed out, interface stalled\r\n");
+		bus->queue.stalled = true;
+	}
+	arch_irq_restore(flags);
+
+	_bus_complete(bus_id, -ETIMEDOUT);
+	_bus_schedule(bus_id);
+}
+
 /*----------------------------------------------------------------------------
  *         Exported functions
  *----------------------------------------------------------------------------*/
@@ -401,25 +692,7 @@ int bus_transfer(uint8_t bus_id, uint16_t remote, struct _buffer* buf, uint16_t
 	callback_copy(&_bus[bus_id].callback, cb);
 
 	callback_set(&_cb, _bus_callback, (void*)(uint32_t)bus_id);
-	switch (_bus[bus_id].type) {
-#ifdef CONFIG_HAVE_SPI_BUS
-	case BUS_TYPE_SPI:
-		_bus[bus_id].iface.spid.chip_select = (uint8_t)remote;
-
-		err = spid_transfer(&_bus[bus_id].iface.spid, buf, buffers, &_cb);
-		break;
-#endif
-#ifdef CONFIG_HAVE_I2C_BUS
-	case BUS_TYPE_I2C:
-		_bus[bus_id].iface.twid.slave_addr = (uint8_t)remote;
-
-		err = twid_transfer(&_bus[bus_id].iface.twid, buf, buffers, &_cb);
-		break;
-#endif
-	default:
-		return -EINVAL;
-	}
-
+	err = _bus_start_transfer(bus_id, remote, buf, buffers, &_cb);
 	if (err < 0) {
 		mutex_unlock(&_bus[bus_id].mutex.lock);
 		return err;
@@ -447,6 +720,9 @@ int bus_stop_transaction(uint8_t bus_id)
 
 	mutex_unlock(&_bus[bus_id].mutex.transaction);
 
+	/* start requests queued during the transaction */
+	_bus_schedule(bus_id);
+
 	return 0;
 }
 
@@ -482,6 +758,140 @@ int bus_wait_transfer(uint8_t bus_id)
 	return 0;
 }
 
+int bus_submit(uint8_t bus_id, struct _bus_request* req, struct _callback* cb)
+{
+	struct _bus_desc* bus;
+	uint32_t flags;
+
+	if (bus_id >= BUS_COUNT)
+		return -ENODEV;
+
+	bus = &_bus[bus_id];
+	if (bus->type == BUS_TYPE_NONE)
+		return -EINVAL;
+	if (req->priority > BUS_PRIORITY_MAX || !req->buf || !req->buffers)
+		return -EINVAL;
+
+	req->next = NULL;
+	req->status = -EINPROGRESS;
+	req->submit_time = timer_get_ns();
+	callback_copy(&req->callback, cb);
+
+	flags = arch_irq_save();
+	if (bus->queue.tail[req->priority])
+		bus->queue.tail[req->priority]->next = req;
+	else
+		bus->queue.head[req->priority] = req;
+	bus->queue.tail[req->priority] = req;
+	bus->queue.depth++;
+	if (bus->queue.depth > bus->queue.max_depth)
+		bus->queue.max_depth = bus->queue.depth;
+	arch_irq_restore(flags);
+
+	_bus_schedule(bus_id);
+
+	return 0;
+}
+
+int bus_cancel(uint8_t bus_id, struct _bus_request* req)
+{
+	struct _bus_desc* bus;
+	uint32_t flags;
+	int err = -ENOENT;
+
+	if (bus_id >= BUS_COUNT)
+		return -ENODEV;
+
+	bus = &_bus[bus_id];
+	flags = arch_irq_save();
+	if (_bus_unlink(bus, req)) {
+		req->status = -ECANCELED;
+		err = 0;
+	} else if (bus->queue.active == req) {
+		err = -EBUSY;
+	}
+	arch_irq_restore(flags);
+
+	/* the queue may now be empty */
+	if (err == 0)
+		_bus_schedule(bus_id);
+
+	return err;
+}
+
+int bus_wait_request(uint8_t bus_id, struct _bus_request* req)
+{
+	if (bus_id >= BUS_COUNT)
+		return -ENODEV;
+
+	if (_bus[bus_id].timeout > 0) {
+		struct _timeout _to;
+
+		timer_start_timeout(&_to, _bus[bus_id].timeout);
+		while (req->status == -EINPROGRESS) {
+			if (timer_timeout_reached(&_to)) {
+				/* always completes the request */
+				_bus_abort(bus_id, req);
+				break;
+			}
+		}
+	} else {
+		while (req->status == -EINPROGRESS);
+	}
+
+	return req->status;
+}
+
+int bus_execute(uint8_t bus_id, struct _bus_request* req)
+{
+	int err;
+
+	err = bus_submit(bus_id, req, NULL);
+	if (err < 0)
+		return err;
+
+	return bus_wait_request(bus_id, req);
+}
+
+void bus_get_stats(uint8_t bus_id, struct _bus_stats* stats)
+{
+	struct _bus_desc* bus;
+	uint32_t flags;
+
+	memset(stats, 0, sizeof(*stats));
+	if (bus_id >= BUS_COUNT)
+		return;
+
+	bus = &_bus[bus_id];
+	flags = arch_irq_save();
+	stats->requests = bus->queue.requests;
+	stats->errors = bus->queue.errors;
+	stats->depth = bus->queue.depth;
+	stats->max_depth = bus->queue.max_depth;
+	stats->max_latency = bus->queue.max_latency;
+	if (bus->queue.requests)
+		stats->mean_latency = (uint32_t)(bus->queue.latency / bus->queue.requests);
+	arch_irq_restore(flags);
+}
+
+void bus_reset_stats(uint8_t bus_id)
+{
+	struct _bus_desc* bus;
+	uint32_t flags;
+
+	if (bus_id >= BUS_COUNT)
+		return;
+
+	bus = &_bus[bus_id];
+	flags = arch_irq_save();
+	bus->queue.requests = 0;
+	bus->queue.errors = 0;
+	bus->queue.latency = 0;
+	bus->queue.max_latency = 0;
+	bus->queue.max_depth = bus->queue.depth;
+	arch_irq_restore(flags);
+}
+
 int bus_suspend(uint8_t bus_id)
 {
 	if (bus_id >= BUS_COUNT)
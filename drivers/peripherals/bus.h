@@ -51,6 +51,14 @@
 
 #define BUS_COUNT (SPI_IFACE_COUNT + TWI_IFACE_COUNT)
 
+/** Number of priority levels of the bus request queue */
+#ifndef BUS_PRIORITY_COUNT
+#define BUS_PRIORITY_COUNT 4
+#endif
+
+/** Highest request priority, 0 being the lowest */
+#define BUS_PRIORITY_MAX (BUS_PRIORITY_COUNT - 1)
+
 enum _bus_type {
 	BUS_TYPE_NONE,
 	BUS_TYPE_I2C,
@@ -133,6 +141,41 @@ struct _bus_dev_cfg {
 	};
 };
 
+/**
+ * Request queued on a bus with bus_submit().
+ * Requests are started by decreasing priority, in submission order within a
+ * priority, each one selecting its own remote device.
+ */
+struct _bus_request {
+	/* --- request parameters --- */
+
+	/** Chip select (SPI) or address (I2C) of the remote device */
+	uint16_t remote;
+	/** Priority, from 0 (lowest) to BUS_PRIORITY_MAX */
+	uint8_t priority;
+	/** Buffers to transfer, as for bus_transfer() */
+	struct _buffer* buf;
+	uint16_t buffers;
+
+	/** Request status: -EINPROGRESS while queued, 0 or error when done */
+	volatile int status;
+
+	/* --- following fields are used internally --- */
+
+	struct _callback callback;
+	struct _bus_request* next;
+	uint64_t submit_time;
+};
+
+struct _bus_stats {
+	uint32_t requests;     /**< requests completed */
+	uint32_t errors;       /**< requests completed with an error */
+	uint32_t depth;        /**< requests queued or in progress */
+	uint32_t max_depth;    /**< maximum depth since last reset */
+	uint32_t mean_latency; /**< mean time from submission to completion (us) */
+	uint32_t max_latency;  /**< maximum time from submission to completion (us) */
+};
+
 /*----------------------------------------------------------------------------
  *         Exported functions
  *----------------------------------------------------------------------------*/
@@ -226,6 +269,72 @@ bool bus_is_busy(uint8_t bus_id);
  */
 int bus_wait_transfer(uint8_t bus_id);
 
+/**
+ * \brief Queue a request on the bus.
+ *
+ * The request is started as soon as the bus is free, the next one is started
+ * from the completion of the previous one (usually from the DMA or
+ * peripheral interrupt). The queue holds the bus transaction while it is not
+ * empty: bus_start_transaction() waits for the queued requests to complete.
+ *
+ * \param bus_id     bus id
+ * \param req        request to queue, must remain valid until completion
+ * \param cb         callback invoked once the request is done (may be NULL),
+ *                   usually from interrupt context
+ * \return 0 on success, < 0 on error
+ */
+int bus_submit(uint8_t bus_id, struct _bus_request* req, struct _callback* cb);
+
+/**
+ * \brief Remove a request which has not been started yet from the queue.
+ * Its status is set to -ECANCELED and its callback is not called.
+ *
+ * \param bus_id     bus id
+ * \param req        request to remove
+ * \return 0 on success, -EBUSY if the request has been started, -ENOENT if
+ * it is not queued
+ */
+int bus_cancel(uint8_t bus_id, struct _bus_request* req);
+
+/**
+ * \brief Wait until a request is complete.
+ *
+ * If a timeout is set (BUS_IOCTL_SET_TIMEOUT) and elapses, the request is
+ * completed with -ETIMEDOUT: a request still queued is removed, the active
+ * one is given up. If its transfer still runs on the interface, the queue
+ * does not start another request until the transfer ends, and that late
+ * completion is ignored.
+ *
+ * \param bus_id     bus id
+ * \param req        submitted request
+ * \return the request status
+ */
+int bus_wait_request(uint8_t bus_id, struct _bus_request* req);
+
+/**
+ * \brief Submit a request and wait until it is complete.
+ *
+ * \param bus_id     bus id
+ * \param req        request to execute
+ * \return the request status
+ */
+int bus_execute(uint8_t bus_id, struct _bus_request* req);
+
+/**
+ * \brief Get the request queue statistics.
+ *
+ * \param bus_id     bus id
+ * \param stats      filled with the statistics since the last reset
+ */
+void bus_get_stats(uint8_t bus_id, struct _bus_stats* stats);
+
+/**
+ * \brief Reset the request queue statistics.
+ *
+ * \param bus_id     bus id
+ */
+void bus_reset_stats(uint8_t bus_id);
+
 /**
  * \brief Suspend the bus if possible
  *
@@ -87,6 +87,7 @@
 #include "callback.h"
 #include "chip.h"
 #include "dma/dma.h"
+#include "errno.h"
 #include "mm/cache.h"
 #include "peripherals/pwmc.h"
 #include "trace.h"
@@ -98,6 +99,19 @@
 #ifdef CONFIG_HAVE_PWMC_DMA
 static struct _dma_channel* pwm_dma_channel = NULL;
 static struct _callback pwmc_cb;
+
+/** First quarter of a sine period, Q15, 64 steps */
+static const int16_t _pwmc_sine[65] = {
+	    0,   804,  1608,  2410,  3212,  4011,  4808,  5602,
+	 6393,  7179,  7962,  8739,  9512, 10278, 11039, 11793,
+	12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+	18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+	23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+	27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+	30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+	32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+	32767,
+};
 #endif /* CONFIG_HAVE_PWMC_DMA */
 
 /*----------------------------------------------------------------------------
@@ -347,6 +361,160 @@ void pwmc_dma_duty_cycle(Pwm* pwm, uint16_t *duty, uint32_t size)
 	dma_start_transfer(pwm_dma_channel);
 }
 
+/**
+ * \brief Sine of a phase (2^32 per period), Q15, linearly interpolated.
+ */
+static int32_t _pwmc_sin(uint32_t phase)
+{
+	uint32_t idx = (phase >> 24) & 0x3f;
+	int32_t frac = (phase >> 8) & 0xffff;
+	int32_t a, b;
+
+	if (phase & (1u << 30)) {
+		/* second and fourth quarters are mirrored */
+		a = _pwmc_sine[64 - idx];
+		b = _pwmc_sine[63 - idx];
+	} else {
+		a = _pwmc_sine[idx];
+		b = _pwmc_sine[idx + 1];
+	}
+	a += ((b - a) * frac) >> 16;
+
+	return (phase & (1u << 31)) ? -a : a;
+}
+
+static uint16_t _pwmc_wavegen_next(struct _pwmc_wavegen* gen)
+{
+	int32_t value;
+
+	if (gen->shape == PWMC_WAVE_SINE)
+		value = _pwmc_sin(gen->phase);
+	else
+		value = (int32_t)(gen->phase >> 16) - 0x8000;
+	gen->phase += gen->step;
+
+	value = gen->offset + ((value * gen->amplitude) >> 15);
+	if (value < 0)
+		return 0;
+	if (value > gen->max)
+		return gen->max;
+	return value;
+}
+
+static uint32_t _pwmc_stream_half_len(const struct _pwmc_stream* stream)
+{
+	return (stream->frames / 2) * stream->channels;
+}
+
+static int _pwmc_stream_callback(void* arg)
+{
+	struct _pwmc_stream* stream = (struct _pwmc_stream*)arg;
+	uint8_t half = stream->next_half;
+
+	stream->next_half ^= 1;
+
+	if (stream->gen) {
+		uint16_t* buffer = pwmc_dma_stream_get_half(stream, half);
+		uint32_t len = _pwmc_stream_half_len(stream);
+
+		pwmc_wavegen_fill(stream->gen, stream->channels, buffer,
+				stream->frames / 2);
+		cache_clean_region(buffer, len * sizeof(uint16_t));
+	}
+
+	return callback_call(half ? &stream->full_cb : &stream->half_cb);
+}
+
+int pwmc_dma_stream_start(struct _pwmc_stream* stream,
+		struct _callback* half_cb, struct _callback* full_cb)
+{
+	Pwm* pwm = stream->pwm;
+	uint32_t sync = pwm->PWM_SCM & (PWM_SCM_SYNC0 | PWM_SCM_SYNC1
+			| PWM_SCM_SYNC2 | PWM_SCM_SYNC3);
+	uint32_t len = _pwmc_stream_half_len(stream);
+	struct _dma_transfer_cfg cfg[2];
+	struct _dma_cfg dma_cfg;
+	struct _callback _cb;
+	uint8_t i;
+
+	if (!stream->buffer || stream->frames < 2 || (stream->frames & 1))
+		return -EINVAL;
+	if ((pwm->PWM_SCM & PWM_SCM_UPDM_Msk) != PWM_SCM_UPDM_MODE2)
+		return -EINVAL;
+	/* one duty cycle per synchronous channel and per frame */
+	for (i = 0; sync; sync &= sync - 1)
+		i++;
+	if (i != stream->channels)
+		return -EINVAL;
+
+	stream->dma = dma_allocate_channel(DMA_PERIPH_MEMORY,
+			get_pwm_id_from_addr(pwm));
+	if (!stream->dma)
+		return -ENODEV;
+
+	callback_copy(&stream->half_cb, half_cb);
+	callback_copy(&stream->full_cb, full_cb);
+	stream->next_half = 0;
+
+	if (stream->gen)
+		pwmc_wavegen_fill(stream->gen, stream->channels,
+				stream->buffer, stream->frames);
+	cache_clean_region(stream->buffer, 2 * len * sizeof(uint16_t));
+
+	for (i = 0; i < 2; i++) {
+		cfg[i].saddr = pwmc_dma_stream_get_half(stream, i);
+		cfg[i].daddr = (void*)&pwm->PWM_DMAR;
+		cfg[i].len = len;
+	}
+	memset(&dma_cfg, 0, sizeof(dma_cfg));
+	dma_cfg.incr_saddr = true;
+	dma_cfg.incr_daddr = false;
+	dma_cfg.data_width = DMA_DATA_WIDTH_HALF_WORD;
+	dma_cfg.chunk_size = DMA_CHUNK_SIZE_1;
+	dma_cfg.loop = true;
+	if (dma_configure_transfer(stream->dma, &dma_cfg, cfg, 2) < 0) {
+		dma_free_channel(stream->dma);
+		stream->dma = NULL;
+		return -EINVAL;
+	}
+	callback_set(&_cb, _pwmc_stream_callback, stream);
+	dma_set_callback(stream->dma, &_cb);
+
+	return dma_start_transfer(stream->dma);
+}
+
+void pwmc_dma_stream_stop(struct _pwmc_stream* stream)
+{
+	if (!stream->dma)
+		return;
+
+	dma_stop_transfer(stream->dma);
+	dma_free_channel(stream->dma);
+	stream->dma = NULL;
+}
+
+uint16_t* pwmc_dma_stream_get_half(const struct _pwmc_stream* stream,
+		uint8_t half)
+{
+	return stream->buffer + (half ? _pwmc_stream_half_len(stream) : 0);
+}
+
+uint32_t pwmc_wavegen_get_step(uint32_t frequency, uint32_t frame_rate)
+{
+	return (uint32_t)(((uint64_t)frequency << 32) / frame_rate);
+}
+
+void pwmc_wavegen_fill(struct _pwmc_wavegen* gen, uint8_t channels,
+		uint16_t* buffer, uint32_t frames)
+{
+	uint32_t i;
+	uint8_t c;
+
+	for (i = 0; i < frames; i++)
+		for (c = 0; c < channels; c++)
+			*buffer++ = _pwmc_wavegen_next(&gen[c]);
+}
+
 #endif /* CONFIG_HAVE_PWMC_DMA */
 
 #ifdef CONFIG_HAVE_PWMC_OOV
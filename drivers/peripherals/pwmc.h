@@ -43,6 +43,9 @@
  *    -# Enable & disable channel using pwmc_enable_channel() and pwmc_disable_channel().
  *    -# Enable & disable the period interrupt for the given PWM channel using
  *       pwmc_enable_channel_it() and pwmc_disable_channel_it().
+ *    -# Stream duty cycles to the synchronous channels without CPU load
+ *       using pwmc_dma_stream_start(), optionally generated by
+ *       pwmc_wavegen_fill().
  *
  */
 
@@ -62,6 +65,10 @@
  *        Macros
  *----------------------------------------------------------------------------*/
 
+#ifdef CONFIG_HAVE_PWMC_DMA
+struct _dma_channel;
+#endif
+
 /** definitions for PWM fault inputs */
 enum _pwm_fault_inputs{
 	PWM_FAULT_INPUT_PWMFI0 = 0,
@@ -72,6 +79,51 @@ enum _pwm_fault_inputs{
 	PWM_FAULT_INPUT_TIMER1 = 5,
 };
 
+#ifdef CONFIG_HAVE_PWMC_DMA
+
+/** Waveform shapes of the duty cycle generator */
+enum _pwmc_wave {
+	PWMC_WAVE_SINE = 0,
+	PWMC_WAVE_RAMP,
+};
+
+/**
+ * Table-driven duty cycle generator. The phase wraps at 2^32 (one waveform
+ * period) and advances by 'step' at each frame: step = 2^32 * frequency /
+ * frame rate, see pwmc_wavegen_get_step().
+ */
+struct _pwmc_wavegen {
+	enum _pwmc_wave shape;
+	uint32_t phase;      /*< Current phase */
+	uint32_t step;       /*< Phase increment per frame */
+	uint16_t offset;     /*< Duty cycle at mid-scale */
+	uint16_t amplitude;  /*< Peak deviation from offset */
+	uint16_t max;        /*< Upper limit, usually the channel period */
+};
+
+/**
+ * Continuous DMA update of the duty cycles of the synchronous channels.
+ * The buffer holds 'frames' frames of 'channels' duty cycles (one per
+ * synchronous channel, in channel order), and is transferred in a loop as
+ * two halves.
+ */
+struct _pwmc_stream {
+	Pwm* pwm;
+	uint16_t* buffer;
+	uint32_t frames;             /*< Number of frames, must be even */
+	uint8_t channels;            /*< Number of synchronous channels */
+	struct _pwmc_wavegen* gen;   /*< Optional, one generator per channel
+	                              *  refilling each half once sent */
+
+	/* private */
+	struct _dma_channel* dma;
+	struct _callback half_cb;
+	struct _callback full_cb;
+	uint8_t next_half;
+};
+
+#endif /* CONFIG_HAVE_PWMC_DMA */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -260,6 +312,57 @@ extern void pwmc_set_dma_finished_callback(Pwm *pwm, struct _callback* cb);
  */
 extern void pwmc_dma_duty_cycle(Pwm *pwm, uint16_t *duty, uint32_t size);
 
+/**
+ * \brief Starts streaming duty cycles to the synchronous channels.
+ *
+ * The synchronous channels must be configured in update mode 2 (see
+ * pwmc_configure_sync_channels()), a frame is sent at each update period.
+ * If the stream has generators, the whole buffer is filled first.
+ *
+ * \param stream Stream descriptor, its public fields must be set.
+ * \param half_cb Called once the first half has been sent (may be NULL).
+ * \param full_cb Called once the second half has been sent (may be NULL).
+ * \return 0 on success, -EINVAL for an invalid configuration, -ENODEV if no
+ * DMA channel is available.
+ */
+extern int pwmc_dma_stream_start(struct _pwmc_stream* stream,
+		struct _callback* half_cb, struct _callback* full_cb);
+
+/**
+ * \brief Stops streaming duty cycles and releases the DMA channel.
+ * \param stream Stream descriptor.
+ */
+extern void pwmc_dma_stream_stop(struct _pwmc_stream* stream);
+
+/**
+ * \brief Gets a half of the stream buffer.
+ *
+ * From the half (resp. full) callback, half 0 (resp. 1) can be refilled
+ * while the other half is sent.
+ *
+ * \param stream Stream descriptor.
+ * \param half 0 or 1.
+ */
+extern uint16_t* pwmc_dma_stream_get_half(const struct _pwmc_stream* stream,
+		uint8_t half);
+
+/**
+ * \brief Computes the phase step of a generator.
+ * \param frequency Waveform frequency.
+ * \param frame_rate Frame rate, in the same unit.
+ */
+extern uint32_t pwmc_wavegen_get_step(uint32_t frequency, uint32_t frame_rate);
+
+/**
+ * \brief Fills interleaved frames of duty cycles.
+ * \param gen Array of 'channels' generators, their phase is advanced.
+ * \param channels Number of channels per frame.
+ * \param buffer Destination buffer.
+ * \param frames Number of frames to fill.
+ */
+extern void pwmc_wavegen_fill(struct _pwmc_wavegen* gen, uint8_t channels,
+		uint16_t* buffer, uint32_t frames);
+
 #endif /* CONFIG_HAVE_PWMC_DMA */
 
 #ifdef CONFIG_HAVE_PWMC_OOV
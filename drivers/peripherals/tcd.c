@@ -45,6 +45,25 @@
 #include "peripherals/tcd.h"
 #include "trace.h"
 
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define TCD_COUNTER_MASK ((uint32_t)((1ull << TC_CHANNEL_SIZE) - 1))
+
+/** Capture: RA = low time and RB = period, counter reset on falling edges */
+#define TCD_CAPTURE_CMR (TC_CMR_LDRA_RISING | TC_CMR_LDRB_FALLING | TC_CMR_ABETRG | TC_CMR_ETRGEDG_FALLING)
+
+/** Ring capture: RA/RB = rising/falling edge times, free running counter */
+#define TCD_CAPTURE_RING_CMR (TC_CMR_LDRA_RISING | TC_CMR_LDRB_FALLING)
+
+#ifdef CONFIG_HAVE_TC_DMA_MODE
+/* the 8-bit wrap queue indexes must wrap on an entry boundary */
+_Static_assert((TCD_WRAP_QUEUE_SIZE & (TCD_WRAP_QUEUE_SIZE - 1)) == 0 &&
+	       TCD_WRAP_QUEUE_SIZE <= 128,
+	       "TCD_WRAP_QUEUE_SIZE must be a power of 2, at most 128");
+#endif
+
 /*----------------------------------------------------------------------------
  *        Local functions
  *----------------------------------------------------------------------------*/
@@ -61,6 +80,180 @@ static int _tcd_dma_transfer_callback(void* args)
 
 	return callback_call(&desc->callback);
 }
+
+static int _tcd_ring_callback(void* args)
+{
+	struct _tcd_desc* desc = (struct _tcd_desc *)args;
+
+	desc->capture.ring.blocks++;
+
+	return callback_call(&desc->callback);
+}
+
+/**
+ * \brief Number of captures written to the ring since start.
+ * The DMA position gives the offset in the ring, the count of completed
+ * halves gives the lap (its callback may still be pending).
+ */
+static uint32_t _tcd_ring_head(struct _tcd_desc* desc)
+{
+	uint32_t words = desc->capture.buffer.size / sizeof(uint32_t);
+	uint32_t blocks = desc->capture.ring.blocks;
+	uint32_t start = (blocks & 1) * (words / 2);
+	uint32_t offset = (dma_get_dest_addr(desc->capture.dma.channel)
+			- (uint32_t)desc->capture.buffer.data) / sizeof(uint32_t);
+
+	return blocks * (words / 2) + (offset + words - start) % words;
+}
+
+/**
+ * \brief Record a counter overflow with the number of captures written when
+ * it is handled and the counter value at that time: among these captures,
+ * those not above this value were taken after the overflow.
+ */
+static void _tcd_ring_overflow(struct _tcd_desc* desc)
+{
+	uint32_t pos, cv;
+	uint8_t last;
+
+	/* position first, so that every capture written before it was taken
+	 * before the counter is read */
+	pos = _tcd_ring_head(desc);
+	cv = tc_get_cv(desc->addr, desc->channel) & TCD_COUNTER_MASK;
+
+	last = (uint8_t)(desc->capture.ring.wrap_in - 1) % TCD_WRAP_QUEUE_SIZE;
+	if (desc->capture.ring.wrap_in != desc->capture.ring.wrap_out &&
+	    desc->capture.ring.wraps[last].pos == pos) {
+		/* no edge since the previous overflow */
+		desc->capture.ring.wraps[last].count++;
+	} else if ((uint8_t)(desc->capture.ring.wrap_in - desc->capture.ring.wrap_out) < TCD_WRAP_QUEUE_SIZE) {
+		last = desc->capture.ring.wrap_in % TCD_WRAP_QUEUE_SIZE;
+		desc->capture.ring.wraps[last].pos = pos;
+		desc->capture.ring.wraps[last].count = 1;
+		desc->capture.ring.wraps[last].cv = cv;
+		desc->capture.ring.wrap_in++;
+	} else {
+		/* keep the count right for the following captures, the ones
+		 * written since the last entry are not measured */
+		desc->capture.ring.wraps[last].count++;
+		desc->capture.ring.lost_wraps++;
+	}
+}
+
+/**
+ * \brief Extended timestamp of capture \a pos.
+ * Overflows handled before the capture was written precede it. The first
+ * overflow handled after it precedes it as well if the capture is not above
+ * the counter value read by the interrupt handler, i.e. if the edge occurred
+ * between the overflow and its interrupt. This is decided for each capture
+ * so that a misplaced edge does not shift the following ones.
+ */
+static uint64_t _tcd_ring_extend(struct _tcd_desc* desc, uint32_t pos,
+		uint32_t raw)
+{
+	uint32_t epoch;
+	uint8_t out;
+
+	raw &= TCD_COUNTER_MASK;
+	while (desc->capture.ring.wrap_out != desc->capture.ring.wrap_in) {
+		out = desc->capture.ring.wrap_out % TCD_WRAP_QUEUE_SIZE;
+		if ((int32_t)(desc->capture.ring.wraps[out].pos - pos) > 0)
+			break;
+		desc->capture.ring.epoch += desc->capture.ring.wraps[out].count;
+		desc->capture.ring.wrap_out++;
+	}
+
+	epoch = desc->capture.ring.epoch;
+	if (desc->capture.ring.wrap_out != desc->capture.ring.wrap_in &&
+	    raw <= desc->capture.ring.wraps[out].cv)
+		epoch++;
+
+	return ((uint64_t)epoch << TC_CHANNEL_SIZE) | raw;
+}
+
+static void _tcd_ring_add_period(struct _tcd_desc* desc, uint64_t period,
+		uint64_t high)
+{
+	struct _tcd_capture_stats* stats = &desc->capture.ring.stats;
+	uint32_t step = desc->cfg.capture.jitter_step ? desc->cfg.capture.jitter_step : 1;
+	uint32_t value = period > UINT32_MAX ? UINT32_MAX : (uint32_t)period;
+	int64_t dev, bin;
+
+	if (stats->count) {
+		dev = (int64_t)period - (int64_t)(desc->capture.ring.sum_period / stats->count);
+		bin = dev >= 0 ? dev / step : -((-dev + step - 1) / step);
+		bin += TCD_JITTER_BINS / 2;
+		if (bin < 0)
+			bin = 0;
+		else if (bin >= TCD_JITTER_BINS)
+			bin = TCD_JITTER_BINS - 1;
+		stats->jitter[bin]++;
+	}
+
+	if (!stats->count || value < stats->min_period)
+		stats->min_period = value;
+	if (value > stats->max_period)
+		stats->max_period = value;
+	stats->count++;
+	desc->capture.ring.sum_period += period;
+	desc->capture.ring.sum_high += high;
+}
+
+/**
+ * \brief Process the captures written since the last call. Even entries
+ * are rising edges (RA), odd entries falling edges (RB).
+ */
+static void _tcd_ring_update(struct _tcd_desc* desc)
+{
+	const uint32_t* data = (const uint32_t*)desc->capture.buffer.data;
+	uint32_t words = desc->capture.buffer.size / sizeof(uint32_t);
+	uint32_t head = _tcd_ring_head(desc);
+	uint32_t raw, lost;
+	bool measure;
+
+	if (head - desc->capture.ring.tail > words) {
+		lost = head - desc->capture.ring.tail - words;
+		desc->capture.ring.stats.overruns += lost;
+		desc->capture.ring.tail += lost;
+		desc->capture.ring.index = (desc->capture.ring.index + lost) % words;
+		desc->capture.ring.rise_valid = false;
+		desc->capture.ring.fall_valid = false;
+	}
+
+	/* overflows folded into the last entry: skip the periods of these
+	 * captures, timestamps are right again from the next update */
+	measure = desc->capture.ring.lost_wraps == desc->capture.ring.lost_seen;
+	desc->capture.ring.lost_seen = desc->capture.ring.lost_wraps;
+
+	cache_invalidate_region((void*)data, desc->capture.buffer.size);
+
+	for (; desc->capture.ring.tail != head; desc->capture.ring.tail++) {
+		raw = data[desc->capture.ring.index];
+		if (++desc->capture.ring.index == words)
+			desc->capture.ring.index = 0;
+		desc->capture.ring.time = _tcd_ring_extend(desc,
+				desc->capture.ring.tail, raw);
+
+		if (desc->capture.ring.tail & 1) {
+			desc->capture.ring.fall = desc->capture.ring.time;
+			desc->capture.ring.fall_valid = desc->capture.ring.rise_valid;
+			continue;
+		}
+		if (measure && desc->capture.ring.rise_valid && desc->capture.ring.fall_valid)
+			_tcd_ring_add_period(desc,
+				desc->capture.ring.time - desc->capture.ring.rise,
+				desc->capture.ring.fall - desc->capture.ring.rise);
+		desc->capture.ring.rise = desc->capture.ring.time;
+		desc->capture.ring.rise_valid = true;
+		desc->capture.ring.fall_valid = false;
+	}
+	if (!measure) {
+		desc->capture.ring.rise_valid = false;
+		desc->capture.ring.fall_valid = false;
+	}
+
+	desc->capture.ring.stats.last_edge = desc->capture.ring.time;
+}
 #endif
 
 /**
@@ -74,6 +267,13 @@ static void _tcd_counter_handler(uint32_t source, void* user_arg)
 	if (desc->mode == TCD_MODE_COUNTER)
 		if ((status & TC_SR_CPCS) == TC_SR_CPCS)
 			callback_call(&desc->callback);
+
+#ifdef CONFIG_HAVE_TC_DMA_MODE
+	if (desc->mode == TCD_MODE_CAPTURE &&
+	    desc->cfg.capture.transfer_mode == TCD_TRANSFER_MODE_DMA_RING)
+		if ((status & TC_SR_COVFS) == TC_SR_COVFS)
+			_tcd_ring_overflow(desc);
+#endif
 }
 
 #ifdef CONFIG_HAVE_TC_DMA_MODE
@@ -105,6 +305,55 @@ static int _tcd_capture_dma(struct _tcd_desc* desc)
 
 	return -EAGAIN;
 }
+
+static int _tcd_capture_ring(struct _tcd_desc* desc)
+{
+	uint32_t tc_id = get_tc_id_from_addr(desc->addr, desc->channel);
+	uint32_t words = desc->capture.buffer.size / sizeof(uint32_t);
+	uint32_t cmr = desc->addr->TC_CHANNEL[desc->channel].TC_CMR;
+	struct _dma_transfer_cfg cfg[2];
+	struct _dma_cfg cfg_dma;
+	struct _callback _cb;
+	uint8_t i;
+
+	if (words < 4 || (words & 1))
+		return -EINVAL;
+
+	memset(&desc->capture.ring, 0, sizeof(desc->capture.ring));
+	desc->capture.ring.stats.timer_freq = tc_get_channel_freq(desc->addr, desc->channel);
+
+	tc_configure(desc->addr, desc->channel,
+			(cmr & TC_CMR_TCCLKS_Msk) | TCD_CAPTURE_RING_CMR);
+
+	memset(&cfg_dma, 0, sizeof(cfg_dma));
+	cfg_dma.incr_saddr = false;
+	cfg_dma.incr_daddr = true;
+	cfg_dma.data_width = DMA_DATA_WIDTH_WORD;
+	cfg_dma.chunk_size = DMA_CHUNK_SIZE_1;
+	cfg_dma.loop = true;
+
+	for (i = 0; i < 2; i++) {
+		cfg[i].saddr = (uint32_t*)&(desc->addr->TC_CHANNEL[desc->channel].TC_RAB);
+		cfg[i].daddr = (uint32_t*)desc->capture.buffer.data + i * (words / 2);
+		cfg[i].len = words / 2;
+	}
+	cache_invalidate_region(desc->capture.buffer.data, desc->capture.buffer.size);
+	dma_configure_transfer(desc->capture.dma.channel, &cfg_dma, cfg, 2);
+
+	callback_set(&_cb, _tcd_ring_callback, (void*)desc);
+	dma_set_callback(desc->capture.dma.channel, &_cb);
+
+	/* overflows only interrupt the CPU, edges never do */
+	irq_add_handler(tc_id, _tcd_counter_handler, (void*)desc);
+	irq_enable(tc_id);
+	tc_get_status(desc->addr, desc->channel);
+	tc_enable_it(desc->addr, desc->channel, TC_IER_COVFS);
+
+	dma_start_transfer(desc->capture.dma.channel);
+	tc_start(desc->addr, desc->channel);
+
+	return 0;
+}
 #endif
 
 static int _tcd_capture_polling(struct _tcd_desc* desc)
@@ -212,7 +461,7 @@ int tcd_configure_capture(struct _tcd_desc* desc, uint32_t frequency, struct _bu
 		pmc_configure_peripheral(tc_id, NULL, true);
 
 	tc_clks = tc_find_best_clock_source(desc->addr, desc->channel, frequency);
-	config = tc_clks | TC_CMR_LDRA_RISING | TC_CMR_LDRB_FALLING | TC_CMR_ABETRG | TC_CMR_ETRGEDG_FALLING;
+	config = tc_clks | TCD_CAPTURE_CMR;
 	tc_configure(desc->addr, desc->channel, config);
 	chan_freq = tc_get_channel_freq(desc->addr, desc->channel);
 
@@ -247,8 +496,18 @@ int tcd_start(struct _tcd_desc* desc, struct _callback* cb)
 		case TCD_TRANSFER_MODE_DMA:
 			_tcd_capture_dma(desc);
 			break;
+		case TCD_TRANSFER_MODE_DMA_RING:
+		{
+			int err = _tcd_capture_ring(desc);
+			if (err < 0) {
+				mutex_unlock(&desc->mutex);
+				return err;
+			}
+			break;
+		}
 #endif
 		default:
+			mutex_unlock(&desc->mutex);
 			return -EINVAL;
 		}
 		break;
@@ -262,6 +521,20 @@ int tcd_start(struct _tcd_desc* desc, struct _callback* cb)
 int tcd_stop(struct _tcd_desc* desc)
 {
 	tc_stop(desc->addr, desc->channel);
+#ifdef CONFIG_HAVE_TC_DMA_MODE
+	if (desc->mode == TCD_MODE_CAPTURE &&
+	    desc->cfg.capture.transfer_mode == TCD_TRANSFER_MODE_DMA_RING) {
+		uint32_t tc_id = get_tc_id_from_addr(desc->addr, desc->channel);
+		uint32_t cmr = desc->addr->TC_CHANNEL[desc->channel].TC_CMR;
+
+		tc_disable_it(desc->addr, desc->channel, TC_IDR_COVFS);
+		irq_remove_handler(tc_id, _tcd_counter_handler);
+		dma_stop_transfer(desc->capture.dma.channel);
+		/* back to the configuration of tcd_configure_capture() */
+		tc_configure(desc->addr, desc->channel,
+				(cmr & TC_CMR_TCCLKS_Msk) | TCD_CAPTURE_CMR);
+	}
+#endif
 	if (mutex_is_locked(&desc->mutex))
 		mutex_unlock(&desc->mutex);
 
@@ -279,3 +552,41 @@ void tcd_wait(struct _tcd_desc* desc)
 #endif
 	}
 }
+
+#ifdef CONFIG_HAVE_TC_DMA_MODE
+int tcd_get_capture_stats(struct _tcd_desc* desc,
+		struct _tcd_capture_stats* stats)
+{
+	if (desc->mode != TCD_MODE_CAPTURE ||
+	    desc->cfg.capture.transfer_mode != TCD_TRANSFER_MODE_DMA_RING)
+		return -EINVAL;
+
+	_tcd_ring_update(desc);
+
+	*stats = desc->capture.ring.stats;
+	stats->lost_wraps = desc->capture.ring.lost_wraps;
+	if (stats->count) {
+		stats->mean_period = (uint32_t)(desc->capture.ring.sum_period / stats->count);
+		stats->duty_cycle = (uint32_t)(desc->capture.ring.sum_high * 1000 / desc->capture.ring.sum_period);
+	}
+
+	return 0;
+}
+
+void tcd_reset_capture_stats(struct _tcd_desc* desc)
+{
+	uint32_t timer_freq = desc->capture.ring.stats.timer_freq;
+
+	_tcd_ring_update(desc);
+
+	memset(&desc->capture.ring.stats, 0, sizeof(desc->capture.ring.stats));
+	desc->capture.ring.stats.timer_freq = timer_freq;
+	desc->capture.ring.stats.last_edge = desc->capture.ring.time;
+	desc->capture.ring.sum_period = 0;
+	desc->capture.ring.sum_high = 0;
+	desc->capture.ring.lost_wraps = 0;
+	desc->capture.ring.lost_seen = 0;
+	desc->capture.ring.rise_valid = false;
+	desc->capture.ring.fall_valid = false;
+}
+#endif
@@ -34,6 +34,7 @@
  *        Headers
  *----------------------------------------------------------------------------*/
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "io.h"
@@ -41,6 +42,21 @@
 #include "dma/dma.h"
 #include "mutex.h"
 
+/*------------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Number of bins of the period jitter histogram */
+#ifndef TCD_JITTER_BINS
+#define TCD_JITTER_BINS 16
+#endif
+
+/** Number of counter overflows tracked between two statistics reads
+ * (power of 2, at most 128) */
+#ifndef TCD_WRAP_QUEUE_SIZE
+#define TCD_WRAP_QUEUE_SIZE 32
+#endif
+
 /*------------------------------------------------------------------------------
  *        Types
  *----------------------------------------------------------------------------*/
@@ -49,6 +65,7 @@ enum _tcd_transfer_mode
 {
 	TCD_TRANSFER_MODE_POLLING = 0,
 	TCD_TRANSFER_MODE_DMA,
+	TCD_TRANSFER_MODE_DMA_RING, /**< continuous capture into a DMA ring */
 };
 
 enum _tcd_mode
@@ -58,6 +75,26 @@ enum _tcd_mode
 	TCD_MODE_CAPTURE,
 };
 
+/** Statistics of a continuous capture, all durations in timer ticks */
+struct _tcd_capture_stats {
+	uint32_t timer_freq;  /**< frequency of the timer ticks (Hz) */
+	uint32_t count;       /**< number of periods measured */
+	uint32_t min_period;
+	uint32_t max_period;
+	uint32_t mean_period;
+	uint32_t duty_cycle;  /**< mean high time, per mille of the period */
+	uint32_t overruns;    /**< edges overwritten before being processed */
+	uint32_t lost_wraps;  /**< overflows not tracked (queue full), periods
+	                       * measured meanwhile are skipped */
+	uint64_t last_edge;   /**< extended timestamp of the last edge */
+	/** Periods by deviation from the mean period at the time they were
+	 * measured: bin i counts deviations in
+	 * [(i - TCD_JITTER_BINS / 2) * jitter_step,
+	 *  (i - TCD_JITTER_BINS / 2 + 1) * jitter_step[,
+	 * first and last bins also count larger deviations. */
+	uint32_t jitter[TCD_JITTER_BINS];
+};
+
 struct _tcd_desc {
 	Tc* addr;
 	uint8_t channel;
@@ -78,6 +115,7 @@ struct _tcd_desc {
 		struct {
 			uint32_t frequency;
 			enum _tcd_transfer_mode transfer_mode;
+			uint32_t jitter_step; /**< ring mode: histogram bin width in ticks */
 		} capture;
 	} cfg;
 
@@ -88,6 +126,31 @@ struct _tcd_desc {
 		struct {
 			struct _dma_channel* channel;
 		} dma;
+
+		/* continuous capture, processed by tcd_get_capture_stats() */
+		struct {
+			volatile uint32_t blocks; /* ring halves written */
+			uint32_t tail;            /* next capture to process */
+			uint32_t index;           /* its position in the ring */
+			struct {
+				uint32_t pos;     /* captures written when handled */
+				uint32_t count;   /* overflows without edge between */
+				uint32_t cv;      /* counter value when handled */
+			} wraps[TCD_WRAP_QUEUE_SIZE];
+			volatile uint8_t wrap_in;
+			uint8_t wrap_out;
+			volatile uint32_t lost_wraps;
+			uint32_t lost_seen;       /* lost_wraps at last update */
+			uint32_t epoch;           /* overflows handled before tail */
+			bool rise_valid;
+			bool fall_valid;
+			uint64_t time;
+			uint64_t rise;
+			uint64_t fall;
+			uint64_t sum_period;
+			uint64_t sum_high;
+			struct _tcd_capture_stats stats;
+		} ring;
 #endif
 	} capture;
 };
@@ -134,6 +197,12 @@ extern int tcd_configure_capture(
 
 /**
  * \brief Start a configured timer and register the calback \cb
+ *
+ * With the TCD_TRANSFER_MODE_DMA_RING capture mode, the counter runs freely
+ * and the DMA loops over the capture buffer, which holds RA (rising edge) and
+ * RB (falling edge) timestamps alternately. The callback is called each time
+ * half of the buffer has been written, the capture only ends on tcd_stop().
+ * The buffer must be cache aligned and hold a multiple of 2 words, at least 4.
  * \param desc   TC driver descriptor
  * \param cb     Callback
  * \return 0 on succes
@@ -153,4 +222,31 @@ extern int tcd_stop(struct _tcd_desc* desc);
  */
 extern void tcd_wait(struct _tcd_desc* desc);
 
+#ifdef CONFIG_HAVE_TC_DMA_MODE
+/**
+ * \brief Process the captures received since the last call and get the
+ * statistics of a continuous capture.
+ *
+ * Timestamps are extended to 64 bits across counter overflows. Captures are
+ * processed here rather than per edge, so this function must be called
+ * before the DMA wraps around the buffer, otherwise the oldest edges are
+ * lost and counted in overruns, and at least every TCD_WRAP_QUEUE_SIZE
+ * counter periods, otherwise overflows are lost and counted in lost_wraps.
+ * The overflow interrupt latency must be shorter than a counter period.
+ *
+ * \param desc   TC driver descriptor, in TCD_TRANSFER_MODE_DMA_RING mode
+ * \param stats  Filled with the statistics since start or last reset
+ * \return 0 on success, -EINVAL if the capture is not in ring mode
+ */
+extern int tcd_get_capture_stats(struct _tcd_desc* desc,
+		struct _tcd_capture_stats* stats);
+
+/**
+ * \brief Reset the statistics of a continuous capture, pending captures are
+ * discarded.
+ * \param desc   TC driver descriptor
+ */
+extern void tcd_reset_capture_stats(struct _tcd_desc* desc);
+#endif
+
 #endif /* TCD_H */
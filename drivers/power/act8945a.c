@@ -280,10 +280,13 @@ static bool _act8945a_read_reg(struct _act8945a* act8945a, uint8_t iaddr, uint8_
 			.attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_RX | BUS_I2C_BUF_ATTR_STOP,
 		},
 	};
+	struct _bus_request req = {
+		.remote = act8945a->addr,
+		.buf = buf,
+		.buffers = 2,
+	};
 
-	bus_start_transaction(act8945a->bus);
-	err = bus_transfer(act8945a->bus, act8945a->addr, buf, 2, NULL);
-	bus_stop_transaction(act8945a->bus);
+	err = bus_execute(act8945a->bus, &req);
 
 	if (err < 0)
 		return false;
@@ -301,10 +304,13 @@ static bool _act8945a_write_reg(struct _act8945a* act8945a, uint8_t iaddr, uint8
 			.attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_TX | BUS_I2C_BUF_ATTR_STOP,
 		}
 	};
+	struct _bus_request req = {
+		.remote = act8945a->addr,
+		.buf = buf,
+		.buffers = 1,
+	};
 
-	bus_start_transaction(act8945a->bus);
-	err = bus_transfer(act8945a->bus, act8945a->addr, buf, 1, NULL);
-	bus_stop_transaction(act8945a->bus);
+	err = bus_execute(act8945a->bus, &req);
 
 	if (err < 0)
 		return false;
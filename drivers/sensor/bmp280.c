@@ -74,10 +74,13 @@ static int _bmp280_read(struct _bmp280* bmp280, uint8_t iaddr, uint8_t* buffer,
 			.attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_RX | BUS_I2C_BUF_ATTR_STOP,
 		},
 	};
+	struct _bus_request req = {
+		.remote = bmp280->addr,
+		.buf = buf,
+		.buffers = 2,
+	};
 
-	bus_start_transaction(bmp280->bus);
-	err = bus_transfer(bmp280->bus, bmp280->addr, buf, 2, NULL);
-	bus_stop_transaction(bmp280->bus);
+	err = bus_execute(bmp280->bus, &req);
 
 	return err;
 }
@@ -97,10 +100,13 @@ static uint8_t _bmp280_write(struct _bmp280* bmp280, uint8_t iaddr, const uint8_
 			.attr = BUS_BUF_ATTR_TX | BUS_I2C_BUF_ATTR_STOP,
 		},
 	};
+	struct _bus_request req = {
+		.remote = bmp280->addr,
+		.buf = buf,
+		.buffers = 2,
+	};
 
-	bus_start_transaction(bmp280->bus);
-	err = bus_transfer(bmp280->bus, bmp280->addr, buf, 2, NULL);
-	bus_stop_transaction(bmp280->bus);
+	err = bus_execute(bmp280->bus, &req);
 
 	return err;
 }
@@ -41,7 +41,12 @@
 #include "board.h"
 #include "chip.h"
 
+#include "cpuidle.h"
+#include "dma/dma.h"
+#include "intmath.h"
 #include "irq/irq.h"
+#include "irqflags.h"
+#include "mm/cache.h"
 #ifdef CONFIG_HAVE_DBGU
 #include "serial/dbgu.h"
 #endif
@@ -60,9 +65,27 @@
 #include "serial/usart.h"
 
 #include "console.h"
+#include "ring.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ *        Local Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Size of the TX ring used once buffering is enabled */
+#ifndef CONSOLE_TX_BUFFER_SIZE
+#define CONSOLE_TX_BUFFER_SIZE 1024
+#endif
+
+/** Largest DMA transfer started at once, so that the OVERWRITE policy always
+ * has queued data it can discard while a transfer is running */
+#define CONSOLE_TX_DMA_MAX_LEN \
+	min_u32(CONSOLE_TX_BUFFER_SIZE / 2, DMA_MAX_BLOCK_LEN)
 
 /*----------------------------------------------------------------------------
  *        Local Types
@@ -70,6 +93,7 @@
 
 typedef void (*init_handler_t)(void*, uint32_t, uint32_t);
 typedef void (*put_char_handler_t)(void*, uint8_t);
+typedef bool (*tx_ready_handler_t)(void*);
 typedef bool (*tx_empty_handler_t)(void*);
 typedef uint8_t (*get_char_handler_t)(void*);
 typedef bool (*rx_ready_handler_t)(void*);
@@ -79,8 +103,11 @@ typedef void (*disable_it_handler_t)(void*, uint32_t);
 struct _console {
 	uint32_t             mode;
 	uint32_t             rx_int_mask;
+	uint32_t             tx_int_mask;
+	uint32_t             thr_offset;
 	init_handler_t       init;
 	put_char_handler_t   put_char;
+	tx_ready_handler_t   tx_ready;
 	tx_empty_handler_t   tx_empty;
 	get_char_handler_t   get_char;
 	rx_ready_handler_t   rx_ready;
@@ -96,8 +123,11 @@ struct _console {
 static const struct _console console = {
 	.mode = US_MR_CHMODE_NORMAL | US_MR_PAR_NO | US_MR_CHRL_8_BIT,
 	.rx_int_mask = US_IER_RXRDY,
+	.tx_int_mask = US_IER_TXRDY,
+	.thr_offset = offsetof(Usart, US_THR),
 	.init = (init_handler_t)usart_configure,
 	.put_char = (put_char_handler_t)usart_put_char,
+	.tx_ready = (tx_ready_handler_t)usart_is_tx_ready,
 	.tx_empty = (tx_empty_handler_t)usart_is_tx_empty,
 	.get_char = (get_char_handler_t)usart_get_char,
 	.rx_ready = (rx_ready_handler_t)usart_is_rx_ready,
@@ -110,8 +140,11 @@ static const struct _console console = {
 static const struct _console console = {
 	.mode = UART_MR_CHMODE_NORMAL | UART_MR_PAR_NO,
 	.rx_int_mask = UART_IER_RXRDY,
+	.tx_int_mask = UART_IER_TXRDY,
+	.thr_offset = offsetof(Uart, UART_THR),
 	.init = (init_handler_t)uart_configure,
 	.put_char = (put_char_handler_t)uart_put_char,
+	.tx_ready = (tx_ready_handler_t)uart_is_tx_ready,
 	.tx_empty = (tx_empty_handler_t)uart_is_tx_empty,
 	.get_char = (get_char_handler_t)uart_get_char,
 	.rx_ready = (rx_ready_handler_t)uart_is_rx_ready,
@@ -124,8 +157,11 @@ static const struct _console console = {
 static const struct _console console = {
 	.mode = DBGU_MR_CHMODE_NORM | DBGU_MR_PAR_NONE,
 	.rx_int_mask = DBGU_IER_RXRDY,
+	.tx_int_mask = DBGU_IER_TXRDY,
+	.thr_offset = offsetof(Dbgu, DBGU_THR),
 	.init = (init_handler_t)dbgu_configure,
 	.put_char = (put_char_handler_t)dbgu_put_char,
+	.tx_ready = (tx_ready_handler_t)dbgu_is_tx_ready,
 	.tx_empty = (tx_empty_handler_t)dbgu_is_tx_empty,
 	.get_char = (get_char_handler_t)dbgu_get_char,
 	.rx_ready = (rx_ready_handler_t)dbgu_is_rx_ready,
@@ -138,15 +174,175 @@ static uint32_t console_id = 0;
 static void *console_addr = NULL;
 static bool console_initialized = false;
 static console_rx_handler_t console_rx_handler;
+static bool console_rx_it = false;
+
+/** Buffered TX state, indices are offsets in _console_tx_buffer */
+static struct {
+	bool enabled;
+	enum _console_tx_policy policy;
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	volatile uint32_t pending;	/* bytes owned by the running DMA */
+	struct _dma_channel* dma;
+	struct _dma_cfg cfg_dma;
+	struct _console_tx_stats stats;
+} _console_tx;
+
+CACHE_ALIGNED static uint8_t _console_tx_buffer[CONSOLE_TX_BUFFER_SIZE];
 
 /*------------------------------------------------------------------------------
  *         Local functions
  *------------------------------------------------------------------------------*/
 
+static void _console_tx_start(void);
+
+static void _console_tx_advance(uint32_t count)
+{
+	_console_tx.tail = (_console_tx.tail + count) % CONSOLE_TX_BUFFER_SIZE;
+}
+
+static int _console_tx_dma_callback(void* arg)
+{
+	uint32_t flags = arch_irq_save();
+
+	dma_reset_channel(_console_tx.dma);
+	_console_tx_advance(_console_tx.pending);
+	_console_tx.pending = 0;
+	_console_tx_start();
+
+	arch_irq_restore(flags);
+	return 0;
+}
+
+/**
+ * \brief Start draining the TX ring, either with a DMA transfer of the
+ * longest contiguous chunk or by unmasking the TXRDY interrupt.
+ * \note Must be called with interrupts disabled.
+ */
+static void _console_tx_start(void)
+{
+	struct _dma_transfer_cfg cfg;
+	struct _callback _cb;
+	uint32_t len;
+
+	if (_console_tx.pending ||
+	    RING_EMPTY(_console_tx.head, _console_tx.tail))
+		return;
+
+	if (!_console_tx.dma) {
+		console.enable_it(console_addr, console.tx_int_mask);
+		return;
+	}
+
+	len = RING_CNT_TO_END(_console_tx.head, _console_tx.tail,
+			CONSOLE_TX_BUFFER_SIZE);
+	len = min_u32(len, CONSOLE_TX_DMA_MAX_LEN);
+
+	cfg.saddr = &_console_tx_buffer[_console_tx.tail];
+	cfg.daddr = (uint8_t*)console_addr + console.thr_offset;
+	cfg.len = len;
+	dma_configure_transfer(_console_tx.dma, &_console_tx.cfg_dma, &cfg, 1);
+	callback_set(&_cb, _console_tx_dma_callback, NULL);
+	dma_set_callback(_console_tx.dma, &_cb);
+	cache_clean_region(cfg.saddr, cfg.len);
+
+	_console_tx.pending = len;
+	_console_tx.stats.dma_transfers++;
+	dma_start_transfer(_console_tx.dma);
+}
+
+/**
+ * \brief Make progress on the TX ring without relying on interrupts: wait
+ * for the running DMA transfer, or else send one byte by polling.
+ * \note Must be called with interrupts disabled.
+ */
+static void _console_tx_poll(void)
+{
+	if (_console_tx.pending) {
+		while (dma_get_transferred_data_len(_console_tx.dma,
+				_console_tx.cfg_dma.chunk_size,
+				_console_tx.pending) < _console_tx.pending);
+		dma_stop_transfer(_console_tx.dma);
+		_console_tx_advance(_console_tx.pending);
+		_console_tx.pending = 0;
+	} else if (!RING_EMPTY(_console_tx.head, _console_tx.tail)) {
+		console.put_char(console_addr,
+				_console_tx_buffer[_console_tx.tail]);
+		_console_tx_advance(1);
+	}
+}
+
+/**
+ * \brief Make room for new data according to the overflow policy.
+ * \return the number of bytes that may be written in the TX ring.
+ * \note Must be called with interrupts disabled.
+ */
+static uint32_t _console_tx_make_room(bool can_wait, uint32_t flags)
+{
+	uint32_t space, queued;
+
+	space = RING_SPACE(_console_tx.head, _console_tx.tail,
+			CONSOLE_TX_BUFFER_SIZE);
+	if (space)
+		return space;
+
+	switch (_console_tx.policy) {
+	case CONSOLE_TX_OVERWRITE:
+		/* discard everything not yet handed to the DMA */
+		queued = RING_CNT(_console_tx.head, _console_tx.tail,
+				CONSOLE_TX_BUFFER_SIZE) - _console_tx.pending;
+		if (queued) {
+			_console_tx.head = (_console_tx.tail + _console_tx.pending)
+				% CONSOLE_TX_BUFFER_SIZE;
+			_console_tx.stats.dropped += queued;
+			break;
+		}
+		/* the whole ring is in flight: wait like BLOCK */
+		/* fall through */
+	case CONSOLE_TX_BLOCK:
+		if (can_wait) {
+			/* sleep with interrupts still masked since the check:
+			 * a completion in between keeps the interrupt pending,
+			 * which wakes WFI up, and is handled on restore */
+			cpu_idle();
+			arch_irq_restore(flags);
+			arch_irq_save();
+		} else {
+			_console_tx_poll();
+		}
+		break;
+	case CONSOLE_TX_DROP:
+	default:
+		return 0;
+	}
+
+	return RING_SPACE(_console_tx.head, _console_tx.tail,
+			CONSOLE_TX_BUFFER_SIZE);
+}
+
+static void _console_tx_handler(void)
+{
+	uint32_t flags = arch_irq_save();
+
+	while (!RING_EMPTY(_console_tx.head, _console_tx.tail) &&
+	       console.tx_ready(console_addr)) {
+		console.put_char(console_addr,
+				_console_tx_buffer[_console_tx.tail]);
+		_console_tx_advance(1);
+	}
+	if (RING_EMPTY(_console_tx.head, _console_tx.tail))
+		console.disable_it(console_addr, console.tx_int_mask);
+
+	arch_irq_restore(flags);
+}
+
 static void console_handler(uint32_t source, void* user_arg)
 {
 	uint8_t c;
 
+	if (_console_tx.enabled && !_console_tx.dma)
+		_console_tx_handler();
+
 	if (!console_is_rx_ready())
 		return;
 
@@ -155,6 +351,11 @@ static void console_handler(uint32_t source, void* user_arg)
 		console_rx_handler(c);
 }
 
+static bool _console_tx_uses_it(void)
+{
+	return _console_tx.enabled && !_console_tx.dma;
+}
+
 /*------------------------------------------------------------------------------
  *         Exported functions
  *------------------------------------------------------------------------------*/
@@ -193,7 +394,164 @@ void console_put_char(uint8_t c)
 	if (!console_initialized)
 		return;
 
-	console.put_char(console_addr, c);
+	if (_console_tx.enabled)
+		console_write(&c, 1);
+	else
+		console.put_char(console_addr, c);
+}
+
+int console_write(const uint8_t* buffer, uint32_t len)
+{
+	uint32_t flags, space, count, written = 0;
+	bool can_wait;
+
+	// if console is not initialized, do nothing
+	if (!console_initialized)
+		return 0;
+
+	if (!_console_tx.enabled) {
+		for (written = 0; written < len; written++)
+			console.put_char(console_addr, buffer[written]);
+		return written;
+	}
+
+	/* Never sleep with interrupts masked or from a handler, the DMA or
+	 * TXRDY interrupt could not preempt us: poll instead */
+	can_wait = !arch_irq_is_disabled() && !irq_is_in_handler();
+
+	flags = arch_irq_save();
+	while (written < len) {
+		space = _console_tx_make_room(can_wait, flags);
+		if (space == 0) {
+			if (_console_tx.policy == CONSOLE_TX_DROP) {
+				_console_tx.stats.dropped += len - written;
+				break;
+			}
+			continue;
+		}
+
+		count = RING_SPACE_TO_END(_console_tx.head, _console_tx.tail,
+				CONSOLE_TX_BUFFER_SIZE);
+		count = min_u32(min_u32(count, space), len - written);
+		memcpy(&_console_tx_buffer[_console_tx.head], &buffer[written],
+				count);
+		_console_tx.head = (_console_tx.head + count)
+			% CONSOLE_TX_BUFFER_SIZE;
+		written += count;
+		_console_tx.stats.written += count;
+
+		count = RING_CNT(_console_tx.head, _console_tx.tail,
+				CONSOLE_TX_BUFFER_SIZE);
+		if (count > _console_tx.stats.max_level)
+			_console_tx.stats.max_level = count;
+
+		_console_tx_start();
+	}
+	arch_irq_restore(flags);
+
+	return written;
+}
+
+void console_flush(void)
+{
+	uint32_t flags;
+
+	// if console is not initialized, do nothing
+	if (!console_initialized)
+		return;
+
+	if (_console_tx.enabled) {
+		if (!arch_irq_is_disabled() && !irq_is_in_handler()) {
+			/* check and sleep with interrupts masked, as in
+			 * _console_tx_make_room() */
+			while (true) {
+				flags = arch_irq_save();
+				if (RING_EMPTY(_console_tx.head, _console_tx.tail)) {
+					arch_irq_restore(flags);
+					break;
+				}
+				cpu_idle();
+				arch_irq_restore(flags);
+			}
+		} else {
+			flags = arch_irq_save();
+			while (!RING_EMPTY(_console_tx.head, _console_tx.tail))
+				_console_tx_poll();
+			if (!_console_tx.dma)
+				console.disable_it(console_addr,
+						console.tx_int_mask);
+			arch_irq_restore(flags);
+		}
+	}
+
+	while (!console.tx_empty(console_addr));
+}
+
+int console_enable_tx_buffer(enum _console_tx_policy policy)
+{
+	uint32_t flags;
+
+	if (!console_initialized)
+		return -ENODEV;
+
+	_console_tx.policy = policy;
+	if (_console_tx.enabled)
+		return 0;
+
+	RING_CLEAR(_console_tx.head, _console_tx.tail);
+	_console_tx.pending = 0;
+	memset(&_console_tx.stats, 0, sizeof(_console_tx.stats));
+
+	/* Prefer DMA, fall back to the TXRDY interrupt for peripherals that
+	 * have no DMA interface (e.g. DBGU on some devices) */
+	_console_tx.dma = dma_allocate_channel(DMA_PERIPH_MEMORY, console_id);
+	if (_console_tx.dma) {
+		_console_tx.cfg_dma.data_width = DMA_DATA_WIDTH_BYTE;
+		_console_tx.cfg_dma.chunk_size = DMA_CHUNK_SIZE_1;
+		_console_tx.cfg_dma.incr_saddr = true;
+		_console_tx.cfg_dma.incr_daddr = false;
+		_console_tx.cfg_dma.loop = false;
+	} else {
+		irq_add_handler(console_id, console_handler, NULL);
+		irq_enable(console_id);
+	}
+
+	flags = arch_irq_save();
+	_console_tx.enabled = true;
+	arch_irq_restore(flags);
+
+	return 0;
+}
+
+void console_disable_tx_buffer(void)
+{
+	if (!_console_tx.enabled)
+		return;
+
+	console_flush();
+	_console_tx.enabled = false;
+
+	if (_console_tx.dma) {
+		dma_free_channel(_console_tx.dma);
+		_console_tx.dma = NULL;
+	} else {
+		console.disable_it(console_addr, console.tx_int_mask);
+		if (!console_rx_it) {
+			irq_disable(console_id);
+			irq_remove_handler(console_id, console_handler);
+		}
+	}
+}
+
+void console_get_tx_stats(struct _console_tx_stats* stats)
+{
+	uint32_t flags = arch_irq_save();
+
+	*stats = _console_tx.stats;
+	stats->level = RING_CNT(_console_tx.head, _console_tx.tail,
+			CONSOLE_TX_BUFFER_SIZE);
+
+	arch_irq_restore(flags);
 }
 
 bool console_is_tx_empty(void)
@@ -232,16 +590,22 @@ void console_set_rx_handler(console_rx_handler_t handler)
 
 void console_enable_rx_interrupt(void)
 {
-	irq_add_handler(console_id, console_handler, NULL);
-	irq_enable(console_id);
+	console_rx_it = true;
+	if (!_console_tx_uses_it()) {
+		irq_add_handler(console_id, console_handler, NULL);
+		irq_enable(console_id);
+	}
 	console.enable_it(console_addr, console.rx_int_mask);
 }
 
 void console_disable_rx_interrupt(void)
 {
 	console.disable_it(console_addr, console.rx_int_mask);
-	irq_disable(console_id);
-	irq_remove_handler(console_id, console_handler);
+	console_rx_it = false;
+	if (!_console_tx_uses_it()) {
+		irq_disable(console_id);
+		irq_remove_handler(console_id, console_handler);
+	}
 }
 
 void console_example_info(const char *example_name)
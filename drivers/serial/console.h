@@ -44,6 +44,22 @@
 /** Handler for character reception using interrupts */
 typedef void (*console_rx_handler_t)(uint8_t received_char);
 
+/** Behaviour of buffered writes when the TX ring is full */
+enum _console_tx_policy {
+	CONSOLE_TX_DROP,      /**< discard the bytes that do not fit */
+	CONSOLE_TX_BLOCK,     /**< wait for room (polls from IRQ context) */
+	CONSOLE_TX_OVERWRITE, /**< discard queued output, keep the newest */
+};
+
+/** Buffered TX statistics */
+struct _console_tx_stats {
+	uint32_t written;       /**< bytes accepted into the TX ring */
+	uint32_t dropped;       /**< bytes discarded on overflow */
+	uint32_t level;         /**< bytes currently in the TX ring */
+	uint32_t max_level;     /**< TX ring high-water mark */
+	uint32_t dma_transfers; /**< DMA transfers started */
+};
+
 /* ----------------------------------------------------------------------------
  *         Global function
  * ---------------------------------------------------------------------------*/
@@ -64,6 +80,49 @@ extern void console_configure(void *addr, uint32_t baudrate);
  */
 extern void console_put_char(uint8_t uc);
 
+/**
+ * \brief Outputs a buffer on the CONSOLE.
+ *
+ * When TX buffering is enabled the data is copied to the TX ring and the
+ * function returns without waiting for the transmission. It can be called
+ * from interrupt handlers.
+ * \param buffer  Data to send.
+ * \param len     Number of bytes to send.
+ * \return the number of bytes accepted (less than len only with the
+ * CONSOLE_TX_DROP policy).
+ */
+extern int console_write(const uint8_t *buffer, uint32_t len);
+
+/**
+ * \brief Wait until all buffered data has been transmitted.
+ *
+ * When called with interrupts disabled or from an interrupt handler (e.g.
+ * on a fatal error) the TX ring is drained by polling.
+ */
+extern void console_flush(void);
+
+/**
+ * \brief Enable TX buffering.
+ *
+ * Output is then queued in a ring buffer and sent by DMA, or by the TXRDY
+ * interrupt if the console peripheral has no DMA interface. The DMA driver
+ * must have been initialized.
+ * \param policy  Behaviour when the TX ring is full.
+ * \return 0 on success, -ENODEV if the console is not configured.
+ */
+extern int console_enable_tx_buffer(enum _console_tx_policy policy);
+
+/**
+ * \brief Flush the TX ring and go back to synchronous output.
+ */
+extern void console_disable_tx_buffer(void);
+
+/**
+ * \brief Get the buffered TX statistics.
+ * \param stats  Structure to fill.
+ */
+extern void console_get_tx_stats(struct _console_tx_stats *stats);
+
 /**
  * \brief Check if any pending TX character has been sent
  */
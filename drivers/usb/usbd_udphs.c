@@ -45,6 +45,7 @@
 
 #include "barriers.h"
 #include "chip.h"
+#include "irqflags.h"
 #include "trace.h"
 
 #include "mm/cache.h"
@@ -93,6 +94,12 @@
 /** Buffer list is null */
 #define MBL_NULL        2
 
+/** Max size of multi-buffer lists on DMA endpoints (one DMA descriptor per
+ *  buffer) */
+#ifndef UDPHS_MULTI_DESC_COUNT
+#define UDPHS_MULTI_DESC_COUNT 8
+#endif
+
 /*---------------------------------------------------------------------------
  *      Types
  *---------------------------------------------------------------------------*/
@@ -169,6 +176,16 @@ struct _multi_xfer {
 
 	/**  Current buffer for input (run time) */
 	uint16_t in;
+
+	/**  Number of buffers queued, not handed to the DMA yet (run time) */
+	uint16_t dma_pending;
+
+	/**  Number of buffers handed to the DMA, not completed yet (run time).
+	 *   They start at index out. */
+	uint16_t dma_active;
+
+	/**  DMA channel started and not seen stopped yet (run time) */
+	bool dma_running;
 };
 
 /**
@@ -242,6 +259,10 @@ static bool force_full_speed = false;
 /** DMA link list */
 CACHE_ALIGNED static struct _udphs_dma_desc dma_desc[4];
 
+/** DMA descriptors of multi-buffer lists, one per list entry */
+CACHE_ALIGNED static struct _udphs_dma_desc
+	multi_desc[USB_ENDPOINTS][UDPHS_MULTI_DESC_COUNT];
+
 /*---------------------------------------------------------------------------
  *      Internal Functions
  *---------------------------------------------------------------------------*/
@@ -375,10 +396,16 @@ static void udphs_end_of_transfer(uint8_t ep, uint8_t status)
 					endpoint->state == UDPHS_ENDPOINT_RECEIVINGM ? "R" : "S",
 					(unsigned)ep);
 
+			if (CHIP_USB_ENDPOINT_HAS_DMA(ep))
+				UDPHS->UDPHS_DMA[ep].UDPHS_DMACONTROL = 0;
+
 			endpoint->state = UDPHS_ENDPOINT_IDLE;
 			xfer->list_state = 0;
 			xfer->out = 0;
 			xfer->in = 0;
+			xfer->dma_pending = 0;
+			xfer->dma_active = 0;
+			xfer->dma_running = false;
 
 			/* Invoke callback */
 			if (endpoint->transfer.callback) {
@@ -722,6 +749,153 @@ static void udphs_dma_single(uint8_t ep, struct _single_xfer *xfer, uint32_t cfg
 		UDPHS_DMACONTROL_BUFF_LENGTH(xfer->buffered);
 }
 
+/**
+ * Hand the buffers queued on a multi-buffer list to the DMA.
+ *
+ * IN buffers are chained: each descriptor is linked to the previous one
+ * (LDNXT_DSC) so the channel moves from buffer to buffer without CPU
+ * intervention. If the channel already loaded the previous descriptor, it
+ * stops at the end of it and udphs_dma_multi_handler() restarts it.
+ *
+ * OUT buffers are handed one at a time: a short packet ends the buffer
+ * (END_TR_EN) and its byte count is only known from the channel status
+ * once it has stopped.
+ *
+ * Must be called with interrupts disabled.
+ * \param ep Endpoint number
+ */
+static void udphs_dma_multi_start(uint8_t ep)
+{
+	UdphsEpt *ept = &UDPHS->UDPHS_EPT[ep];
+	struct _endpoint *endpoint = &endpoints[ep];
+	struct _multi_xfer *xfer = &endpoint->transfer.multi;
+	struct _udphs_dma_desc *desc, *prev;
+	struct _usbd_transfer_buffer *buffer;
+	bool is_in = (ept->UDPHS_EPTCFG & UDPHS_EPTCFG_EPT_DIR) != 0;
+	uint16_t index;
+
+	while (xfer->dma_pending) {
+		if (!is_in && xfer->dma_active)
+			break;
+
+		index = (xfer->out + xfer->dma_active) % xfer->list_size;
+		buffer = &xfer->buffers[index];
+		buffer->buffered = buffer->size;
+
+		desc = &multi_desc[ep][index];
+		desc->next = &multi_desc[ep][(index + 1) % xfer->list_size];
+		desc->addr = buffer->buffer;
+		desc->ctrl = UDPHS_DMACONTROL_CHANN_ENB |
+			UDPHS_DMACONTROL_BUFF_LENGTH(buffer->size) |
+			UDPHS_DMACONTROL_END_B_EN |
+			UDPHS_DMACONTROL_END_BUFFIT;
+		if (!is_in)
+			desc->ctrl |= UDPHS_DMACONTROL_END_TR_EN |
+				UDPHS_DMACONTROL_END_TR_IT;
+		desc->reserved = 0;
+		cache_clean_region(desc, sizeof(*desc));
+
+		/* Chain after the previous IN buffer */
+		if (xfer->dma_active && xfer->dma_running) {
+			prev = &multi_desc[ep][(index + xfer->list_size - 1) %
+				xfer->list_size];
+			prev->ctrl |= UDPHS_DMACONTROL_LDNXT_DSC;
+			cache_clean_region(prev, sizeof(*prev));
+		}
+
+		xfer->dma_pending--;
+		xfer->dma_active++;
+	}
+
+	/* (Re)start the channel on the oldest uncompleted buffer */
+	if (xfer->dma_active && !xfer->dma_running) {
+		xfer->dma_running = true;
+		UDPHS->UDPHS_IEN |= UDPHS_IEN_DMA_1 << (ep - 1);
+		UDPHS->UDPHS_DMA[ep].UDPHS_DMANXTDSC =
+			(uint32_t)&multi_desc[ep][xfer->out];
+		UDPHS->UDPHS_DMA[ep].UDPHS_DMACONTROL = 0;
+		UDPHS->UDPHS_DMA[ep].UDPHS_DMACONTROL =
+			UDPHS_DMACONTROL_LDNXT_DSC;
+	}
+}
+
+/**
+ * Complete the buffers of a multi-buffer list processed by the DMA, invoke
+ * the transfer callback once per buffer and keep the channel fed.
+ *
+ * The last descriptor loaded by the channel is found from the next
+ * descriptor address: all buffers before it are done, and so is this one
+ * if the channel has stopped. This copes with several buffers completing
+ * before the interrupt is serviced.
+ * \param ep Endpoint number
+ * \param dma_status DMA channel status
+ */
+static void udphs_dma_multi_handler(uint8_t ep, uint32_t dma_status)
+{
+	UdphsEpt *ept = &UDPHS->UDPHS_EPT[ep];
+	struct _endpoint *endpoint = &endpoints[ep];
+	struct _multi_xfer *xfer = &endpoint->transfer.multi;
+	struct _usbd_transfer_buffer *buffer;
+	bool is_in = (ept->UDPHS_EPTCFG & UDPHS_EPTCFG_EPT_DIR) != 0;
+	bool running = (dma_status & UDPHS_DMASTATUS_CHANN_ENB) != 0;
+	uint32_t next, loaded, done, remaining;
+
+	if (!xfer->dma_active)
+		return;
+
+	next = (UDPHS->UDPHS_DMA[ep].UDPHS_DMANXTDSC -
+		(uint32_t)&multi_desc[ep][0]) / sizeof(struct _udphs_dma_desc);
+	loaded = (next + xfer->list_size - 1) % xfer->list_size;
+	done = (loaded + xfer->list_size - xfer->out) % xfer->list_size;
+	if (!running)
+		done++;
+	if (done > xfer->dma_active)
+		done = xfer->dma_active;
+
+	USB_HAL_TRACE("iDmaM%d,%d ", ep, (unsigned)done);
+
+	while (done--) {
+		buffer = &xfer->buffers[xfer->out];
+		buffer->transferred = buffer->size;
+		/* Only the last buffer of a stopped channel can be short */
+		if (done == 0 && !running) {
+			remaining = (dma_status & UDPHS_DMASTATUS_BUFF_COUNT_Msk)
+				>> UDPHS_DMASTATUS_BUFF_COUNT_Pos;
+			buffer->transferred -= remaining;
+		}
+		buffer->buffered = 0;
+		buffer->remaining = 0;
+
+		if (!is_in && buffer->transferred)
+			cache_invalidate_region(buffer->buffer,
+					buffer->transferred);
+
+		xfer->out = (xfer->out + 1) % xfer->list_size;
+		xfer->dma_active--;
+		xfer->list_state = 0;
+
+		if (endpoint->transfer.callback) {
+			endpoint->transfer.callback(
+					endpoint->transfer.callback_arg,
+					USBD_STATUS_SUCCESS, buffer->transferred,
+					xfer->dma_active + xfer->dma_pending);
+		}
+	}
+
+	/* Only now allow a restart: a buffer queued from a callback must not
+	 * restart the channel on buffers not completed yet */
+	if (!running)
+		xfer->dma_running = false;
+	udphs_dma_multi_start(ep);
+
+	/* List drained: wait for the start offset to be reached again */
+	if (!xfer->dma_active && !xfer->dma_pending) {
+		USB_HAL_TRACE("EoMT[%d] ", ep);
+		UDPHS->UDPHS_IEN &= ~(UDPHS_IEN_DMA_1 << (ep - 1));
+		endpoint->state = UDPHS_ENDPOINT_IDLE;
+	}
+}
+
 /**
  * Endpoint DMA interrupt handler.
  * This function handles DMA interrupts.
@@ -740,7 +914,7 @@ static void udphs_dma_handler(uint8_t ep)
 	/* Multi transfer */
 	if (endpoint->state == UDPHS_ENDPOINT_SENDINGM ||
 		endpoint->state == UDPHS_ENDPOINT_RECEIVINGM) {
-		/* Not implemented */
+		udphs_dma_multi_handler(ep, dma_status);
 		return;
 	}
 
@@ -878,6 +1052,11 @@ static uint8_t udphs_write(uint8_t ep,
  * for the endpoint) and then starts the actual transfer. The operation is
  * complete when all the transfer buffer in the list has been sent.
  *
+ * On endpoints with DMA, the buffer is transferred by the DMA, in both
+ * directions, and the transfer callback is invoked when each buffer
+ * completes with the number of bytes transferred and the number of
+ * buffers still queued.
+ *
  * *If the size of the buffer is greater than the size of the endpoint
  *  (or twice the size if the endpoint has two FIFO banks), then the buffer
  *  must be kept allocated until the transfer is finished*. This means that
@@ -898,18 +1077,30 @@ static uint8_t udphs_add_buffer(uint8_t ep,
 	struct _multi_xfer *xfer = &endpoint->transfer.multi;
 	struct _usbd_transfer_buffer *tx;
 
+	uint32_t flags;
+
 	/* Check parameter */
 	if (data_len >= 0x10000)
 		return USBD_STATUS_INVALID_PARAMETER;
 
+	/* A zero DMA buffer length stands for 64K */
+	if (CHIP_USB_ENDPOINT_HAS_DMA(ep) && data_len == 0)
+		return USBD_STATUS_INVALID_PARAMETER;
+
+	flags = arch_irq_save();
+
 	/* Data in process */
 	if (endpoint->state > UDPHS_ENDPOINT_IDLE) {
 		/* MBL transfer */
 		if (!endpoint->transfer.use_multi ||
 				xfer->list_state == MBL_FULL) {
+			arch_irq_restore(flags);
 			trace_warning("udphs_add_buffer: EP%d not idle\n\r", ep);
 			return USBD_STATUS_LOCKED;
 		}
+	} else if (xfer->list_state == MBL_FULL) {
+		arch_irq_restore(flags);
+		return USBD_STATUS_LOCKED;
 	}
 
 	USB_HAL_TRACE("AddW%d(%d) ", ep, (unsigned)data_len);
@@ -931,6 +1122,25 @@ static uint8_t udphs_add_buffer(uint8_t ep,
 	else
 		xfer->list_state = 0;
 
+	/* DMA: chain the buffer, start when offset achieved */
+	if (CHIP_USB_ENDPOINT_HAS_DMA(ep)) {
+		xfer->dma_pending++;
+		if (endpoint->state == UDPHS_ENDPOINT_IDLE) {
+			if (xfer->dma_pending < xfer->offset) {
+				arch_irq_restore(flags);
+				return USBD_STATUS_SUCCESS;
+			}
+			USB_HAL_TRACE("StartM ");
+			if (ept->UDPHS_EPTCFG & UDPHS_EPTCFG_EPT_DIR)
+				endpoint->state = UDPHS_ENDPOINT_SENDINGM;
+			else
+				endpoint->state = UDPHS_ENDPOINT_RECEIVINGM;
+		}
+		udphs_dma_multi_start(ep);
+		arch_irq_restore(flags);
+		return USBD_STATUS_SUCCESS;
+	}
+
 	/* Start sending when offset achieved */
 	if (MBL_NbBuffer(xfer->in, xfer->out, xfer->list_size) >= xfer->offset &&
 			endpoint->state == UDPHS_ENDPOINT_IDLE) {
@@ -952,6 +1162,7 @@ static uint8_t udphs_add_buffer(uint8_t ep,
 		ept->UDPHS_EPTCTLENB = UDPHS_EPTCTLENB_TXRDY;
 
 	}
+	arch_irq_restore(flags);
 
 	return USBD_STATUS_SUCCESS;
 }
@@ -1354,7 +1565,8 @@ uint8_t usbd_hal_set_transfer_callback(uint8_t ep,
  * The buffers can be added by _Read/_Write function.
  * \param ep Endpoint number.
  * \param list  Pointer to a multi-buffer list used, NULL to disable MBL.
- * \param list_size  Multi-buffer list size (number of buffers can be queued)
+ * \param list_size  Multi-buffer list size (number of buffers can be queued),
+ *                   up to UDPHS_MULTI_DESC_COUNT on endpoints with DMA
  * \param start_offset When number of buffer achieve this offset transfer start
  */
 uint8_t usbd_hal_setup_multi_transfer(uint8_t ep,
@@ -1373,8 +1585,13 @@ uint8_t usbd_hal_setup_multi_transfer(uint8_t ep,
 
 	/* Enable Multi-Buffer Transfer List */
 	if (list) {
+		/* One DMA descriptor per list item */
+		if (CHIP_USB_ENDPOINT_HAS_DMA(ep) &&
+				list_size > UDPHS_MULTI_DESC_COUNT)
+			return USBD_STATUS_INVALID_PARAMETER;
+
 		/* Reset list items */
-		for (i = 0; i < list_size; i--) {
+		for (i = 0; i < list_size; i++) {
 			list[i].buffer = NULL;
 			list[i].size = 0;
 			list[i].transferred = 0;
@@ -1390,6 +1607,9 @@ uint8_t usbd_hal_setup_multi_transfer(uint8_t ep,
 		xfer->out = 0;
 		xfer->in = 0;
 		xfer->offset = start_offset;
+		xfer->dma_pending = 0;
+		xfer->dma_active = 0;
+		xfer->dma_running = false;
 	}
 	/* Disable Multi-Buffer Transfer */
 	else {
@@ -1640,7 +1860,9 @@ uint16_t usbd_hal_get_data_size(uint8_t ep)
 uint8_t usbd_hal_read(uint8_t ep, void *data, uint32_t data_len)
 {
 	if (endpoints[ep].transfer.use_multi) {
-		trace_warning("usbd_hal_read does not support 'multi' transfers\r\n");
+		if (CHIP_USB_ENDPOINT_HAS_DMA(ep))
+			return udphs_add_buffer(ep, data, data_len);
+		trace_warning("usbd_hal_read does not support 'multi' transfers without DMA\r\n");
 		return USBD_STATUS_SW_NOT_SUPPORTED;
 	} else {
 		return udphs_read(ep, data, data_len);
@@ -1937,6 +2159,24 @@ bool usbd_hal_is_high_speed(void)
 	return (UDPHS->UDPHS_INTSTA & UDPHS_INTSTA_SPEED) != 0;
 }
 
+/**
+ * Returns the number of the current (micro)frame.
+ * In high speed, the value counts microframes (frame number in bits 13:3,
+ * microframe number in bits 2:0). In full speed, it counts 1ms frames and
+ * wraps at 2048.
+ */
+uint16_t usbd_hal_get_frame_number(void)
+{
+	uint32_t fnum = UDPHS->UDPHS_FNUM;
+
+	if (usbd_hal_is_high_speed())
+		return fnum & (UDPHS_FNUM_FRAME_NUMBER_Msk |
+				UDPHS_FNUM_MICRO_FRAME_NUM_Msk);
+	else
+		return (fnum & UDPHS_FNUM_FRAME_NUMBER_Msk) >>
+			UDPHS_FNUM_FRAME_NUMBER_Pos;
+}
+
 /**
  * Suspend USB Device HW Interface
  * -# Disable transceiver
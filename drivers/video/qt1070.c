@@ -40,7 +40,7 @@
 
 #include "i2c/twi.h"
 #include "i2c/twid.h"
-#include "twi-peripherals/bus.h"
+#include "peripherals/bus.h"
 
 #include "video/qt1070.h"
 
@@ -77,10 +77,13 @@ static int _qt1070_read_reg(struct _qt1070* qt1070, uint8_t reg_addr)
 			.attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_RX | BUS_I2C_BUF_ATTR_STOP,
 		},
 	};
+	struct _bus_request req = {
+		.remote = qt1070->addr,
+		.buf = buf,
+		.buffers = 2,
+	};
 
-	bus_start_transaction(qt1070->bus);
-	err = bus_transfer(qt1070->bus, qt1070->addr, buf, 2, NULL);
-	bus_stop_transaction(qt1070->bus);
+	err = bus_execute(qt1070->bus, &req);
 
 	if (err < 0)
 		return err;
@@ -106,10 +109,13 @@ static int _qt1070_write_reg(struct _qt1070* qt1070, uint32_t reg_addr,
 			.attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_TX | BUS_I2C_BUF_ATTR_STOP,
 		}
 	};
+	struct _bus_request req = {
+		.remote = qt1070->addr,
+		.buf = buf,
+		.buffers = 1,
+	};
 
-	bus_start_transaction(qt1070->bus);
-	err = bus_transfer(qt1070->bus, qt1070->addr, buf, 1, NULL);
-	bus_stop_transaction(qt1070->bus);
+	err = bus_execute(qt1070->bus, &req);
 
 	return err;
 }
@@ -61,6 +61,8 @@
  * <li>Configure an interrupt for TC and enable the RB load interrupt.
  * <li> 'c' start capture.
  * <li> 's' will stop capture,and dump the informations what have been captured.
+ * <li> 'r' starts/stops a continuous capture into a DMA ring, 's' then
+ * displays the period statistics.
  * </ul>
  *
  * \section Usage
@@ -260,6 +262,8 @@ static void _display_menu(void)
 	printf("  -------------------------------------------\r\n");
 #ifdef CONFIG_HAVE_TC_DMA_MODE
 	printf("  [p|d] to set capture mode (polling/dma) \r\n");
+	printf("  r: Start/stop continuous capture \r\n");
+	printf("  s: Display continuous capture statistics \r\n");
 #endif
 	printf("  c: Capture waveform from TC capture channel \r\n");
 	printf("  h: Display menu \r\n");
@@ -267,6 +271,36 @@ static void _display_menu(void)
 }
 
 
+#ifdef CONFIG_HAVE_TC_DMA_MODE
+static void _tc_capture_display_stats(void)
+{
+	struct _tcd_capture_stats stats;
+	uint32_t i;
+
+	if (tcd_get_capture_stats(&tc_capture, &stats) < 0) {
+		printf("No continuous capture\r\n");
+		return;
+	}
+	if (!stats.count) {
+		printf("No period captured\r\n");
+		return;
+	}
+
+	printf("Continuous capture: %u periods, %u overruns\r\n",
+		(unsigned)stats.count, (unsigned)stats.overruns);
+	printf("- period min/mean/max = %u/%u/%u ticks\r\n",
+		(unsigned)stats.min_period, (unsigned)stats.mean_period,
+		(unsigned)stats.max_period);
+	printf("- frequency=%uHz\r\n",
+		(unsigned)(stats.timer_freq / stats.mean_period));
+	printf("- duty cycle=%u%%\r\n", (unsigned)stats.duty_cycle / 10);
+	printf("- jitter:");
+	for (i = 0; i < TCD_JITTER_BINS; i++)
+		printf(" %u", (unsigned)stats.jitter[i]);
+	printf("\r\n");
+}
+#endif
+
 static void _tc_counter_initialize(uint32_t freq)
 {
 	uint32_t frequency;
@@ -368,9 +402,35 @@ int main(void)
 			tc_capture.cfg.capture.transfer_mode = TCD_TRANSFER_MODE_DMA;
 			printf("TC capture in DMA mode\r\n");
 			break;
+		case 'R':
+		case 'r':
+			if (tc_capture.cfg.capture.transfer_mode == TCD_TRANSFER_MODE_DMA_RING) {
+				tcd_stop(&tc_capture);
+				_tc_capture_display_stats();
+				tc_capture.cfg.capture.transfer_mode = TCD_TRANSFER_MODE_DMA;
+				printf("Continuous capture stopped, TC capture in DMA mode\r\n");
+			} else {
+				tc_capture.cfg.capture.transfer_mode = TCD_TRANSFER_MODE_DMA_RING;
+				tc_capture.cfg.capture.jitter_step = 1;
+				if (tcd_start(&tc_capture, NULL) < 0)
+					tc_capture.cfg.capture.transfer_mode = TCD_TRANSFER_MODE_DMA;
+				else
+					printf("Continuous capture started\r\n");
+			}
+			break;
+		case 'S':
+		case 's':
+			_tc_capture_display_stats();
+			break;
 #endif
 		case 'c':
 		case 'C':
+#ifdef CONFIG_HAVE_TC_DMA_MODE
+			if (tc_capture.cfg.capture.transfer_mode == TCD_TRANSFER_MODE_DMA_RING) {
+				printf("Stop the continuous capture first\r\n");
+				break;
+			}
+#endif
 			printf("TC: capture...\r\n");
 			callback_set(&_cb, _tc_capture_callback, NULL);
 			tcd_start(&tc_capture, &_cb);
@@ -53,6 +53,12 @@
  *  amplifier. At the same time, the audio stream received is also sent
  *  back to host from EK for recording.
  *
+ *  With CONFIG_USB_AUDIO_ASYNC (default), the streaming endpoint is
+ *  asynchronous: the codec runs from its own clock and the number of bytes
+ *  it consumes is reported to the host on a feedback endpoint, so that the
+ *  host sends exactly what is played. Otherwise the stream is synchronous
+ *  and the codec clock is adjusted to the buffer level.
+ *
  *  \section Usage
  *
  *  -# Build the program and download it inside the evaluation board. Please
@@ -152,7 +158,7 @@
 #define BUFFERS (32)
 
 /**  Size of one buffer in bytes. */
-#define BUFFER_SIZE ROUND_UP_MULT(AUDDSpeakerDriver_BYTESPERFRAME, L1_CACHE_BYTES)
+#define BUFFER_SIZE ROUND_UP_MULT(AUDDSpeakerDriver_MAXBYTESPERFRAME, L1_CACHE_BYTES)
 
 /**  Delay (in number of buffers) before starting the DAC transmission
      after data has been received. */
@@ -186,6 +192,12 @@ static struct _audio_ctx {
 	} circ;
 	uint8_t volume;
 	bool playing;
+#ifdef CONFIG_USB_AUDIO_ASYNC
+	struct {
+		uint32_t pending;
+		uint32_t played;
+	} dac;
+#endif
 } _audio_ctx = {
 	.samples = _samples,
 	.threshold = BUFFER_THRESHOLD,
@@ -215,10 +227,23 @@ static int _audio_transfer_callback(void* arg)
 	struct _audio_desc* desc = (struct _audio_desc*)arg;
 	struct _callback _cb;
 
+#ifdef CONFIG_USB_AUDIO_ASYNC
+	/* Count the bytes consumed by the codec, measured by the feedback.
+	 * The count only moves when a whole buffer (one USB packet) is done,
+	 * instead of sample by sample as a TC clocked by the codec would:
+	 * each feedback value is off by up to one packet per window, but
+	 * no byte is lost between windows so the error does not build up */
+	_audio_ctx.dac.played += _audio_ctx.dac.pending;
+	_audio_ctx.dac.pending = 0;
+#endif
+
 	if (_audio_ctx.circ.count > 0) {
 		_audio_ctx.circ.tx = (_audio_ctx.circ.tx + 1) % BUFFERS;
 		_audio_ctx.circ.count--;
 		/* Load next buffer */
+#ifdef CONFIG_USB_AUDIO_ASYNC
+		_audio_ctx.dac.pending = _audio_ctx.samples[_audio_ctx.circ.tx];
+#endif
 		callback_set(&_cb, _audio_transfer_callback, desc);
 		audio_transfer(desc,
 			       _buffer[_audio_ctx.circ.tx],
@@ -253,11 +278,20 @@ static void _usb_frame_recv_callback(void* arg, uint8_t status, uint32_t transfe
 			if (!_audio_ctx.playing) {
 				audio_enable(desc, true);
 				_audio_ctx.playing = true;
+#ifdef CONFIG_USB_AUDIO_ASYNC
+				/* Restart the codec rate measurement */
+				audd_speaker_driver_feedback_initialize(
+					AUDDSpeakerDriver_SAMPLERATE,
+					AUDDSpeakerDriver_BYTESPERSUBFRAME, 32);
+#endif
 			}
 			if (audio_transfer_is_done(&audio_device)) {
 				struct _callback _cb;
 
 				/* Start DAC transmission if necessary */
+#ifdef CONFIG_USB_AUDIO_ASYNC
+				_audio_ctx.dac.pending = _audio_ctx.samples[_audio_ctx.circ.tx];
+#endif
 				callback_set(&_cb, _audio_transfer_callback, desc);
 				audio_transfer(desc,
 					       _buffer[_audio_ctx.circ.tx],
@@ -267,6 +301,11 @@ static void _usb_frame_recv_callback(void* arg, uint8_t status, uint32_t transfe
 				_audio_ctx.circ.count--;
 			}
 		}
+#ifdef CONFIG_USB_AUDIO_ASYNC
+		/* Report the codec rate to the host */
+		if (_audio_ctx.playing)
+			audd_speaker_driver_feedback_update(_audio_ctx.dac.played);
+#endif
 	} else if (status == USBD_STATUS_ABORTED) {
 		/* Error , ABORT, add NULL buffer */
 		_audio_ctx.samples[_audio_ctx.circ.rx] = 0;
@@ -276,7 +315,7 @@ static void _usb_frame_recv_callback(void* arg, uint8_t status, uint32_t transfe
 
 	/* Receive next packet */
 	audd_speaker_driver_read(_buffer[_audio_ctx.circ.rx],
-				 AUDDSpeakerDriver_BYTESPERFRAME,
+				 AUDDSpeakerDriver_MAXBYTESPERFRAME,
 				 _usb_frame_recv_callback, desc);
 }
 
@@ -426,6 +465,9 @@ void audd_speaker_driver_stream_setting_changed(uint8_t new_setting)
 		_audio_ctx.circ.count = 0;
 		_audio_ctx.circ.tx = 0;
 		_audio_ctx.circ.rx = 0;
+#ifdef CONFIG_USB_AUDIO_ASYNC
+		_audio_ctx.dac.pending = 0;
+#endif
 	}
 }
 
@@ -442,8 +484,10 @@ int main(void)
 {
 	bool usb_conn = false;
 
+#ifndef CONFIG_USB_AUDIO_ASYNC
 	int32_t jitter = 0, _jitter_curr;
 	int8_t clock_adjust = 0;
+#endif
 
 	console_set_rx_handler(console_handler);
 	console_enable_rx_interrupt();
@@ -483,6 +527,8 @@ int main(void)
 			continue;
 		}
 
+#ifndef CONFIG_USB_AUDIO_ASYNC
+		/* Synchronous stream: the codec clock follows the host */
 		_jitter_curr = (_audio_ctx.circ.count - _audio_ctx.threshold);
 
 		if (jitter != _jitter_curr) {
@@ -498,12 +544,13 @@ int main(void)
 				audio_sync_adjust(&audio_device, clock_adjust);
 			}
 		}
+#endif
 
 		if (!usb_conn) {
 			trace_info("USB connected\r\n");
 			/* Start Reading the incoming audio stream */
 			audd_speaker_driver_read(_buffer[_audio_ctx.circ.rx],
-					AUDDSpeakerDriver_BYTESPERFRAME,
+					AUDDSpeakerDriver_MAXBYTESPERFRAME,
 					_usb_frame_recv_callback, &audio_device);
 
 			usb_conn = true;
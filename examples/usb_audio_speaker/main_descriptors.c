@@ -41,6 +41,32 @@
 
 #include "main_descriptors.h"
 
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#ifdef CONFIG_USB_AUDIO_ASYNC
+/** Descriptors of the asynchronous speaker, with a feedback endpoint. */
+typedef AUDDSpeakerDriverAsyncConfigurationDescriptors _speaker_config_desc;
+/** Number of endpoints of the streaming interface. */
+#define STREAMING_NUM_ENDPOINTS 2
+/** Attributes of the streaming out endpoint. */
+#define STREAMING_EP_ATTRIBUTES (USBEndpointDescriptor_ISOCHRONOUS | \
+		USBEndpointDescriptor_Asynchronous_ISOCHRONOUS)
+/** Address of the feedback endpoint of the streaming out endpoint. */
+#define STREAMING_EP_SYNC_ADDRESS USBEndpointDescriptor_ADDRESS( \
+		USBEndpointDescriptor_IN, AUDDSpeakerDriverDescriptors_FEEDBACK)
+#else
+/** Descriptors of the synchronous speaker. */
+typedef AUDDSpeakerDriverConfigurationDescriptors _speaker_config_desc;
+/** Number of endpoints of the streaming interface. */
+#define STREAMING_NUM_ENDPOINTS 1
+/** Attributes of the streaming out endpoint. */
+#define STREAMING_EP_ATTRIBUTES USBEndpointDescriptor_ISOCHRONOUS
+/** No feedback endpoint. */
+#define STREAMING_EP_SYNC_ADDRESS 0
+#endif
+
 /*----------------------------------------------------------------------------
  *         Exported variables
  *----------------------------------------------------------------------------*/
@@ -79,13 +105,13 @@ static const USBDeviceQualifierDescriptor qualifierDescriptor = {
 	0x00
 };
 /** Configuration descriptors for a USB audio speaker driver. */
-const AUDDSpeakerDriverConfigurationDescriptors fsConfigurationDescriptors = {
+const _speaker_config_desc fsConfigurationDescriptors = {
 
 	/* Configuration descriptor */
 	{
 		sizeof(USBConfigurationDescriptor),
 		USBGenericDescriptor_CONFIGURATION,
-		sizeof(AUDDSpeakerDriverConfigurationDescriptors),
+		sizeof(_speaker_config_desc),
 		2, /* This configuration has 2 interfaces */
 		1, /* This is configuration #1 */
 		0, /* No string descriptor */
@@ -179,7 +205,7 @@ const AUDDSpeakerDriverConfigurationDescriptors fsConfigurationDescriptors = {
 		USBGenericDescriptor_INTERFACE,
 		AUDDSpeakerDriverDescriptors_STREAMING,
 		1, /* This is alternate setting #1 */
-		1, /* This interface uses 1 endpoint */
+		STREAMING_NUM_ENDPOINTS, /* Data (and feedback) endpoints */
 		AUDStreamingInterfaceDescriptor_CLASS,
 		AUDStreamingInterfaceDescriptor_SUBCLASS,
 		AUDStreamingInterfaceDescriptor_PROTOCOL,
@@ -219,11 +245,11 @@ const AUDDSpeakerDriverConfigurationDescriptors fsConfigurationDescriptors = {
 		USBEndpointDescriptor_ADDRESS(
 			USBEndpointDescriptor_OUT,
 			AUDDSpeakerDriverDescriptors_DATAOUT),
-		USBEndpointDescriptor_ISOCHRONOUS,
-		AUDDSpeakerDriver_BYTESPERFRAME,
+		STREAMING_EP_ATTRIBUTES,
+		AUDDSpeakerDriver_MAXBYTESPERFRAME,
 		AUDDSpeakerDriverDescriptors_FS_INTERVAL, /* Polling interval = 1 ms */
 		0, /* This is not a synchronization endpoint */
-		0  /* No associated synchronization endpoint */
+		STREAMING_EP_SYNC_ADDRESS
 	},
 	/* Audio streaming endpoint class-specific descriptor */
 	{
@@ -233,17 +259,33 @@ const AUDDSpeakerDriverConfigurationDescriptors fsConfigurationDescriptors = {
 		0, /* No attributes */
 		0, /* Endpoint is not synchronized */
 		0  /* Endpoint is not synchronized */
+	},
+#ifdef CONFIG_USB_AUDIO_ASYNC
+	/* Audio streaming feedback endpoint standard descriptor */
+	{
+		sizeof(AUDEndpointDescriptor),
+		USBGenericDescriptor_ENDPOINT,
+		USBEndpointDescriptor_ADDRESS(
+			USBEndpointDescriptor_IN,
+			AUDDSpeakerDriverDescriptors_FEEDBACK),
+		USBEndpointDescriptor_ISOCHRONOUS
+		| USBEndpointDescriptor_Feedback_ISOCHRONOUS,
+		AUDFeedbackEndpoint_FS_SIZE,
+		AUDDSpeakerDriverDescriptors_FS_INTERVAL, /* Polling interval = 1 ms */
+		AUDDSpeakerDriverDescriptors_FB_REFRESH,
+		0  /* No associated synchronization endpoint */
 	}
+#endif
 };
 
 /** Configuration descriptors for a USB audio speaker driver. */
-const AUDDSpeakerDriverConfigurationDescriptors hsConfigurationDescriptors = {
+const _speaker_config_desc hsConfigurationDescriptors = {
 
 	/* Configuration descriptor */
 	{
 		sizeof(USBConfigurationDescriptor),
 		USBGenericDescriptor_CONFIGURATION,
-		sizeof(AUDDSpeakerDriverConfigurationDescriptors),
+		sizeof(_speaker_config_desc),
 		2, /* This configuration has 2 interfaces */
 		1, /* This is configuration #1 */
 		0, /* No string descriptor */
@@ -337,7 +379,7 @@ const AUDDSpeakerDriverConfigurationDescriptors hsConfigurationDescriptors = {
 		USBGenericDescriptor_INTERFACE,
 		AUDDSpeakerDriverDescriptors_STREAMING,
 		1, /* This is alternate setting #1 */
-		1, /* This interface uses 1 endpoint */
+		STREAMING_NUM_ENDPOINTS, /* Data (and feedback) endpoints */
 		AUDStreamingInterfaceDescriptor_CLASS,
 		AUDStreamingInterfaceDescriptor_SUBCLASS,
 		AUDStreamingInterfaceDescriptor_PROTOCOL,
@@ -377,11 +419,11 @@ const AUDDSpeakerDriverConfigurationDescriptors hsConfigurationDescriptors = {
 		USBEndpointDescriptor_ADDRESS(
 			USBEndpointDescriptor_OUT,
 			AUDDSpeakerDriverDescriptors_DATAOUT),
-		USBEndpointDescriptor_ISOCHRONOUS,
-		AUDDSpeakerDriver_BYTESPERFRAME,
+		STREAMING_EP_ATTRIBUTES,
+		AUDDSpeakerDriver_MAXBYTESPERFRAME,
 		AUDDSpeakerDriverDescriptors_HS_INTERVAL, /* Polling interval = 1 ms */
 		0, /* This is not a synchronization endpoint */
-		0  /* No associated synchronization endpoint */
+		STREAMING_EP_SYNC_ADDRESS
 	},
 	/* Audio streaming endpoint class-specific descriptor */
 	{
@@ -391,7 +433,23 @@ const AUDDSpeakerDriverConfigurationDescriptors hsConfigurationDescriptors = {
 		0, /* No attributes */
 		0, /* Endpoint is not synchronized */
 		0  /* Endpoint is not synchronized */
+	},
+#ifdef CONFIG_USB_AUDIO_ASYNC
+	/* Audio streaming feedback endpoint standard descriptor */
+	{
+		sizeof(AUDEndpointDescriptor),
+		USBGenericDescriptor_ENDPOINT,
+		USBEndpointDescriptor_ADDRESS(
+			USBEndpointDescriptor_IN,
+			AUDDSpeakerDriverDescriptors_FEEDBACK),
+		USBEndpointDescriptor_ISOCHRONOUS
+		| USBEndpointDescriptor_Feedback_ISOCHRONOUS,
+		AUDFeedbackEndpoint_HS_SIZE,
+		AUDDSpeakerDriverDescriptors_HS_INTERVAL, /* Polling interval = 1 ms */
+		AUDDSpeakerDriverDescriptors_FB_REFRESH,
+		0  /* No associated synchronization endpoint */
 	}
+#endif
 };
 
 /** String descriptor with the supported languages. */
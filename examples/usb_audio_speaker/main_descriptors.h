@@ -56,6 +56,7 @@
  * - \ref AUDDSpeakerDriver_BITSPERSAMPLE
  * - \ref AUDDSpeakerDriver_SAMPLESPERFRAME
  * - \ref AUDDSpeakerDriver_BYTESPERFRAME
+ * - \ref AUDDSpeakerDriver_MAXBYTESPERFRAME
  */
 
 /** Sample rate in Hz. */
@@ -75,6 +76,15 @@
 /** Number of bytes in one USB frame. */
 #define AUDDSpeakerDriver_BYTESPERFRAME     (AUDDSpeakerDriver_SAMPLESPERFRAME * \
 		AUDDSpeakerDriver_BYTESPERSAMPLE)
+#ifdef CONFIG_USB_AUDIO_ASYNC
+/** Maximum number of bytes in one USB frame: the host may send one more
+    subframe than nominal to follow the feedback. */
+#define AUDDSpeakerDriver_MAXBYTESPERFRAME  (AUDDSpeakerDriver_BYTESPERFRAME + \
+		AUDDSpeakerDriver_BYTESPERSUBFRAME)
+#else
+/** Maximum number of bytes in one USB frame. */
+#define AUDDSpeakerDriver_MAXBYTESPERFRAME  AUDDSpeakerDriver_BYTESPERFRAME
+#endif
 /**     @}*/
 
 /** \addtogroup usbd_audio_id USB Device Audio Speaker Codes
@@ -99,6 +109,8 @@
  * - \ref AUDDSpeakerDriverDescriptors_DATAOUT
  * - \ref AUDDSpeakerDriverDescriptors_FS_INTERVAL
  * - \ref AUDDSpeakerDriverDescriptors_HS_INTERVAL
+ * - \ref AUDDSpeakerDriverDescriptors_FEEDBACK
+ * - \ref AUDDSpeakerDriverDescriptors_FB_REFRESH
  *
  * \note for UDP, uses IN EPs that support double buffer; for UDPHS, uses
  *       IN EPs that support DMA and High bandwidth.
@@ -109,6 +121,12 @@
 #define AUDDSpeakerDriverDescriptors_HS_INTERVAL        0x04
 /** Endpoint polling interval 2^(x-1) * ms */
 #define AUDDSpeakerDriverDescriptors_FS_INTERVAL        0x01
+#ifdef CONFIG_USB_AUDIO_ASYNC
+/** Feedback in endpoint number. */
+#define AUDDSpeakerDriverDescriptors_FEEDBACK           0x01
+/** Feedback refresh period 2^x ms */
+#define AUDDSpeakerDriverDescriptors_FB_REFRESH         0x05
+#endif
 /**     @}*/
 
 /**@}*/
@@ -61,6 +61,7 @@
 #include "lwip/stats.h"
 #include "lwip/sys.h"
 #include "timer.h"
+#include "timer_wheel.h"
 
 /*----------------------------------------------------------------------------
  *        Definitions
@@ -76,7 +77,7 @@
 
 /* Timer for calling lwIP tmr functions without system */
 typedef struct _timers_info {
-	uint32_t timer;
+	struct _wheel_timer timer;
 	uint32_t timer_interval;
 	void (*timer_func)(void);
 } timers_info;
@@ -89,17 +90,17 @@ typedef struct _timers_info {
 static timers_info timers_table[] = {
 	/* LWIP_TCP */
 #if LWIP_TCP
-	{ 0, TCP_FAST_INTERVAL,     tcp_fasttmr},
-	{ 0, TCP_SLOW_INTERVAL,     tcp_slowtmr},
+	{ .timer_interval = TCP_FAST_INTERVAL,       .timer_func = tcp_fasttmr },
+	{ .timer_interval = TCP_SLOW_INTERVAL,       .timer_func = tcp_slowtmr },
 #endif
 	/* LWIP_ARP */
 #if LWIP_ARP
-	{ 0, ARP_TMR_INTERVAL,      etharp_tmr},
+	{ .timer_interval = ARP_TMR_INTERVAL,        .timer_func = etharp_tmr },
 #endif
 	/* LWIP_DHCP */
 #if LWIP_DHCP
-	{ 0, DHCP_COARSE_TIMER_SECS, dhcp_coarse_tmr},
-	{ 0, DHCP_FINE_TIMER_MSECS,  dhcp_fine_tmr},
+	{ .timer_interval = DHCP_COARSE_TIMER_MSECS, .timer_func = dhcp_coarse_tmr },
+	{ .timer_interval = DHCP_FINE_TIMER_MSECS,   .timer_func = dhcp_fine_tmr },
 #endif
 };
 
@@ -107,34 +108,33 @@ static timers_info timers_table[] = {
  *        Local functions
  *----------------------------------------------------------------------------*/
 
+static int timers_callback(void* arg)
+{
+	timers_info* ptmr_inf = (timers_info*)arg;
+
+	ptmr_inf->timer_func();
+	return 0;
+}
+
 /**
- * Process timing functions
+ * Schedule lwIP timing functions on the timer wheel. They are run as
+ * deferred callbacks from ethif_poll() as lwIP is not reentrant.
  */
-static void timers_update(void)
+static void timers_start(void)
 {
-	static uint32_t last_time;
-	uint32_t cur_time, time_diff, idxtimer;
+	struct _callback cb;
+	uint32_t idxtimer;
 	timers_info * ptmr_inf;
 
-	cur_time = timer_get_tick();
-	if (cur_time >= last_time)
-		time_diff = cur_time - last_time;
-	else
-		time_diff = 0xFFFFFFFF - last_time + cur_time;
-
-	if (time_diff) {
-		last_time = cur_time;
-		for (idxtimer = 0;
-			idxtimer < (sizeof(timers_table)/sizeof(timers_info));
-			idxtimer++) {
-			ptmr_inf = &timers_table[idxtimer];
-			ptmr_inf->timer += time_diff;
-			if (ptmr_inf->timer > ptmr_inf->timer_interval) {
-				if (ptmr_inf->timer_func)
-					ptmr_inf->timer_func();
-				ptmr_inf->timer -= ptmr_inf->timer_interval;
-			}
-		}
+	for (idxtimer = 0; idxtimer < ARRAY_SIZE(timers_table); idxtimer++) {
+		ptmr_inf = &timers_table[idxtimer];
+		if (timer_wheel_is_pending(&ptmr_inf->timer))
+			continue;
+		callback_set(&cb, timers_callback, ptmr_inf);
+		timer_wheel_init_timer(&ptmr_inf->timer, &cb,
+				       TIMER_WHEEL_DEFERRED);
+		timer_wheel_add(&ptmr_inf->timer, ptmr_inf->timer_interval,
+				ptmr_inf->timer_interval);
 	}
 }
 
@@ -337,6 +337,7 @@ err_t ethif_init(struct netif *netif)
 	netif->linkoutput = glow_level_output;
 	glow_level_init(netif, board_get_eth(netif->num));
 	etharp_init();
+	timers_start();
 	return ERR_OK;
 }
 
@@ -348,7 +349,7 @@ err_t ethif_init(struct netif *netif)
 void ethif_poll(struct netif *netif)
 {
 	/* Run periodic tasks */
-	timers_update();
+	timer_wheel_process();
 
 	ethif_input(netif);
 }
@@ -207,6 +207,20 @@
 #define AUDDataEndpointDescriptor_PCMSAMPLES                2
 /**     @}*/
 
+/** \addtogroup usb_audio_feedback USB Audio feedback endpoint
+ *      @{
+ * Size of the value returned by an isochronous feedback endpoint
+ * (samples per frame): 10.14 format in full speed, 16.16 format in high
+ * speed (samples per microframe).
+ * - \ref AUDFeedbackEndpoint_FS_SIZE
+ * - \ref AUDFeedbackEndpoint_HS_SIZE
+ */
+/** Feedback value size in full speed (10.14 format). */
+#define AUDFeedbackEndpoint_FS_SIZE                         3
+/** Feedback value size in high speed (16.16 format). */
+#define AUDFeedbackEndpoint_HS_SIZE                         4
+/**     @}*/
+
 
 /** \addtogroup usb_audio_class_ver USB Audio class releases
  *      @{
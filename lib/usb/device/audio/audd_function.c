@@ -59,6 +59,8 @@ typedef struct _AUDDFunction {
 	AUDDStream  speaker;
 	/** Stream instance for microphone */
 	AUDDStream  mic;
+	/** Feedback state for asynchronous speaker */
+	AUDDFeedback feedback;
 } AUDDFunction;
 
 /*----------------------------------------------------------------------------
@@ -151,6 +153,8 @@ void audd_function_interface_setting_changed_handler(uint8_t interface,
 	AUDDFunction *p_audf = &audd_function;
 	AUDDSpeakerPhone *p_drv = &p_audf->drv;
 	if (setting == 0) audd_speaker_phone_close_stream(p_drv, interface);
+	if (interface == p_drv->pSpeaker->bAsInterface)
+		p_audf->feedback.bStarted = 0;
 	if (NULL != (void *)audd_function_stream_setting_changed) {
 		uint8_t mic = (interface == p_drv->pMicrophone->bAsInterface);
 		audd_function_stream_setting_changed(mic, setting);
@@ -221,5 +225,34 @@ uint8_t audd_function_write(void* buffer, uint16_t length)
 	return audd_speaker_phone_write(p_drv, buffer, length);
 }
 
+/**
+ * Initialize the feedback of the asynchronous speaker stream.
+ * Should be invoked when the device is configured.
+ * \param sample_rate Nominal sample rate in Hz.
+ * \param ticks_per_sample Number of counter ticks per sample.
+ * \param counter_bits Width of the counter measuring the codec clock.
+ */
+void audd_function_feedback_initialize(uint32_t sample_rate,
+		uint32_t ticks_per_sample, uint8_t counter_bits)
+{
+	AUDDFunction *p_audf = &audd_function;
+
+	audd_stream_feedback_initialize(&p_audf->speaker, &p_audf->feedback,
+			sample_rate, ticks_per_sample, counter_bits);
+}
+
+/**
+ * Update the measured codec rate and send it on the feedback endpoint.
+ * \param count Current value of the counter measuring the codec clock.
+ * \return Feedback value currently reported to the host.
+ */
+uint32_t audd_function_feedback_update(uint32_t count)
+{
+	AUDDFunction *p_audf = &audd_function;
+
+	return audd_stream_feedback_update(&p_audf->speaker,
+			&p_audf->feedback, count);
+}
+
 /**@}*/
 
@@ -97,6 +97,9 @@ extern uint8_t audd_function_setup_write(
 	void * pListInit, uint16_t listSize, uint16_t delaySize,
 	usbd_xfer_cb_t callback,void * argument);
 extern uint8_t audd_function_write(void * buffer, uint16_t length);
+extern void audd_function_feedback_initialize(
+	uint32_t sample_rate, uint32_t ticks_per_sample, uint8_t counter_bits);
+extern uint32_t audd_function_feedback_update(uint32_t count);
 
 extern void audd_function_mute_changed(
 	uint8_t idMic, uint8_t ch, uint8_t mute);
@@ -58,6 +58,9 @@ typedef struct _AUDDSpeakerDriver {
 	/** Stream instance for speaker */
 	AUDDStream speaker;
 
+	/** Feedback state for asynchronous speaker */
+	AUDDFeedback feedback;
+
 	/** Array for storing the current setting of each interface */
 	uint8_t b_alt_interfaces[AUDDSpeakerDriver_NUMINTERFACES];
 } AUDDSpeakerDriver;
@@ -164,6 +167,10 @@ void audd_speaker_driver_interface_setting_changed_handler(uint8_t interface,
 		audd_speaker_phone_close_stream(p_audf, interface);
 	}
 
+	/* Restart feedback measurement with the stream */
+	if (interface == p_audf->pSpeaker->bAsInterface)
+		p_speakerd->feedback.bStarted = 0;
+
 	if (NULL != (void*)audd_speaker_driver_stream_setting_changed)
 		audd_speaker_driver_stream_setting_changed(setting);
 }
@@ -220,4 +227,33 @@ uint8_t audd_speaker_driver_read(void *buffer, uint32_t length,
 			buffer, length, callback, argument);
 }
 
+/**
+ * Initialize the feedback of the asynchronous speaker stream.
+ * Should be invoked when the device is configured.
+ * \param sample_rate Nominal sample rate in Hz.
+ * \param ticks_per_sample Number of counter ticks per sample.
+ * \param counter_bits Width of the counter measuring the codec clock.
+ */
+void audd_speaker_driver_feedback_initialize(uint32_t sample_rate,
+		uint32_t ticks_per_sample, uint8_t counter_bits)
+{
+	AUDDSpeakerDriver *p_audd = &audd_speaker_driver;
+
+	audd_stream_feedback_initialize(&p_audd->speaker, &p_audd->feedback,
+			sample_rate, ticks_per_sample, counter_bits);
+}
+
+/**
+ * Update the measured codec rate and send it on the feedback endpoint.
+ * \param count Current value of the counter measuring the codec clock.
+ * \return Feedback value currently reported to the host.
+ */
+uint32_t audd_speaker_driver_feedback_update(uint32_t count)
+{
+	AUDDSpeakerDriver *p_audd = &audd_speaker_driver;
+
+	return audd_stream_feedback_update(&p_audd->speaker,
+			&p_audd->feedback, count);
+}
+
 /**@}*/
@@ -218,6 +218,38 @@ typedef PACKED_STRUCT _AUDDSpeakerDriverConfigurationDescriptors {
 
 } AUDDSpeakerDriverConfigurationDescriptors;
 
+/**
+ * \typedef AUDDSpeakerDriverAsyncConfigurationDescriptors
+ * \brief Holds a list of descriptors returned as part of the configuration of
+ *        a USB audio speaker device with an asynchronous streaming out
+ *        endpoint and its explicit feedback endpoint.
+ */
+typedef PACKED_STRUCT _AUDDSpeakerDriverAsyncConfigurationDescriptors {
+
+	/** Standard configuration. */
+	USBConfigurationDescriptor configuration;
+	/** Audio control interface. */
+	USBInterfaceDescriptor control;
+	/** Descriptors for the audio control interface. */
+	AUDDSpeakerDriverAudioControlDescriptors controlDescriptors;
+	/* - AUDIO OUT */
+	/** Streaming out interface descriptor (with no endpoint, required). */
+	USBInterfaceDescriptor streamingOutNoIsochronous;
+	/** Streaming out interface descriptor. */
+	USBInterfaceDescriptor streamingOut;
+	/** Audio class descriptor for the streaming out interface. */
+	AUDStreamingInterfaceDescriptor streamingOutClass;
+	/** Stream format descriptor. */
+	AUDFormatTypeOneDescriptor1 streamingOutFormatType;
+	/** Streaming out endpoint descriptor. */
+	AUDEndpointDescriptor streamingOutEndpoint;
+	/** Audio class descriptor for the streaming out endpoint. */
+	AUDDataEndpointDescriptor streamingOutDataEndpoint;
+	/** Feedback endpoint descriptor of the streaming out endpoint. */
+	AUDEndpointDescriptor streamingOutFeedbackEndpoint;
+
+} AUDDSpeakerDriverAsyncConfigurationDescriptors;
+
 /*----------------------------------------------------------------------------
  *         Exported functions
  *----------------------------------------------------------------------------*/
@@ -237,6 +269,11 @@ extern uint8_t audd_speaker_driver_read(void *buffer,
 									  usbd_xfer_cb_t callback,
 									  void *argument);
 
+extern void audd_speaker_driver_feedback_initialize(uint32_t sample_rate,
+		uint32_t ticks_per_sample, uint8_t counter_bits);
+
+extern uint32_t audd_speaker_driver_feedback_update(uint32_t count);
+
 extern void audd_speaker_driver_mute_changed(uint8_t channel,uint8_t muted);
 
 extern void audd_speaker_driver_stream_setting_changed(uint8_t newSetting);
@@ -40,6 +40,9 @@
  *         Headers
  *------------------------------------------------------------------------------*/
 
+#include <stdbool.h>
+
+#include "intmath.h"
 #include "trace.h"
 
 #include "usb/common/audio/aud_descriptors.h"
@@ -134,15 +137,30 @@ static uint32_t audd_speaker_phone_parse(USBGenericDescriptor *desc,
 		/* Find Streaming Interface & Endpoints */
 		if (desc->bDescriptorType == USBGenericDescriptor_ENDPOINT
 			&& (pEp->bmAttributes & 0x3) == USBEndpointDescriptor_ISOCHRONOUS) {
-			if (pEp->bEndpointAddress & 0x80 && p_mic) {
+			AUDEndpointDescriptor *p_aud_ep = (AUDEndpointDescriptor*)desc;
+			bool audio_ep = desc->bLength >= sizeof(AUDEndpointDescriptor);
+			if (p_speaker && (pEp->bEndpointAddress & 0x80) &&
+				((pEp->bmAttributes & USBEndpointDescriptor_USAGE_MASK)
+					== USBEndpointDescriptor_Feedback_ISOCHRONOUS ||
+				 p_speaker->bEndpointFeedback == (pEp->bEndpointAddress & 0x7F))) {
+				/* Feedback endpoint of the asynchronous speaker */
+				p_speaker->bEndpointFeedback = pEp->bEndpointAddress & 0x7F;
+				if (audio_ep)
+					p_speaker->bFeedbackRefresh = p_aud_ep->bRefresh;
+			}
+			else if (pEp->bEndpointAddress & 0x80 && p_mic) {
 				p_mic->bEndpointIn = pEp->bEndpointAddress & 0x7F;
 				p_mic->bAsInterface = p_arg->p_if_desc->bInterfaceNumber;
 				/* Fixed FU */
 				p_mic->bFeatureUnitIn = AUDD_ID_MicrophoneFU;
 			}
-			else if (p_speaker) {
+			else if (p_speaker && !(pEp->bEndpointAddress & 0x80)) {
 				p_speaker->bEndpointOut = pEp->bEndpointAddress;
 				p_speaker->bAsInterface = p_arg->p_if_desc->bInterfaceNumber;
+				/* Associated feedback endpoint, if asynchronous */
+				if (audio_ep && p_aud_ep->bSyncAddress)
+					p_speaker->bEndpointFeedback =
+						p_aud_ep->bSyncAddress & 0x7F;
 				/* Fixed FU */
 				p_speaker->bFeatureUnitOut = AUDD_ID_SpeakerFU;
 			}
@@ -313,6 +331,17 @@ static void audd_get_cur(AUDDSpeakerPhone *p_audf, const USBGenericRequest *requ
 	}
 }
 
+/**
+ * Callback invoked when the feedback value has been sent.
+ */
+static void audd_feedback_sent(void *arg, uint8_t status,
+		uint32_t transferred, uint32_t remaining)
+{
+	AUDDFeedback *feedback = (AUDDFeedback*)arg;
+
+	feedback->bPending = 0;
+}
+
 /*------------------------------------------------------------------------------
  *         Exported Functions
  *------------------------------------------------------------------------------*/
@@ -337,6 +366,8 @@ void audd_stream_initialize(AUDDStream *p_auds,
 	p_auds->bAsInterface    = 0xFF;
 	p_auds->bEndpointOut    = 0;
 	p_auds->bEndpointIn     = 0;
+	p_auds->bEndpointFeedback = 0;
+	p_auds->bFeedbackRefresh  = 0;
 
 	p_auds->bNumChannels   = num_channels;
 	p_auds->bmMute         = 0;
@@ -506,11 +537,133 @@ uint32_t audd_stream_close(AUDDStream *stream)
 		bm_eps |= 1 << stream->bEndpointOut;
 	}
 
+	/* Close feedback endpoint */
+	if (stream->bEndpointFeedback) {
+		bm_eps |= 1 << stream->bEndpointFeedback;
+	}
+
 	usbd_hal_reset_endpoints(bm_eps, USBRC_CANCELED, 1);
 
 	return USBRC_SUCCESS;
 }
 
+/**
+ * Initialize the feedback state of an asynchronous OUT stream.
+ * Must be called once the device is configured, as the feedback format
+ * depends on the bus speed.
+ * \param p_auds  Pointer to AUDDStream instance.
+ * \param feedback  Pointer to AUDDFeedback instance.
+ * \param sample_rate  Nominal sample rate in Hz.
+ * \param ticks_per_sample  Number of counter ticks per sample.
+ * \param counter_bits  Width of the counter in bits (16 or 32 for TC).
+ */
+void audd_stream_feedback_initialize(AUDDStream *p_auds,
+		AUDDFeedback *feedback, uint32_t sample_rate,
+		uint32_t ticks_per_sample, uint8_t counter_bits)
+{
+	(void)p_auds;
+
+	feedback->dwTicksPerSample = ticks_per_sample;
+	if (counter_bits >= 32)
+		feedback->dwCounterMask = 0xFFFFFFFF;
+	else
+		feedback->dwCounterMask = (1u << counter_bits) - 1;
+
+	/* Samples per microframe in 16.16 or per frame in 10.14 */
+	if (usbd_hal_is_high_speed())
+		feedback->dwNominal = ((uint64_t)sample_rate << 16) / 8000;
+	else
+		feedback->dwNominal = ((uint64_t)sample_rate << 14) / 1000;
+
+	feedback->dwValue    = feedback->dwNominal;
+	feedback->dwUpdates  = 0;
+	feedback->wAccFrames = 0;
+	feedback->dwAccTicks = 0;
+	feedback->bStarted   = 0;
+	feedback->bPending   = 0;
+}
+
+/**
+ * Update the measured device sample rate and queue it on the feedback
+ * endpoint.
+ *
+ * To be called periodically, at least every few frames (for example from
+ * the streaming OUT endpoint callback), with the current value of the
+ * counter clocked by the codec.  Elapsed time is taken from the USB frame
+ * number so missed calls only lengthen the measurement window.
+ *
+ * \param p_auds  Pointer to AUDDStream instance.
+ * \param feedback  Pointer to AUDDFeedback instance.
+ * \param count  Current counter value.
+ * \return Feedback value currently reported to the host.
+ */
+uint32_t audd_stream_feedback_update(AUDDStream *p_auds,
+		AUDDFeedback *feedback, uint32_t count)
+{
+	bool high_speed = usbd_hal_is_high_speed();
+	uint16_t frame = usbd_hal_get_frame_number();
+	uint16_t frame_mask = high_speed ? 0x3FFF : 0x7FF;
+	uint32_t window;
+	uint16_t elapsed;
+
+	if (!feedback->bStarted) {
+		feedback->wLastFrame  = frame;
+		feedback->dwLastCount = count;
+		feedback->bStarted    = 1;
+		return feedback->dwValue;
+	}
+
+	elapsed = (frame - feedback->wLastFrame) & frame_mask;
+	if (elapsed == 0)
+		return feedback->dwValue;
+
+	feedback->dwAccTicks += (count - feedback->dwLastCount) &
+		feedback->dwCounterMask;
+	feedback->wAccFrames += elapsed;
+	feedback->wLastFrame  = frame;
+	feedback->dwLastCount = count;
+
+	/* Measurement window: at least the feedback refresh period */
+	window = max_u32(1 << p_auds->bFeedbackRefresh,
+			AUDD_FEEDBACK_MIN_WINDOW);
+	if (high_speed)
+		window *= 8;
+
+	if (feedback->wAccFrames >= window) {
+		uint64_t value = (uint64_t)feedback->dwAccTicks <<
+			(high_speed ? 16 : 14);
+		value /= (uint64_t)feedback->dwTicksPerSample *
+			feedback->wAccFrames;
+
+		/* Discard measurements too far (>1/8) from nominal, most
+		 * likely caused by a stopped or resynchronizing clock */
+		if (value > feedback->dwNominal - (feedback->dwNominal >> 3) &&
+		    value < feedback->dwNominal + (feedback->dwNominal >> 3)) {
+			feedback->dwValue = value;
+			feedback->dwUpdates++;
+		}
+		feedback->wAccFrames = 0;
+		feedback->dwAccTicks = 0;
+	}
+
+	if (p_auds->bEndpointFeedback && !feedback->bPending) {
+		uint32_t length = high_speed ? AUDFeedbackEndpoint_HS_SIZE
+					     : AUDFeedbackEndpoint_FS_SIZE;
+
+		feedback->pBuffer[0] = feedback->dwValue;
+		feedback->pBuffer[1] = feedback->dwValue >> 8;
+		feedback->pBuffer[2] = feedback->dwValue >> 16;
+		feedback->pBuffer[3] = feedback->dwValue >> 24;
+		feedback->bPending = 1;
+		if (usbd_write(p_auds->bEndpointFeedback, feedback->pBuffer,
+				length, audd_feedback_sent, feedback)
+				!= USBD_STATUS_SUCCESS)
+			feedback->bPending = 0;
+	}
+
+	return feedback->dwValue;
+}
+
 /*
  *          Audio Speakerphone functions
  */
@@ -536,6 +689,8 @@ void audd_speaker_phone_initializeStream(AUDDStream *p_auds,
 	p_auds->bAsInterface    = 0xFF;
 	p_auds->bEndpointOut    = 0;
 	p_auds->bEndpointIn     = 0;
+	p_auds->bEndpointFeedback = 0;
+	p_auds->bFeedbackRefresh  = 0;
 
 	p_auds->bNumChannels   = numChannels;
 	p_auds->bmMute         = 0;
@@ -63,6 +63,11 @@
 #define AUDD_EC_VolumeChanged       2
 /**     @}*/
 
+/** Minimum length of a feedback measurement window, in 1ms frames */
+#ifndef AUDD_FEEDBACK_MIN_WINDOW
+#define AUDD_FEEDBACK_MIN_WINDOW    128
+#endif
+
 /*------------------------------------------------------------------------------
  *         Types
  *------------------------------------------------------------------------------*/
@@ -90,6 +95,11 @@ typedef struct _AUDDStream {
 	uint8_t     bEndpointOut;
 	/** Streaming IN  endpoint address */
 	uint8_t     bEndpointIn;
+	/** Feedback (synch) IN endpoint address, 0 if the stream is not
+	    asynchronous */
+	uint8_t     bEndpointFeedback;
+	/** Feedback endpoint refresh rate (2^bFeedbackRefresh frames) */
+	uint8_t     bFeedbackRefresh;
 	/** Number of channels (<=8) */
 	uint8_t     bNumChannels;
 	/** Mute control bits  (8b) */
@@ -103,6 +113,41 @@ typedef struct _AUDDStream {
 	void* pArg;
 } AUDDStream;
 
+/**
+ * Feedback state of an asynchronous OUT stream.
+ *
+ * The device sample clock is measured by a free-running counter (typically a
+ * TC clocked from the codec clock) sampled against the USB (micro)frame
+ * number.  The resulting rate is returned to the host on the feedback
+ * endpoint so that it sends exactly as many samples as the codec consumes.
+ */
+typedef struct _AUDDFeedback {
+	/** Counter ticks per audio sample (e.g. 256 when counting MCLK) */
+	uint32_t    dwTicksPerSample;
+	/** Mask of the significant counter bits */
+	uint32_t    dwCounterMask;
+	/** Counter value at the previous update */
+	uint32_t    dwLastCount;
+	/** Frame number at the previous update */
+	uint16_t    wLastFrame;
+	/** Frames elapsed in the current measurement window */
+	uint16_t    wAccFrames;
+	/** Counter ticks elapsed in the current measurement window */
+	uint32_t    dwAccTicks;
+	/** Feedback value currently reported (10.14 FS / 16.16 HS) */
+	uint32_t    dwValue;
+	/** Nominal feedback value */
+	uint32_t    dwNominal;
+	/** Number of feedback values computed */
+	uint32_t    dwUpdates;
+	/** A measurement window has been started */
+	uint8_t     bStarted;
+	/** A feedback transfer is pending */
+	volatile uint8_t bPending;
+	/** Buffer for the value sent on the feedback endpoint */
+	uint8_t     pBuffer[4];
+} AUDDFeedback;
+
 /*------------------------------------------------------------------------------
  *         Functions
  *------------------------------------------------------------------------------*/
@@ -145,5 +190,17 @@ extern uint32_t audd_stream_write(
 
 extern uint32_t audd_stream_close(AUDDStream * pStream);
 
+extern void audd_stream_feedback_initialize(
+	AUDDStream * pAuds,
+	AUDDFeedback * pFeedback,
+	uint32_t dwSampleRate,
+	uint32_t dwTicksPerSample,
+	uint8_t bCounterBits);
+
+extern uint32_t audd_stream_feedback_update(
+	AUDDStream * pAuds,
+	AUDDFeedback * pFeedback,
+	uint32_t dwCount);
+
 #endif /* _AUDD_STREAM_H_ */
 
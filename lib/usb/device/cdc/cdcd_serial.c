@@ -42,6 +42,7 @@
 #include "trace.h"
 
 #include "usb/device/cdc/cdcd_serial.h"
+#include "usb/device/cdc/cdcd_serial_stream.h"
 #include "usb/device/usbd_driver.h"
 
 /*------------------------------------------------------------------------------
@@ -68,6 +69,8 @@ static uint32_t cdcd_serial_event_handler(uint32_t event, uint32_t param)
 {
 	switch (event) {
 	case CDCDSerialPortEvent_SETCONTROLLINESTATE:
+		cdcd_serial_stream_control_line_changed(
+			(param & CDCControlLineState_DTR) > 0);
 		cdcd_serial_control_line_state_changed(
 			(param & CDCControlLineState_DTR) > 0,
 			(param & CDCControlLineState_RTS) > 0);
@@ -170,6 +173,14 @@ uint32_t cdcd_serial_write(void *data, uint32_t size,
 			callback, callback_arg);
 }
 
+/**
+ * Returns the serial port instance, for the layers built on top of it.
+ */
+const CDCDSerialPort *cdcd_serial_get_port(void)
+{
+	return &cdcd_serial;
+}
+
 /**
  * Returns the current control line state of the RS-232 line.
  */
@@ -0,0 +1,418 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**\file
+ * Implementation of the CDC serial streaming layer.
+ */
+
+/** \addtogroup usbd_cdc
+ *@{
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include "irqflags.h"
+#include "timer.h"
+#include "trace.h"
+
+#include "mm/cache.h"
+
+#include "usb/common/cdc/cdc_requests.h"
+#include "usb/device/cdc/cdcd_serial.h"
+#include "usb/device/cdc/cdcd_serial_stream.h"
+#include "usb/device/usbd.h"
+#include "usb/device/usbd_hal.h"
+
+#include <string.h>
+
+/*------------------------------------------------------------------------------
+ *         Definitions
+ *------------------------------------------------------------------------------*/
+
+#if (CDCD_STREAM_TX_SIZE & (CDCD_STREAM_TX_SIZE - 1)) != 0
+#error "CDCD_STREAM_TX_SIZE must be a power of two"
+#endif
+
+#if (CDCD_STREAM_RX_BUFFER_SIZE % CDCDSerialPort_BULK_MAXPACKETSIZE_HS) != 0
+#error "CDCD_STREAM_RX_BUFFER_SIZE must be a multiple of the HS packet size"
+#endif
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+struct _cdcd_stream {
+	bool started;
+	bool dtr;
+	uint8_t ep_in;
+	uint8_t ep_out;
+	uint16_t packet_size;
+
+	/* TX ring, free-running indexes */
+	volatile uint32_t tx_head;
+	volatile uint32_t tx_tail;
+	uint32_t tx_busy;      /**< bytes of the transfer in flight */
+	bool tx_zlp_busy;      /**< the transfer in flight is a ZLP */
+	bool tx_need_zlp;      /**< last transfer ended on a packet boundary */
+
+	/* RX buffers, filled and read in ring order */
+	uint16_t rx_length[CDCD_STREAM_RX_BUFFERS];
+	uint16_t rx_head;      /**< oldest filled buffer */
+	uint16_t rx_pos;       /**< bytes already read from rx_head */
+	volatile uint16_t rx_filled;
+
+	struct _cdcd_serial_stream_stats stats;
+	uint64_t rate_start;
+	uint32_t rate_tx_bytes;
+	uint32_t rate_rx_bytes;
+};
+
+/*------------------------------------------------------------------------------
+ *         Internal variables
+ *------------------------------------------------------------------------------*/
+
+static struct _cdcd_stream _stream;
+
+CACHE_ALIGNED static uint8_t _tx_ring[CDCD_STREAM_TX_SIZE];
+
+CACHE_ALIGNED static uint8_t
+	_rx_buffers[CDCD_STREAM_RX_BUFFERS][CDCD_STREAM_RX_BUFFER_SIZE];
+
+static struct _usbd_transfer_buffer _rx_list[CDCD_STREAM_RX_BUFFERS];
+
+/*------------------------------------------------------------------------------
+ *         Internal functions
+ *------------------------------------------------------------------------------*/
+
+static void _tx_kick(void);
+
+/**
+ * Bulk IN transfer completion: release the bytes sent and send more.
+ */
+static void _tx_done(void *arg, uint8_t status, uint32_t transferred,
+		uint32_t remaining)
+{
+	uint32_t flags = arch_irq_save();
+
+	if (status != USBD_STATUS_SUCCESS) {
+		/* Aborted, the data stays in the ring */
+		trace_warning("cdcd_stream: TX status %u\r\n", (unsigned)status);
+	} else if (_stream.tx_zlp_busy) {
+		_stream.tx_need_zlp = false;
+		_stream.stats.tx_zlps++;
+	} else {
+		_stream.tx_tail += _stream.tx_busy;
+		_stream.stats.tx_bytes += _stream.tx_busy;
+		_stream.stats.tx_transfers++;
+	}
+	_stream.tx_busy = 0;
+	_stream.tx_zlp_busy = false;
+
+	_tx_kick();
+	arch_irq_restore(flags);
+}
+
+/**
+ * Start a bulk IN transfer with the pending bytes of the TX ring, if the
+ * endpoint is free and the host has the port open.
+ * Must be called with interrupts disabled.
+ */
+static void _tx_kick(void)
+{
+	uint32_t pending, offset, len;
+
+	if (!_stream.started || !_stream.dtr ||
+			_stream.tx_busy || _stream.tx_zlp_busy)
+		return;
+
+	pending = _stream.tx_head - _stream.tx_tail;
+	if (pending == 0) {
+		/* End the burst, the host would wait for more data otherwise */
+		if (_stream.tx_need_zlp) {
+			_stream.tx_zlp_busy = true;
+			if (usbd_write(_stream.ep_in, NULL, 0, _tx_done, NULL)
+					!= USBD_STATUS_SUCCESS)
+				_stream.tx_zlp_busy = false;
+		}
+		return;
+	}
+
+	offset = _stream.tx_tail & (CDCD_STREAM_TX_SIZE - 1);
+	len = pending;
+	if (len > CDCD_STREAM_TX_SIZE - offset)
+		len = CDCD_STREAM_TX_SIZE - offset;
+
+	/* Keep packets full when the rest follows in the next transfer */
+	if (len < pending && len > _stream.packet_size)
+		len -= len % _stream.packet_size;
+
+	_stream.tx_busy = len;
+	_stream.tx_need_zlp = (len % _stream.packet_size) == 0;
+	if (usbd_write(_stream.ep_in, &_tx_ring[offset], len, _tx_done, NULL)
+			!= USBD_STATUS_SUCCESS)
+		_stream.tx_busy = 0;
+}
+
+/**
+ * Bulk OUT buffer completion, invoked for each buffer in queue order.
+ */
+static void _rx_done(void *arg, uint8_t status, uint32_t transferred,
+		uint32_t remaining)
+{
+	uint16_t index = (_stream.rx_head + _stream.rx_filled) %
+		CDCD_STREAM_RX_BUFFERS;
+
+	if (status != USBD_STATUS_SUCCESS) {
+		trace_warning("cdcd_stream: RX status %u\r\n", (unsigned)status);
+		return;
+	}
+
+	/* ZLPs are kept as empty buffers to preserve the ring order */
+	_stream.rx_length[index] = (uint16_t)transferred;
+	_stream.rx_filled++;
+	_stream.stats.rx_bytes += transferred;
+}
+
+/**
+ * Compute the throughput over the last period.
+ */
+static void _update_rates(void)
+{
+	uint64_t now = timer_get_tick();
+	uint32_t elapsed = (uint32_t)timer_get_interval(_stream.rate_start, now);
+
+	if (elapsed < CDCD_STREAM_RATE_PERIOD)
+		return;
+
+	_stream.stats.tx_rate = (uint32_t)(((uint64_t)(_stream.stats.tx_bytes -
+			_stream.rate_tx_bytes) * 1000) / elapsed);
+	_stream.stats.rx_rate = (uint32_t)(((uint64_t)(_stream.stats.rx_bytes -
+			_stream.rate_rx_bytes) * 1000) / elapsed);
+	_stream.rate_start = now;
+	_stream.rate_tx_bytes = _stream.stats.tx_bytes;
+	_stream.rate_rx_bytes = _stream.stats.rx_bytes;
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * Start streaming on the CDC serial port, once the device is configured:
+ * queue all RX buffers and send pending TX data if DTR is set.
+ * \return USBD_STATUS_SUCCESS or the error code of the USB layer.
+ */
+uint32_t cdcd_serial_stream_start(void)
+{
+	const CDCDSerialPort *port = cdcd_serial_get_port();
+	uint32_t rc, flags;
+	int i;
+
+	if (port->bBulkInPIPE == 0 || port->bBulkOutPIPE == 0)
+		return USBRC_PARAM_ERR;
+
+	cdcd_serial_stream_stop();
+
+	_stream.ep_in = port->bBulkInPIPE;
+	_stream.ep_out = port->bBulkOutPIPE;
+	_stream.packet_size = usbd_is_high_speed() ?
+		CDCDSerialPort_BULK_MAXPACKETSIZE_HS :
+		CDCDSerialPort_BULK_MAXPACKETSIZE_FS;
+	_stream.dtr = (cdcd_serial_get_control_line_state() &
+			CDCControlLineState_DTR) != 0;
+	_stream.rx_head = 0;
+	_stream.rx_pos = 0;
+	_stream.rx_filled = 0;
+	_stream.rate_start = timer_get_tick();
+	_stream.rate_tx_bytes = _stream.stats.tx_bytes;
+	_stream.rate_rx_bytes = _stream.stats.rx_bytes;
+
+	rc = usbd_hal_setup_multi_transfer(_stream.ep_out, _rx_list,
+			CDCD_STREAM_RX_BUFFERS, 1);
+	if (rc != USBD_STATUS_SUCCESS)
+		return rc;
+	usbd_hal_set_transfer_callback(_stream.ep_out, _rx_done, NULL);
+	for (i = 0; i < CDCD_STREAM_RX_BUFFERS; i++) {
+		rc = usbd_hal_read(_stream.ep_out, _rx_buffers[i],
+				CDCD_STREAM_RX_BUFFER_SIZE);
+		if (rc != USBD_STATUS_SUCCESS)
+			return rc;
+	}
+
+	flags = arch_irq_save();
+	_stream.started = true;
+	_tx_kick();
+	arch_irq_restore(flags);
+
+	return USBD_STATUS_SUCCESS;
+}
+
+/**
+ * Stop streaming: abort the transfers in progress and discard received
+ * data. Data not sent yet is kept in the TX ring.
+ */
+void cdcd_serial_stream_stop(void)
+{
+	if (!_stream.started)
+		return;
+
+	_stream.started = false;
+	usbd_hal_reset_endpoints((1 << _stream.ep_in) | (1 << _stream.ep_out),
+			USBD_STATUS_ABORTED, true);
+	usbd_hal_setup_multi_transfer(_stream.ep_out, NULL, 0, 0);
+	_stream.tx_busy = 0;
+	_stream.tx_zlp_busy = false;
+	_stream.rx_filled = 0;
+}
+
+/**
+ * Queue data to send. Does not block: the data that does not fit in the TX
+ * ring is not taken.
+ * \param data Pointer to the data to send.
+ * \param size Size of the data in bytes.
+ * \return Number of bytes queued.
+ */
+uint32_t cdcd_serial_stream_write(const void *data, uint32_t size)
+{
+	const uint8_t *src = (const uint8_t*)data;
+	uint32_t free, offset, len, flags;
+
+	free = CDCD_STREAM_TX_SIZE - (_stream.tx_head - _stream.tx_tail);
+	if (size > free)
+		size = free;
+
+	offset = _stream.tx_head & (CDCD_STREAM_TX_SIZE - 1);
+	len = size;
+	if (len > CDCD_STREAM_TX_SIZE - offset)
+		len = CDCD_STREAM_TX_SIZE - offset;
+	memcpy(&_tx_ring[offset], src, len);
+	memcpy(_tx_ring, src + len, size - len);
+
+	flags = arch_irq_save();
+	_stream.tx_head += size;
+	_tx_kick();
+	arch_irq_restore(flags);
+
+	return size;
+}
+
+/**
+ * Read received data. Does not block.
+ * \param data Pointer to the destination buffer.
+ * \param size Size of the destination buffer in bytes.
+ * \return Number of bytes read.
+ */
+uint32_t cdcd_serial_stream_read(void *data, uint32_t size)
+{
+	uint8_t *dst = (uint8_t*)data;
+	uint32_t done = 0, len, flags;
+	uint16_t head;
+
+	while (done < size && _stream.rx_filled) {
+		head = _stream.rx_head;
+		len = _stream.rx_length[head] - _stream.rx_pos;
+		if (len > size - done)
+			len = size - done;
+		memcpy(dst + done, &_rx_buffers[head][_stream.rx_pos], len);
+		done += len;
+		_stream.rx_pos += len;
+
+		if (_stream.rx_pos < _stream.rx_length[head])
+			break;
+
+		/* Buffer consumed, give it back to the endpoint */
+		flags = arch_irq_save();
+		_stream.rx_pos = 0;
+		_stream.rx_head = (head + 1) % CDCD_STREAM_RX_BUFFERS;
+		_stream.rx_filled--;
+		if (_stream.started)
+			usbd_hal_read(_stream.ep_out, _rx_buffers[head],
+					CDCD_STREAM_RX_BUFFER_SIZE);
+		arch_irq_restore(flags);
+	}
+
+	return done;
+}
+
+/**
+ * \return Number of bytes that cdcd_serial_stream_write() can take.
+ */
+uint32_t cdcd_serial_stream_get_tx_free(void)
+{
+	return CDCD_STREAM_TX_SIZE - (_stream.tx_head - _stream.tx_tail);
+}
+
+/**
+ * \return Number of received bytes not read yet.
+ */
+uint32_t cdcd_serial_stream_get_rx_available(void)
+{
+	uint32_t flags = arch_irq_save();
+	uint32_t available = 0;
+	uint16_t i;
+
+	for (i = 0; i < _stream.rx_filled; i++)
+		available += _stream.rx_length[(_stream.rx_head + i) %
+			CDCD_STREAM_RX_BUFFERS];
+	arch_irq_restore(flags);
+
+	return available - (_stream.rx_filled ? _stream.rx_pos : 0);
+}
+
+/**
+ * Get the transfer counters. Rates are updated at most every
+ * CDCD_STREAM_RATE_PERIOD milliseconds, when this function is called.
+ * \param stats Pointer to the structure to fill.
+ */
+void cdcd_serial_stream_get_stats(struct _cdcd_serial_stream_stats *stats)
+{
+	uint32_t flags = arch_irq_save();
+
+	_update_rates();
+	*stats = _stream.stats;
+	arch_irq_restore(flags);
+}
+
+/**
+ * Flow control: transmit only while the host asserts DTR. Called by the
+ * CDC serial function on SetControlLineState requests.
+ * \param dtr New DTR value.
+ */
+void cdcd_serial_stream_control_line_changed(bool dtr)
+{
+	uint32_t flags = arch_irq_save();
+
+	_stream.dtr = dtr;
+	_tx_kick();
+	arch_irq_restore(flags);
+}
+
+/**@}*/
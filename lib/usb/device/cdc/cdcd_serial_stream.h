@@ -0,0 +1,121 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Streaming layer for the single CDC serial port function.
+ *
+ * Data written is copied to a TX ring and sent in bulk transfers as large
+ * as possible: while a transfer is in flight, small writes accumulate and
+ * go out together as full packets. A zero-length packet ends bursts that
+ * are a multiple of the packet size. Transmission only happens while the
+ * host asserts DTR (port open).
+ *
+ * Received data is DMA'd into a ring of buffers which are all queued on
+ * the bulk OUT endpoint (multi-buffer list). A buffer is queued again once
+ * its content has been read: when the application lags, the endpoint NAKs
+ * the host instead of dropping data.
+ */
+
+#ifndef CDCD_SERIAL_STREAM_H
+#define CDCD_SERIAL_STREAM_H
+
+/** \addtogroup usbd_cdc
+ *@{
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ *         Definitions
+ *------------------------------------------------------------------------------*/
+
+/** Size of the TX ring in bytes (power of two) */
+#ifndef CDCD_STREAM_TX_SIZE
+#define CDCD_STREAM_TX_SIZE 4096
+#endif
+
+/** Number of RX buffers queued on the bulk OUT endpoint */
+#ifndef CDCD_STREAM_RX_BUFFERS
+#define CDCD_STREAM_RX_BUFFERS 4
+#endif
+
+/** Size of each RX buffer in bytes (multiple of the HS packet size) */
+#ifndef CDCD_STREAM_RX_BUFFER_SIZE
+#define CDCD_STREAM_RX_BUFFER_SIZE 1024
+#endif
+
+/** Period of the throughput computation, in milliseconds */
+#ifndef CDCD_STREAM_RATE_PERIOD
+#define CDCD_STREAM_RATE_PERIOD 1000
+#endif
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+struct _cdcd_serial_stream_stats {
+	uint32_t tx_bytes;     /**< bytes sent */
+	uint32_t rx_bytes;     /**< bytes received */
+	uint32_t tx_rate;      /**< bytes/s sent over the last period */
+	uint32_t rx_rate;      /**< bytes/s received over the last period */
+	uint32_t tx_transfers; /**< bulk IN transfers, ZLPs excluded */
+	uint32_t tx_zlps;      /**< zero-length packets sent */
+};
+
+/*------------------------------------------------------------------------------
+ *      Exported functions
+ *------------------------------------------------------------------------------*/
+
+extern uint32_t cdcd_serial_stream_start(void);
+
+extern void cdcd_serial_stream_stop(void);
+
+extern uint32_t cdcd_serial_stream_write(const void *data, uint32_t size);
+
+extern uint32_t cdcd_serial_stream_read(void *data, uint32_t size);
+
+extern uint32_t cdcd_serial_stream_get_tx_free(void);
+
+extern uint32_t cdcd_serial_stream_get_rx_available(void);
+
+extern void cdcd_serial_stream_get_stats(
+		struct _cdcd_serial_stream_stats *stats);
+
+extern void cdcd_serial_stream_control_line_changed(bool dtr);
+
+/**@}*/
+
+#endif /* CDCD_SERIAL_STREAM_H */
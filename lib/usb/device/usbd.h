@@ -126,8 +126,10 @@
 
 /**
  * Callback used by transfer functions (usbd_read & usbd_write) to notify
- * that a transaction is complete. For MBL transfers, transferred and remaining
- * arguments are not set.
+ * that a transaction is complete. For MBL transfers on endpoints with DMA, it
+ * is invoked for each buffer with the bytes transferred and the number of
+ * buffers still queued as remaining. Otherwise, for MBL transfers,
+ * transferred and remaining arguments are not set.
  */
 typedef void (*usbd_xfer_cb_t)(void *arg, uint8_t status, uint32_t transferred, uint32_t remaining);
 
@@ -30,6 +30,7 @@
 #ifndef _APPLET_H_
 #define _APPLET_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /*----------------------------------------------------------------------------
@@ -43,6 +44,11 @@
 #define APPLET_CMD_WRITE_PAGES       0x33 /* Write pages */
 #define APPLET_CMD_READ_BOOTCFG      0x34 /* Read Boot Config */
 #define APPLET_CMD_WRITE_BOOTCFG     0x35 /* Write Boot Config */
+#define APPLET_CMD_READ_DB_INFO      0x36 /* Read double-buffer info */
+#define APPLET_CMD_WRITE_PAGES_DB    0x37 /* Write pages from a buffer half */
+#define APPLET_CMD_POLL_STATUS       0x38 /* Poll end of pending write */
+#define APPLET_CMD_WRITE_PAGES_LZ4   0x39 /* Write LZ4-compressed pages */
+#define APPLET_CMD_VERIFY_PAGES      0x3A /* Compute digest of pages */
 
 #define APPLET_SUCCESS               0x00 /* Operation was successful */
 #define APPLET_DEV_UNKNOWN           0x01 /* Device unknown */
@@ -55,6 +61,7 @@
 #define APPLET_ALIGN_ERROR           0x08 /* Read / write address is not aligned */
 #define APPLET_BAD_BLOCK             0x09 /* Read / write found bad block */
 #define APPLET_PMECC_CONFIG          0x0A /* ECC configure failure */
+#define APPLET_BUSY                  0x0B /* Pending write still in progress */
 #define APPLET_FAIL                  0x0F /* Generic/Unknown failure */
 
 /* Communication link identification */
@@ -117,8 +124,106 @@ union read_write_erase_pages_mailbox {
 	} out;
 };
 
+/** Mailbox content for the 'read double-buffer info' command. */
+union read_db_info_mailbox {
+	struct {
+		/** Address of each buffer half */
+		uint32_t buf_addr[2];
+		/** Size of each buffer half (in bytes) */
+		uint32_t buf_size;
+	} out;
+};
+
+/** Mailbox content for the 'write pages (double-buffer)' command. */
+union write_pages_db_mailbox {
+	struct {
+		/** Write offset (in pages) */
+		uint32_t offset;
+		/** Write length (in pages) */
+		uint32_t length;
+		/** Index of the buffer half holding the data (0 or 1) */
+		uint32_t buffer;
+	} in;
+
+	struct {
+		/** Pages written */
+		uint32_t pages;
+	} out;
+};
+
+/** 'write pages (LZ4)' flag: do not program pages filled with 0xFF */
+#define APPLET_LZ4_SKIP_ERASED       (1 << 0)
+
+/**
+ * Mailbox content for the 'write pages (LZ4)' command.
+ *
+ * The LZ4 block is loaded at the start of the second buffer half (see
+ * 'read double-buffer info') and decompressed into the first half.
+ */
+union write_pages_lz4_mailbox {
+	struct {
+		/** Write offset (in pages) */
+		uint32_t offset;
+		/** Write length (in pages, after decompression) */
+		uint32_t length;
+		/** Size of the LZ4 block (in bytes) */
+		uint32_t size;
+		/** Flags (APPLET_LZ4_*) */
+		uint32_t flags;
+	} in;
+
+	struct {
+		/** Pages written or skipped */
+		uint32_t pages;
+		/** CRC-32 of the decompressed data */
+		uint32_t crc;
+		/** Pages skipped because filled with 0xFF */
+		uint32_t skipped;
+	} out;
+};
+
+/* Digest algorithms for the 'verify pages' command */
+#define APPLET_DIGEST_CRC32          0x00 /* CRC-32 (zlib), 4 bytes */
+#define APPLET_DIGEST_SHA256         0x01 /* SHA-256, 32 bytes */
+
+/** Mailbox content for the 'verify pages' command. */
+union verify_pages_mailbox {
+	struct {
+		/** Verify offset (in pages) */
+		uint32_t offset;
+		/** Verify length (in pages) */
+		uint32_t length;
+		/** Requested digest algorithm (APPLET_DIGEST_*) */
+		uint32_t algo;
+	} in;
+
+	struct {
+		/** Pages read */
+		uint32_t pages;
+		/** Digest algorithm used, CRC-32 when SHA is not available */
+		uint32_t algo;
+		/** Digest (in memory order for SHA-256) */
+		uint32_t digest[8];
+	} out;
+};
+
 typedef uint32_t (*applet_command_handler_t)(uint32_t cmd, uint32_t *args);
 
+/**
+ * \brief Write handler for the double-buffer mode.
+ *
+ * Writes 'length' pages from 'buf' at page 'offset' and stores the number
+ * of pages written in 'pages'. The handler may return while the device is
+ * still completing the last program operation, the busy handler given to
+ * applet_db_configure() is then used to wait for its completion.
+ * \return APPLET_SUCCESS or an applet error status
+ */
+typedef uint32_t (*applet_db_write_t)(uint32_t offset, uint32_t length,
+		const uint8_t *buf, uint32_t *pages);
+
+/** Returns true while the device is completing the last write */
+typedef bool (*applet_db_busy_t)(void);
+
 struct applet_command
 {
 	uint32_t command;
@@ -136,4 +241,21 @@ extern applet_command_handler_t get_applet_command_handler(uint8_t cmd);
 
 extern void applet_main(struct applet_mailbox *mailbox);
 
+/**
+ * \brief Enable the double-buffer and compressed write commands.
+ *
+ * The buffer is split in two halves of a whole number of pages. The host
+ * loads one half while the applet programs the other one: over JTAG the
+ * host can write the idle half while a command executes, over USB/DBGU it
+ * is loaded while the device completes the previous write (e.g. final
+ * page program or card busy), as the applet does not wait for it.
+ * \param buffer  Applet buffer
+ * \param size  Applet buffer size (in bytes)
+ * \param page_size  Size of a page (in bytes)
+ * \param write  Write handler
+ * \param busy  Busy handler, NULL if 'write' always completes synchronously
+ */
+extern void applet_db_configure(uint8_t *buffer, uint32_t size,
+		uint32_t page_size, applet_db_write_t write, applet_db_busy_t busy);
+
 #endif /* _APPLET_H_ */
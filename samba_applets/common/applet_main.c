@@ -27,6 +27,7 @@
  * ----------------------------------------------------------------------------
  */
 
+#include <assert.h>
 #include <string.h>
 
 #include "applet.h"
@@ -34,8 +35,14 @@
 #include "board.h"
 #include "board_timer.h"
 #include "chip.h"
+#include "crc32.h"
+#ifdef CONFIG_HAVE_SHA
+#include "crypto/shad.h"
+#endif
 #include "dma/dma.h"
 #include "gpio/pio.h"
+#include "intmath.h"
+#include "lz4.h"
 #include "nvm/sfc.h"
 #include "peripherals/pmc.h"
 #include "serial/console.h"
@@ -56,6 +63,26 @@ static uint32_t _comm_type;
 uint8_t *applet_buffer;
 uint32_t applet_buffer_size;
 
+/** Double-buffer mode state */
+static struct {
+	uint8_t *buffer[2];
+	uint32_t size;
+	uint32_t page_size;
+	applet_db_write_t write;
+	applet_db_busy_t busy;
+} _db;
+
+#ifdef CONFIG_HAVE_SHA
+static struct _shad_desc shad = {
+	.cfg = {
+		.transfer_mode = SHAD_TRANS_POLLING,
+		.algo = ALGO_SHA_256,
+	},
+};
+
+static bool shad_initialized = false;
+#endif
+
 /*----------------------------------------------------------------------------
  *         Local functions
  *----------------------------------------------------------------------------*/
@@ -87,6 +114,258 @@ static void debug_display_mailbox(struct applet_mailbox *mailbox)
 #endif
 }
 
+static void _db_wait(void)
+{
+	if (_db.busy)
+		while (_db.busy());
+}
+
+static uint32_t _db_handle_cmd_read_info(uint32_t cmd, uint32_t *mailbox)
+{
+	union read_db_info_mailbox *mbx = (union read_db_info_mailbox*)mailbox;
+
+	assert(cmd == APPLET_CMD_READ_DB_INFO);
+
+	mbx->out.buf_addr[0] = (uint32_t)_db.buffer[0];
+	mbx->out.buf_addr[1] = (uint32_t)_db.buffer[1];
+	mbx->out.buf_size = _db.size;
+
+	return APPLET_SUCCESS;
+}
+
+static uint32_t _db_handle_cmd_write_pages(uint32_t cmd, uint32_t *mailbox)
+{
+	union write_pages_db_mailbox *mbx =
+		(union write_pages_db_mailbox*)mailbox;
+	uint32_t pages = 0;
+	uint32_t status;
+
+	assert(cmd == APPLET_CMD_WRITE_PAGES_DB);
+
+	if (mbx->in.buffer > 1) {
+		trace_error_wp("Invalid buffer index %u\r\n",
+				(unsigned)mbx->in.buffer);
+		return APPLET_FAIL;
+	}
+
+	/* check that requested size does not overflow buffer half */
+	if (mbx->in.length > _db.size / _db.page_size) {
+		trace_error_wp("Buffer overflow\r\n");
+		return APPLET_FAIL;
+	}
+
+	/* the previous write was completed by applet_main() */
+	status = _db.write(mbx->in.offset, mbx->in.length,
+			_db.buffer[mbx->in.buffer], &pages);
+	mbx->out.pages = pages;
+
+	return status;
+}
+
+static uint32_t _db_handle_cmd_poll_status(uint32_t cmd, uint32_t *mailbox)
+{
+	assert(cmd == APPLET_CMD_POLL_STATUS);
+
+	if (_db.busy && _db.busy())
+		return APPLET_BUSY;
+
+	return APPLET_SUCCESS;
+}
+
+static bool _is_erased_page(const uint8_t *page)
+{
+	const uint32_t *word = (const uint32_t*)page;
+	uint32_t i;
+
+	for (i = 0; i < _db.page_size / 4; i++)
+		if (word[i] != 0xffffffff)
+			return false;
+
+	return true;
+}
+
+static uint32_t _db_handle_cmd_write_pages_lz4(uint32_t cmd,
+		uint32_t *mailbox)
+{
+	union write_pages_lz4_mailbox *mbx =
+		(union write_pages_lz4_mailbox*)mailbox;
+	uint32_t offset = mbx->in.offset;
+	uint32_t length = mbx->in.length;
+	uint32_t comp_size = mbx->in.size;
+	bool skip_erased = (mbx->in.flags & APPLET_LZ4_SKIP_ERASED) != 0;
+	uint8_t *data = _db.buffer[0];
+	uint32_t start, end = 0, pages, skipped;
+	uint32_t status = APPLET_SUCCESS;
+	int size;
+
+	assert(cmd == APPLET_CMD_WRITE_PAGES_LZ4);
+
+	if (comp_size > _db.size ||
+	    length > _db.size / _db.page_size) {
+		trace_error_wp("Buffer overflow\r\n");
+		return APPLET_FAIL;
+	}
+
+	size = lz4_decompress(_db.buffer[1], comp_size, data, _db.size);
+	if (size != (int)(length * _db.page_size)) {
+		trace_error_wp("Invalid LZ4 data (%d bytes, %u expected)\r\n",
+				size, (unsigned)(length * _db.page_size));
+		mbx->out.pages = 0;
+		return APPLET_FAIL;
+	}
+
+	mbx->out.crc = crc32_update(0, data, size);
+
+	/* program each run of pages not filled with 0xFF in one write */
+	skipped = 0;
+	for (start = 0; start < length; start = end) {
+		if (skip_erased && _is_erased_page(data + start * _db.page_size)) {
+			skipped++;
+			end = start + 1;
+			continue;
+		}
+		for (end = start + 1; end < length; end++)
+			if (skip_erased &&
+			    _is_erased_page(data + end * _db.page_size))
+				break;
+
+		/* the previous run may still be completing */
+		_db_wait();
+		pages = 0;
+		status = _db.write(offset + start, end - start,
+				data + start * _db.page_size, &pages);
+		if (status != APPLET_SUCCESS) {
+			end = start + pages;
+			break;
+		}
+	}
+
+	trace_info_wp("LZ4: %u bytes -> %u pages, %u skipped\r\n",
+			(unsigned)comp_size, (unsigned)length,
+			(unsigned)skipped);
+
+	mbx->out.pages = end;
+	mbx->out.skipped = skipped;
+
+	return status;
+}
+
+static void _verify_update(uint32_t algo, uint32_t *crc,
+		const uint8_t *data, uint32_t size)
+{
+#ifdef CONFIG_HAVE_SHA
+	if (algo == APPLET_DIGEST_SHA256) {
+		struct _buffer buf = {
+			.data = (uint8_t*)data,
+			.size = size,
+		};
+		shad_update(&shad, &buf, NULL);
+		shad_wait_completion(&shad);
+		return;
+	}
+#endif
+	*crc = crc32_update(*crc, data, size);
+}
+
+static uint32_t _handle_cmd_verify_pages(uint32_t cmd, uint32_t *mailbox)
+{
+	union verify_pages_mailbox *mbx = (union verify_pages_mailbox*)mailbox;
+	union initialize_mailbox info;
+	union read_write_erase_pages_mailbox rd;
+	applet_command_handler_t read_info, read_pages;
+	uint32_t offset = mbx->in.offset;
+	uint32_t length = mbx->in.length;
+	uint32_t algo = mbx->in.algo;
+	uint32_t chunk, count, done, status;
+	uint32_t crc = 0;
+	uint8_t *data;
+
+	assert(cmd == APPLET_CMD_VERIFY_PAGES);
+
+	/* the data is read in chunks as large as the applet buffer, using
+	 * the 'read info' and 'read pages' commands of the applet */
+	read_info = get_applet_command_handler(APPLET_CMD_READ_INFO);
+	read_pages = get_applet_command_handler(APPLET_CMD_READ_PAGES);
+	if (!read_info || !read_pages)
+		return APPLET_FAIL;
+	if (read_info(APPLET_CMD_READ_INFO, (uint32_t*)&info) != APPLET_SUCCESS)
+		return APPLET_FAIL;
+	data = (uint8_t*)info.out.buf_addr;
+	chunk = info.out.buf_size / info.out.page_size;
+	if (chunk == 0)
+		return APPLET_FAIL;
+
+#ifdef CONFIG_HAVE_SHA
+	if (algo == APPLET_DIGEST_SHA256) {
+		if (!shad_initialized) {
+			shad_init(&shad);
+			shad_initialized = true;
+		}
+		shad_start(&shad);
+	} else
+#endif
+	{
+		algo = APPLET_DIGEST_CRC32;
+	}
+
+	for (done = 0; done < length; done += count) {
+		count = min_u32(length - done, chunk);
+		rd.in.offset = offset + done;
+		rd.in.length = count;
+		status = read_pages(APPLET_CMD_READ_PAGES, (uint32_t*)&rd);
+		if (status != APPLET_SUCCESS) {
+			mbx->out.pages = done;
+			return status;
+		}
+		_verify_update(algo, &crc, data, count * info.out.page_size);
+	}
+
+	memset(mbx->out.digest, 0, sizeof(mbx->out.digest));
+#ifdef CONFIG_HAVE_SHA
+	if (algo == APPLET_DIGEST_SHA256) {
+		struct _buffer buf = {
+			.data = (uint8_t*)mbx->out.digest,
+			.size = shad_get_output_size(shad.cfg.algo),
+		};
+		shad_finish(&shad, &buf, NULL);
+		shad_wait_completion(&shad);
+	} else
+#endif
+	{
+		mbx->out.digest[0] = crc;
+	}
+
+	trace_info_wp("Verified %u pages at offset %u\r\n",
+			(unsigned)length, (unsigned)offset);
+
+	mbx->out.pages = length;
+	mbx->out.algo = algo;
+
+	return APPLET_SUCCESS;
+}
+
+static applet_command_handler_t get_framework_command_handler(uint32_t cmd)
+{
+	if (cmd == APPLET_CMD_VERIFY_PAGES)
+		return _handle_cmd_verify_pages;
+
+	if (!_db.write)
+		return NULL;
+
+	switch (cmd) {
+	case APPLET_CMD_READ_DB_INFO:
+		return _db_handle_cmd_read_info;
+	case APPLET_CMD_WRITE_PAGES_DB:
+		return _db_handle_cmd_write_pages;
+	case APPLET_CMD_POLL_STATUS:
+		return _db_handle_cmd_poll_status;
+	case APPLET_CMD_WRITE_PAGES_LZ4:
+		return _db_handle_cmd_write_pages_lz4;
+	default:
+		return NULL;
+	}
+}
+
 /*----------------------------------------------------------------------------
  *         Public functions
  *----------------------------------------------------------------------------*/
@@ -103,6 +382,21 @@ void applet_set_init_params(uint32_t comm, uint32_t trace)
 	board_cfg_console(0);
 }
 
+void applet_db_configure(uint8_t *buffer, uint32_t size,
+		uint32_t page_size, applet_db_write_t write, applet_db_busy_t busy)
+{
+	_db.size = (size / 2) / page_size * page_size;
+	_db.buffer[0] = buffer;
+	_db.buffer[1] = buffer + _db.size;
+	_db.page_size = page_size;
+	_db.write = _db.size ? write : NULL;
+	_db.busy = busy;
+
+	if (_db.write)
+		trace_info_wp("Double-buffer: 2x %u bytes\r\n",
+				(unsigned)_db.size);
+}
+
 applet_command_handler_t get_applet_command_handler(uint8_t cmd)
 {
 	int i;
@@ -136,8 +430,15 @@ void applet_main(struct applet_mailbox *mailbox)
 	/* set default status */
 	mailbox->status = APPLET_FAIL;
 
+	/* complete any pending double-buffer write before processing the
+	 * command, except when the host is polling for its completion */
+	if (mailbox->command != APPLET_CMD_POLL_STATUS)
+		_db_wait();
+
 	/* look for handler and call it */
 	handler = get_applet_command_handler(mailbox->command);
+	if (!handler)
+		handler = get_framework_command_handler(mailbox->command);
 	if (handler) {
 		if (mailbox->command == APPLET_CMD_INITIALIZE) {
 			mailbox->status = handler(mailbox->command, mailbox->data);
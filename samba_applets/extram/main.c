@@ -37,8 +37,16 @@
 #include "board_support.h"
 #include "trace.h"
 #include "extram/ddram.h"
+#include "extram/ddram_test.h"
 #include "peripherals/pmc.h"
 
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+/** Size of the range tested in qualification mode, if not given */
+#define QUALIFY_DEFAULT_SIZE (1024 * 1024)
+
 /*----------------------------------------------------------------------------
  *         Private functions
  *----------------------------------------------------------------------------*/
@@ -61,29 +69,26 @@ static bool check_extram(void)
 	return true;
 }
 
-static bool init_extram_from_preset(uint32_t preset)
+static bool get_preset_device(uint32_t preset, enum _ddram_devices *device)
 {
-	enum _ddram_devices device;
-	struct _mpddrc_desc desc;
-
 	switch (preset) {
 #ifdef CONFIG_HAVE_MPDDRC_DDR2
   #ifdef CONFIG_HAVE_DDR2_MT47H128M8
 	case 0:
 		trace_info_wp("Preset 0 (4 x MT47H128M8)\r\n");
-		device = MT47H128M8;
+		*device = MT47H128M8;
 		break;
   #endif
   #ifdef CONFIG_HAVE_DDR2_MT47H64M16
 	case 1:
 		trace_info_wp("Preset 1 (MT47H64M16)\r\n");
-		device = MT47H64M16;
+		*device = MT47H64M16;
 		break;
   #endif
   #ifdef CONFIG_HAVE_DDR2_MT47H128M16
 	case 2:
 		trace_info_wp("Preset 2 (2 x MT47H128M16)\r\n");
-		device = MT47H128M16;
+		*device = MT47H128M16;
 		break;
   #endif
 #endif
@@ -91,7 +96,7 @@ static bool init_extram_from_preset(uint32_t preset)
   #ifdef CONFIG_HAVE_LPDDR2_MT42L128M16
 	case 3:
 		trace_info_wp("Preset 3 (2 x MT42L128M16)\r\n");
-		device = MT42L128M16;
+		*device = MT42L128M16;
 		break;
   #endif
 #endif
@@ -99,7 +104,7 @@ static bool init_extram_from_preset(uint32_t preset)
   #ifdef CONFIG_HAVE_DDR3_MT41K128M16
 	case 4:
 		trace_info_wp("Preset 4 (2 x MT41K128M16)\r\n");
-		device = MT41K128M16;
+		*device = MT41K128M16;
 		break;
   #endif
 #endif
@@ -107,7 +112,7 @@ static bool init_extram_from_preset(uint32_t preset)
   #ifdef CONFIG_HAVE_LPDDR3_EDF8164A3MA
 	case 5:
 		trace_info_wp("Preset 5 (EDF8164A3MA)\r\n");
-		device = EDF8164A3MA;
+		*device = EDF8164A3MA;
 		break;
   #endif
 #endif
@@ -115,7 +120,7 @@ static bool init_extram_from_preset(uint32_t preset)
   #ifdef CONFIG_HAVE_SDRAM_IS42S16100E
 	case 6:
 		trace_info_wp("Preset 6 (IS42S16100E)\r\n");
-		device = IS42S16100E;
+		*device = IS42S16100E;
 		break;
   #endif
 #endif
@@ -125,16 +130,46 @@ static bool init_extram_from_preset(uint32_t preset)
 		return false;
 	}
 
+	return true;
+}
+
+static bool init_extram_from_preset(uint32_t preset, struct _mpddrc_desc *desc)
+{
+	enum _ddram_devices device;
+
+	if (!get_preset_device(preset, &device))
+		return false;
+
 	board_cfg_matrix_for_ddr();
-	ddram_init_descriptor(&desc, device);
-	ddram_configure(&desc);
+	ddram_init_descriptor(desc, device);
+	ddram_configure(desc);
 	return true;
 }
 
+static bool qualify_extram(uint32_t preset, struct _mpddrc_desc *desc,
+		bool configured, uint32_t size, uint8_t margin)
+{
+	enum _ddram_devices device;
+
+	/* already configured: assume the preset timings are in use */
+	if (configured) {
+		if (!get_preset_device(preset, &device))
+			return false;
+		ddram_init_descriptor(desc, device);
+	}
+
+	if (!size)
+		size = QUALIFY_DEFAULT_SIZE;
+
+	return ddram_qualify(desc, DDR_CS_ADDR, size, margin) == 0;
+}
+
 static uint32_t handle_cmd_initialize(uint32_t cmd, uint32_t *mailbox)
 {
 	union initialize_mailbox *mbx = (union initialize_mailbox*)mailbox;
 	uint32_t mode = mbx->in.parameters[0];
+	struct _mpddrc_desc desc;
+	bool configured;
 
 	assert(cmd == APPLET_CMD_INITIALIZE);
 
@@ -142,18 +177,17 @@ static uint32_t handle_cmd_initialize(uint32_t cmd, uint32_t *mailbox)
 
 	trace_info_wp("\r\nApplet 'External RAM' from softpack " SOFTPACK_VERSION ".\r\n");
 
-	if (check_extram()) {
+	if (mode > 1) {
+		trace_error("Invalid external RAM mode: only modes 0 (preset) and 1 (preset and qualification) are supported.\r\n");
+		return APPLET_FAIL;
+	}
+
+	configured = check_extram();
+	if (configured) {
 		trace_info_wp("External RAM already configured.\r\n");
 	} else {
-		switch (mode) {
-		case 0:
-			if (!init_extram_from_preset(mbx->in.parameters[1]))
-				return APPLET_FAIL;
-			break;
-		default:
-			trace_error("Invalid external RAM mode: only mode 0 (preset) is supported.\r\n");
+		if (!init_extram_from_preset(mbx->in.parameters[1], &desc))
 			return APPLET_FAIL;
-		}
 
 		if (!check_extram()) {
 			trace_error("External RAM test failed.\r\n");
@@ -163,6 +197,13 @@ static uint32_t handle_cmd_initialize(uint32_t cmd, uint32_t *mailbox)
 		trace_info_wp("External RAM initialization complete.\r\n");
 	}
 
+	if (mode == 1) {
+		if (!qualify_extram(mbx->in.parameters[1], &desc, configured,
+				mbx->in.parameters[2], mbx->in.parameters[3]))
+			return APPLET_FAIL;
+		trace_info_wp("External RAM qualification complete.\r\n");
+	}
+
 	mbx->out.buf_addr = 0;
 	mbx->out.buf_size = 0;
 	mbx->out.page_size = 0;
@@ -247,6 +247,51 @@ static bool pmecc_set_header(uint32_t header)
 }
 
 
+/*
+	Write pages from a buffer to NAND flash.
+*/
+static uint32_t write_pages(uint32_t offset, uint32_t length,
+		const uint8_t *buf, uint32_t *pages)
+{
+	uint32_t i;
+	uint16_t block, page;
+
+	block = offset / block_size;
+	page = offset - block * block_size;
+
+	for (i = 0; i < length; i++, buf += page_size) {
+		trace_debug_wp("Writing %u bytes at block %u page %u (offset 0x%08x)\r\n",
+				(unsigned)page_size, block, page,
+				(unsigned)((block * block_size + page) * page_size));
+		uint8_t status = nand_skipblock_write_page(&nand, block, page, buf, NULL);
+		if (status == NAND_ERROR_BADBLOCK) {
+			trace_error_wp("Cannot write bad block %u (page %u)\r\n",
+					block, page);
+			*pages = i;
+			return APPLET_BAD_BLOCK;
+		} else if (status != 0) {
+			trace_error_wp("Write error at block %u, page %u\r\n",
+					block, page);
+			*pages = 0;
+			return APPLET_WRITE_FAIL;
+		}
+
+		page++;
+		if (page == block_size) {
+			page = 0;
+			block++;
+		}
+	}
+
+	trace_info_wp("Wrote %u bytes at offset 0x%08x\r\n",
+			(unsigned)(length * page_size),
+			(unsigned)(offset * page_size));
+
+	*pages = length;
+
+	return APPLET_SUCCESS;
+}
+
 static uint32_t handle_cmd_initialize(uint32_t cmd, uint32_t *mailbox)
 {
 	union initialize_mailbox *mbx = (union initialize_mailbox*)mailbox;
@@ -372,6 +417,9 @@ static uint32_t handle_cmd_initialize(uint32_t cmd, uint32_t *mailbox)
 	trace_info_wp("Buffer Address: 0x%08x\r\n", (unsigned)buffer);
 	trace_info_wp("Buffer Size: %u bytes\r\n", (unsigned)buffer_size);
 
+	applet_db_configure(buffer, buffer_size, page_size,
+			write_pages, NULL);
+
 	mbx->out.buf_addr = (uint32_t)buffer;
 	mbx->out.buf_size = buffer_size;
 	mbx->out.page_size = page_size;
@@ -407,9 +455,6 @@ static uint32_t handle_cmd_write_pages(uint32_t cmd, uint32_t *mailbox)
 {
 	union read_write_erase_pages_mailbox *mbx =
 		(union read_write_erase_pages_mailbox*)mailbox;
-	uint32_t i;
-	uint8_t *buf;
-	uint16_t block, page;
 
 	assert(cmd == APPLET_CMD_WRITE_PAGES);
 
@@ -419,41 +464,8 @@ static uint32_t handle_cmd_write_pages(uint32_t cmd, uint32_t *mailbox)
 		return APPLET_FAIL;
 	}
 
-	block = mbx->in.offset / block_size;
-	page = mbx->in.offset - block * block_size;
-
-	for (i = 0, buf = buffer; i < mbx->in.length; i++, buf += page_size) {
-		trace_debug_wp("Writing %u bytes at block %u page %u (offset 0x%08x)\r\n",
-				(unsigned)page_size, block, page,
-				(unsigned)((block * block_size + page) * page_size));
-		uint8_t status = nand_skipblock_write_page(&nand, block, page, buf, NULL);
-		if (status == NAND_ERROR_BADBLOCK) {
-			trace_error_wp("Cannot write bad block %u (page %u)\r\n",
-					block, page);
-			mbx->out.pages = i;
-			return APPLET_BAD_BLOCK;
-		} else if (status != 0) {
-			trace_error_wp("Write error at block %u, page %u\r\n",
-					block, page);
-			mbx->out.pages = 0;
-			return APPLET_WRITE_FAIL;
-		}
-
-		page++;
-		if (page == block_size) {
-			page = 0;
-			block++;
-		}
-	}
-
-
-	trace_info_wp("Wrote %u bytes at offset 0x%08x\r\n",
-			(unsigned)(mbx->in.length * page_size),
-			(unsigned)(mbx->in.offset * page_size));
-
-	mbx->out.pages = mbx->in.length;
-
-	return APPLET_SUCCESS;
+	return write_pages(mbx->in.offset, mbx->in.length, buffer,
+			&mbx->out.pages);
 }
 
 /*
@@ -91,6 +91,28 @@ static bool configure_instance_pio(uint32_t instance, uint32_t ioset, Qspi** add
 	return false;
 }
 
+static uint32_t write_pages(uint32_t offset, uint32_t length,
+		const uint8_t *buf, uint32_t *pages)
+{
+	uint32_t page_size = flash.desc->page_size;
+
+	/* perform the write operation */
+	if (qspiflash_write(&flash, offset * page_size, buf,
+				length * page_size) < 0) {
+		trace_error("Write error\r\n");
+		*pages = 0;
+		return APPLET_WRITE_FAIL;
+	}
+
+	trace_info_wp("Wrote %u bytes at 0x%08x\r\n",
+			(unsigned)(length * page_size),
+			(unsigned)(offset * page_size));
+
+	*pages = length;
+
+	return APPLET_SUCCESS;
+}
+
 static uint32_t handle_cmd_initialize(uint32_t cmd, uint32_t *mailbox)
 {
 	union initialize_mailbox *mbx = (union initialize_mailbox*)mailbox;
@@ -171,6 +193,9 @@ static uint32_t handle_cmd_initialize(uint32_t cmd, uint32_t *mailbox)
 		trace_info_wp("Buffer Address: 0x%08x\r\n", (unsigned)buffer);
 		trace_info_wp("Buffer Size: %u bytes\r\n", (unsigned)buffer_size);
 
+		applet_db_configure(buffer, buffer_size, page_size,
+				write_pages, NULL);
+
 		mbx->out.buf_addr = (uint32_t)buffer;
 		mbx->out.buf_size = buffer_size;
 		mbx->out.page_size = page_size;
@@ -206,7 +231,6 @@ static uint32_t handle_cmd_write_pages(uint32_t cmd, uint32_t *mailbox)
 	union read_write_erase_pages_mailbox *mbx =
 		(union read_write_erase_pages_mailbox*)mailbox;
 
-	uint32_t offset = mbx->in.offset * flash.desc->page_size;
 	uint32_t length = mbx->in.length * flash.desc->page_size;
 
 	assert(cmd == APPLET_CMD_WRITE_PAGES);
@@ -217,19 +241,8 @@ static uint32_t handle_cmd_write_pages(uint32_t cmd, uint32_t *mailbox)
 		return APPLET_FAIL;
 	}
 
-	/* perform the write operation */
-	if (qspiflash_write(&flash, offset, buffer, length) < 0) {
-		trace_error("Write error\r\n");
-		mbx->out.pages = 0;
-		return APPLET_WRITE_FAIL;
-	}
-
-	trace_info_wp("Wrote %u bytes at 0x%08x\r\n",
-			(unsigned)length, (unsigned)offset);
-
-	mbx->out.pages = mbx->in.length;
-
-	return APPLET_SUCCESS;
+	return write_pages(mbx->in.offset, mbx->in.length, buffer,
+			&mbx->out.pages);
 }
 
 static uint32_t handle_cmd_read_pages(uint32_t cmd, uint32_t *mailbox)
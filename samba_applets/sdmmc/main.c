@@ -206,6 +206,32 @@ static char* get_supported_voltage_string(uint32_t supported_voltages)
 	return str;
 }
 
+static uint32_t write_pages(uint32_t offset, uint32_t length,
+		const uint8_t *buf, uint32_t *pages)
+{
+	/* check that requested offset/size does not overflow memory */
+	if (offset + length > mem_size) {
+		trace_error_wp("Memory overflow\r\n");
+		*pages = 0;
+		return APPLET_FAIL;
+	}
+
+	if (SD_Write(&lib, offset, buf, length, NULL, NULL) != SDMMC_OK) {
+		trace_info_wp("Error while writing %u bytes at offset 0x%08x\r\n",
+				(unsigned)(length * BLOCK_SIZE),
+				(unsigned)(offset * BLOCK_SIZE));
+		*pages = 0;
+		return APPLET_READ_FAIL;
+	}
+
+	trace_info_wp("Wrote %u bytes at offset 0x%08x\r\n",
+			(unsigned)(length * BLOCK_SIZE),
+			(unsigned)(offset * BLOCK_SIZE));
+	*pages = length;
+
+	return APPLET_SUCCESS;
+}
+
 static uint32_t handle_cmd_initialize(uint32_t cmd, uint32_t *mailbox)
 {
 	union initialize_mailbox *mbx = (union initialize_mailbox*)mailbox;
@@ -357,6 +383,9 @@ static uint32_t handle_cmd_initialize(uint32_t cmd, uint32_t *mailbox)
 		return APPLET_FAIL;
 	}
 
+	applet_db_configure(buffer, buffer_size, BLOCK_SIZE,
+			write_pages, NULL);
+
 	mbx->out.buf_addr = (uint32_t)buffer;
 	mbx->out.buf_size = buffer_size;
 	mbx->out.page_size = BLOCK_SIZE;
@@ -394,37 +423,17 @@ static uint32_t handle_cmd_write_pages(uint32_t cmd, uint32_t *mailbox)
 {
 	union read_write_erase_pages_mailbox *mbx =
 		(union read_write_erase_pages_mailbox*)mailbox;
-	uint32_t offset = mbx->in.offset;
-	uint32_t length = mbx->in.length;
 
 	assert(cmd == APPLET_CMD_WRITE_PAGES);
 
 	/* check that requested size does not overflow buffer */
-	if ((length * BLOCK_SIZE) > buffer_size) {
+	if ((mbx->in.length * BLOCK_SIZE) > buffer_size) {
 		trace_error_wp("Buffer overflow\r\n");
 		return APPLET_FAIL;
 	}
 
-	/* check that requested offset/size does not overflow memory */
-	if (offset + length > mem_size) {
-		trace_error_wp("Memory overflow\r\n");
-		return APPLET_FAIL;
-	}
-
-	if (SD_Write(&lib, offset, buffer, length, NULL, NULL) != SDMMC_OK) {
-		trace_info_wp("Error while writing %u bytes at offset 0x%08x\r\n",
-				(unsigned)(mbx->in.length * BLOCK_SIZE),
-				(unsigned)(mbx->in.offset * BLOCK_SIZE));
-		mbx->out.pages = 0;
-		return APPLET_READ_FAIL;
-	}
-
-	trace_info_wp("Wrote %u bytes at offset 0x%08x\r\n",
-			(unsigned)(mbx->in.length * BLOCK_SIZE),
-			(unsigned)(mbx->in.offset * BLOCK_SIZE));
-	mbx->out.pages = mbx->in.length;
-
-	return APPLET_SUCCESS;
+	return write_pages(mbx->in.offset, mbx->in.length, buffer,
+			&mbx->out.pages);
 }
 
 static uint32_t handle_cmd_read_pages(uint32_t cmd, uint32_t *mailbox)
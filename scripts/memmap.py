@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+# Dump and check the memory map (MMU/MPU configuration) of a program
+#
+# usage: memmap.py [--symbol NAME] <program.elf>
+#
+# The memory map is read from the struct _mem_region table of the ELF file
+# (board_mem_regions by default, see drivers/mm/memmap.h). The effective map
+# is printed as generated by mmu_build_tlb() or mpu_build_config(), followed
+# by errors (exit status 1) and warnings:
+# - regions that cannot be mapped (alignment, size, number of MPU regions),
+# - overlapping regions,
+# - device or strongly-ordered regions that allow instruction fetch,
+# - strongly-ordered mappings that could be device mappings,
+# - program sections placed in unmapped, non-executable or wrongly cached
+#   memory (e.g. .region_nocache in a cacheable region).
+
+import argparse
+import struct
+import sys
+
+SHT_PROGBITS = 1
+SHT_SYMTAB = 2
+SHT_NOBITS = 8
+SHF_ALLOC = 0x2
+SHF_EXECINSTR = 0x4
+
+MEM_TYPES = ['strongly-ordered', 'device', 'normal-nc', 'normal-wt',
+             'normal-wb', 'normal-wb-wa', '?', '?']
+MEM_STRONGLY_ORDERED = 0
+MEM_DEVICE = 1
+MEM_NORMAL_NC = 2
+MEM_TYPE_MASK = 0x7
+MEM_READ_ONLY = 1 << 4
+MEM_EXEC_NEVER = 1 << 5
+MEM_SHAREABLE = 1 << 6
+
+MPU_REGION_COUNT = 16
+SECTION = 1 << 20
+SUPERSECTION = 16 << 20
+
+
+class Elf(object):
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            data = f.read()
+        if data[:4] != b'\x7fELF' or data[4] != 1 or data[5] != 1:
+            raise ValueError('%s: not a little-endian ELF32 file' % path)
+        shoff, = struct.unpack_from('<I', data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from('<HHH', data, 0x2e)
+        sections = [struct.unpack_from('<IIIIIIIIII', data,
+                                       shoff + i * shentsize)
+                    for i in range(shnum)]
+        strtab = sections[shstrndx]
+        self.sections = []
+        self.regions = []
+        self.symbols = {}
+        for (name, stype, flags, addr, offset, size,
+             link, _info, _align, _entsize) in sections:
+            name = self._str(data, strtab[4], name)
+            if flags & SHF_ALLOC and size:
+                self.sections.append((name, addr, size, flags))
+            if stype == SHT_PROGBITS and flags & SHF_ALLOC:
+                self.regions.append((addr, data[offset:offset + size]))
+            elif stype == SHT_SYMTAB:
+                names = sections[link][4]
+                for pos in range(offset, offset + size, 16):
+                    (sym_name, value, sym_size, _info, _other,
+                     _shndx) = struct.unpack_from('<IIIBBH', data, pos)
+                    sym_name = self._str(data, names, sym_name)
+                    if sym_name:
+                        self.symbols.setdefault(sym_name, (value, sym_size))
+        self.data = data
+
+    @staticmethod
+    def _str(data, table, offset):
+        end = data.index(b'\0', table + offset)
+        return data[table + offset:end].decode()
+
+    def read(self, addr, size):
+        for start, data in self.regions:
+            if start <= addr and addr + size <= start + len(data):
+                return data[addr - start:addr - start + size]
+        return None
+
+    def string(self, addr):
+        for start, data in self.regions:
+            if start <= addr < start + len(data):
+                end = data.find(b'\0', addr - start)
+                if end >= 0:
+                    return data[addr - start:end].decode('latin-1')
+        return '<0x%08x>' % addr
+
+
+def describe(attrs):
+    desc = MEM_TYPES[attrs & MEM_TYPE_MASK]
+    desc += ' ro' if attrs & MEM_READ_ONLY else ' rw'
+    desc += '' if attrs & MEM_EXEC_NEVER else 'x'
+    if attrs & MEM_SHAREABLE:
+        desc += ' shareable'
+    return desc
+
+
+def is_peripheral(attrs):
+    return (attrs & MEM_TYPE_MASK) in (MEM_STRONGLY_ORDERED, MEM_DEVICE)
+
+
+def is_cached(attrs):
+    return (attrs & MEM_TYPE_MASK) > MEM_NORMAL_NC
+
+
+def effective_map(regions):
+    # later entries (higher MPU region numbers) take precedence
+    edges = sorted(set([r[1] for r in regions] +
+                       [r[1] + r[2] for r in regions]))
+    result = []
+    for start, end in zip(edges, edges[1:]):
+        owner = None
+        for region in regions:
+            if region[1] <= start and end <= region[1] + region[2]:
+                owner = region
+        if owner is None:
+            continue
+        last = result[-1] if result else None
+        if last and last[1] == start and last[2] is owner:
+            result[-1] = (last[0], end, owner)
+        else:
+            result.append((start, end, owner))
+    return result
+
+
+def lookup(emap, addr):
+    for start, end, region in emap:
+        if start <= addr < end:
+            return region
+    return None
+
+
+def check(elf, regions, mpu, errors, warnings):
+    if mpu and len(regions) > MPU_REGION_COUNT:
+        errors.append('%u regions, the MPU has %u'
+                      % (len(regions), MPU_REGION_COUNT))
+    for index, (name, start, size, attrs) in enumerate(regions):
+        label = '%s (0x%08x)' % (name, start)
+        if start + size > 1 << 32:
+            errors.append('%s: extends past 4GB' % label)
+        if mpu:
+            if size < 32 or size & (size - 1):
+                errors.append('%s: size 0x%x is not a power of 2 >= 32'
+                              % (label, size))
+            elif start & (size - 1):
+                errors.append('%s: not aligned on its size' % label)
+        elif start % SECTION or not size or size % SECTION:
+            errors.append('%s: not a multiple of 1MB' % label)
+        if is_peripheral(attrs) and not attrs & MEM_EXEC_NEVER:
+            warnings.append('%s: %s memory allows instruction fetch, '
+                            'add MEM_EXEC_NEVER'
+                            % (label, MEM_TYPES[attrs & MEM_TYPE_MASK]))
+        if (attrs & MEM_TYPE_MASK) == MEM_STRONGLY_ORDERED:
+            warnings.append('%s: strongly-ordered, MEM_DEVICE allows '
+                            'buffered writes' % label)
+        for other in regions[index + 1:]:
+            if start < other[1] + other[2] and other[1] < start + size:
+                warnings.append('%s: partly overridden by %s (0x%08x)'
+                                % (label, other[0], other[1]))
+
+    emap = effective_map(regions)
+    for name, addr, size, flags in elf.sections:
+        region = lookup(emap, addr)
+        if region is None or lookup(emap, addr + size - 1) is not region:
+            errors.append('section %s (0x%08x-0x%08x) is not covered by '
+                          'a single region' % (name, addr, addr + size))
+            continue
+        attrs = region[3]
+        if flags & SHF_EXECINSTR and attrs & MEM_EXEC_NEVER:
+            errors.append('section %s is in execute-never region %s'
+                          % (name, region[0]))
+        if name == '.region_nocache' and is_cached(attrs):
+            errors.append('section %s is in cacheable region %s'
+                          % (name, region[0]))
+        elif name != '.region_nocache' and not is_cached(attrs):
+            warnings.append('section %s is in non-cacheable region %s'
+                            % (name, region[0]))
+    return emap
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Dump and check the memory map of a program')
+    parser.add_argument('--symbol', default='board_mem_regions',
+                        help='name of the struct _mem_region table')
+    parser.add_argument('elf', help='ELF file of the program')
+    opts = parser.parse_args()
+
+    elf = Elf(opts.elf)
+    if opts.symbol not in elf.symbols:
+        sys.stderr.write('%s: symbol %s not found\n'
+                         % (opts.elf, opts.symbol))
+        return 1
+    addr, size = elf.symbols[opts.symbol]
+    table = elf.read(addr, size)
+    if table is None:
+        sys.stderr.write('%s: cannot read %s\n' % (opts.elf, opts.symbol))
+        return 1
+    regions = []
+    for pos in range(0, size - size % 16, 16):
+        name, start, length, attrs = struct.unpack_from('<IIII', table, pos)
+        regions.append((elf.string(name), start, length, attrs))
+    mpu = 'mpu_build_config' in elf.symbols
+
+    errors = []
+    warnings = []
+    emap = check(elf, regions, mpu, errors, warnings)
+
+    print('%s memory map, %u regions:' % ('MPU' if mpu else 'MMU',
+                                          len(regions)))
+    for start, end, (name, _start, _size, attrs) in emap:
+        note = ''
+        first = (start + SUPERSECTION - 1) // SUPERSECTION * SUPERSECTION
+        if not mpu and first + SUPERSECTION <= end:
+            note = ' (supersections)'
+        print('  0x%08x-0x%08x %7uK  %-26s %s%s'
+              % (start, end - 1, (end - start) // 1024, describe(attrs),
+                 name, note))
+    for warning in warnings:
+        print('warning: ' + warning)
+    for error in errors:
+        print('error: ' + error)
+    return 1 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
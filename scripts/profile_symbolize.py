@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+# Turn sampling profiler logs (CONFIG_PROFILE) into a per-function histogram
+#
+# usage: profile_symbolize.py [--limit N] <program.elf> <dump> [<dump>...]
+#
+# A dump is any file containing one or more copies of profile_log: a capture
+# of profile_dump() output from the console, data received from USB CDC or a
+# RAM dump taken with a debugger. Samples are attributed to the function
+# symbols of the ELF file, samples outside of any function are reported by
+# address.
+
+import argparse
+import bisect
+import struct
+import sys
+
+MAGIC = 0x4C465250
+
+SHT_SYMTAB = 2
+STT_FUNC = 2
+
+
+class Elf(object):
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            data = f.read()
+        if data[:4] != b'\x7fELF' or data[4] != 1 or data[5] != 1:
+            raise ValueError('%s: not a little-endian ELF32 file' % path)
+        shoff, = struct.unpack_from('<I', data, 0x20)
+        shentsize, shnum, _shstrndx = struct.unpack_from('<HHH', data, 0x2e)
+        sections = [struct.unpack_from('<IIIIIIIIII', data,
+                                       shoff + i * shentsize)
+                    for i in range(shnum)]
+        functions = {}
+        for (_name, stype, _flags, _addr, offset, size,
+             link, _info, _align, _entsize) in sections:
+            if stype != SHT_SYMTAB:
+                continue
+            names = sections[link][4]
+            for pos in range(offset, offset + size, 16):
+                (sym_name, value, sym_size, info, _other,
+                 _shndx) = struct.unpack_from('<IIIBBH', data, pos)
+                if info & 0xf != STT_FUNC or not sym_name:
+                    continue
+                end = data.index(b'\0', names + sym_name)
+                # clear the Thumb bit
+                functions.setdefault(value & ~1, (
+                    data[names + sym_name:end].decode(), sym_size))
+        self.starts = sorted(functions)
+        self.functions = [functions[start] for start in self.starts]
+
+    def lookup(self, addr):
+        index = bisect.bisect_right(self.starts, addr) - 1
+        if index >= 0:
+            name, size = self.functions[index]
+            # size is 0 for assembly functions without .size directive
+            if addr < self.starts[index] + max(size, 4) or size == 0:
+                return name
+        return None
+
+
+def find_logs(data):
+    pattern = struct.pack('<I', MAGIC)
+    start = data.find(pattern)
+    while start >= 0:
+        if start + 16 <= len(data):
+            size, count, dropped = struct.unpack_from('<III', data, start + 4)
+            end = start + 16 + size * 4
+            if size and count <= size and end <= len(data):
+                samples = struct.unpack_from('<%uI' % count, data, start + 16)
+                yield samples, dropped
+                start = data.find(pattern, end)
+                continue
+        start = data.find(pattern, start + 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Print a per-function histogram of profiler samples')
+    parser.add_argument('--limit', type=int, default=0,
+                        help='only print the N most sampled functions')
+    parser.add_argument('elf', help='ELF file of the profiled program')
+    parser.add_argument('dumps', nargs='+',
+                        help='files containing profile_log dumps')
+    opts = parser.parse_args()
+
+    elf = Elf(opts.elf)
+    histogram = {}
+    total = 0
+    dropped = 0
+    for path in opts.dumps:
+        with open(path, 'rb') as f:
+            data = f.read()
+        for samples, lost in find_logs(data):
+            dropped += lost
+            for pc in samples:
+                name = elf.lookup(pc & ~1) or '0x%08x' % pc
+                histogram[name] = histogram.get(name, 0) + 1
+                total += 1
+    if not total:
+        sys.stderr.write('no profile log found\n')
+        return 1
+
+    ranking = sorted(histogram.items(), key=lambda item: (-item[1], item[0]))
+    if opts.limit:
+        ranking = ranking[:opts.limit]
+    print('%8s %7s  %s' % ('samples', '%', 'function'))
+    for name, count in ranking:
+        print('%8u %6.2f%%  %s' % (count, 100.0 * count / total, name))
+    print('%8u samples' % total)
+    if dropped:
+        sys.stderr.write('%u samples dropped, the log was full\n' % dropped)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
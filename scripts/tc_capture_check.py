@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+# Check the timestamp extension of the TC continuous capture on the host
+#
+# usage: tc_capture_check.py [--bits N] [--edges N] [--seed N]
+#
+# Models a free running counter of N bits capturing random edges into a DMA
+# ring, with overflow interrupts handled after a variable latency, and runs
+# the extension algorithm of drivers/peripherals/tcd.c (_tcd_ring_overflow()
+# and _tcd_ring_extend()) on the result. Intervals between edges range from
+# a few ticks to several counter periods. The statistics are read every
+# half wrap queue, so the 8-bit queue indexes wrap many times over a run.
+#
+# Every extended timestamp must match the edge time, except for edges taken
+# before an overflow but not above the counter value read by its interrupt:
+# these cannot be told apart from edges taken between the overflow and its
+# interrupt. They only exist if the interrupt latency varies or if the DMA
+# writes a capture after the interrupt reads the ring position. Such edges
+# are counted separately, a run with a fixed latency and no DMA delay must
+# have none. Edges within the first interrupt latency after the start are
+# as ambiguous and are not generated. Exit status is 1 on any other
+# mismatch.
+
+import argparse
+import random
+import sys
+
+WRAP_QUEUE_SIZE = 32
+
+
+def simulate(bits, edges, lat_min, lat_max, dma_lag, rng):
+    period = 1 << bits
+    mask = period - 1
+
+    # edge times, long intervals included
+    times = []
+    t = rng.randrange(lat_max + 1, period)
+    for _ in range(edges):
+        times.append(t)
+        kind = rng.random()
+        if kind < 0.4:
+            t += rng.randrange(1, period // 16)
+        elif kind < 0.8:
+            t += rng.randrange(period // 2, 2 * period)
+        else:
+            t += rng.randrange(2 * period, 5 * period)
+    end = times[-1] + period
+
+    # overflow interrupts: (time, pos, cv), pos read before cv
+    isrs = []
+    k = 1
+    pos = 0
+    while k * period < end:
+        when = k * period + rng.randint(lat_min, lat_max)
+        while pos < len(times) and times[pos] + dma_lag <= when:
+            pos += 1
+        isrs.append((when, pos, when & mask, k))
+        k += 1
+    return times, isrs
+
+
+class Ring:
+    """Mirror of the wrap queue of _tcd_ring_overflow() and
+    _tcd_ring_extend(), with their 8-bit indexes"""
+
+    def __init__(self, bits):
+        self.bits = bits
+        self.mask = (1 << bits) - 1
+        self.wraps = [None] * WRAP_QUEUE_SIZE
+        self.wrap_in = 0
+        self.wrap_out = 0
+        self.epoch = 0
+        self.lost = 0
+
+    def overflow(self, pos, cv):
+        last = ((self.wrap_in - 1) & 0xFF) % WRAP_QUEUE_SIZE
+        if self.wrap_in != self.wrap_out and self.wraps[last][0] == pos:
+            self.wraps[last][1] += 1
+        elif (self.wrap_in - self.wrap_out) & 0xFF < WRAP_QUEUE_SIZE:
+            last = self.wrap_in % WRAP_QUEUE_SIZE
+            self.wraps[last] = [pos, 1, cv]
+            self.wrap_in = (self.wrap_in + 1) & 0xFF
+        else:
+            self.wraps[last][1] += 1
+            self.lost += 1
+
+    def extend(self, pos, raw):
+        raw &= self.mask
+        out = None
+        while self.wrap_out != self.wrap_in:
+            out = self.wrap_out % WRAP_QUEUE_SIZE
+            if self.wraps[out][0] > pos:
+                break
+            self.epoch += self.wraps[out][1]
+            self.wrap_out = (self.wrap_out + 1) & 0xFF
+        epoch = self.epoch
+        if self.wrap_out != self.wrap_in and raw <= self.wraps[out][2]:
+            epoch += 1
+        return (epoch << self.bits) | raw
+
+
+def extend(times, isrs, bits):
+    """Run the interrupts and the statistics reads in time order. The
+    statistics are read every WRAP_QUEUE_SIZE / 2 overflows, so the 8-bit
+    queue indexes wrap many times over a run."""
+    ring = Ring(bits)
+    result = []
+    for i, (when, pos, cv, _k) in enumerate(isrs):
+        ring.overflow(pos, cv)
+        if (i + 1) % (WRAP_QUEUE_SIZE // 2) and i + 1 != len(isrs):
+            continue
+        # _tcd_ring_update(): captures written so far
+        head = len(times) if i + 1 == len(isrs) else pos
+        while len(result) < head:
+            n = len(result)
+            result.append(ring.extend(n, times[n]))
+    return result, ring.lost
+
+
+def ambiguous(t, isrs, bits):
+    period = 1 << bits
+    mask = period - 1
+    # next overflow after the edge, and its interrupt
+    k = t // period + 1
+    if k > len(isrs):
+        return False
+    when, _pos, cv, _k = isrs[k - 1]
+    return when > t and (t & mask) <= cv
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Check the TC capture timestamp extension')
+    parser.add_argument('--bits', type=int, default=16,
+                        help='counter size (default 16)')
+    parser.add_argument('--edges', type=int, default=40000,
+                        help='number of edges per run (default 40000)')
+    parser.add_argument('--seed', type=int, default=1)
+    opts = parser.parse_args()
+
+    rng = random.Random(opts.seed)
+    period = 1 << opts.bits
+    # interrupt latency and DMA delay in ticks
+    runs = [('fixed latency', 40, 40, 0), ('variable latency', 20, 200, 2)]
+    if opts.bits < 10 or opts.bits > 32:
+        sys.stderr.write('counter size must be 10 to 32 bits, the modelled '
+                         'interrupt latency is up to 200 ticks\n')
+        return 1
+    failed = False
+    for name, lat_min, lat_max, dma_lag in runs:
+        errors = ambiguous_edges = long_intervals = 0
+        times, isrs = simulate(opts.bits, opts.edges, lat_min, lat_max,
+                               dma_lag, rng)
+        extended, lost = extend(times, isrs, opts.bits)
+        if lost:
+            sys.stderr.write('%s: %u overflows lost\n' % (name, lost))
+            return 1
+        for i, (t, ext) in enumerate(zip(times, extended)):
+            if i and t - times[i - 1] >= period:
+                long_intervals += 1
+            if ext == t:
+                continue
+            if ambiguous(t, isrs, opts.bits):
+                ambiguous_edges += 1
+            else:
+                errors += 1
+        base = len(times)
+        if lat_min == lat_max and not dma_lag and ambiguous_edges:
+            errors += ambiguous_edges
+        print('%s: %u edges (%u after a long interval), %u errors, '
+              '%u within the latency variation'
+              % (name, base, long_intervals, errors, ambiguous_edges))
+        failed = failed or errors != 0
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+# Decode binary trace logs (CONFIG_TRACE_BINARY) into text
+#
+# usage: trace_decode.py <program.elf> <dump> [<dump>...]
+#
+# A dump is any file containing one or more copies of trace_binary_log:
+# a capture of trace_binary_dump() output from the console, data received
+# from USB CDC or a RAM dump taken with a debugger. Format strings are read
+# from the .trace_fmt section of the ELF file, %s arguments pointing to
+# initialized data of the program are resolved from the ELF file as well.
+
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = 0x4C425254
+SYNC_MASK = 0xF0000000
+SYNC = 0xA0000000
+LEVEL_POS = 25
+NARGS_POS = 21
+ID_MASK = 0x1FFFFF
+MAX_ARGS = 12
+
+SHT_PROGBITS = 1
+SHF_ALLOC = 0x2
+
+CONV = re.compile(r'%([-+ #0]*)(\d+)?(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diuxXocsp%])')
+
+
+class Elf(object):
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            data = f.read()
+        if data[:4] != b'\x7fELF' or data[5] != 1:
+            raise ValueError('%s: not a little-endian ELF file' % path)
+        if data[4] == 1:
+            shoff, = struct.unpack_from('<I', data, 0x20)
+            shentsize, shnum, shstrndx = struct.unpack_from('<HHH', data, 0x2e)
+            shdr = '<IIIIIIIIII'
+        else:
+            shoff, = struct.unpack_from('<Q', data, 0x28)
+            shentsize, shnum, shstrndx = struct.unpack_from('<HHH', data, 0x3a)
+            shdr = '<IIQQQQIIQQ'
+        sections = []
+        for i in range(shnum):
+            sections.append(struct.unpack_from(shdr, data,
+                                               shoff + i * shentsize))
+        strtab = sections[shstrndx]
+        self.fmt = b''
+        self.regions = []
+        for (name, stype, flags, addr, offset, size,
+             _link, _info, _align, _entsize) in sections:
+            name_end = data.index(b'\0', strtab[4] + name)
+            name = data[strtab[4] + name:name_end].decode()
+            if name == '.trace_fmt':
+                self.fmt = data[offset:offset + size]
+            elif stype == SHT_PROGBITS and flags & SHF_ALLOC:
+                self.regions.append((addr, data[offset:offset + size]))
+        if not self.fmt:
+            raise ValueError('%s: no .trace_fmt section' % path)
+
+    def format_string(self, fmt_id):
+        if fmt_id >= len(self.fmt):
+            return None
+        end = self.fmt.find(b'\0', fmt_id)
+        if end < 0:
+            return None
+        return self.fmt[fmt_id:end].decode('latin-1')
+
+    def string(self, addr):
+        for start, data in self.regions:
+            if start <= addr < start + len(data):
+                end = data.find(b'\0', addr - start)
+                if end >= 0:
+                    return data[addr - start:end].decode('latin-1')
+        return '<0x%08x>' % addr
+
+
+def count_args(fmt):
+    return sum(1 for m in CONV.finditer(fmt) if m.group(5) != '%')
+
+
+def format_record(elf, fmt, args):
+    args = list(args)
+
+    def conv(m):
+        flags, width, prec, _length, c = m.groups()
+        if c == '%':
+            return '%'
+        value = args.pop(0)
+        spec = '%' + flags + (width or '') + ('.' + prec if prec else '')
+        if c in 'di':
+            if value & 0x80000000:
+                value -= 1 << 32
+            return (spec + 'd') % value
+        if c == 'u':
+            return (spec + 'd') % value
+        if c in 'xXo':
+            return (spec + c) % value
+        if c == 'c':
+            return (spec + 'c') % chr(value & 0xff)
+        if c == 'p':
+            return (spec + 's') % ('0x%08x' % value)
+        return (spec + 's') % elf.string(value)
+
+    return CONV.sub(conv, fmt)
+
+
+def decode_log(elf, words, head, out):
+    size = len(words)
+    mask = size - 1
+    pos = max(0, head - size)
+    skipped = 0
+    while pos < head:
+        header = words[pos & mask]
+        nargs = (header >> NARGS_POS) & 0xF
+        fmt = None
+        if (header & SYNC_MASK) == SYNC and nargs <= MAX_ARGS \
+                and pos + 3 + nargs <= head:
+            fmt = elf.format_string(header & ID_MASK)
+            if fmt is not None and count_args(fmt) != nargs:
+                fmt = None
+        if fmt is None:
+            # overwritten or partial record, resynchronize on next word
+            skipped += 1
+            pos += 1
+            continue
+        timestamp = words[(pos + 1) & mask] | (words[(pos + 2) & mask] << 32)
+        args = [words[(pos + 3 + i) & mask] for i in range(nargs)]
+        text = format_record(elf, fmt, args)
+        out.write('[%5u.%09u] %s' % (timestamp // 1000000000,
+                                     timestamp % 1000000000, text))
+        if not text.endswith('\n'):
+            out.write('\n')
+        pos += 3 + nargs
+    return skipped
+
+
+def find_logs(data):
+    pattern = struct.pack('<I', MAGIC)
+    start = data.find(pattern)
+    while start >= 0:
+        if start + 12 <= len(data):
+            size, head = struct.unpack_from('<II', data, start + 4)
+            end = start + 12 + size * 4
+            if size and (size & (size - 1)) == 0 and end <= len(data):
+                words = struct.unpack_from('<%uI' % size, data, start + 12)
+                yield words, head
+                start = data.find(pattern, end)
+                continue
+        start = data.find(pattern, start + 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Decode binary trace logs into text')
+    parser.add_argument('elf', help='ELF file of the traced program')
+    parser.add_argument('dumps', nargs='+',
+                        help='files containing trace_binary_log dumps')
+    opts = parser.parse_args()
+
+    elf = Elf(opts.elf)
+    found = False
+    for path in opts.dumps:
+        with open(path, 'rb') as f:
+            data = f.read()
+        for words, head in find_logs(data):
+            found = True
+            skipped = decode_log(elf, words, head, sys.stdout)
+            if skipped:
+                sys.stderr.write('%s: skipped %u words of partial records\n'
+                                 % (path, skipped))
+    if not found:
+        sys.stderr.write('no trace log found\n')
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+# Check the USB audio asynchronous feedback against host/codec clock drift
+#
+# usage: uac_feedback_check.py [--seconds N] [--high-speed] [--seed N]
+#
+# Models the usb_audio_speaker example built with CONFIG_USB_AUDIO_ASYNC: the
+# host sends 1ms packets whose size follows the last feedback value it read,
+# the device queues them in BUFFERS buffers and the codec consumes them from
+# its own clock, off by a few hundred ppm from the host clock. The feedback is
+# computed as audd_stream_feedback_update() does, from the bytes the codec has
+# consumed (counted when a whole buffer is done) and the USB frame number.
+#
+# Each run must keep the number of queued buffers bounded, without any
+# overrun or underrun after the start, and the feedback value must converge:
+# its average over the second half of the run must match the codec rate. The
+# same drifts are also run with a host ignoring the feedback, to show the
+# buffer drift they would cause. Exit status is 1 if a feedback run fails.
+
+import argparse
+import random
+import sys
+
+SAMPLE_RATE = 48000
+BYTES_PER_SAMPLE = 4            # 2 channels of 16 bits
+BUFFERS = 32                    # examples/usb_audio_speaker/main.c
+BUFFER_THRESHOLD = 8
+FB_REFRESH = 5                  # AUDDSpeakerDriverDescriptors_FB_REFRESH
+MIN_WINDOW = 128                # AUDD_FEEDBACK_MIN_WINDOW
+
+
+class Feedback:
+    """Mirror of audd_stream_feedback_initialize() and _update()"""
+
+    def __init__(self, high_speed):
+        self.high_speed = high_speed
+        self.shift = 16 if high_speed else 14
+        per_frame = 8000 if high_speed else 1000
+        self.nominal = (SAMPLE_RATE << self.shift) // per_frame
+        self.value = self.nominal
+        self.started = False
+        self.acc_frames = 0
+        self.acc_ticks = 0
+        self.updates = 0
+        self.frame_mask = 0x3FFF if high_speed else 0x7FF
+        self.window = max(1 << FB_REFRESH, MIN_WINDOW)
+        if high_speed:
+            self.window *= 8
+
+    def update(self, frame, count):
+        if not self.started:
+            self.last_frame = frame & self.frame_mask
+            self.last_count = count
+            self.started = True
+            return self.value
+        frame &= self.frame_mask
+        elapsed = (frame - self.last_frame) & self.frame_mask
+        if elapsed == 0:
+            return self.value
+        self.acc_ticks += (count - self.last_count) & 0xFFFFFFFF
+        self.acc_frames += elapsed
+        self.last_frame = frame
+        self.last_count = count
+        if self.acc_frames >= self.window:
+            value = (self.acc_ticks << self.shift) // \
+                (BYTES_PER_SAMPLE * self.acc_frames)
+            if self.nominal - (self.nominal >> 3) < value < \
+                    self.nominal + (self.nominal >> 3):
+                self.value = value
+                self.updates += 1
+            self.acc_frames = 0
+            self.acc_ticks = 0
+        return self.value
+
+
+def simulate(seconds, drift, high_speed, use_feedback, rng):
+    """drift(t) gives the codec clock offset in ppm at second t"""
+    uframes = 8 if high_speed else 1
+    shift = 16 if high_speed else 14
+    fb = None
+    host_fb = None              # value read by the host, None: nominal
+    host_acc = 0.0
+    queue = []                  # sizes in samples of the queued buffers
+    playing = False
+    current = 0.0               # samples left in the buffer being played
+    current_size = 0
+    played = 0                  # bytes consumed by the codec
+    overruns = underruns = 0
+    min_count = max_count = None
+    fb_sum = fb_frames = 0
+    rate_sum = 0.0
+    frames = seconds * 1000
+
+    for frame in range(frames):
+        rate = SAMPLE_RATE / 1000.0 * (1 + drift(frame / 1000.0) * 1e-6)
+
+        # host: read the feedback every 2^bRefresh frames
+        if use_feedback and fb is not None and \
+                frame % (1 << FB_REFRESH) == 0:
+            host_fb = fb.value
+        if host_fb is None:
+            per_frame = SAMPLE_RATE / 1000.0
+        else:
+            per_frame = host_fb * uframes / float(1 << shift)
+        host_acc += per_frame
+        size = int(host_acc)
+        host_acc -= size
+
+        # device: _usb_frame_recv_callback()
+        if len(queue) >= BUFFERS - 1:
+            queue.pop(0)
+            overruns += 1
+        queue.append(size)
+        if len(queue) >= BUFFER_THRESHOLD and not playing:
+            playing = True
+            fb = Feedback(high_speed)
+            current_size = queue.pop(0)
+            current = current_size
+        if playing:
+            # the recv callback is sometimes delayed by a few frames
+            if rng.random() > 0.02:
+                fb.update(frame * uframes, played)
+            if frame >= frames // 2:
+                fb_sum += fb.value
+                fb_frames += 1
+                rate_sum += rate
+            count = len(queue)
+            if min_count is None or count < min_count:
+                min_count = count
+            if max_count is None or count > max_count:
+                max_count = count
+
+        # codec: consume one frame worth of samples
+        consume = rate
+        while playing and consume > 0:
+            step = min(consume, current)
+            current -= step
+            consume -= step
+            if current <= 0:
+                # _audio_transfer_callback()
+                played += current_size * BYTES_PER_SAMPLE
+                if queue:
+                    current_size = queue.pop(0)
+                    current += current_size
+                else:
+                    playing = False
+                    underruns += 1
+
+    if fb_frames:
+        fb_avg = fb_sum / float(fb_frames) * uframes / float(1 << shift)
+        rate_avg = rate_sum / fb_frames
+    else:
+        fb_avg = rate_avg = 0.0
+    return {
+        'overruns': overruns,
+        'underruns': underruns,
+        'min': min_count,
+        'max': max_count,
+        'fb_error': (fb_avg - rate_avg) / rate_avg * 1e6 if rate_avg else 0,
+        'updates': fb.updates if fb else 0,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Check the USB audio asynchronous feedback')
+    parser.add_argument('--seconds', type=int, default=300,
+                        help='length of each run (default 300)')
+    parser.add_argument('--high-speed', action='store_true',
+                        help='16.16 feedback per microframe')
+    parser.add_argument('--seed', type=int, default=1)
+    opts = parser.parse_args()
+
+    rng = random.Random(opts.seed)
+    drifts = [
+        ('-1000 ppm', lambda t: -1000.0),
+        ('-250 ppm', lambda t: -250.0),
+        ('0 ppm', lambda t: 0.0),
+        ('+250 ppm', lambda t: 250.0),
+        ('+1000 ppm', lambda t: 1000.0),
+        ('wander', lambda t: 300.0 * ((t % 120.0) / 60.0 - 1.0)),
+    ]
+    failed = False
+    for name, drift in drifts:
+        res = simulate(opts.seconds, drift, opts.high_speed, True, rng)
+        ref = simulate(opts.seconds, drift, opts.high_speed, False, rng)
+        # one buffer of quantization over half the run, plus the wander
+        ok = (res['overruns'] == 0 and res['underruns'] == 0 and
+              res['min'] > 0 and res['max'] < BUFFERS - 2 and
+              abs(res['fb_error']) < 20)
+        print('%-10s feedback: buffers %u..%u, %u overruns, %u underruns, '
+              'average error %+.1f ppm (%u values) %s'
+              % (name, res['min'], res['max'], res['overruns'],
+                 res['underruns'], res['fb_error'], res['updates'],
+                 'ok' if ok else 'FAILED'))
+        print('%-10s nominal:  buffers %s..%s, %u overruns, %u underruns'
+              % ('', ref['min'], ref['max'], ref['overruns'],
+                 ref['underruns']))
+        failed = failed or not ok
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,394 @@
+#!/usr/bin/env python3
+# Check the UDPHS DMA multi-buffer transfers on a register model
+#
+# usage: udphs_multi_check.py [--buffers N] [--seed N]
+#
+# Runs the multi-buffer-list code of drivers/usb/usbd_udphs.c
+# (udphs_add_buffer(), udphs_dma_multi_start() and udphs_dma_multi_handler())
+# against a model of one UDPHS DMA channel: descriptors are loaded from
+# memory when LDNXT_DSC is written or when a buffer ends with LDNXT_DSC set
+# in the loaded control, and the channel stops otherwise. The host reads IN
+# packets or sends OUT packets, some of them short, while the channel runs.
+#
+# The channel keeps running while the driver works: it may end a buffer
+# between the status and next descriptor reads of the interrupt handler, or
+# before a new IN buffer is linked to the descriptor it already loaded.
+# Interrupts are serviced after a random delay, so several buffers may
+# complete per interrupt. The application queues buffers from the main loop
+# and, in some runs, from the transfer callback.
+#
+# Every buffer must complete exactly once, in order, with the byte count
+# the host actually transferred, and the data seen by the host (IN) or
+# written to the buffers (OUT) must match. Exit status is 1 on any error
+# or if a run stalls.
+
+import argparse
+import random
+import sys
+
+# UDPHS_DMACONTROL
+CHANN_ENB = 1 << 0
+LDNXT_DSC = 1 << 1
+END_TR_EN = 1 << 2
+END_B_EN = 1 << 3
+END_TR_IT = 1 << 4
+END_BUFFIT = 1 << 5
+BUFF_LENGTH_POS = 16
+
+# UDPHS_DMASTATUS
+ST_CHANN_ENB = 1 << 0
+END_TR_ST = 1 << 4
+END_BF_ST = 1 << 5
+BUFF_COUNT_POS = 16
+
+# usbd_udphs.c
+MBL_FULL = 1
+IDLE, SENDINGM, RECEIVINGM = 0, 1, 2
+DESC_BASE = 0x20001000
+DESC_SIZE = 16
+UDPHS_MULTI_DESC_COUNT = 8
+
+
+class Desc:
+    def __init__(self):
+        self.next = 0
+        self.addr = None
+        self.ctrl = 0
+
+
+class Channel:
+    """One UDPHS DMA channel and the host traffic on its endpoint"""
+
+    def __init__(self, desc, is_in, max_packet, rng):
+        self.desc = desc
+        self.is_in = is_in
+        self.max_packet = max_packet
+        self.rng = rng
+        self.nxtdsc = 0
+        self.ctrl = 0
+        self.addr = None            # (buffer, offset)
+        self.count = 0
+        self.enabled = False
+        self.status = 0
+        self.irq = False
+        self.host = []              # IN: bytes read, OUT: bytes sent
+        self.fifo = []              # OUT: packets in the endpoint banks
+        self.sent = 0
+
+    def write_control(self, value):
+        self.ctrl = value
+        if value & CHANN_ENB:
+            self.enabled = True
+        elif value & LDNXT_DSC and not self.enabled:
+            self.load()
+        else:
+            self.enabled = False
+
+    def load(self):
+        d = self.desc[(self.nxtdsc - DESC_BASE) // DESC_SIZE]
+        self.nxtdsc = d.next
+        self.addr = [d.addr, 0]
+        self.ctrl = d.ctrl
+        self.count = d.ctrl >> BUFF_LENGTH_POS
+        self.enabled = (d.ctrl & CHANN_ENB) != 0
+
+    def read_status(self):
+        value = self.status | (self.count << BUFF_COUNT_POS)
+        if self.enabled:
+            value |= ST_CHANN_ENB
+        self.status = 0
+        self.irq = False
+        return value
+
+    def _end(self, flag, it):
+        self.status |= flag
+        if self.ctrl & it:
+            self.irq = True
+        if self.ctrl & LDNXT_DSC:
+            self.load()
+        else:
+            self.enabled = False
+
+    def tick(self):
+        """Host traffic for one packet"""
+        if self.is_in:
+            if not self.enabled:
+                return
+            buf, off = self.addr
+            n = min(self.max_packet, self.count)
+            self.host.extend(buf.data[off:off + n])
+            self.addr[1] += n
+            self.count -= n
+            if self.count == 0:
+                self._end(END_BF_ST, END_BUFFIT)
+            return
+        # OUT: the host fills the two banks, the channel empties them
+        if len(self.fifo) < 2:
+            if self.rng.random() < 0.15:
+                n = self.rng.randrange(0, self.max_packet)
+            else:
+                n = self.max_packet
+            pkt = list(range(self.sent, self.sent + n))
+            self.sent += n
+            self.host.extend(pkt)
+            self.fifo.append([pkt, n < self.max_packet])
+        while self.enabled and self.fifo:
+            pkt, short = self.fifo[0]
+            buf, off = self.addr
+            n = min(len(pkt), self.count)
+            buf.data[off:off + n] = pkt[:n]
+            del pkt[:n]
+            self.addr[1] += n
+            self.count -= n
+            if not pkt:
+                self.fifo.pop(0)
+            if self.count == 0:
+                self._end(END_BF_ST, END_BUFFIT)
+            elif short and not pkt and self.ctrl & END_TR_EN:
+                self._end(END_TR_ST, END_TR_IT)
+            else:
+                continue
+            break
+
+
+class Buffer:
+    def __init__(self, data, size):
+        self.data = data
+        self.size = size
+        self.remaining = 0
+        self.transferred = 0
+        self.buffered = 0
+
+
+class Endpoint:
+    """Mirror of the multi-buffer-list code of a DMA endpoint"""
+
+    def __init__(self, is_in, list_size, offset, max_packet, race, rng):
+        self.is_in = is_in
+        self.state = IDLE
+        self.callback = None
+        self.list_size = list_size
+        self.buffers = [Buffer(None, 0) for _ in range(list_size)]
+        self.list_state = 0
+        self.out = 0
+        self.in_ = 0
+        self.offset = offset
+        self.dma_pending = 0
+        self.dma_active = 0
+        self.dma_running = False
+        self.ien = False
+        self.desc = [Desc() for _ in range(UDPHS_MULTI_DESC_COUNT)]
+        self.chan = Channel(self.desc, is_in, max_packet, rng)
+        # chance for the channel to progress within the driver code
+        self.race = race
+        self.rng = rng
+
+    def _race(self):
+        if self.rng.random() < self.race:
+            self.chan.tick()
+
+    def add_buffer(self, data, data_len):
+        """udphs_add_buffer(), interrupts masked"""
+        if data_len >= 0x10000 or data_len == 0:
+            return False
+        if self.list_state == MBL_FULL:
+            return False
+        tx = self.buffers[self.in_]
+        tx.data = data
+        tx.size = tx.remaining = data_len
+        tx.transferred = 0
+        tx.buffered = 0
+        self.in_ = 0 if self.in_ >= self.list_size - 1 else self.in_ + 1
+        self.list_state = MBL_FULL if self.in_ == self.out else 0
+
+        self.dma_pending += 1
+        if self.state == IDLE:
+            if self.dma_pending < self.offset:
+                return True
+            self.state = SENDINGM if self.is_in else RECEIVINGM
+        self.multi_start()
+        return True
+
+    def multi_start(self):
+        """udphs_dma_multi_start()"""
+        while self.dma_pending:
+            if not self.is_in and self.dma_active:
+                break
+            index = (self.out + self.dma_active) % self.list_size
+            buffer = self.buffers[index]
+            buffer.buffered = buffer.size
+            desc = self.desc[index]
+            desc.next = DESC_BASE + DESC_SIZE * ((index + 1) % self.list_size)
+            desc.addr = buffer
+            desc.ctrl = CHANN_ENB | (buffer.size << BUFF_LENGTH_POS) | \
+                END_B_EN | END_BUFFIT
+            if not self.is_in:
+                desc.ctrl |= END_TR_EN | END_TR_IT
+
+            self._race()
+            if self.dma_active and self.dma_running:
+                prev = self.desc[(index + self.list_size - 1) %
+                                 self.list_size]
+                prev.ctrl |= LDNXT_DSC
+
+            self.dma_pending -= 1
+            self.dma_active += 1
+
+        if self.dma_active and not self.dma_running:
+            self.dma_running = True
+            self.ien = True
+            self.chan.nxtdsc = DESC_BASE + DESC_SIZE * self.out
+            self.chan.write_control(0)
+            self.chan.write_control(LDNXT_DSC)
+
+    def dma_handler(self):
+        """udphs_dma_handler(), multi-buffer states only"""
+        dma_status = self.chan.read_status()
+        if self.state not in (SENDINGM, RECEIVINGM):
+            raise AssertionError('DMA interrupt in single transfer state')
+        self._race()
+        self.multi_handler(dma_status)
+
+    def multi_handler(self, dma_status):
+        """udphs_dma_multi_handler()"""
+        running = (dma_status & ST_CHANN_ENB) != 0
+        if not self.dma_active:
+            return
+        nxt = (self.chan.nxtdsc - DESC_BASE) // DESC_SIZE
+        loaded = (nxt + self.list_size - 1) % self.list_size
+        done = (loaded + self.list_size - self.out) % self.list_size
+        if not running:
+            done += 1
+        if done > self.dma_active:
+            done = self.dma_active
+
+        while done:
+            done -= 1
+            buffer = self.buffers[self.out]
+            buffer.transferred = buffer.size
+            if done == 0 and not running:
+                buffer.transferred -= dma_status >> BUFF_COUNT_POS
+            buffer.buffered = 0
+            buffer.remaining = 0
+            self.out = (self.out + 1) % self.list_size
+            self.dma_active -= 1
+            self.list_state = 0
+            if self.callback:
+                self.callback(buffer, buffer.transferred,
+                              self.dma_active + self.dma_pending)
+
+        if not running:
+            self.dma_running = False
+        self.multi_start()
+
+        if not self.dma_active and not self.dma_pending:
+            self.ien = False
+            self.state = IDLE
+
+
+def run(is_in, count, list_size, offset, max_packet, from_callback, rng):
+    ep = Endpoint(is_in, list_size, offset, max_packet, 0.3, rng)
+    submitted = []
+    completed = []
+    errors = []
+    next_byte = [0]
+
+    def new_buffer():
+        size = rng.choice([rng.randrange(1, 4 * max_packet),
+                           max_packet * rng.randrange(1, 4)])
+        if is_in:
+            data = list(range(next_byte[0], next_byte[0] + size))
+            next_byte[0] += size
+        else:
+            data = [None] * size
+        return Buffer(data, size)
+
+    def submit():
+        buf = new_buffer()
+        if not ep.add_buffer(buf.data, buf.size):
+            return False
+        submitted.append(buf)
+        return True
+
+    def callback(buffer, transferred, remaining):
+        completed.append((buffer.data, transferred))
+        queued = len(submitted) - len(completed)
+        if remaining != queued:
+            errors.append('buffer %u: %u queued, callback says %u'
+                          % (len(completed) - 1, queued, remaining))
+        if from_callback and rng.random() < 0.7:
+            submit()
+
+    ep.callback = callback
+
+    steps = 0
+    while len(completed) < count:
+        steps += 1
+        r = rng.random()
+        if r < 0.5:
+            ep.chan.tick()
+        elif r < 0.75:
+            if ep.chan.irq and ep.ien:
+                ep.dma_handler()
+        elif not from_callback or r < 0.8 or not submitted:
+            submit()
+        if steps > 200 * count + 10000:
+            errors.append('stalled after %u of %u buffers (%u queued, '
+                          '%u on the DMA)' % (len(completed), count,
+                                              ep.dma_pending, ep.dma_active))
+            break
+
+    # check the data, in order
+    pos = 0
+    for i, (data, transferred) in enumerate(completed):
+        if data is not submitted[i].data:
+            errors.append('buffer %u completed out of order' % i)
+            break
+        if is_in:
+            if transferred != len(data) or \
+                    ep.chan.host[pos:pos + transferred] != data:
+                errors.append('buffer %u: %u bytes, host data differs'
+                              % (i, transferred))
+                break
+        else:
+            if data[:transferred] != ep.chan.host[pos:pos + transferred] or \
+                    None in data[:transferred]:
+                errors.append('buffer %u: %u bytes, data differs from the '
+                              'host' % (i, transferred))
+                break
+        pos += transferred
+    return len(completed), pos, errors
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Check the UDPHS DMA multi-buffer transfers')
+    parser.add_argument('--buffers', type=int, default=2000,
+                        help='number of buffers per run (default 2000)')
+    parser.add_argument('--seed', type=int, default=1)
+    opts = parser.parse_args()
+
+    rng = random.Random(opts.seed)
+    failed = False
+    for is_in in (True, False):
+        for from_callback in (False, True):
+            for list_size in (2, 3, UDPHS_MULTI_DESC_COUNT):
+                offset = rng.randrange(1, list_size + 1)
+                max_packet = rng.choice([64, 512, 1024])
+                done, size, errors = run(is_in, opts.buffers, list_size,
+                                         offset, max_packet, from_callback,
+                                         rng)
+                print('%s, %u buffers, start at %u, %u byte packets, '
+                      'queued from the %s: %u buffers, %u bytes %s'
+                      % ('IN' if is_in else 'OUT', list_size, offset,
+                         max_packet,
+                         'callback' if from_callback else 'main loop',
+                         done, size, 'ok' if not errors else 'FAILED'))
+                for e in errors[:5]:
+                    print('  ' + e)
+                failed = failed or bool(errors)
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -57,7 +57,9 @@
 #include "extram/ddram.h"
 
 #include "arm/mmu_cp15.h"
+#include "mm/cache.h"
 #include "mm/l1cache.h"
+#include "mm/l2cache.h"
 #include "mm/l2cache_l2cc.h"
 #include "serial/console.h"
 
@@ -97,6 +99,70 @@ static const struct _l2cc_config l2cc_cfg = {
 
 static const char* board_name = BOARD_NAME;
 
+#if defined(VARIANT_QSPI0) || defined(VARIANT_QSPI1)
+#define QSPI_MEM_ATTRS MEM_NORMAL_WB
+#else
+#define QSPI_MEM_ATTRS MEM_STRONGLY_ORDERED
+#endif
+
+/* TODO: some peripherals are mapped MEM_STRONGLY_ORDERED instead of
+   MEM_DEVICE because their drivers have to be verified for correct
+   operation when write-back is enabled */
+static const struct _mem_region board_mem_regions[] = {
+	MEM_MMU_REGION("ROM", 0x00000000, 0x00100000,
+	               MEM_NORMAL_WB | MEM_READ_ONLY),
+	MEM_MMU_REGION("NFC SRAM", 0x00100000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("SRAM", 0x00200000, 0x00100000,
+	               MEM_NORMAL_WB),
+#ifdef CONFIG_HAVE_UDPHS
+	MEM_MMU_REGION("UDPHS (RAM)", 0x00300000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("UHPHS (OHCI)", 0x00400000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("UHPHS (EHCI)", 0x00500000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+#endif
+	MEM_MMU_REGION("AXIMX", 0x00600000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("DAP", 0x00700000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+#ifdef CONFIG_HAVE_L2CC
+	MEM_MMU_REGION("L2CC", 0x00a00000, 0x00200000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+#endif
+	MEM_MMU_REGION("EBI Chip Select 0", 0x10000000, 0x10000000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("DDR", 0x20000000, 0x04000000,
+	               MEM_NORMAL_WB),
+	MEM_MMU_REGION("DDR (not cached)", 0x24000000, 0x1c000000,
+	               MEM_STRONGLY_ORDERED),
+	MEM_MMU_REGION("DDR AESB", 0x40000000, 0x20000000,
+	               MEM_NORMAL_WB),
+	MEM_MMU_REGION("EBI Chip Select 1", 0x60000000, 0x10000000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("EBI Chip Select 2", 0x70000000, 0x10000000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("EBI Chip Select 3", 0x80000000, 0x10000000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("QSPI0/1 AESB MEM", 0x90000000, 0x10000000,
+	               QSPI_MEM_ATTRS),
+	MEM_MMU_REGION("SDMMC0", 0xa0000000, 0x10000000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("SDMMC1", 0xb0000000, 0x10000000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("NFC Command Register", 0xc0000000, 0x10000000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("QSPI0/1 MEM", 0xd0000000, 0x10000000,
+	               QSPI_MEM_ATTRS),
+	MEM_MMU_REGION("Internal Peripherals", 0xf0000000, 0x00100000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("Internal Peripherals", 0xf8000000, 0x00100000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("Internal Peripherals", 0xfc000000, 0x00100000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+};
+
 /*----------------------------------------------------------------------------
  *        Local variables
  *----------------------------------------------------------------------------*/
@@ -294,253 +360,27 @@ void board_save_misc_power(void)
 
 void board_cfg_mmu(void)
 {
-	uint32_t addr;
-
 	if (mmu_is_enabled())
 		return;
 
-	/* TODO: some peripherals are configured TTB_SECT_STRONGLY_ORDERED
-	   instead of TTB_SECT_SHAREABLE_DEVICE because their drivers have to
-	   be verified for correct operation when write-back is enabled */
-
-	/* Reset table entries */
-	for (addr = 0; addr < 4096; addr++)
-		tlb[addr] = 0;
-
-	/* 0x00000000: ROM */
-	tlb[0x000] = TTB_SECT_ADDR(0x00000000)
-	           | TTB_SECT_AP_READ_ONLY
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_CACHEABLE_WB
-	           | TTB_TYPE_SECT;
-
-	/* 0x00100000: NFC SRAM */
-	tlb[0x001] = TTB_SECT_ADDR(0x00100000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-
-	/* 0x00200000: SRAM */
-	tlb[0x002] = TTB_SECT_ADDR(0x00200000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_CACHEABLE_WB
-	           | TTB_TYPE_SECT;
-
-#ifdef CONFIG_HAVE_UDPHS
-	/* 0x00300000: UDPHS (RAM) */
-	tlb[0x003] = TTB_SECT_ADDR(0x00300000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-
-	/* 0x00400000: UHPHS (OHCI) */
-	tlb[0x004] = TTB_SECT_ADDR(0x00400000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-
-	/* 0x00500000: UDPHS (EHCI) */
-	tlb[0x005] = TTB_SECT_ADDR(0x00500000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-#endif /* CONFIG_HAVE_UDPHS */
-
-	/* 0x00600000: AXIMX */
-	tlb[0x006] = TTB_SECT_ADDR(0x00600000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-
-	/* 0x00700000: DAP */
-	tlb[0x007] = TTB_SECT_ADDR(0x00700000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-
-#ifdef CONFIG_HAVE_L2CC
-	/* 0x00a00000: L2CC */
-	tlb[0x00a] = TTB_SECT_ADDR(0x00a00000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-	tlb[0x00b] = TTB_SECT_ADDR(0x00b00000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-#endif
-
-	/* 0x10000000: EBI Chip Select 0 */
-	for (addr = 0x100; addr < 0x200; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC_NEVER
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0x20000000: DDR Chip Select */
-	/* (64MB cacheable, 448MB strongly ordered) */
-	for (addr = 0x200; addr < 0x240; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC
-	                  | TTB_SECT_CACHEABLE_WB
-	                  | TTB_TYPE_SECT;
-	for (addr = 0x240; addr < 0x400; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0x40000000: DDR AESB Chip Select */
-	for (addr = 0x400; addr < 0x600; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC
-	                  | TTB_SECT_CACHEABLE_WB
-	                  | TTB_TYPE_SECT;
-
-	/* 0x60000000: EBI Chip Select 1 */
-	for (addr = 0x600; addr < 0x700; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC_NEVER
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0x70000000: EBI Chip Select 2 */
-	for (addr = 0x700; addr < 0x800; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC_NEVER
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0x80000000: EBI Chip Select 3 */
-	for (addr = 0x800; addr < 0x900; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC_NEVER
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0x90000000: QSPI0/1 AESB MEM */
-	for (addr = 0x900; addr < 0xa00; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC
-#if defined(VARIANT_QSPI0) || defined(VARIANT_QSPI1)
-	                  | TTB_SECT_CACHEABLE_WB
-#else
-	                  | TTB_SECT_STRONGLY_ORDERED
-#endif
-	                  | TTB_TYPE_SECT;
-
-	/* 0xa0000000: SDMMC0 */
-	for (addr = 0xa00; addr < 0xb00; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC_NEVER
-	                  //| TTB_SECT_SHAREABLE_DEVICE
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0xb0000000: SDMMC1 */
-	for (addr = 0xb00; addr < 0xc00; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC_NEVER
-	                  //| TTB_SECT_SHAREABLE_DEVICE
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0xc0000000: NFC Command Register */
-	for (addr = 0xc00; addr < 0xd00; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC_NEVER
-	                  //| TTB_SECT_SHAREABLE_DEVICE
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0xd0000000: QSPI0/1 MEM */
-	for (addr = 0xd00; addr < 0xe00; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC
-#if defined(VARIANT_QSPI0) || defined(VARIANT_QSPI1)
-	                  | TTB_SECT_CACHEABLE_WB
-#else
-	                  | TTB_SECT_STRONGLY_ORDERED
-#endif
-	                  | TTB_TYPE_SECT;
-
-	/* 0xf0000000: Internal Peripherals */
-	tlb[0xf00] = TTB_SECT_ADDR(0xf0000000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_STRONGLY_ORDERED
-	           | TTB_TYPE_SECT;
-
-	/* 0xf8000000: Internal Peripherals */
-	tlb[0xf80] = TTB_SECT_ADDR(0xf8000000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_STRONGLY_ORDERED
-	           | TTB_TYPE_SECT;
-
-	/* 0xfc000000: Internal Peripherals */
-	tlb[0xfc0] = TTB_SECT_ADDR(0xfc000000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_STRONGLY_ORDERED
-	           | TTB_TYPE_SECT;
+	mmu_build_tlb(tlb, board_mem_regions, ARRAY_SIZE(board_mem_regions));
 
 	/* Enable MMU, I-Cache and D-Cache */
 	mmu_configure(tlb);
 	icache_enable();
 	mmu_enable();
 	dcache_enable();
+	cache_calibrate();
 }
 
 void board_cfg_l2cc(void)
 {
-	l2cc_configure(&l2cc_cfg);
+	if (!l2cache_is_enabled())
+		l2cc_configure(&l2cc_cfg);
+
+	/* L2 thresholds can only be measured with the L2 cache enabled */
+	if (l2cache_is_enabled())
+		cache_calibrate();
 }
 
 void board_cfg_matrix_for_ddr(void)
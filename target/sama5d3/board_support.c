@@ -53,6 +53,7 @@
 #include "extram/ddram.h"
 
 #include "arm/mmu_cp15.h"
+#include "mm/cache.h"
 #include "mm/l1cache.h"
 #include "serial/console.h"
 
@@ -75,6 +76,54 @@ struct _act8865 pmic = {
 
 static const char* board_name = BOARD_NAME;
 
+/* TODO: some peripherals are mapped MEM_STRONGLY_ORDERED instead of
+   MEM_DEVICE because their drivers have to be verified for correct
+   operation when write-back is enabled */
+static const struct _mem_region board_mem_regions[] = {
+	MEM_MMU_REGION("Boot memory", 0x00000000, 0x00100000,
+	               MEM_NORMAL_WB | MEM_READ_ONLY),
+	MEM_MMU_REGION("ROM", 0x00100000, 0x00100000,
+	               MEM_NORMAL_WB | MEM_READ_ONLY),
+	MEM_MMU_REGION("NFC SRAM", 0x00200000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("SRAM0 - SRAM1", 0x00300000, 0x00100000,
+	               MEM_NORMAL_WB),
+	MEM_MMU_REGION("SMD", 0x00400000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+#ifdef CONFIG_HAVE_UDPHS
+	MEM_MMU_REGION("UDPHS (RAM)", 0x00500000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("UHP (OHCI)", 0x00600000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("UHP (EHCI)", 0x00700000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+#endif
+	MEM_MMU_REGION("AXI Matrix", 0x00800000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("DAP", 0x00900000, 0x00100000,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("EBI Chip Select 0", 0x10000000, 0x10000000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("DDR", 0x20000000, 0x04000000,
+	               MEM_NORMAL_WB),
+	MEM_MMU_REGION("DDR (not cached)", 0x24000000, 0x1c000000,
+	               MEM_STRONGLY_ORDERED),
+	MEM_MMU_REGION("EBI Chip Select 1", 0x40000000, 0x10000000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("EBI Chip Select 2", 0x50000000, 0x10000000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("EBI Chip Select 3", 0x60000000, 0x10000000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("NFC Command Registers", 0x70000000, 0x10000000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("Internal Peripherals", 0xf0000000, 0x00100000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("Internal Peripherals", 0xf8000000, 0x00100000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MMU_REGION("Internal Peripherals", 0xfff00000, 0x00100000,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+};
+
 /*----------------------------------------------------------------------------
  *        Local variables
  *----------------------------------------------------------------------------*/
@@ -262,193 +311,17 @@ void board_save_misc_power(void)
 
 void board_cfg_mmu(void)
 {
-	uint32_t addr;
-
 	if (mmu_is_enabled())
 		return;
 
-	/* TODO: some peripherals are configured TTB_SECT_STRONGLY_ORDERED
-	   instead of TTB_SECT_SHAREABLE_DEVICE because their drivers have to
-	   be verified for correct operation when write-back is enabled */
-
-	/* Reset table entries */
-	for (addr = 0; addr < 4096; addr++)
-		tlb[addr] = 0;
-
-	/* 0x00000000: BOOT MEMORY */
-	tlb[0x000] = TTB_SECT_ADDR(0x00000000)
-	           | TTB_SECT_AP_READ_ONLY
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_CACHEABLE_WB
-	           | TTB_TYPE_SECT;
-
-	/* 0x00100000: ROM */
-	tlb[0x001] = TTB_SECT_ADDR(0x00100000)
-	           | TTB_SECT_AP_READ_ONLY
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_CACHEABLE_WB
-	           | TTB_TYPE_SECT;
-
-	/* 0x00200000: NFC SRAM */
-	tlb[0x002] = TTB_SECT_ADDR(0x00200000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-
-	/* 0x00300000: SRAM0 - SRAM1 */
-	tlb[0x003] = TTB_SECT_ADDR(0x00300000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_CACHEABLE_WB
-	           | TTB_TYPE_SECT;
-
-	/* 0x00400000: SMD */
-	tlb[0x004] = TTB_SECT_ADDR(0x00400000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-
-#ifdef CONFIG_HAVE_UDPHS
-	/* 0x00500000: UDPHS (RAM) */
-	tlb[0x005] = TTB_SECT_ADDR(0x00500000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-
-	/* 0x00600000: UHP (OHCI) */
-	tlb[0x006] = TTB_SECT_ADDR(0x00600000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-
-	/* 0x00700000: UHP (EHCI) */
-	tlb[0x007] = TTB_SECT_ADDR(0x00700000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-#endif /* CONFIG_HAVE_UDPHS */
-
-	/* 0x00800000: AXI Matrix */
-	tlb[0x008] = TTB_SECT_ADDR(0x00800000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-
-	/* 0x00900000: DAP */
-	tlb[0x009] = TTB_SECT_ADDR(0x00900000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC_NEVER
-	           | TTB_SECT_SHAREABLE_DEVICE
-	           | TTB_TYPE_SECT;
-
-	/* 0x10000000: EBI Chip Select 0 */
-	for (addr = 0x100; addr < 0x200; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC_NEVER
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0x20000000: DDR CS */
-	/* (64MB cacheable, 448MB strongly ordered) */
-	for (addr = 0x200; addr < 0x240; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC
-	                  | TTB_SECT_CACHEABLE_WB
-	                  | TTB_TYPE_SECT;
-	for (addr = 0x240; addr < 0x400; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0x40000000: EBI Chip Select 1 */
-	for (addr = 0x400; addr < 0x500; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC_NEVER
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0x50000000: EBI Chip Select 2 */
-	for (addr = 0x500; addr < 0x600; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC_NEVER
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0x60000000: EBI Chip Select 3 */
-	for (addr = 0x600; addr < 0x700; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC_NEVER
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0x90000000: NFC Command Registers */
-	for (addr = 0x700; addr < 0x800; addr++)
-		tlb[addr] = TTB_SECT_ADDR(addr << 20)
-	                  | TTB_SECT_AP_FULL_ACCESS
-	                  | TTB_SECT_DOMAIN(0xf)
-	                  | TTB_SECT_EXEC
-	                  //| TTB_SECT_SHAREABLE_DEVICE
-	                  | TTB_SECT_STRONGLY_ORDERED
-	                  | TTB_TYPE_SECT;
-
-	/* 0xf0000000: Internal Peripherals */
-	tlb[0xf00] = TTB_SECT_ADDR(0xf0000000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_STRONGLY_ORDERED
-	           | TTB_TYPE_SECT;
-
-	/* 0xf8000000: Internal Peripherals */
-	tlb[0xf80] = TTB_SECT_ADDR(0xf8000000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_STRONGLY_ORDERED
-	           | TTB_TYPE_SECT;
-
-	/* 0xfff00000: Internal Peripherals */
-	tlb[0xfff] = TTB_SECT_ADDR(0xfff00000)
-	           | TTB_SECT_AP_FULL_ACCESS
-	           | TTB_SECT_DOMAIN(0xf)
-	           | TTB_SECT_EXEC
-	           | TTB_SECT_STRONGLY_ORDERED
-	           | TTB_TYPE_SECT;
+	mmu_build_tlb(tlb, board_mem_regions, ARRAY_SIZE(board_mem_regions));
 
 	/* Enable MMU, I-Cache and D-Cache */
 	mmu_configure(tlb);
 	icache_enable();
 	mmu_enable();
 	dcache_enable();
+	cache_calibrate();
 }
 
 void board_cfg_l2cc(void)
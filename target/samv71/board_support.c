@@ -40,6 +40,7 @@
 #include "gpio/pio.h"
 #include "irq/irq.h"
 #include "irqflags.h"
+#include "mm/cache.h"
 #include "mm/l1cache.h"
 #include "nvm/eefc.h"
 #include "peripherals/pmc.h"
@@ -48,6 +49,8 @@
 
 #include "board_support.h"
 
+#include <assert.h>
+
 /*----------------------------------------------------------------------------
  *        Local types
  *----------------------------------------------------------------------------*/
@@ -63,6 +66,32 @@ struct _console_cfg {
 
 static const char* board_name = BOARD_NAME;
 
+/* MPU region N is entry N, later entries take precedence */
+static const struct _mem_region board_mem_regions[] = {
+	MEM_MPU_REGION("ITCM", 0x00000000, 4 * 1024 * 1024,
+	               MEM_NORMAL_WB | MEM_READ_ONLY),
+	MEM_MPU_REGION("Internal flash", 0x00400000, 4 * 1024 * 1024,
+	               MEM_NORMAL_WB | MEM_READ_ONLY),
+	MEM_MPU_REGION("DTCM", 0x20000000, 4 * 1024 * 1024,
+	               MEM_NORMAL_WB_WA),
+	MEM_MPU_REGION("SRAM", 0x20400000, 4 * 1024 * 1024,
+	               MEM_NORMAL_WB_WA),
+	MEM_MPU_REGION("Not cached SRAM", 0x2045F000, 4 * 1024,
+	               MEM_NORMAL_NC),
+	MEM_MPU_REGION("Peripherals", 0x40000000, 256 * 1024 * 1024,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+	MEM_MPU_REGION("EBI", 0x60000000, 256 * 1024 * 1024,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+	MEM_MPU_REGION("SDRAM", 0x70000000, 256 * 1024 * 1024,
+	               MEM_NORMAL_WB),
+	MEM_MPU_REGION("QSPI", 0x80000000, 256 * 1024 * 1024,
+	               MEM_STRONGLY_ORDERED),
+	MEM_MPU_REGION("USB RAM", 0xA0100000, 1024 * 1024,
+	               MEM_DEVICE | MEM_EXEC_NEVER),
+	MEM_MPU_REGION("Private Peripheral Bus", 0xE0000000, 1024 * 1024,
+	               MEM_STRONGLY_ORDERED | MEM_EXEC_NEVER),
+};
+
 /*----------------------------------------------------------------------------
  *        Exported functions
  *----------------------------------------------------------------------------*/
@@ -143,95 +172,18 @@ void board_cfg_console(uint32_t baudrate)
 
 void board_cfg_mpu(void)
 {
-	const uint32_t mpu_regions[] = {
-		/* ITCM, 0x0-0x400000, 4MB=2^22 */
-		MPU_REGION(0, 0x0),
-		MPU_REGION_SIZE(21) |
-		MPU_AP_READONLY |
-		MPU_ATTR_NORMAL_WB |
-		MPU_ATTR_ENABLE,
-
-		/* Internal flash, 0x400000-0x800000, 4MB=2^22 */
-		MPU_REGION(1, 0x400000),
-		MPU_REGION_SIZE(21) |
-		MPU_AP_READONLY |
-		MPU_ATTR_NORMAL_WB |
-		MPU_ATTR_ENABLE,
-
-		/* DTCM, 0x20000000-0x20400000, 4MB=2^22 */
-		MPU_REGION(2, 0x20000000),
-		MPU_REGION_SIZE(21) |
-		MPU_AP_READWRITE |
-		MPU_ATTR_NORMAL_WB_WA |
-		MPU_ATTR_ENABLE,
-
-		/* SRAM, 0x20400000-0x20C00000, 8MB=2^23 */
-		MPU_REGION(3, 0x20400000),
-		MPU_REGION_SIZE(22) |
-		MPU_AP_READWRITE |
-		MPU_ATTR_NORMAL_WB_WA |
-		MPU_ATTR_ENABLE,
-
-		/* Not Cached SRAM, 0x2045F000-0x20460000, 4KB=2^12 */
-		MPU_REGION(4, 0x2045F000),
-		MPU_REGION_SIZE(11) |
-		MPU_AP_READWRITE |
-		MPU_ATTR_NORMAL |
-		MPU_ATTR_ENABLE,
-
-		/* Peripherals,  0x40000000, 256MB=2^28 */
-		MPU_REGION(5, 0x40000000),
-		MPU_REGION_SIZE(27) |
-		MPU_AP_READWRITE |
-		MPU_ATTR_DEVICE |
-		MPU_ATTR_EXECUTE_NEVER |
-		MPU_ATTR_ENABLE,
-
-		/* EBI, 0x60000000, 256MB=2^28 */
-		MPU_REGION(6, 0x60000000),
-		MPU_REGION_SIZE(27) |
-		MPU_AP_READWRITE |
-		MPU_ATTR_STRONGLY_ORDERED |
-		MPU_ATTR_EXECUTE_NEVER |
-		MPU_ATTR_ENABLE,
-
-		/* SDRAM, 0x70000000, 256MB=2^28 */
-		MPU_REGION(7, 0x70000000),
-		MPU_REGION_SIZE(27) |
-		MPU_AP_READWRITE |
-		MPU_ATTR_NORMAL_WB |
-		MPU_ATTR_ENABLE,
-
-		/* QSPI, 0x80000000, 256MB=2^28 */
-		MPU_REGION(8, 0x80000000),
-		MPU_REGION_SIZE(27) |
-		MPU_AP_READWRITE |
-		MPU_ATTR_STRONGLY_ORDERED |
-		MPU_ATTR_ENABLE,
-
-		/* USB RAM, 0xA0100000, 1MB=2^20 */
-		MPU_REGION(9, 0xA0100000),
-		MPU_REGION_SIZE(19) |
-		MPU_AP_READWRITE |
-		MPU_ATTR_DEVICE |
-		MPU_ATTR_EXECUTE_NEVER |
-		MPU_ATTR_ENABLE,
-
-		/* Private Peripheral Bus, 0xE0000000, 1MB=2^20 */
-		MPU_REGION(10, 0xE0000000),
-		MPU_REGION_SIZE(19) |
-		MPU_AP_READWRITE |
-		MPU_ATTR_STRONGLY_ORDERED |
-		MPU_ATTR_EXECUTE_NEVER |
-		MPU_ATTR_ENABLE,
-
-		/* end marker */
-		0, 0
-	};
+	uint32_t mpu_regions[2 * ARRAY_SIZE(board_mem_regions) + 2];
+	int err;
 
 	if (mpu_is_enabled())
 		return;
 
+	err = mpu_build_config(board_mem_regions, ARRAY_SIZE(board_mem_regions),
+	                       mpu_regions, ARRAY_SIZE(mpu_regions));
+	assert(err == 0);
+	if (err < 0)
+		return;
+
 	/* disable interrupts while we configure/enable MPU */
 	arch_irq_disable();
 
@@ -240,6 +192,7 @@ void board_cfg_mpu(void)
 	mpu_enable();
 	icache_enable();
 	dcache_enable();
+	cache_calibrate();
 
 	/* re-enable interrupts */
 	arch_irq_enable();
@@ -0,0 +1,358 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_FEATURE_SAT)
+#include <arm_acle.h>
+#endif
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "audio_dsp.h"
+#include "errno.h"
+
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+/** SRC tracking loop proportional gain (ppm per frame of error) */
+#ifndef AUDIO_SRC_KP
+#define AUDIO_SRC_KP 2
+#endif
+
+/** SRC tracking loop integral gain (1 / 2^n ppm per accumulated frame) */
+#ifndef AUDIO_SRC_KI_SHIFT
+#define AUDIO_SRC_KI_SHIFT 4
+#endif
+
+#define AUDIO_SRC_ONE (1u << 16)
+
+/*----------------------------------------------------------------------------
+ *        Local variables
+ *----------------------------------------------------------------------------*/
+
+/** Non-zero halfband coefficients, outermost first (Kaiser, beta 7) */
+static const int16_t _decim2_coefs[(AUDIO_DECIM2_TAPS + 1) / 4] = {
+	-3, 13, -35, 77, -148, 261, -433, 693, -1096, 1787, -3290, 10367,
+};
+
+/** Halfband center coefficient */
+#define DECIM2_CENTER_COEF 16382
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static inline int16_t _sat16(int32_t x)
+{
+#if defined(__ARM_FEATURE_SAT)
+	return __ssat(x, 16);
+#else
+	if (x > INT16_MAX)
+		return INT16_MAX;
+	if (x < INT16_MIN)
+		return INT16_MIN;
+	return x;
+#endif
+}
+
+static inline int32_t _mul_q15(int32_t a, int32_t mu)
+{
+	return (int32_t)(((int64_t)a * mu) >> 15);
+}
+
+/**
+ * 4-point, 3rd-order Hermite (Catmull-Rom) interpolation between x[1] and
+ * x[2] at fractional position mu (Q15).  Polynomial coefficients are
+ * computed doubled to stay in integers.
+ */
+static inline int16_t _audio_src_interp(const int16_t *x, int32_t mu)
+{
+	int32_t c1 = x[2] - x[0];
+	int32_t c2 = 2 * x[0] - 5 * x[1] + 4 * x[2] - x[3];
+	int32_t c3 = (x[3] - x[0]) + 3 * (x[1] - x[2]);
+	int32_t y;
+
+	y = _mul_q15(c3, mu) + c2;
+	y = _mul_q15(y, mu) + c1;
+	y = _mul_q15(y, mu);
+
+	return _sat16(x[1] + ((y + 1) >> 1));
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+int audio_src_init(struct _audio_src *src, uint8_t channels,
+		uint32_t in_rate, uint32_t out_rate)
+{
+	if (channels == 0 || channels > AUDIO_DSP_MAX_CHANNELS)
+		return -EINVAL;
+	if (in_rate == 0 || out_rate == 0)
+		return -EINVAL;
+
+	memset(src, 0, sizeof(*src));
+	src->channels = channels;
+	src->nominal = (uint32_t)((((uint64_t)in_rate << 16) + out_rate / 2)
+			/ out_rate);
+	src->step = src->nominal;
+
+	return 0;
+}
+
+void audio_src_track(struct _audio_src *src, uint32_t fill, uint32_t target)
+{
+	const int32_t limit = AUDIO_SRC_MAX_PPM << AUDIO_SRC_KI_SHIFT;
+	int32_t err = (int32_t)fill - (int32_t)target;
+	int32_t ppm;
+
+	src->integral += err;
+	if (src->integral > limit)
+		src->integral = limit;
+	else if (src->integral < -limit)
+		src->integral = -limit;
+
+	ppm = err * AUDIO_SRC_KP + (src->integral >> AUDIO_SRC_KI_SHIFT);
+	if (ppm > AUDIO_SRC_MAX_PPM)
+		ppm = AUDIO_SRC_MAX_PPM;
+	else if (ppm < -AUDIO_SRC_MAX_PPM)
+		ppm = -AUDIO_SRC_MAX_PPM;
+
+	src->ppm = ppm;
+	src->step = src->nominal +
+		(int32_t)(((int64_t)src->nominal * ppm) / 1000000);
+}
+
+int32_t audio_src_get_ppm(const struct _audio_src *src)
+{
+	return src->ppm;
+}
+
+uint32_t audio_src_process(struct _audio_src *src,
+		const int16_t *in, uint32_t in_frames, uint32_t *consumed,
+		int16_t *out, uint32_t out_frames)
+{
+	const uint8_t channels = src->channels;
+	uint32_t used = 0;
+	uint32_t produced = 0;
+	uint8_t ch;
+
+	while (produced < out_frames) {
+		int32_t mu;
+
+		/* Advance the history until pos lies between hist[1] and
+		 * hist[2] */
+		while (src->pos >= AUDIO_SRC_ONE) {
+			if (used == in_frames)
+				goto exit;
+			for (ch = 0; ch < channels; ch++) {
+				int16_t *h = src->hist[ch];
+				h[0] = h[1];
+				h[1] = h[2];
+				h[2] = h[3];
+				h[3] = *in++;
+			}
+			used++;
+			src->pos -= AUDIO_SRC_ONE;
+		}
+
+		mu = src->pos >> 1;
+		for (ch = 0; ch < channels; ch++)
+			*out++ = _audio_src_interp(src->hist[ch], mu);
+		produced++;
+		src->pos += src->step;
+	}
+
+exit:
+	if (consumed)
+		*consumed = used;
+	return produced;
+}
+
+void audio_dsp_mix(int16_t *out, const int16_t * const *in,
+		const int32_t *gains, uint8_t inputs, uint32_t samples)
+{
+	uint32_t i = 0;
+	uint8_t j;
+
+#if defined(__ARM_NEON__)
+	for (; i + 8 <= samples; i += 8) {
+		int32x4_t lo = vdupq_n_s32(0);
+		int32x4_t hi = vdupq_n_s32(0);
+
+		for (j = 0; j < inputs; j++) {
+			int16x8_t x = vld1q_s16(in[j] + i);
+			int32x4_t l = vmulq_n_s32(vmovl_s16(vget_low_s16(x)), gains[j]);
+			int32x4_t h = vmulq_n_s32(vmovl_s16(vget_high_s16(x)), gains[j]);
+			lo = vaddq_s32(lo, vshrq_n_s32(l, 15));
+			hi = vaddq_s32(hi, vshrq_n_s32(h, 15));
+		}
+		vst1q_s16(out + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+	}
+#endif
+
+	for (; i < samples; i++) {
+		int32_t acc = 0;
+		for (j = 0; j < inputs; j++)
+			acc += (in[j][i] * gains[j]) >> 15;
+		out[i] = _sat16(acc);
+	}
+}
+
+void audio_ramp_init(struct _audio_ramp *ramp, int32_t gain)
+{
+	if (gain < 0)
+		gain = 0;
+	else if (gain > AUDIO_DSP_UNITY)
+		gain = AUDIO_DSP_UNITY;
+
+	ramp->gain = gain << 8;
+	ramp->target = ramp->gain;
+	ramp->delta = 0;
+}
+
+void audio_ramp_set(struct _audio_ramp *ramp, int32_t gain, uint32_t frames)
+{
+	if (gain < 0)
+		gain = 0;
+	else if (gain > AUDIO_DSP_UNITY)
+		gain = AUDIO_DSP_UNITY;
+
+	ramp->target = gain << 8;
+	if (frames == 0) {
+		ramp->gain = ramp->target;
+		ramp->delta = 0;
+		return;
+	}
+
+	ramp->delta = (ramp->target - ramp->gain) / (int32_t)frames;
+	if (ramp->delta == 0 && ramp->target != ramp->gain)
+		ramp->delta = ramp->target > ramp->gain ? 1 : -1;
+}
+
+void audio_ramp_process(struct _audio_ramp *ramp, int16_t *buf,
+		uint8_t channels, uint32_t frames)
+{
+	uint32_t samples = frames * channels;
+	uint32_t i = 0;
+	int32_t gain;
+	uint8_t ch;
+
+	/* Ramp sample by sample until the target is reached */
+	while (ramp->delta != 0 && i < samples) {
+		gain = ramp->gain >> 8;
+		for (ch = 0; ch < channels; ch++, i++)
+			buf[i] = _sat16((buf[i] * gain) >> 15);
+
+		ramp->gain += ramp->delta;
+		if ((ramp->delta > 0 && ramp->gain >= ramp->target) ||
+		    (ramp->delta < 0 && ramp->gain <= ramp->target)) {
+			ramp->gain = ramp->target;
+			ramp->delta = 0;
+		}
+	}
+
+	/* Constant gain for the remaining samples */
+	gain = ramp->gain >> 8;
+	if (gain == AUDIO_DSP_UNITY)
+		return;
+
+#if defined(__ARM_NEON__)
+	for (; i + 8 <= samples; i += 8) {
+		int16x8_t x = vld1q_s16(buf + i);
+		int32x4_t l = vmulq_n_s32(vmovl_s16(vget_low_s16(x)), gain);
+		int32x4_t h = vmulq_n_s32(vmovl_s16(vget_high_s16(x)), gain);
+		vst1q_s16(buf + i, vcombine_s16(vqshrn_n_s32(l, 15),
+						 vqshrn_n_s32(h, 15)));
+	}
+#endif
+
+	for (; i < samples; i++)
+		buf[i] = _sat16((buf[i] * gain) >> 15);
+}
+
+int audio_decim2_init(struct _audio_decim2 *decim, uint8_t channels)
+{
+	if (channels == 0 || channels > AUDIO_DSP_MAX_CHANNELS)
+		return -EINVAL;
+
+	memset(decim, 0, sizeof(*decim));
+	decim->channels = channels;
+
+	return 0;
+}
+
+uint32_t audio_decim2_process(struct _audio_decim2 *decim,
+		const int16_t *in, uint32_t in_frames, int16_t *out)
+{
+	const uint8_t channels = decim->channels;
+	uint32_t produced = 0;
+	uint32_t i;
+	uint8_t ch;
+	int k;
+
+	for (i = 0; i < in_frames; i++) {
+		/* The delay line is stored twice so that the last TAPS
+		 * samples are always contiguous */
+		for (ch = 0; ch < channels; ch++) {
+			int16_t s = *in++;
+			decim->line[ch][decim->index] = s;
+			decim->line[ch][decim->index + AUDIO_DECIM2_TAPS] = s;
+		}
+		decim->index++;
+		if (decim->index == AUDIO_DECIM2_TAPS)
+			decim->index = 0;
+
+		decim->phase ^= 1;
+		if (decim->phase)
+			continue;
+
+		for (ch = 0; ch < channels; ch++) {
+			const int16_t *w = &decim->line[ch][decim->index];
+			int32_t acc;
+
+			acc = DECIM2_CENTER_COEF * w[AUDIO_DECIM2_TAPS / 2];
+			for (k = 0; k < (AUDIO_DECIM2_TAPS + 1) / 4; k++)
+				acc += _decim2_coefs[k] *
+					(w[2 * k] + w[AUDIO_DECIM2_TAPS - 1 - 2 * k]);
+			*out++ = _sat16((acc + (1 << 14)) >> 15);
+		}
+		produced++;
+	}
+
+	return produced;
+}
@@ -0,0 +1,219 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * \section Purpose
+ *
+ * Fixed-point audio processing blocks operating on interleaved signed 16-bit
+ * PCM frames:
+ * - asynchronous sample-rate converter (4-point Farrow interpolator) with a
+ *   ratio tracking loop driven by buffer fill level,
+ * - N-input mixer with per-input gain,
+ * - linear volume ramp,
+ * - 2:1 halfband decimation filter.
+ *
+ * Gains are Q15 values where AUDIO_DSP_UNITY is 1.0.  All blocks saturate
+ * their output instead of wrapping.
+ */
+
+#ifndef _AUDIO_DSP_H_
+#define _AUDIO_DSP_H_
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Q15 gain value for 1.0 */
+#define AUDIO_DSP_UNITY (1 << 15)
+
+/** Maximum number of interleaved channels handled by a block */
+#ifndef AUDIO_DSP_MAX_CHANNELS
+#define AUDIO_DSP_MAX_CHANNELS 8
+#endif
+
+/** Maximum number of inputs accepted by audio_dsp_mix() */
+#ifndef AUDIO_DSP_MAX_INPUTS
+#define AUDIO_DSP_MAX_INPUTS 8
+#endif
+
+/** Maximum ratio deviation applied by the SRC tracking loop (ppm) */
+#ifndef AUDIO_SRC_MAX_PPM
+#define AUDIO_SRC_MAX_PPM 2000
+#endif
+
+/** Number of taps of the halfband decimation filter */
+#define AUDIO_DECIM2_TAPS 47
+
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+/** Asynchronous sample-rate converter state */
+struct _audio_src {
+	uint8_t channels;
+	uint32_t nominal;    /**< nominal input step per output frame (Q16.16) */
+	uint32_t step;       /**< current input step per output frame (Q16.16) */
+	uint32_t pos;        /**< position between hist[1] and hist[2] (Q16.16) */
+	int32_t ppm;         /**< current correction applied to the ratio */
+	int32_t integral;    /**< tracking loop integrator (frames) */
+	int16_t hist[AUDIO_DSP_MAX_CHANNELS][4];
+};
+
+/** Volume ramp state */
+struct _audio_ramp {
+	int32_t gain;        /**< current gain (Q15 << 8) */
+	int32_t target;      /**< target gain (Q15 << 8) */
+	int32_t delta;       /**< gain increment per frame (Q15 << 8) */
+};
+
+/** 2:1 halfband decimator state */
+struct _audio_decim2 {
+	uint8_t channels;
+	uint8_t phase;
+	uint8_t index;
+	int16_t line[AUDIO_DSP_MAX_CHANNELS][2 * AUDIO_DECIM2_TAPS];
+};
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Initialize a sample-rate converter.
+ * \param src  SRC state
+ * \param channels  number of interleaved channels
+ * \param in_rate  nominal input sample rate (Hz)
+ * \param out_rate  nominal output sample rate (Hz)
+ * \return 0 on success, -EINVAL on invalid parameters
+ */
+extern int audio_src_init(struct _audio_src *src, uint8_t channels,
+		uint32_t in_rate, uint32_t out_rate);
+
+/**
+ * \brief Update the conversion ratio from the fill level of the buffer
+ * feeding the converter.
+ *
+ * A proportional-integral loop nudges the ratio, within AUDIO_SRC_MAX_PPM of
+ * its nominal value, so that the fill level converges to the target: a buffer
+ * filling up is consumed faster and conversely.  Call it at a regular
+ * interval, typically once per audio period.
+ *
+ * \param src  SRC state
+ * \param fill  current fill level of the input buffer (frames)
+ * \param target  wanted fill level (frames)
+ */
+extern void audio_src_track(struct _audio_src *src, uint32_t fill,
+		uint32_t target);
+
+/**
+ * \brief Get the correction currently applied to the nominal ratio.
+ * \return correction in ppm, positive when consuming input faster
+ */
+extern int32_t audio_src_get_ppm(const struct _audio_src *src);
+
+/**
+ * \brief Convert interleaved frames.
+ *
+ * Processing stops when either all input frames are consumed or the output
+ * buffer is full.
+ *
+ * \param src  SRC state
+ * \param in  input frames
+ * \param in_frames  number of input frames available
+ * \param consumed  returns the number of input frames consumed
+ * \param out  output frames
+ * \param out_frames  room in output buffer (frames)
+ * \return number of output frames produced
+ */
+extern uint32_t audio_src_process(struct _audio_src *src,
+		const int16_t *in, uint32_t in_frames, uint32_t *consumed,
+		int16_t *out, uint32_t out_frames);
+
+/**
+ * \brief Mix several buffers of samples with individual gains.
+ * \param out  output samples (may be one of the inputs)
+ * \param in  array of input sample buffers
+ * \param gains  array of Q15 gains, one per input, within +/-AUDIO_DSP_UNITY
+ * \param inputs  number of inputs (up to AUDIO_DSP_MAX_INPUTS)
+ * \param samples  number of samples (frames * channels)
+ */
+extern void audio_dsp_mix(int16_t *out, const int16_t * const *in,
+		const int32_t *gains, uint8_t inputs, uint32_t samples);
+
+/**
+ * \brief Set the volume ramp to a fixed gain.
+ * \param ramp  ramp state
+ * \param gain  Q15 gain, from 0 to AUDIO_DSP_UNITY
+ */
+extern void audio_ramp_init(struct _audio_ramp *ramp, int32_t gain);
+
+/**
+ * \brief Start a linear ramp from the current gain.
+ * \param ramp  ramp state
+ * \param gain  Q15 target gain, from 0 to AUDIO_DSP_UNITY
+ * \param frames  ramp duration in frames (0 for an immediate change)
+ */
+extern void audio_ramp_set(struct _audio_ramp *ramp, int32_t gain,
+		uint32_t frames);
+
+/**
+ * \brief Apply the volume ramp in place.
+ * \param ramp  ramp state
+ * \param buf  interleaved frames
+ * \param channels  number of interleaved channels
+ * \param frames  number of frames
+ */
+extern void audio_ramp_process(struct _audio_ramp *ramp, int16_t *buf,
+		uint8_t channels, uint32_t frames);
+
+/**
+ * \brief Initialize a 2:1 halfband decimator.
+ * \return 0 on success, -EINVAL on invalid parameters
+ */
+extern int audio_decim2_init(struct _audio_decim2 *decim, uint8_t channels);
+
+/**
+ * \brief Low-pass filter and decimate interleaved frames by two.
+ *
+ * Odd input frame counts are handled across calls.  \a out may alias \a in.
+ *
+ * \return number of output frames produced
+ */
+extern uint32_t audio_decim2_process(struct _audio_decim2 *decim,
+		const int16_t *in, uint32_t in_frames, int16_t *out);
+
+#endif /* _AUDIO_DSP_H_ */
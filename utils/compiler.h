@@ -17,12 +17,16 @@
 	#define CONSTRUCTOR
 	#define SECTION(a) _CC_PRAGMA(location = a)
 	#define ALIGNED(a) _CC_PRAGMA(data_alignment = a)
+	#define NOINLINE _CC_PRAGMA(inline = never)
+	#define NAKED __stackless
 #elif defined(__GNUC__)
 	#define WEAK __attribute__((weak))
 	#define USED __attribute__((used))
 	#define CONSTRUCTOR __attribute__((constructor))
 	#define SECTION(a) __attribute__((__section__(a)))
 	#define ALIGNED(a) __attribute__((__aligned__(a)))
+	#define NOINLINE __attribute__((noinline))
+	#define NAKED __attribute__((naked))
 #else
 	#error Unknown compiler!
 #endif
@@ -0,0 +1,124 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file */
+
+/*------------------------------------------------------------------------------
+ *         Header
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+
+#include "crc32.h"
+
+/*------------------------------------------------------------------------------
+ *         Local constants
+ *------------------------------------------------------------------------------*/
+
+/** Reversed IEEE 802.3 polynomial */
+#define CRC32_POLY 0xEDB88320u
+
+/*------------------------------------------------------------------------------
+ *         Local variables
+ *------------------------------------------------------------------------------*/
+
+/**
+ * Slice-by-8 tables, computed on first use: crc32_table[0] holds the CRC of
+ * each byte value, crc32_table[n] the CRC of the same byte followed by n
+ * null bytes. Eight input bytes are then processed with eight lookups.
+ */
+static uint32_t crc32_table[8][256];
+
+static bool crc32_table_ready = false;
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+static void _crc32_init_table(void)
+{
+	uint32_t i, j, crc;
+
+	for (i = 0; i < 256; i++) {
+		crc = i;
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? CRC32_POLY : 0);
+		crc32_table[0][i] = crc;
+	}
+	for (i = 0; i < 256; i++) {
+		crc = crc32_table[0][i];
+		for (j = 1; j < 8; j++) {
+			crc = crc32_table[0][crc & 0xff] ^ (crc >> 8);
+			crc32_table[j][i] = crc;
+		}
+	}
+	crc32_table_ready = true;
+}
+
+/*------------------------------------------------------------------------------
+ *         Global functions
+ *------------------------------------------------------------------------------*/
+
+uint32_t crc32_update(uint32_t crc, const void *data, uint32_t len)
+{
+	const uint8_t *p = (const uint8_t*)data;
+	uint32_t lo, hi;
+
+	if (!crc32_table_ready)
+		_crc32_init_table();
+
+	crc = ~crc;
+
+	/* process bytes up to the first word boundary */
+	while (len && ((uint32_t)p & 3)) {
+		crc = crc32_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+		len--;
+	}
+
+	/* process 8 bytes at a time (little-endian words) */
+	while (len >= 8) {
+		lo = *(const uint32_t*)p ^ crc;
+		hi = *(const uint32_t*)(p + 4);
+		crc = crc32_table[7][lo & 0xff] ^
+		      crc32_table[6][(lo >> 8) & 0xff] ^
+		      crc32_table[5][(lo >> 16) & 0xff] ^
+		      crc32_table[4][lo >> 24] ^
+		      crc32_table[3][hi & 0xff] ^
+		      crc32_table[2][(hi >> 8) & 0xff] ^
+		      crc32_table[1][(hi >> 16) & 0xff] ^
+		      crc32_table[0][hi >> 24];
+		p += 8;
+		len -= 8;
+	}
+
+	while (len--)
+		crc = crc32_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+}
@@ -0,0 +1,128 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file */
+
+/*------------------------------------------------------------------------------
+ *         Header
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "errno.h"
+#include "lz4.h"
+
+/*------------------------------------------------------------------------------
+ *         Local constants
+ *------------------------------------------------------------------------------*/
+
+/** Minimum length of a match */
+#define LZ4_MIN_MATCH 4
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Read an extended length (sequence of bytes added to the token
+ * value until a byte different from 255).
+ * \return false if the input ends before the length
+ */
+static bool _lz4_read_length(const uint8_t **src, const uint8_t *end,
+		uint32_t *length)
+{
+	uint8_t b;
+
+	do {
+		if (*src >= end)
+			return false;
+		b = *(*src)++;
+		*length += b;
+	} while (b == 255);
+
+	return true;
+}
+
+/*------------------------------------------------------------------------------
+ *         Global functions
+ *------------------------------------------------------------------------------*/
+
+int lz4_decompress(const uint8_t *src, uint32_t src_size,
+		uint8_t *dst, uint32_t dst_size)
+{
+	const uint8_t *src_end = src + src_size;
+	uint8_t *out = dst;
+	uint8_t *out_end = dst + dst_size;
+
+	while (src < src_end) {
+		uint8_t token = *src++;
+		uint32_t length = token >> 4;
+		uint32_t offset;
+		const uint8_t *match;
+
+		/* literals */
+		if (length == 15 && !_lz4_read_length(&src, src_end, &length))
+			return -EINVAL;
+		if (length > (uint32_t)(src_end - src))
+			return -EINVAL;
+		if (length > (uint32_t)(out_end - out))
+			return -ENOSPC;
+		memcpy(out, src, length);
+		out += length;
+		src += length;
+
+		/* the last sequence only contains literals */
+		if (src == src_end)
+			break;
+
+		/* match */
+		if (src_end - src < 2)
+			return -EINVAL;
+		offset = src[0] | (src[1] << 8);
+		src += 2;
+		if (offset == 0 || offset > (uint32_t)(out - dst))
+			return -EINVAL;
+
+		length = token & 0xf;
+		if (length == 15 && !_lz4_read_length(&src, src_end, &length))
+			return -EINVAL;
+		length += LZ4_MIN_MATCH;
+		if (length > (uint32_t)(out_end - out))
+			return -ENOSPC;
+
+		/* byte copy, source and destination overlap when the offset
+		 * is smaller than the length (e.g. runs of 0xFF) */
+		match = out - offset;
+		while (length--)
+			*out++ = *match++;
+	}
+
+	return out - dst;
+}
@@ -0,0 +1,65 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *  \file
+ *
+ *  \section Purpose
+ *  Decompression of LZ4 blocks (raw block format, without frame header).
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef _LZ4_H
+#define _LZ4_H
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ *         Global Functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Decompress a LZ4 block.
+ * The input is fully checked, a corrupted block cannot make the decoder read
+ * or write outside the given buffers.
+ * \param src  Compressed block
+ * \param src_size  Size of the compressed block (in bytes)
+ * \param dst  Output buffer
+ * \param dst_size  Size of the output buffer (in bytes)
+ * \return the decompressed size, -EINVAL if the block is corrupted or
+ * -ENOSPC if it does not fit in the output buffer
+ */
+extern int lz4_decompress(const uint8_t *src, uint32_t src_size,
+		uint8_t *dst, uint32_t dst_size);
+
+#endif /* #ifndef _LZ4_H */
@@ -0,0 +1,332 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include "chip.h"
+#include "compiler.h"
+#include "cycles.h"
+#include "irqflags.h"
+#include "pmu.h"
+#include "irq/irq.h"
+#if defined(CONFIG_HAVE_NVIC)
+#include "irq/nvic.h"
+#endif
+#include "peripherals/pmc.h"
+#include "peripherals/tc.h"
+#include "serial/console.h"
+#include "profile.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/*----------------------------------------------------------------------------
+ *         Local types
+ *----------------------------------------------------------------------------*/
+
+struct _profile_sampler {
+	Tc* tc;
+	uint8_t channel;
+	uint32_t id;
+	bool running;
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static uint32_t _events[PROFILE_EVENTS] = {
+	ARCH_PMU_DEFAULT_EVENT0,
+	ARCH_PMU_DEFAULT_EVENT1,
+};
+
+/** Scopes updated at least once */
+static struct _profile_scope* _scopes;
+
+static struct _profile_sampler _sampler;
+
+/*----------------------------------------------------------------------------
+ *         Exported variables
+ *----------------------------------------------------------------------------*/
+
+/** Sampling log */
+struct _profile_log profile_log = {
+	.magic = PROFILE_MAGIC,
+	.size = PROFILE_SAMPLE_COUNT,
+	.count = 0,
+	.dropped = 0,
+};
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static void _profile_record(uint32_t pc)
+{
+	uint32_t count = profile_log.count;
+
+	if (count < PROFILE_SAMPLE_COUNT) {
+		profile_log.samples[count] = pc;
+		profile_log.count = count + 1;
+	} else {
+		profile_log.dropped++;
+	}
+}
+
+#if defined(CONFIG_HAVE_NVIC)
+
+/**
+ * \brief Record the PC stacked on exception entry. frame points to the
+ * basic frame: r0-r3, r12, lr, pc, xpsr.
+ */
+static USED void _profile_sample_frame(const uint32_t* frame)
+{
+	tc_get_status(_sampler.tc, _sampler.channel);
+	_profile_record(frame[6]);
+}
+
+/**
+ * \brief Sampling vector, replaces the irq.c trampoline to reach the frame
+ * stacked by the core before any register is pushed.
+ */
+static NAKED void _profile_sample_vector(void)
+{
+	asm volatile(
+		"tst lr, #4\n"
+		"ite eq\n"
+		"mrseq r0, msp\n"
+		"mrsne r0, psp\n"
+		"b _profile_sample_frame\n");
+}
+
+#else /* !CONFIG_HAVE_NVIC */
+
+/**
+ * \brief Get the interrupted PC, saved by irqHandler (cstartup) on the IRQ
+ * mode stack as r0, spsr, lr - 4. The sampling interrupt has the highest
+ * priority so its frame is the last one pushed.
+ */
+static uint32_t _profile_irq_pc(void)
+{
+	uint32_t cpsr, sp;
+
+	asm volatile(
+		"mrs %0, cpsr\n"
+		"msr cpsr_c, %2\n"
+		"mov %1, sp\n"
+		"msr cpsr_c, %0\n"
+		: "=&r"(cpsr), "=&r"(sp)
+		: "r"(0xd2) /* IRQ mode, IRQ and FIQ masked */
+		: "memory");
+
+	return ((const uint32_t*)sp)[2];
+}
+
+#endif /* !CONFIG_HAVE_NVIC */
+
+static void _profile_sample_handler(uint32_t source, void* user_arg)
+{
+#if !defined(CONFIG_HAVE_NVIC)
+	tc_get_status(_sampler.tc, _sampler.channel);
+	_profile_record(_profile_irq_pc());
+#endif
+}
+
+/*----------------------------------------------------------------------------
+ *         Exported functions
+ *----------------------------------------------------------------------------*/
+
+void profile_init(void)
+{
+	arch_cycles_init();
+	arch_pmu_init(_events[0], _events[1]);
+}
+
+void profile_set_events(uint32_t event0, uint32_t event1)
+{
+	_events[0] = event0;
+	_events[1] = event1;
+	arch_pmu_init(event0, event1);
+	profile_reset_scopes();
+}
+
+void profile_read(struct _profile_counters* counters)
+{
+	int i;
+
+	counters->cycles = arch_cycles_read();
+	for (i = 0; i < PROFILE_EVENTS; i++)
+		counters->events[i] = arch_pmu_read_event(i, _events[i]);
+}
+
+void profile_scope_update(struct _profile_scope* scope,
+		const struct _profile_counters* start)
+{
+	struct _profile_counters now;
+	uint32_t cycles, flags;
+	int i;
+
+	profile_read(&now);
+	cycles = now.cycles - start->cycles;
+
+	flags = arch_irq_save();
+	if (scope->count == 0 && scope->next == NULL && _scopes != scope) {
+		scope->next = _scopes;
+		_scopes = scope;
+	}
+	if (scope->count == 0 || cycles < scope->min_cycles)
+		scope->min_cycles = cycles;
+	if (cycles > scope->max_cycles)
+		scope->max_cycles = cycles;
+	scope->count++;
+	scope->cycles += cycles;
+	for (i = 0; i < PROFILE_EVENTS; i++)
+		scope->events[i] += (now.events[i] - start->events[i]) &
+		                    ARCH_PMU_EVENT_MASK;
+	arch_irq_restore(flags);
+}
+
+struct _profile_scope_guard profile_scope_enter(struct _profile_scope* scope)
+{
+	struct _profile_scope_guard guard;
+
+	guard.scope = scope;
+	profile_read(&guard.start);
+	return guard;
+}
+
+void profile_scope_leave(struct _profile_scope_guard* guard)
+{
+	profile_scope_update(guard->scope, &guard->start);
+}
+
+void profile_print_scopes(void)
+{
+	struct _profile_scope* scope;
+
+	printf("%-16s %8s %10s %10s %10s %10s %10s %10s\r\n", "scope",
+	       "calls", "Kcycles", "avg", "min", "max", "ev0/call", "ev1/call");
+	for (scope = _scopes; scope; scope = scope->next) {
+		uint32_t count = scope->count ? scope->count : 1;
+		printf("%-16s %8u %10u %10u %10u %10u %10u %10u\r\n",
+		       scope->name, (unsigned)scope->count,
+		       (unsigned)(scope->cycles >> 10),
+		       (unsigned)(scope->cycles / count),
+		       (unsigned)scope->min_cycles,
+		       (unsigned)scope->max_cycles,
+		       (unsigned)(scope->events[0] / count),
+		       (unsigned)(scope->events[1] / count));
+	}
+}
+
+void profile_reset_scopes(void)
+{
+	struct _profile_scope* scope;
+	uint32_t flags = arch_irq_save();
+	int i;
+
+	/* scopes stay linked, count == 0 only means no statistics yet */
+	for (scope = _scopes; scope; scope = scope->next) {
+		scope->count = 0;
+		scope->cycles = 0;
+		scope->min_cycles = 0;
+		scope->max_cycles = 0;
+		for (i = 0; i < PROFILE_EVENTS; i++)
+			scope->events[i] = 0;
+	}
+	arch_irq_restore(flags);
+}
+
+int profile_sampling_start(Tc* tc, uint8_t channel, uint32_t freq)
+{
+	uint32_t id = get_tc_id_from_addr(tc, channel);
+	uint32_t tc_clks, rc;
+
+	if (freq == 0)
+		return -EINVAL;
+
+	profile_sampling_stop();
+
+	_sampler.tc = tc;
+	_sampler.channel = channel;
+	_sampler.id = id;
+
+	if (!pmc_is_peripheral_enabled(id))
+		pmc_configure_peripheral(id, NULL, true);
+
+	/* at least 1000 timer ticks per sample for an accurate rate */
+	tc_clks = tc_find_best_clock_source(tc, channel, freq * 1000);
+	tc_configure(tc, channel, tc_clks | TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC);
+	rc = tc_get_channel_freq(tc, channel) / freq;
+	if (rc == 0 || ((uint64_t)rc >> TC_CHANNEL_SIZE) != 0)
+		return -EINVAL;
+	tc_set_ra_rb_rc(tc, channel, NULL, NULL, &rc);
+
+	irq_add_handler(id, _profile_sample_handler, NULL);
+#if defined(CONFIG_HAVE_NVIC)
+	nvic_set_source_vector(id, _profile_sample_vector);
+#endif
+	irq_configure_priority(id, IRQ_PRIORITY_MAX);
+	irq_enable(id);
+	tc_enable_it(tc, channel, TC_IER_CPCS);
+	_sampler.running = true;
+	tc_start(tc, channel);
+
+	return 0;
+}
+
+void profile_sampling_stop(void)
+{
+	if (!_sampler.running)
+		return;
+
+	tc_stop(_sampler.tc, _sampler.channel);
+	tc_disable_it(_sampler.tc, _sampler.channel, TC_IDR_CPCS);
+	irq_disable(_sampler.id);
+	/* also restores the default vector on NVIC */
+	irq_remove_handler(_sampler.id, _profile_sample_handler);
+	_sampler.running = false;
+}
+
+void profile_sampling_clear(void)
+{
+	uint32_t flags = arch_irq_save();
+	profile_log.count = 0;
+	profile_log.dropped = 0;
+	arch_irq_restore(flags);
+}
+
+void profile_dump(void)
+{
+	console_write((const uint8_t*)&profile_log, sizeof(profile_log));
+	console_flush();
+}
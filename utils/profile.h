@@ -0,0 +1,230 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Profiling helpers based on the core performance counters.
+ *
+ * Scoped measurements record the number of calls, the cycles spent (total,
+ * minimum and maximum) and two core events for a block of code:
+ *
+ *     PROFILE_BEGIN(fft);
+ *     fft_process(...);
+ *     PROFILE_END(fft);
+ *     ...
+ *     profile_print_scopes();
+ *
+ * The events are L1 data cache refills and branch mispredictions on
+ * Cortex-A5, load/store and multi-cycle instruction stall cycles on
+ * Cortex-M7 (DWT counters, only 8 bits wide: they are only meaningful for
+ * blocks shorter than 256 events). ARM926 has no counters, only the call
+ * count is meaningful there.
+ *
+ * The sampling profiler records the program counter interrupted by a TC
+ * channel interrupt at a fixed rate. The log is sent with profile_dump()
+ * and scripts/profile_symbolize.py turns it into a per-function histogram
+ * using the ELF file of the program.
+ *
+ * Without CONFIG_PROFILE, the macros expand to nothing.
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+#include "chip.h"
+
+/*----------------------------------------------------------------------------
+ *         Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Number of events recorded besides cycles */
+#define PROFILE_EVENTS 2
+
+/** Size of the sampling log, in samples */
+#ifndef PROFILE_SAMPLE_COUNT
+#if defined(CONFIG_ARCH_ARMV7M)
+#define PROFILE_SAMPLE_COUNT 1024
+#else
+#define PROFILE_SAMPLE_COUNT 4096
+#endif
+#endif
+
+#define PROFILE_MAGIC 0x4C465250 /* "PRFL" */
+
+/*----------------------------------------------------------------------------
+ *         Type definitions
+ *----------------------------------------------------------------------------*/
+
+/** Snapshot of the counters */
+struct _profile_counters {
+	uint32_t cycles;
+	uint32_t events[PROFILE_EVENTS];
+};
+
+/** Statistics of a profiled block, linked on first update */
+struct _profile_scope {
+	const char* name;
+	uint32_t count;
+	uint64_t cycles;
+	uint32_t min_cycles;
+	uint32_t max_cycles;
+	uint64_t events[PROFILE_EVENTS];
+	struct _profile_scope* next;
+};
+
+struct _profile_scope_guard {
+	struct _profile_scope* scope;
+	struct _profile_counters start;
+};
+
+/** Sampling log layout, also parsed by the host symbolizer */
+struct _profile_log {
+	uint32_t magic;          /**< PROFILE_MAGIC */
+	uint32_t size;           /**< samples buffer size */
+	volatile uint32_t count; /**< number of samples recorded */
+	volatile uint32_t dropped; /**< samples lost because the log was full */
+	uint32_t samples[PROFILE_SAMPLE_COUNT];
+};
+
+/*----------------------------------------------------------------------------
+ *         Exported variables
+ *----------------------------------------------------------------------------*/
+
+extern struct _profile_log profile_log;
+
+/*----------------------------------------------------------------------------
+ *         Exported functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Enable the cycle counter and the default event counters.
+ */
+extern void profile_init(void);
+
+/**
+ * \brief Select the events counted, see ARCH_PMU_EVENT_* in arch/arm/pmu.h.
+ * Statistics of scopes are reset.
+ */
+extern void profile_set_events(uint32_t event0, uint32_t event1);
+
+/**
+ * \brief Take a snapshot of the counters.
+ */
+extern void profile_read(struct _profile_counters* counters);
+
+/**
+ * \brief Account the counters elapsed since start to a scope. Can be
+ * called from interrupt handlers.
+ */
+extern void profile_scope_update(struct _profile_scope* scope,
+		const struct _profile_counters* start);
+
+extern struct _profile_scope_guard profile_scope_enter(
+		struct _profile_scope* scope);
+
+extern void profile_scope_leave(struct _profile_scope_guard* guard);
+
+/**
+ * \brief Print the statistics of all scopes on the console.
+ */
+extern void profile_print_scopes(void);
+
+/**
+ * \brief Clear the statistics of all scopes.
+ */
+extern void profile_reset_scopes(void);
+
+/**
+ * \brief Start sampling the interrupted program counter.
+ *
+ * The TC channel interrupt runs at the highest priority, the code of
+ * handlers of the same priority is not sampled.
+ *
+ * \param tc    TC instance, must not be used by the system timer.
+ * \param channel TC channel.
+ * \param freq  Sampling frequency in Hz.
+ * \return 0 on success, -EINVAL if freq cannot be reached.
+ */
+extern int profile_sampling_start(Tc* tc, uint8_t channel, uint32_t freq);
+
+/**
+ * \brief Stop sampling, the log is kept.
+ */
+extern void profile_sampling_stop(void);
+
+/**
+ * \brief Clear the sampling log.
+ */
+extern void profile_sampling_clear(void);
+
+/**
+ * \brief Send the sampling log on the console. Other transports (USB CDC,
+ * debugger) can send the profile_log structure as-is.
+ */
+extern void profile_dump(void);
+
+/*----------------------------------------------------------------------------
+ *         Macros
+ *----------------------------------------------------------------------------*/
+
+#ifdef CONFIG_PROFILE
+
+#define PROFILE_BEGIN(id) \
+	static struct _profile_scope _profile_scope_##id = { .name = #id }; \
+	struct _profile_counters _profile_start_##id; \
+	profile_read(&_profile_start_##id)
+
+#define PROFILE_END(id) \
+	profile_scope_update(&_profile_scope_##id, &_profile_start_##id)
+
+#ifdef __GNUC__
+/** Profile the rest of the enclosing block */
+#define PROFILE_SCOPE(id) \
+	static struct _profile_scope _profile_scope_##id = { .name = #id }; \
+	struct _profile_scope_guard _profile_guard_##id \
+		__attribute__((cleanup(profile_scope_leave))) = \
+		profile_scope_enter(&_profile_scope_##id)
+#endif
+
+#else /* !CONFIG_PROFILE */
+
+#define PROFILE_BEGIN(id) do {} while (0)
+#define PROFILE_END(id) do {} while (0)
+#define PROFILE_SCOPE(id) do {} while (0)
+
+#endif /* !CONFIG_PROFILE */
+
+#endif /* PROFILE_H_ */
@@ -35,8 +35,13 @@
 
 #include "board.h"
 
+#include "errno.h"
 #include "rand.h"
 
+#if defined(CONFIG_HAVE_TRNG) && defined(CONFIG_HAVE_AES)
+#include "crypto/trngd.h"
+#endif
+
 /*------------------------------------------------------------------------------
  *         Global Variables
  *------------------------------------------------------------------------------*/
@@ -66,3 +71,12 @@ uint32_t rand(void)
 
 	return (uint32_t)(_rand_next / 131072) % 65536;
 }
+
+int random_bytes(void *buf, uint32_t len)
+{
+#if defined(CONFIG_HAVE_TRNG) && defined(CONFIG_HAVE_AES)
+	return trngd_get_random(buf, len);
+#else
+	return -ENOTSUP;
+#endif
+}
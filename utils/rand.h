@@ -52,4 +52,12 @@ extern void srand(uint32_t seed);
 
 extern uint32_t rand(void);
 
+/**
+ * \brief Fill a buffer with cryptographically secure random bytes.
+ * Never waits for the TRNG, see trngd_get_random().
+ * \return len on success, <0 on error (-ENOTSUP when no TRNG/AES engine is
+ * available)
+ */
+extern int random_bytes(void *buf, uint32_t len);
+
 #endif /* #ifndef _RAND_H */
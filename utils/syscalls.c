@@ -132,13 +132,10 @@ int _read(int file, char *ptr, int len)
 extern int _write(int file, char *ptr, int len);
 int _write(int file, char *ptr, int len)
 {
-	int i;
-
-	for (i = 0; i < len; i++, ptr++) {
-		console_put_char(*ptr);
-	}
-
-	return i;
+	/* bytes dropped by a full console buffer (CONSOLE_TX_DROP) are
+	 * reported as written: newlib takes a short count for an error */
+	console_write((const uint8_t*)ptr, len);
+	return len;
 }
 
 extern int _close(int file);
@@ -32,21 +32,35 @@
  *----------------------------------------------------------------------------*/
 
 #include "board.h"
+#include "cpuidle.h"
 #include "irqflags.h"
 #include "irq/irq.h"
 #include "peripherals/pmc.h"
 #include "peripherals/tc.h"
 #include "timer.h"
 
+#include <assert.h>
+
 /*----------------------------------------------------------------------------
  *         Local type definitions
  *----------------------------------------------------------------------------*/
 
+/** Fixed-point conversion factor: out = (in * mult) >> shift */
+struct _timer_conv {
+	uint32_t mult;
+	uint32_t shift;
+};
+
 struct _timer {
 	Tc* tc;
 	uint8_t channel;
 	uint32_t channel_freq;
 	volatile uint32_t upper;
+
+	struct _timer_conv to_ms;    /**< counter to milliseconds */
+	struct _timer_conv to_ns;    /**< counter to nanoseconds */
+	struct _timer_conv from_ms;  /**< milliseconds to counter */
+	struct _timer_conv from_us;  /**< microseconds to counter */
 };
 
 /*----------------------------------------------------------------------------
@@ -60,17 +74,134 @@ static struct _timer _timer;
  *         Local Functions
  *----------------------------------------------------------------------------*/
 
-static void timer_update_upper_tick_counter(void)
+/**
+ * \brief Compute the conversion factor for a to/from ratio, using the
+ * largest shift keeping mult on 32 bits for best precision.
+ */
+static void timer_init_conv(struct _timer_conv* conv, uint32_t from,
+		uint32_t to)
+{
+	uint64_t mult, next;
+	uint32_t shift;
+
+	mult = ((uint64_t)to + from / 2) / from;
+	assert(mult <= UINT32_MAX);
+
+	for (shift = 0; shift < 63; shift++) {
+		if ((((uint64_t)to << (shift + 1)) >> (shift + 1)) != to)
+			break;
+		next = (((uint64_t)to << (shift + 1)) + from / 2) / from;
+		if (next > UINT32_MAX)
+			break;
+		mult = next;
+	}
+
+	conv->mult = (uint32_t)mult;
+	conv->shift = shift;
+}
+
+/**
+ * \brief Apply a conversion factor to a 64-bit value without division and
+ * without overflowing the intermediate 96-bit product.
+ */
+static uint64_t timer_convert(const struct _timer_conv* conv, uint64_t value)
+{
+	uint64_t lo = (uint64_t)(uint32_t)value * conv->mult;
+	uint64_t hi = (value >> 32) * conv->mult;
+	uint64_t mid = (lo >> 32) + (uint32_t)hi;
+	uint64_t top = (hi >> 32) + (mid >> 32);
+
+	/* product is top:mid[31:0]:lo[31:0] */
+	mid = (top << 32) | (uint32_t)mid;
+	if (conv->shift >= 32)
+		return mid >> (conv->shift - 32);
+	else if (conv->shift == 0)
+		return (mid << 32) | (uint32_t)lo;
+	else
+		return (mid << (32 - conv->shift)) |
+		       ((uint32_t)lo >> conv->shift);
+}
+
+/**
+ * \brief Read the TC status, accounting for counter overflows.
+ * All status reads must go through this function as reading clears the
+ * flags.
+ */
+static uint32_t timer_poll_status(void)
 {
 	uint32_t status = tc_get_status(_timer.tc, _timer.channel);
 	if ((status & TC_SR_COVFS) == TC_SR_COVFS)
 		_timer.upper++;
+	return status;
+}
+
+/**
+ * \brief Get the extended 64-bit counter value.
+ */
+static uint64_t timer_get_counter(void)
+{
+	uint32_t flags, upper, lower;
+
+	flags = arch_irq_save();
+	timer_poll_status();
+	lower = tc_get_cv(_timer.tc, _timer.channel);
+	/* the counter wrapped around before or after reading it, read it again
+	 * to be consistent with the updated upper part */
+	if (timer_poll_status() & TC_SR_COVFS)
+		lower = tc_get_cv(_timer.tc, _timer.channel);
+	upper = _timer.upper;
+	arch_irq_restore(flags);
+
+	return (((uint64_t)upper) << TC_CHANNEL_SIZE) | lower;
 }
 
-static uint32_t timer_get_upper_tick_counter(void)
+/**
+ * \brief Wait until the extended counter reaches target.
+ *
+ * When the timer interrupt is available and the caller is not an interrupt
+ * handler, the TC is programmed to interrupt at the target time (RC compare)
+ * or at the next overflow, and the core sleeps in between.  Otherwise the
+ * counter is polled, with interrupts enabled.
+ */
+static void timer_wait_until(uint64_t target)
 {
-	timer_update_upper_tick_counter();
-	return _timer.upper;
+#ifndef CONFIG_TIMER_POLLING
+	uint32_t flags, rc;
+	bool compare = false;
+
+	/* handlers only see interrupts of higher priority than their own,
+	 * the TC interrupt may never wake them up */
+	if (irq_is_in_handler()) {
+		while (timer_get_counter() < target);
+		return;
+	}
+
+	while (timer_get_counter() < target) {
+		/* interrupts are masked from the wake-up setup to the sleep so
+		 * that the wake-up interrupt cannot be handled in between */
+		flags = arch_irq_save();
+		if (!compare && (target >> TC_CHANNEL_SIZE) == _timer.upper) {
+			/* RC only holds the low TC_CHANNEL_SIZE bits */
+			rc = (uint32_t)(target &
+					(((uint64_t)1 << TC_CHANNEL_SIZE) - 1));
+			tc_set_ra_rb_rc(_timer.tc, _timer.channel, NULL, NULL, &rc);
+			tc_enable_it(_timer.tc, _timer.channel, TC_IER_CPCS);
+			compare = true;
+		}
+
+		/* WFI wakes up on pending interrupts even when they are masked,
+		 * they are handled once interrupts are restored.  Check again
+		 * in case RC was written after the counter passed it. */
+		if (timer_get_counter() < target)
+			cpu_idle();
+		arch_irq_restore(flags);
+	}
+
+	if (compare)
+		tc_disable_it(_timer.tc, _timer.channel, TC_IDR_CPCS);
+#else
+	while (timer_get_counter() < target);
+#endif
 }
 
 #ifndef CONFIG_TIMER_POLLING
@@ -80,7 +211,7 @@ static uint32_t timer_get_upper_tick_counter(void)
  */
 static void timer_irq_handler(uint32_t source, void* user_arg)
 {
-	timer_update_upper_tick_counter();
+	timer_poll_status();
 }
 
 #endif /* !CONFIG_TIMER_POLLING */
@@ -102,6 +233,12 @@ void timer_configure(Tc* tc, uint8_t channel, uint32_t clock_source)
 	tc_configure(tc, channel, TC_CMR_WAVE | TC_CMR_WAVSEL_UP |
 			(clock_source & TC_CMR_TCCLKS_Msk));
 	_timer.channel_freq = tc_get_channel_freq(tc, channel);
+
+	timer_init_conv(&_timer.to_ms, _timer.channel_freq, 1000);
+	timer_init_conv(&_timer.to_ns, _timer.channel_freq, 1000000000);
+	timer_init_conv(&_timer.from_ms, 1000, _timer.channel_freq);
+	timer_init_conv(&_timer.from_us, 1000000, _timer.channel_freq);
+
 #ifndef CONFIG_TIMER_POLLING
 	irq_add_handler(tc_id, timer_irq_handler, &_timer);
 	irq_enable(tc_id);
@@ -135,24 +272,19 @@ uint8_t timer_timeout_reached(struct _timeout* timeout)
 
 void timer_sleep(uint64_t count)
 {
-	uint64_t end_tick = timer_get_tick() + count;
-
-	while (timer_get_tick() <= end_tick);
+	/* one extra period to wait at least count */
+	timer_wait_until(timer_get_counter() +
+			 timer_convert(&_timer.from_ms, count) + 1);
 }
 
 uint64_t timer_get_tick(void)
 {
-	uint32_t upper, lower;
-	uint64_t tick;
-
-	do {
-		upper = timer_get_upper_tick_counter();
-		COMPILER_BARRIER();
-		lower = tc_get_cv(_timer.tc, _timer.channel);
-	} while (upper != timer_get_upper_tick_counter());
+	return timer_convert(&_timer.to_ms, timer_get_counter());
+}
 
-	tick = (((uint64_t)upper) << TC_CHANNEL_SIZE) | lower;
-	return (tick * 1000) / _timer.channel_freq;
+uint64_t timer_get_ns(void)
+{
+	return timer_convert(&_timer.to_ns, timer_get_counter());
 }
 
 void sleep(uint32_t count)
@@ -167,27 +299,6 @@ void msleep(uint32_t count)
 
 void usleep(uint32_t count)
 {
-	uint32_t rc;
-	uint32_t status;
-
-	if (count < 2)
-		count = 2;
-
-	/* Disable interrupts */
-	arch_irq_disable();
-
-	/* Configure RC */
-	rc = ROUND_INT_DIV((_timer.channel_freq / 1000) * count, 1000);
-	rc += tc_get_cv(_timer.tc, _timer.channel);
-	tc_set_ra_rb_rc(_timer.tc, _timer.channel, 0, 0, &rc);
-
-	/* Wait for RC compare */
-	do {
-		status = tc_get_status(_timer.tc, _timer.channel);
-		if (status & TC_SR_COVFS)
-			_timer.upper++;
-	} while ((status & TC_SR_CPCS) == 0);
-
-	/* Re-enable interrupts */
-	arch_irq_enable();
+	timer_wait_until(timer_get_counter() +
+			 timer_convert(&_timer.from_us, count) + 1);
 }
@@ -68,11 +68,12 @@ struct _timeout
 extern void timer_configure(Tc* tc, uint8_t channel, uint32_t clock_source);
 
 /**
- * \brief Wait for count times the timer resolution
+ * \brief Wait for at least count milliseconds
  *
- * If interrupts are enabled, the waiting loop will use WFI instructions to put
- * the core to sleep between timer ticks.  Otherwise, if polling is enabled, a
- * busy-loop is used to poll the TC counter value.
+ * If interrupts are enabled, the TC is programmed to interrupt at the end of
+ * the wait and the core sleeps (WFI) until then.  Otherwise, if polling is
+ * enabled or when called from an interrupt handler, a busy-loop is used to
+ * poll the TC counter value.
  */
 extern void timer_sleep(uint64_t count);
 
@@ -101,10 +102,16 @@ extern uint8_t timer_timeout_reached(struct _timeout* timeout);
 extern uint64_t timer_get_interval(uint64_t start, uint64_t end);
 
 /**
- * \brief Returns the current number of ticks
+ * \brief Returns the current number of ticks (milliseconds)
  */
 extern uint64_t timer_get_tick(void);
 
+/**
+ * \brief Returns the time elapsed since timer_configure(), in nanoseconds,
+ * with the resolution of the TC channel clock
+ */
+extern uint64_t timer_get_ns(void);
+
 /**
  *  \brief Wait for at least count seconds.
  */
@@ -118,12 +125,8 @@ extern void msleep(uint32_t count);
 /**
  *  \brief Wait for at least count microseconds
  *
- * Notes:
- * - interrupts are disabled during the wait
- * - if count is <2, it is assumed to be 2
- * - maximum wait interval depends on the effective TC frequency and the TC
- * channel resolution (it is expected that this function is called with
- * count<1000)
+ * Same as timer_sleep(), the core sleeps until the end of the wait unless
+ * called from an interrupt handler or with CONFIG_TIMER_POLLING.
  */
 extern void usleep(uint32_t count);
 
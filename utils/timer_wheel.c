@@ -0,0 +1,457 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include "board.h"
+#include "callback.h"
+#include "irqflags.h"
+#include "irq/irq.h"
+#include "peripherals/pmc.h"
+#include "peripherals/tc.h"
+#include "timer.h"
+#include "timer_wheel.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define WHEEL_LEVELS     4
+#define WHEEL_SLOT_BITS  6
+#define WHEEL_SLOTS      (1 << WHEEL_SLOT_BITS)
+#define WHEEL_SLOT_MASK  (WHEEL_SLOTS - 1)
+
+/** Largest delay the wheel can hold, longer timers are cascaded again */
+#define WHEEL_MAX_DELTA  ((1ull << (WHEEL_LEVELS * WHEEL_SLOT_BITS)) - 1)
+
+/** Pseudo-level of timers in the deferred queue */
+#define WHEEL_DEFERRED_LEVEL  0xff
+
+#define WHEEL_NO_DEADLINE  UINT64_MAX
+
+/*----------------------------------------------------------------------------
+ *         Local type definitions
+ *----------------------------------------------------------------------------*/
+
+struct _timer_wheel {
+	Tc* tc;
+	uint8_t channel;
+	uint32_t channel_freq;
+	uint64_t alarm;
+
+	/** next tick to process */
+	uint64_t jiffies;
+	struct _wheel_timer* slots[WHEEL_LEVELS][WHEEL_SLOTS];
+	uint64_t bitmap[WHEEL_LEVELS];
+
+	struct _wheel_timer* deferred;
+	struct _wheel_timer** deferred_tail;
+
+	bool expiring;
+	bool rerun;
+
+	uint32_t armed;
+	uint32_t max_armed;
+	uint32_t expired;
+	uint32_t alarms;
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static struct _timer_wheel _wheel = {
+	.alarm = WHEEL_NO_DEADLINE,
+	.deferred_tail = &_wheel.deferred,
+};
+
+/*----------------------------------------------------------------------------
+ *         Local Functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Distance from start to the first set bit of a slot bitmap, wrapping
+ * around.  bitmap must not be 0.
+ */
+static uint32_t _wheel_first_slot(uint64_t bitmap, uint32_t start)
+{
+	if (start)
+		bitmap = (bitmap >> start) | (bitmap << (WHEEL_SLOTS - start));
+	return __builtin_ctzll(bitmap);
+}
+
+static void _wheel_link(struct _wheel_timer** head, struct _wheel_timer* timer)
+{
+	timer->next = *head;
+	if (timer->next)
+		timer->next->pprev = &timer->next;
+	timer->pprev = head;
+	*head = timer;
+}
+
+static void _wheel_unlink(struct _wheel_timer* timer)
+{
+	*timer->pprev = timer->next;
+	if (timer->next)
+		timer->next->pprev = timer->pprev;
+	else if (timer->level == WHEEL_DEFERRED_LEVEL)
+		_wheel.deferred_tail = timer->pprev;
+
+	if (timer->level < WHEEL_LEVELS &&
+	    !_wheel.slots[timer->level][timer->slot])
+		_wheel.bitmap[timer->level] &= ~(1ull << timer->slot);
+
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+/**
+ * \brief Insert a timer in the wheel level matching its remaining delay.
+ */
+static void _wheel_insert(struct _wheel_timer* timer)
+{
+	uint64_t expires = timer->expires;
+	uint64_t delta;
+	uint8_t level;
+
+	if (expires < _wheel.jiffies)
+		expires = _wheel.jiffies;
+	delta = expires - _wheel.jiffies;
+	if (delta > WHEEL_MAX_DELTA)
+		expires = _wheel.jiffies + WHEEL_MAX_DELTA;
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		if (delta < (1ull << ((level + 1) * WHEEL_SLOT_BITS)))
+			break;
+
+	timer->level = level;
+	timer->slot = (expires >> (level * WHEEL_SLOT_BITS)) & WHEEL_SLOT_MASK;
+	_wheel_link(&_wheel.slots[level][timer->slot], timer);
+	_wheel.bitmap[level] |= 1ull << timer->slot;
+}
+
+static void _wheel_queue_deferred(struct _wheel_timer* timer)
+{
+	timer->level = WHEEL_DEFERRED_LEVEL;
+	timer->next = NULL;
+	timer->pprev = _wheel.deferred_tail;
+	*_wheel.deferred_tail = timer;
+	_wheel.deferred_tail = &timer->next;
+}
+
+/**
+ * \brief Move the timers of the upper level slots reached by jiffies down
+ * the wheel.  Called when the level 0 index wraps around.
+ */
+static void _wheel_cascade(void)
+{
+	struct _wheel_timer* list;
+	struct _wheel_timer* timer;
+	uint32_t level, index;
+
+	for (level = 1; level < WHEEL_LEVELS; level++) {
+		index = (_wheel.jiffies >> (level * WHEEL_SLOT_BITS)) &
+			WHEEL_SLOT_MASK;
+
+		list = _wheel.slots[level][index];
+		_wheel.slots[level][index] = NULL;
+		_wheel.bitmap[level] &= ~(1ull << index);
+		while (list) {
+			timer = list;
+			list = timer->next;
+			_wheel_insert(timer);
+		}
+
+		if (index)
+			break;
+	}
+}
+
+/**
+ * \brief Compute the tick at which the wheel must be processed next: first
+ * occupied level 0 slot, or next cascade of an occupied upper level slot.
+ */
+static uint64_t _wheel_next_deadline(void)
+{
+	uint64_t deadline = WHEEL_NO_DEADLINE;
+	uint64_t base, time;
+	uint32_t level, shift;
+
+	for (level = 0; level < WHEEL_LEVELS; level++) {
+		if (!_wheel.bitmap[level])
+			continue;
+		/* first slot boundary not processed yet */
+		shift = level * WHEEL_SLOT_BITS;
+		base = _wheel.jiffies >> shift;
+		if (_wheel.jiffies & ((1ull << shift) - 1))
+			base++;
+		time = (base + _wheel_first_slot(_wheel.bitmap[level],
+				base & WHEEL_SLOT_MASK)) << shift;
+		if (time < deadline)
+			deadline = time;
+	}
+
+	return deadline;
+}
+
+/**
+ * \brief Program the one-shot TC compare for the next deadline.
+ * Must be called with interrupts disabled.
+ */
+static void _wheel_program_alarm(void)
+{
+	uint64_t deadline, now, counts;
+	uint32_t rc;
+
+	if (!_wheel.tc || _wheel.expiring)
+		return;
+
+	deadline = _wheel_next_deadline();
+	if (deadline == _wheel.alarm)
+		return;
+	_wheel.alarm = deadline;
+	if (deadline == WHEEL_NO_DEADLINE)
+		return;
+
+	now = timer_get_tick();
+	counts = 2;
+	if (deadline > now)
+		counts += ROUND_INT_DIV((deadline - now) * _wheel.channel_freq,
+				       1000);
+	if (counts >= (1ull << TC_CHANNEL_SIZE))
+		counts = (1ull << TC_CHANNEL_SIZE) - 1;
+
+	rc = (uint32_t)counts;
+	tc_set_ra_rb_rc(_wheel.tc, _wheel.channel, NULL, NULL, &rc);
+	tc_start(_wheel.tc, _wheel.channel);
+}
+
+/**
+ * \brief Expire all timers due up to the current tick.
+ * Nested calls (from the TC interrupt while a callback runs) only flag the
+ * running instance to loop again.
+ */
+static void _wheel_expire(void)
+{
+	struct _wheel_timer* timer;
+	uint64_t now, next;
+	uint32_t flags, index;
+
+	flags = arch_irq_save();
+	if (_wheel.expiring) {
+		_wheel.rerun = true;
+		arch_irq_restore(flags);
+		return;
+	}
+	_wheel.expiring = true;
+
+	do {
+		_wheel.rerun = false;
+		now = timer_get_tick();
+
+		while (_wheel.jiffies <= now) {
+			index = _wheel.jiffies & WHEEL_SLOT_MASK;
+			if (index == 0)
+				_wheel_cascade();
+
+			while ((timer = _wheel.slots[0][index]) != NULL) {
+				_wheel_unlink(timer);
+				_wheel.expired++;
+
+				if (timer->flags & TIMER_WHEEL_DEFERRED) {
+					_wheel_queue_deferred(timer);
+					continue;
+				}
+
+				if (timer->period) {
+					timer->expires += timer->period;
+					_wheel_insert(timer);
+				} else {
+					_wheel.armed--;
+				}
+
+				arch_irq_restore(flags);
+				callback_call(&timer->callback);
+				flags = arch_irq_save();
+			}
+
+			/* skip empty slots up to the next cascade */
+			next = _wheel.jiffies + 1;
+			if (!(_wheel.bitmap[0] >> index))
+				next = (_wheel.jiffies | WHEEL_SLOT_MASK) + 1;
+			_wheel.jiffies = next < now + 1 ? next : now + 1;
+		}
+	} while (_wheel.rerun);
+
+	_wheel.expiring = false;
+	_wheel_program_alarm();
+	arch_irq_restore(flags);
+}
+
+static void _wheel_irq_handler(uint32_t source, void* user_arg)
+{
+	uint32_t status = tc_get_status(_wheel.tc, _wheel.channel);
+
+	if (status & TC_SR_CPCS) {
+		/* the one-shot compare stopped the channel */
+		_wheel.alarms++;
+		_wheel.alarm = WHEEL_NO_DEADLINE;
+		_wheel_expire();
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *         Exported Functions
+ *----------------------------------------------------------------------------*/
+
+int timer_wheel_configure(Tc* tc, uint8_t channel, uint32_t clock_source)
+{
+	uint32_t tc_id, flags;
+
+	/* armed timers are linked in the wheel */
+	flags = arch_irq_save();
+	if (_wheel.armed) {
+		arch_irq_restore(flags);
+		return -EBUSY;
+	}
+	memset(&_wheel, 0, sizeof(_wheel));
+	_wheel.deferred_tail = &_wheel.deferred;
+	_wheel.jiffies = timer_get_tick();
+	_wheel.alarm = WHEEL_NO_DEADLINE;
+	arch_irq_restore(flags);
+
+	if (!tc)
+		return 0;
+
+	tc_id = get_tc_id_from_addr(tc, channel);
+	_wheel.tc = tc;
+	_wheel.channel = channel;
+
+	if (!pmc_is_peripheral_enabled(tc_id))
+		pmc_configure_peripheral(tc_id, NULL, true);
+
+	tc_configure(tc, channel, TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC |
+			TC_CMR_CPCSTOP | (clock_source & TC_CMR_TCCLKS_Msk));
+	_wheel.channel_freq = tc_get_channel_freq(tc, channel);
+
+	irq_add_handler(tc_id, _wheel_irq_handler, NULL);
+	irq_enable(tc_id);
+	tc_enable_it(tc, channel, TC_IER_CPCS);
+
+	return 0;
+}
+
+void timer_wheel_init_timer(struct _wheel_timer* timer, struct _callback* cb,
+		uint8_t flags)
+{
+	memset(timer, 0, sizeof(*timer));
+	callback_copy(&timer->callback, cb);
+	timer->flags = flags;
+}
+
+void timer_wheel_add(struct _wheel_timer* timer, uint32_t delay,
+		uint32_t period)
+{
+	uint32_t flags;
+
+	flags = arch_irq_save();
+	if (timer->pprev)
+		_wheel_unlink(timer);
+	else if (++_wheel.armed > _wheel.max_armed)
+		_wheel.max_armed = _wheel.armed;
+
+	/* empty wheel: skip the idle time instead of catching up later */
+	if (!_wheel.expiring && !(_wheel.bitmap[0] | _wheel.bitmap[1] |
+				  _wheel.bitmap[2] | _wheel.bitmap[3]))
+		_wheel.jiffies = timer_get_tick();
+
+	timer->expires = timer_get_tick() + delay;
+	timer->period = period;
+	_wheel_insert(timer);
+	_wheel_program_alarm();
+	arch_irq_restore(flags);
+}
+
+void timer_wheel_cancel(struct _wheel_timer* timer)
+{
+	uint32_t flags;
+
+	flags = arch_irq_save();
+	if (timer->pprev) {
+		_wheel_unlink(timer);
+		_wheel.armed--;
+	}
+	timer->period = 0;
+	arch_irq_restore(flags);
+}
+
+bool timer_wheel_is_pending(struct _wheel_timer* timer)
+{
+	return timer->pprev != NULL;
+}
+
+void timer_wheel_process(void)
+{
+	struct _wheel_timer* timer;
+	uint32_t flags;
+
+	_wheel_expire();
+
+	flags = arch_irq_save();
+	while ((timer = _wheel.deferred) != NULL) {
+		_wheel_unlink(timer);
+		if (timer->period) {
+			timer->expires += timer->period;
+			_wheel_insert(timer);
+			_wheel_program_alarm();
+		} else {
+			_wheel.armed--;
+		}
+
+		arch_irq_restore(flags);
+		callback_call(&timer->callback);
+		flags = arch_irq_save();
+	}
+	arch_irq_restore(flags);
+}
+
+void timer_wheel_get_stats(struct _timer_wheel_stats* stats)
+{
+	stats->armed = _wheel.armed;
+	stats->max_armed = _wheel.max_armed;
+	stats->expired = _wheel.expired;
+	stats->alarms = _wheel.alarms;
+}
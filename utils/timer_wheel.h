@@ -0,0 +1,147 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2016, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Hierarchical timer wheel.
+ *
+ * Software timers with millisecond resolution (timer_get_tick()) are kept in
+ * a 4-level wheel of 64 slots per level, so that adding and cancelling a
+ * timer are O(1) operations whatever the number of armed timers.
+ *
+ * When configured with a TC channel, the wheel programs a one-shot RC compare
+ * for the next deadline only, and expires timers from the TC interrupt.
+ * Timers created with TIMER_WHEEL_DEFERRED have their callback queued instead,
+ * and run from timer_wheel_process() in thread context (e.g. for lwIP which is
+ * not reentrant).  Without TC channel, timer_wheel_process() also expires the
+ * timers and must be called periodically; this is the default until
+ * timer_wheel_configure() is called with a TC channel.
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "board.h"
+#include "callback.h"
+
+/*----------------------------------------------------------------------------
+ *         Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Run the timer callback from timer_wheel_process() */
+#define TIMER_WHEEL_DEFERRED (1 << 0)
+
+/*----------------------------------------------------------------------------
+ *         Type definitions
+ *----------------------------------------------------------------------------*/
+
+struct _wheel_timer {
+	/* --- following fields are used internally --- */
+
+	struct _wheel_timer* next;
+	struct _wheel_timer** pprev;
+	uint64_t expires;
+	uint32_t period;
+	uint8_t flags;
+	uint8_t level;
+	uint8_t slot;
+	struct _callback callback;
+};
+
+struct _timer_wheel_stats {
+	uint32_t armed;       /**< timers currently armed or queued */
+	uint32_t max_armed;   /**< maximum of armed timers */
+	uint32_t expired;     /**< timers expired */
+	uint32_t alarms;      /**< TC interrupts */
+};
+
+/*----------------------------------------------------------------------------
+ *         Global functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Configure the timer wheel.
+ * \param tc  TC instance used for the deadline interrupt, NULL to expire
+ * timers from timer_wheel_process() only
+ * \param channel  TC channel, not shared with the system timer
+ * \param clock_source  TC clock source (TC_CMR_TCCLKS_xxx)
+ * \return 0 on success, -EBUSY if timers are pending
+ * \note The system timer (timer_configure) must be configured first.
+ */
+extern int timer_wheel_configure(Tc* tc, uint8_t channel,
+		uint32_t clock_source);
+
+/**
+ * \brief Initialize a timer.
+ * \param timer  timer to initialize
+ * \param cb  callback invoked on expiry
+ * \param flags  0 or TIMER_WHEEL_DEFERRED
+ */
+extern void timer_wheel_init_timer(struct _wheel_timer* timer,
+		struct _callback* cb, uint8_t flags);
+
+/**
+ * \brief Arm a timer, or re-arm it if already armed.
+ * \param timer  timer to arm
+ * \param delay  delay before first expiry, in milliseconds
+ * \param period  period for periodic timers, 0 for one-shot timers
+ */
+extern void timer_wheel_add(struct _wheel_timer* timer, uint32_t delay,
+		uint32_t period);
+
+/**
+ * \brief Cancel a timer, removing its deferred callback if queued.
+ */
+extern void timer_wheel_cancel(struct _wheel_timer* timer);
+
+/**
+ * \brief Tell if a timer is armed or has its deferred callback queued.
+ */
+extern bool timer_wheel_is_pending(struct _wheel_timer* timer);
+
+/**
+ * \brief Expire due timers and run queued deferred callbacks.
+ * To be called from the main loop.
+ */
+extern void timer_wheel_process(void);
+
+/**
+ * \brief Get the timer wheel statistics.
+ */
+extern void timer_wheel_get_stats(struct _timer_wheel_stats* stats);
+
+#endif /* TIMER_WHEEL_H_ */
@@ -38,9 +38,67 @@
 #include "serial/console.h"
 #include "gpio/pio.h"
 
+#ifdef CONFIG_TRACE_BINARY
+#include "irqflags.h"
+#include "timer.h"
+#endif
+
 /*------------------------------------------------------------------------------
  *         Internal variables
  *------------------------------------------------------------------------------*/
 
 /** Current trace level */
 uint32_t trace_level = TRACE_LEVEL;
+
+#ifdef CONFIG_TRACE_BINARY
+
+#if (TRACE_BINARY_BUFFER_WORDS & (TRACE_BINARY_BUFFER_WORDS - 1)) != 0
+#error "TRACE_BINARY_BUFFER_WORDS must be a power of two"
+#endif
+
+/** Binary trace log */
+struct _trace_binary_log trace_binary_log = {
+	.magic = TRACE_BINARY_MAGIC,
+	.size = TRACE_BINARY_BUFFER_WORDS,
+	.head = 0,
+};
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+void trace_binary_record(uint32_t header, const uint32_t *args)
+{
+	const uint32_t mask = TRACE_BINARY_BUFFER_WORDS - 1;
+	uint32_t nargs = (header >> TRACE_BINARY_NARGS_POS) & 0xF;
+	uint64_t timestamp = timer_get_ns();
+	uint32_t flags, head, i;
+
+	flags = arch_irq_save();
+
+	head = trace_binary_log.head;
+	trace_binary_log.buffer[head++ & mask] = header;
+	trace_binary_log.buffer[head++ & mask] = (uint32_t)timestamp;
+	trace_binary_log.buffer[head++ & mask] = (uint32_t)(timestamp >> 32);
+	for (i = 0; i < nargs; i++)
+		trace_binary_log.buffer[head++ & mask] = args[i];
+	trace_binary_log.head = head;
+
+	arch_irq_restore(flags);
+}
+
+void trace_binary_dump(void)
+{
+	console_write((const uint8_t*)&trace_binary_log,
+			sizeof(trace_binary_log));
+	console_flush();
+}
+
+void trace_binary_clear(void)
+{
+	uint32_t flags = arch_irq_save();
+	trace_binary_log.head = 0;
+	arch_irq_restore(flags);
+}
+
+#endif /* CONFIG_TRACE_BINARY */
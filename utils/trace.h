@@ -67,6 +67,7 @@
  * ----------------------------------------------------------------------------*/
 
 #include "compiler.h"
+#include "serial/console.h"
 #include <stdio.h>
 #include <stdint.h>
 
@@ -93,6 +94,105 @@
 /** Trace level is modifable at runtime */
 extern uint32_t trace_level;
 
+#ifdef CONFIG_TRACE_BINARY
+
+/*
+ * Binary trace mode
+ *
+ * Instead of being formatted with printf, error/warning/info/debug traces
+ * are recorded in trace_binary_log as a header word, a 64-bit timestamp in
+ * nanoseconds and the raw arguments (one word each, so %f and %ll are not
+ * supported). The header holds the offset of the format string in the
+ * .trace_fmt section, which the linker scripts keep in the ELF file but do
+ * not load on target. scripts/trace_decode.py turns a dump of the log back
+ * into text using the ELF file.
+ */
+
+#ifndef __GNUC__
+#error "CONFIG_TRACE_BINARY requires GCC"
+#endif
+
+/** Size of the log, in 32-bit words (must be a power of two) */
+#ifndef TRACE_BINARY_BUFFER_WORDS
+#define TRACE_BINARY_BUFFER_WORDS 2048
+#endif
+
+#define TRACE_BINARY_MAGIC      0x4C425254 /* "TRBL" */
+
+#define TRACE_BINARY_SYNC       (0xAu << 28)
+#define TRACE_BINARY_LEVEL_POS  25
+#define TRACE_BINARY_NARGS_POS  21
+#define TRACE_BINARY_ID_MASK    0x1FFFFF
+
+/** Log layout, also parsed by the host decoder */
+struct _trace_binary_log {
+	uint32_t magic;          /**< TRACE_BINARY_MAGIC */
+	uint32_t size;           /**< buffer size in words */
+	volatile uint32_t head;  /**< total number of words written */
+	uint32_t buffer[TRACE_BINARY_BUFFER_WORDS];
+};
+
+extern struct _trace_binary_log trace_binary_log;
+
+/**
+ * \brief Append a record to the binary log. Can be called from interrupt
+ * handlers.
+ * \param header  Record header built by the trace macros.
+ * \param args    Arguments, count is given by the header.
+ */
+extern void trace_binary_record(uint32_t header, const uint32_t *args);
+
+/**
+ * \brief Send the whole binary log on the console. Other transports (USB
+ * CDC, debugger) can send the trace_binary_log structure as-is.
+ */
+extern void trace_binary_dump(void);
+
+/**
+ * \brief Discard all records from the binary log.
+ */
+extern void trace_binary_clear(void);
+
+#define _TRACE_NARGS(...) \
+	_TRACE_NARGS_(__VA_ARGS__, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define _TRACE_NARGS_(_f, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, n, ...) n
+#define _TRACE_FMT(fmt, ...) fmt
+#define _TRACE_CAT(a, b) _TRACE_CAT_(a, b)
+#define _TRACE_CAT_(a, b) a##b
+
+/* Expand each argument following the format to a word, with a trailing comma */
+#define _TRACE_ARG(a) (uint32_t)(a),
+#define _TRACE_ARGS_0(f)
+#define _TRACE_ARGS_1(f, a) _TRACE_ARG(a)
+#define _TRACE_ARGS_2(f, a, ...) _TRACE_ARG(a) _TRACE_ARGS_1(f, __VA_ARGS__)
+#define _TRACE_ARGS_3(f, a, ...) _TRACE_ARG(a) _TRACE_ARGS_2(f, __VA_ARGS__)
+#define _TRACE_ARGS_4(f, a, ...) _TRACE_ARG(a) _TRACE_ARGS_3(f, __VA_ARGS__)
+#define _TRACE_ARGS_5(f, a, ...) _TRACE_ARG(a) _TRACE_ARGS_4(f, __VA_ARGS__)
+#define _TRACE_ARGS_6(f, a, ...) _TRACE_ARG(a) _TRACE_ARGS_5(f, __VA_ARGS__)
+#define _TRACE_ARGS_7(f, a, ...) _TRACE_ARG(a) _TRACE_ARGS_6(f, __VA_ARGS__)
+#define _TRACE_ARGS_8(f, a, ...) _TRACE_ARG(a) _TRACE_ARGS_7(f, __VA_ARGS__)
+#define _TRACE_ARGS_9(f, a, ...) _TRACE_ARG(a) _TRACE_ARGS_8(f, __VA_ARGS__)
+#define _TRACE_ARGS_10(f, a, ...) _TRACE_ARG(a) _TRACE_ARGS_9(f, __VA_ARGS__)
+#define _TRACE_ARGS_11(f, a, ...) _TRACE_ARG(a) _TRACE_ARGS_10(f, __VA_ARGS__)
+#define _TRACE_ARGS_12(f, a, ...) _TRACE_ARG(a) _TRACE_ARGS_11(f, __VA_ARGS__)
+
+#define _trace_binary(level, prefix, ...) \
+	do { \
+		if (trace_level >= (level)) { \
+			static const char _trace_fmt[] SECTION(".trace_fmt") USED = \
+				prefix _TRACE_FMT(__VA_ARGS__, 0); \
+			const uint32_t _trace_args[] = { \
+				_TRACE_CAT(_TRACE_ARGS_, _TRACE_NARGS(__VA_ARGS__))(__VA_ARGS__) 0 }; \
+			trace_binary_record(TRACE_BINARY_SYNC | \
+				((level) << TRACE_BINARY_LEVEL_POS) | \
+				(_TRACE_NARGS(__VA_ARGS__) << TRACE_BINARY_NARGS_POS) | \
+				((uint32_t)_trace_fmt & TRACE_BINARY_ID_MASK), \
+				_trace_args); \
+		} \
+	} while (0)
+
+#endif /* CONFIG_TRACE_BINARY */
+
 /* ------------------------------------------------------------------------------
  *         Exported functions
  * ----------------------------------------------------------------------------*/
@@ -103,11 +203,19 @@ extern uint32_t trace_level;
  *  \param ...  Additional parameters depending on formatted string.
  */
 
+#ifdef CONFIG_TRACE_BINARY
+#define _trace_emit(level, prefix, ...) \
+	_trace_binary(level, prefix, __VA_ARGS__)
+#else
+#define _trace_emit(level, prefix, ...) \
+	do { if (trace_level >= (level)) printf(prefix __VA_ARGS__); } while (0)
+#endif
+
 #if (TRACE_LEVEL >= 1)
 #define trace_fatal(...) \
-	do { if (trace_level >= TRACE_LEVEL_FATAL) printf("-F- " __VA_ARGS__); while (1) ; } while (0)
+	do { if (trace_level >= TRACE_LEVEL_FATAL) printf("-F- " __VA_ARGS__); console_flush(); while (1) ; } while (0)
 #define trace_fatal_wp(...) \
-	do { if (trace_level >= TRACE_LEVEL_FATAL) printf(__VA_ARGS__); while (1) ; } while (0)
+	do { if (trace_level >= TRACE_LEVEL_FATAL) printf(__VA_ARGS__); console_flush(); while (1) ; } while (0)
 #else
 #define trace_fatal(...) \
 	do {} while (1)
@@ -117,9 +225,9 @@ extern uint32_t trace_level;
 
 #if (TRACE_LEVEL >= 2)
 #define trace_error(...) \
-	do { if (trace_level >= TRACE_LEVEL_ERROR) printf("-E- " __VA_ARGS__); } while (0)
+	_trace_emit(TRACE_LEVEL_ERROR, "-E- ", __VA_ARGS__)
 #define trace_error_wp(...) \
-	do { if (trace_level >= TRACE_LEVEL_ERROR) printf(__VA_ARGS__); } while (0)
+	_trace_emit(TRACE_LEVEL_ERROR, "", __VA_ARGS__)
 #else
 #define trace_error(...) ((void)0)
 #define trace_error_wp(...) ((void)0)
@@ -127,9 +235,9 @@ extern uint32_t trace_level;
 
 #if (TRACE_LEVEL >= 3)
 #define trace_warning(...) \
-	do { if (trace_level >= TRACE_LEVEL_WARNING) printf("-W- " __VA_ARGS__); } while (0)
+	_trace_emit(TRACE_LEVEL_WARNING, "-W- ", __VA_ARGS__)
 #define trace_warning_wp(...) \
-	do { if (trace_level >= TRACE_LEVEL_WARNING) printf(__VA_ARGS__); } while (0)
+	_trace_emit(TRACE_LEVEL_WARNING, "", __VA_ARGS__)
 #else
 #define trace_warning(...) ((void)0)
 #define trace_warning_wp(...) ((void)0)
@@ -137,9 +245,9 @@ extern uint32_t trace_level;
 
 #if (TRACE_LEVEL >= 4)
 #define trace_info(...) \
-	do { if (trace_level >= TRACE_LEVEL_INFO) printf("-I- " __VA_ARGS__); } while (0)
+	_trace_emit(TRACE_LEVEL_INFO, "-I- ", __VA_ARGS__)
 #define trace_info_wp(...) \
-	do { if (trace_level >= TRACE_LEVEL_INFO) printf(__VA_ARGS__); } while (0)
+	_trace_emit(TRACE_LEVEL_INFO, "", __VA_ARGS__)
 #else
 #define trace_info(...) ((void)0)
 #define trace_info_wp(...) ((void)0)
@@ -147,9 +255,9 @@ extern uint32_t trace_level;
 
 #if (TRACE_LEVEL >= 5)
 #define trace_debug(...) \
-	do { if (trace_level >= TRACE_LEVEL_DEBUG) printf("-D- " __FILE__ ":" STRINGIFY(__LINE__) " " __VA_ARGS__); } while (0)
+	_trace_emit(TRACE_LEVEL_DEBUG, "-D- " __FILE__ ":" STRINGIFY(__LINE__) " ", __VA_ARGS__)
 #define trace_debug_wp(...) \
-	do { if (trace_level >= TRACE_LEVEL_DEBUG) printf(__VA_ARGS__); } while (0)
+	_trace_emit(TRACE_LEVEL_DEBUG, "", __VA_ARGS__)
 #else
 #define trace_debug(...) ((void)0)
 #define trace_debug_wp(...) ((void)0)